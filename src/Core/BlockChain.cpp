@@ -3,13 +3,18 @@
 
 #include "BlockChain.hpp"
 
+#include <atomic>
 #include <boost/lexical_cast.hpp>
 #include <chrono>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include "VarNoteTools.hpp"
 #include "DifficultyCheck.hpp"
 #include "TransactionExtra.hpp"
+#include "common/Metrics.hpp"
 #include "common/StringTools.hpp"
+#include "common/Trace.hpp"
 #include "common/Varint.hpp"
 #include "rpc_api.hpp"
 #include "seria/BinaryInputStream.hpp"
@@ -21,7 +26,7 @@ using namespace platform;
 static const std::string previous_versions[] = {"B"};  // most recent previous version should be first in list
                                                        // 1 -> 2 we fix difficulty for consensus
 static const std::string version_1            = "1";
-const std::string BlockChain::version_current = "3";
+const std::string BlockChain::version_current = "5";
 // We increment when making incompatible changes to indices.
 
 // We use suffixes so all keys related to the same block are close to each other
@@ -33,12 +38,52 @@ static const std::string HEADER_SUFFIX          = "h";
 static const std::string TRANSATION_PREFIX      = "t";
 static const size_t TRANSACTION_PREFIX_BYTES    = 5;  // We store only first bytes of tx hash in index
 static const std::string TIP_CHAIN_PREFIX       = "c";
-static const std::string TIMESTAMP_BLOCK_PREFIX = "T";
+static const std::string TIMESTAMP_BLOCK_PREFIX = "T";  // Only in versions before 4, timestamps are in chain
 
 static const std::string CHILDREN_PREFIX = "x-ch/";
 static const std::string CD_TIPS_PREFIX  = "x-tips/";
 // We store bid->children counter, with counter=1 default (absent from index)
 // We store cumulative_difficulty->bid for bids with no children
+// Both are mirrored in memory and written on db_commit
+
+static const std::string CHECK_CONSENSUS_FAST_PROGRESS = "$check_consensus_fast";
+// bid of last block checked by check_consensus_fast, so interrupted check continues from there
+
+static DB::Key block_key(const Hash &bid) {
+	DB::Key key(BLOCK_PREFIX);
+	key.append_pod(bid).append(BLOCK_SUFFIX);
+	return key;
+}
+
+static DB::Key header_key(const Hash &bid) {
+	DB::Key key(HEADER_PREFIX);
+	key.append_pod(bid).append(HEADER_SUFFIX);
+	return key;
+}
+
+static DB::Key transaction_key(const Hash &tid, Height height, size_t index_in_block) {
+	DB::Key key(TRANSATION_PREFIX);
+	key.append(tid.data, TRANSACTION_PREFIX_BYTES).append_varint_sqlite4(height).append_varint_sqlite4(index_in_block);
+	return key;
+}
+
+static DB::Key chain_key(const std::string &version, Height height) {
+	DB::Key key(TIP_CHAIN_PREFIX);
+	key.append(version).append("/", 1).append_varint_sqlite4(height);
+	return key;
+}
+
+static DB::Key children_key(const Hash &bid) {
+	DB::Key key(CHILDREN_PREFIX);
+	key.append_pod(bid);
+	return key;
+}
+
+static DB::Key cd_tip_key(Difficulty cd, const Hash &bid) {
+	DB::Key key(CD_TIPS_PREFIX);
+	key.append_varint_sqlite4(cd).append_pod(bid);
+	return key;
+}
 
 static const size_t HEADER_CACHE_MAX_SIZE          = 100000;  // when lots of read_header called without commit
 static const std::string delete_blockchain_message = "database corrupted, please delete ";
@@ -77,6 +122,7 @@ bool Block::to_raw_block(RawBlock &raw_block) const {
 }
 
 PreparedBlock::PreparedBlock(BinaryArray &&ba, crypto::CryptoNightContext *context) : block_data(std::move(ba)) {
+	COMMON_TRACE_SPAN("PreparedBlock(block_data)");
 	seria::from_binary(raw_block, block_data);
 	if (block.from_raw_block(raw_block))
 		bid = varcoin::get_block_hash(block.header);
@@ -89,6 +135,7 @@ PreparedBlock::PreparedBlock(BinaryArray &&ba, crypto::CryptoNightContext *conte
 }
 
 PreparedBlock::PreparedBlock(RawBlock &&rba, crypto::CryptoNightContext *context) : raw_block(rba) {
+	COMMON_TRACE_SPAN("PreparedBlock(raw_block)");
 	block_data = seria::to_binary(raw_block);
 	if (block.from_raw_block(raw_block))
 		bid = varcoin::get_block_hash(block.header);
@@ -117,7 +164,7 @@ BlockChain::BlockChain(const Hash &genesis_bid, const std::string &coin_folder,
 		std::set<Hash> main_chain_bids;
 		for (Height ha = 1;; ha += 1) {
 			BinaryArray ba;
-			if (!m_db.get(TIP_CHAIN_PREFIX + previous_versions[0] + "/" + common::write_varint_sqlite4(ha), ba))
+			if (!m_db.get(chain_key(previous_versions[0], ha), ba))
 				break;
 			Hash bid;
 			seria::from_binary(bid, ba);
@@ -153,12 +200,10 @@ BlockChain::BlockChain(const Hash &genesis_bid, const std::string &coin_folder,
 		std::cout << "Deleted " << erased << " records, skipped " << skipped << " records" << std::endl;
 		db_commit();
 	}
-	Hash stored_genesis_bid;
-	if (read_chain(0, &stored_genesis_bid)) {
-		if (stored_genesis_bid != genesis_bid)
-			throw std::runtime_error("Database starts with different genesis_block");
-		read_tip();
-	}
+	read_tip();
+	if (!m_chain.empty() && m_chain.front() != genesis_bid)
+		throw std::runtime_error("Database starts with different genesis_block");
+	read_block_tree();
 	DB::Cursor cur2 = m_db.rbegin(TIP_CHAIN_PREFIX + previous_versions[0] + "/");
 	m_internal_import_known_height =
 	    cur2.end() ? 0 : boost::lexical_cast<Height>(common::read_varint_sqlite4(cur2.get_suffix()));
@@ -166,14 +211,20 @@ BlockChain::BlockChain(const Hash &genesis_bid, const std::string &coin_folder,
 }
 
 void BlockChain::db_commit() {
+	COMMON_TRACE_SPAN("db_commit");
 	std::cout << "BlockChain::db_commit started... tip_height=" << m_tip_height
 	          << " header_cache.size=" << header_cache.size() << std::endl;
+	on_db_commit();
+	write_block_tree();
 	m_db.commit_db_txn();
 	header_cache.clear();  // Most simple cache policy ever
 	std::cout << "BlockChain::db_commit finished..." << std::endl;
 }
 
 BroadcastAction BlockChain::add_block(const PreparedBlock &pb, api::BlockHeader *info) {
+	static auto &add_block_histogram = common::metrics::histogram("varcoind_add_block_seconds");
+	common::metrics::ScopedTimer timer(add_block_histogram);
+	COMMON_TRACE_SPAN("add_block");
 	*info             = api::BlockHeader();
 	bool have_header = read_header(pb.bid, info);
 	bool have_block  = has_block(pb.bid);
@@ -193,10 +244,7 @@ BroadcastAction BlockChain::add_block(const PreparedBlock &pb, api::BlockHeader
 	info->height              = prev_info.height + 1;
 	// Rest fields are filled by check_standalone_consensus
 	std::string check_error = check_standalone_consensus(pb, info, prev_info, true);
-	Hash first_difficulty_check_hash;
-	if (!common::pod_from_hex(difficulty_check[0].hash, first_difficulty_check_hash))
-		throw std::logic_error("DifficultyCheck table corrupted");
-	if (info->hash == first_difficulty_check_hash &&
+	if (info->hash == difficulty_check[0].hash &&
 	    info->cumulative_difficulty != difficulty_check[0].cumulative_difficulty) {
 		std::cout << "Reached first difficulty checkpoint with wrong cumulative_difficulty "
 		          << info->cumulative_difficulty << ", should be " << difficulty_check[0].cumulative_difficulty << ", "
@@ -211,10 +259,12 @@ BroadcastAction BlockChain::add_block(const PreparedBlock &pb, api::BlockHeader
 		                                         // reorganize_blocks or invariant
 		                                         // might be dead
 		store_header(pb.bid, *info);
+		if (m_chain_heights.count(pb.bid) == 0)
+			m_side_blocks[pb.bid] = SideBlock{pb.block.header.previous_block_hash, info->height};
 		if (pb.bid == m_genesis_bid) {
 			if (!redo_block(pb.bid, pb.raw_block, pb.block, *info, pb.base_transaction_hash))
 				throw std::logic_error("Failed to apply genesis block");
-			push_chain(pb.bid, info->cumulative_difficulty);
+			push_chain(*info);
 		} else {
 			modify_children_counter(prev_info.cumulative_difficulty, pb.block.header.previous_block_hash, 1);
 		}
@@ -224,7 +274,7 @@ BroadcastAction BlockChain::add_block(const PreparedBlock &pb, api::BlockHeader
 			if (get_tip_bid() == pb.block.header.previous_block_hash) {  // most common case optimization
 				if (!redo_block(pb.bid, pb.raw_block, pb.block, *info, pb.base_transaction_hash))
 					return BroadcastAction::BAN;
-				push_chain(pb.bid, info->cumulative_difficulty);
+				push_chain(*info);
 				//				std::map<Hash, std::pair<Transaction, BinaryArray>> undone_transactions;
 				//				on_reorganization(undone_transactions, true);
 			} else
@@ -244,9 +294,15 @@ BroadcastAction BlockChain::add_block(const PreparedBlock &pb, api::BlockHeader
 bool BlockChain::reorganize_blocks(const Hash &switch_to_chain,
     const PreparedBlock &recent_pb,
     const api::BlockHeader &recent_info) {
+	COMMON_TRACE_SPAN("reorganize_blocks");
 	// Header chain is better than block chain, undo upto splitting block
+	static auto &common_block_histogram = common::metrics::histogram("varcoind_reorganize_common_block_seconds");
 	std::vector<Hash> chain1, chain2;
-	Hash common = get_common_block(m_tip_bid, switch_to_chain, &chain1, &chain2);
+	Hash common;
+	{
+		common::metrics::ScopedTimer timer(common_block_histogram);
+		common = get_common_block(m_tip_bid, switch_to_chain, &chain1, &chain2);
+	}
 	for (auto &&chha : chain2) {
 		if (!has_block(chha))
 			return false;  // Full new chain not yet downloaded
@@ -291,7 +347,7 @@ bool BlockChain::reorganize_blocks(const Hash &switch_to_chain,
 				result = false;
 				break;
 			}
-			push_chain(chha, recent_info.cumulative_difficulty);
+			push_chain(recent_info);
 			for (auto &&tid : recent_pb.block.header.transaction_hashes)
 				undone_transactions.erase(tid);
 		} else {
@@ -311,7 +367,7 @@ bool BlockChain::reorganize_blocks(const Hash &switch_to_chain,
 				result = false;
 				break;
 			}
-			push_chain(chha, info.cumulative_difficulty);
+			push_chain(info);
 			for (auto &&tid : block.header.transaction_hashes)
 				undone_transactions.erase(tid);
 		}
@@ -322,46 +378,47 @@ bool BlockChain::reorganize_blocks(const Hash &switch_to_chain,
 
 Hash BlockChain::get_common_block(
     const Hash &bid1, const Hash &bid2, std::vector<Hash> *chain1, std::vector<Hash> *chain2) const {
-	Hash hid1            = bid1;
-	Hash hid2            = bid2;
-	api::BlockHeader ha1 = read_header(hid1);
-	api::BlockHeader ha2 = read_header(hid2);
+	Hash hid1 = bid1;
+	Hash hid2 = bid2;
+	Hash prev1, prev2;
+	Height height1 = 0, height2 = 0;
+	read_tree_node(hid1, &prev1, &height1);
+	read_tree_node(hid2, &prev2, &height2);
 	if (chain1)
 		chain1->clear();
 	if (chain2)
 		chain2->clear();
-	while (ha1.height > ha2.height) {
-		if (chain1)
-			chain1->push_back(hid1);
-		hid1 = ha1.previous_block_hash;
-		ha1  = read_header(hid1);
-	}
-	while (ha2.height > ha1.height) {
-		if (chain2)
-			chain2->push_back(hid2);
-		hid2 = ha2.previous_block_hash;
-		ha2  = read_header(hid2);
-	}
 	while (hid1 != hid2) {
-		if (chain1)
-			chain1->push_back(hid1);
-		hid1 = ha1.previous_block_hash;
-		ha1  = read_header(hid1);
-
-		if (chain2)
-			chain2->push_back(hid2);
-		hid2 = ha2.previous_block_hash;
-		ha2  = read_header(hid2);
+		if (m_chain_heights.count(hid1) != 0 && m_chain_heights.count(hid2) != 0) {
+			// Both reached main chain, lower one is common, no need to walk further
+			const Height common_height = std::min(height1, height2);
+			for (; chain1 && height1 > common_height; --height1)
+				chain1->push_back(m_chain.at(height1));
+			for (; chain2 && height2 > common_height; --height2)
+				chain2->push_back(m_chain.at(height2));
+			return m_chain.at(common_height);
+		}
+		if (height1 >= height2) {
+			if (chain1)
+				chain1->push_back(hid1);
+			hid1 = prev1;
+			read_tree_node(hid1, &prev1, &height1);
+		} else {
+			if (chain2)
+				chain2->push_back(hid2);
+			hid2 = prev2;
+			read_tree_node(hid2, &prev2, &height2);
+		}
 	}
 	return hid1;
 }
 
-std::vector<Hash> BlockChain::get_sparse_chain() const {
+std::vector<Hash> BlockChain::get_sparse_chain(Height start_height) const {
 	std::vector<Hash> tip_path;
 
 	uint32_t jump = 0;
-	while (m_tip_height >= jump) {
-		tip_path.push_back(read_chain(m_tip_height - jump));
+	while (start_height >= jump) {
+		tip_path.push_back(read_chain(start_height - jump));
 		if (tip_path.size() <= 10)
 			jump += 1;
 		else
@@ -385,25 +442,19 @@ std::vector<api::BlockHeader> BlockChain::get_sync_headers(const std::vector<Has
 
 uint32_t BlockChain::find_blockchain_supplement(const std::vector<Hash> &remote_block_ids) const {
 	for (auto &&lit : remote_block_ids) {
-		api::BlockHeader header;
-		if (!read_header(lit, &header))
-			continue;
-		if (header.height > m_tip_height)
-			continue;
-		return header.height;
+		auto cit = m_chain_heights.find(lit);
+		if (cit != m_chain_heights.end())
+			return cit->second;
 	}
 	return 0;  // Not possible if genesis blocks match
 }
 
 Height BlockChain::get_timestamp_lower_bound_block_index(Timestamp ts) const {
-	auto middle    = common::write_varint_sqlite4(ts);
-	DB::Cursor cur = m_db.begin(TIMESTAMP_BLOCK_PREFIX, middle);
-	if (cur.end())
+	// First block with timestamp >= ts. Blocks after it can have smaller timestamps, but none before it has larger
+	auto mit = std::lower_bound(m_chain_max_timestamps.begin(), m_chain_max_timestamps.end(), ts);
+	if (mit == m_chain_max_timestamps.end())
 		return m_tip_height;
-	const char *be = cur.get_suffix().data();
-	const char *en = be + cur.get_suffix().size();
-	common::read_varint_sqlite4(be, en);  // We ignore result, auto actual_ts =
-	return boost::lexical_cast<Height>(common::read_varint_sqlite4(be, en));
+	return static_cast<Height>(mit - m_chain_max_timestamps.begin());
 }
 
 std::vector<Hash> BlockChain::get_sync_headers_chain(const std::vector<Hash> &locator,
@@ -411,21 +462,26 @@ std::vector<Hash> BlockChain::get_sync_headers_chain(const std::vector<Hash> &lo
     size_t max_count) const {
 	std::vector<Hash> result;
 	for (auto &&lit : locator) {
-		api::BlockHeader header;
-		if (!read_header(lit, &header))
-			continue;
-		if (header.height > m_tip_height) {  // Asker has better chain then we do
-			*start_height = m_tip_height + 1;
-			return result;
-		}
-		uint32_t min_height = header.height;
-		Hash loc_ha         = lit;
-		for (; min_height != 0; min_height -= 1) {
-			Hash ha = read_chain(min_height);
-			if (ha == loc_ha)
-				break;
-			loc_ha = header.previous_block_hash;
-			header = read_header(loc_ha);
+		uint32_t min_height = 0;
+		auto cit            = m_chain_heights.find(lit);
+		if (cit != m_chain_heights.end()) {
+			min_height = cit->second;  // Usual case, no DB access
+		} else {
+			api::BlockHeader header;
+			if (!read_header(lit, &header))
+				continue;
+			if (header.height > m_tip_height) {  // Asker has better chain then we do
+				*start_height = m_tip_height + 1;
+				return result;
+			}
+			min_height  = header.height;
+			Hash loc_ha = lit;  // Walk from side chain to main chain
+			for (; min_height != 0; min_height -= 1) {
+				if (m_chain.at(min_height) == loc_ha)
+					break;
+				loc_ha = header.previous_block_hash;
+				header = read_header(loc_ha);
+			}
 		}
 		*start_height = min_height;
 		for (; result.size() < max_count && min_height <= m_tip_height; min_height += 1) {
@@ -504,20 +560,13 @@ bool BlockChain::read_transaction(
 
 bool BlockChain::redo_block(const Hash &bhash, const RawBlock &, const Block &block, const api::BlockHeader &info,
     const Hash &base_transaction_hash) {
+	COMMON_TRACE_SPAN("BlockChain::redo_block");
 	if (!redo_block(bhash, block, info))
 		return false;
-	auto tikey = TIMESTAMP_BLOCK_PREFIX + common::write_varint_sqlite4(info.timestamp) +
-	             common::write_varint_sqlite4(info.height);
-	m_db.put(tikey, std::string(), true);
-
-	auto bkey = TRANSATION_PREFIX + DB::to_binary_key(base_transaction_hash.data, TRANSACTION_PREFIX_BYTES) +
-	            common::write_varint_sqlite4(info.height) + common::write_varint_sqlite4(0);
-	m_db.put(bkey, std::string(), true);
+	m_db.put(transaction_key(base_transaction_hash, info.height, 0), std::string(), true);
 	for (size_t tx_index = 0; tx_index != block.transactions.size(); ++tx_index) {
 		Hash tid = block.header.transaction_hashes.at(tx_index);
-		bkey     = TRANSATION_PREFIX + DB::to_binary_key(tid.data, TRANSACTION_PREFIX_BYTES) +
-		       common::write_varint_sqlite4(info.height) + common::write_varint_sqlite4(tx_index + 1);
-		m_db.put(bkey, std::string(), true);
+		m_db.put(transaction_key(tid, info.height, tx_index + 1), std::string(), true);
 	}
 
 	//	m_tip_segment.push_back(info);
@@ -530,31 +579,22 @@ void BlockChain::undo_block(const Hash &bhash, const RawBlock &, const Block &bl
 	//		m_tip_segment.pop_back();
 	undo_block(bhash, block, height);
 
-	auto tikey = TIMESTAMP_BLOCK_PREFIX + common::write_varint_sqlite4(block.header.timestamp) +
-	             common::write_varint_sqlite4(height);
-	m_db.del(tikey, true);
-
-	Hash tid  = get_transaction_hash(block.header.base_transaction);
-	auto bkey = TRANSATION_PREFIX + DB::to_binary_key(tid.data, TRANSACTION_PREFIX_BYTES) +
-	            common::write_varint_sqlite4(height) + common::write_varint_sqlite4(0);
-	m_db.del(bkey, true);
+	Hash tid = get_transaction_hash(block.header.base_transaction);
+	m_db.del(transaction_key(tid, height, 0), true);
 	for (size_t tx_index = 0; tx_index != block.transactions.size(); ++tx_index) {
-		tid  = block.header.transaction_hashes.at(tx_index);
-		bkey = TRANSATION_PREFIX + DB::to_binary_key(tid.data, TRANSACTION_PREFIX_BYTES) +
-		       common::write_varint_sqlite4(height) + common::write_varint_sqlite4(tx_index + 1);
-		m_db.del(bkey, true);
+		tid = block.header.transaction_hashes.at(tx_index);
+		m_db.del(transaction_key(tid, height, tx_index + 1), true);
 	}
 }
 
 void BlockChain::store_block(const Hash &bid, const BinaryArray &block_data) {
-	auto key = BLOCK_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + BLOCK_SUFFIX;
-	m_db.put(key, block_data, true);
+	COMMON_TRACE_SPAN("store_block");
+	m_db.put(block_key(bid), block_data, true);
 }
 
 bool BlockChain::read_block(const Hash &bid, RawBlock *raw_block) const {
 	BinaryArray rb;
-	auto key = BLOCK_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + BLOCK_SUFFIX;
-	if (!m_db.get(key, rb))
+	if (!m_db.get(block_key(bid), rb))
 		return false;
 	seria::from_binary(*raw_block, rb);
 	return true;
@@ -562,16 +602,14 @@ bool BlockChain::read_block(const Hash &bid, RawBlock *raw_block) const {
 
 bool BlockChain::has_block(const Hash &bid) const {
 	platform::DB::Value ms;
-	auto key = BLOCK_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + BLOCK_SUFFIX;
-	if (!m_db.get(key, ms))
+	if (!m_db.get(block_key(bid), ms))
 		return false;
 	return true;
 }
 
 void BlockChain::store_header(const Hash &bid, const api::BlockHeader &header) {
-	auto key       = HEADER_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + HEADER_SUFFIX;
 	BinaryArray ba = seria::to_binary(header);
-	m_db.put(key, ba, true);
+	m_db.put(header_key(bid), ba, true);
 }
 
 bool BlockChain::read_header(const Hash &bid, api::BlockHeader *header) const {
@@ -585,8 +623,7 @@ bool BlockChain::read_header(const Hash &bid, api::BlockHeader *header) const {
 		header_cache.clear();  // very simple policy
 	}
 	BinaryArray rb;
-	auto key = HEADER_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + HEADER_SUFFIX;
-	if (!m_db.get(key, rb))
+	if (!m_db.get(header_key(bid), rb))
 		return false;
 	Hash bbid = bid;  // next line can modify bid, because it can be reference to header.previous_block_hash
 	seria::from_binary(*header, rb);
@@ -649,34 +686,67 @@ std::vector<api::BlockHeader> BlockChain::get_tip_segment(
 }
 
 void BlockChain::read_tip() {
-	DB::Cursor cur2 = m_db.rbegin(TIP_CHAIN_PREFIX + version_1 + "/");
-	m_tip_height    = cur2.end() ? -1 : boost::lexical_cast<Height>(common::read_varint_sqlite4(cur2.get_suffix()));
-	seria::from_binary(m_tip_bid, cur2.get_value_array());
+	m_chain.clear();
+	m_chain_heights.clear();
+	m_chain_timestamps.clear();
+	m_chain_max_timestamps.clear();
+	for (DB::Cursor cur = m_db.begin(TIP_CHAIN_PREFIX + version_1 + "/"); !cur.end(); cur.next()) {
+		const Height ha = boost::lexical_cast<Height>(common::read_varint_sqlite4(cur.get_suffix()));
+		if (ha != m_chain.size())
+			throw std::logic_error("read_tip main chain index corrupted at height=" + std::to_string(ha));
+		std::pair<Hash, Timestamp> bid_timestamp;
+		const BinaryArray ba = cur.get_value_array();
+		if (ba.size() == sizeof(Hash)) {  // before version 4, upgrade_chain_timestamps will rewrite
+			seria::from_binary(bid_timestamp.first, ba);
+			bid_timestamp.second = read_header(bid_timestamp.first).timestamp;
+		} else
+			seria::from_binary(bid_timestamp, ba);
+		m_chain.push_back(bid_timestamp.first);
+		m_chain_heights[bid_timestamp.first] = ha;
+		m_chain_timestamps.push_back(bid_timestamp.second);
+		m_chain_max_timestamps.push_back(m_chain_max_timestamps.empty()
+		                                     ? bid_timestamp.second
+		                                     : std::max(m_chain_max_timestamps.back(), bid_timestamp.second));
+	}
+	if (m_chain.empty())
+		return;
+	m_tip_height                = static_cast<Height>(m_chain.size() - 1);
+	m_tip_bid                   = m_chain.back();
 	api::BlockHeader tip_block  = read_header(m_tip_bid);
 	m_tip_cumulative_difficulty = tip_block.cumulative_difficulty;
 }
 
-void BlockChain::push_chain(Hash bid, Difficulty cumulative_difficulty) {
+void BlockChain::push_chain(const api::BlockHeader &info) {
 	m_tip_height += 1;
-	BinaryArray ba = seria::to_binary(bid);
-	m_db.put(TIP_CHAIN_PREFIX + version_1 + "/" + common::write_varint_sqlite4(m_tip_height), ba, true);
-	m_tip_bid                   = bid;
-	m_tip_cumulative_difficulty = cumulative_difficulty;
+	BinaryArray ba = seria::to_binary(std::make_pair(info.hash, info.timestamp));
+	m_db.put(chain_key(version_1, m_tip_height), ba, true);
+	m_chain.push_back(info.hash);
+	m_chain_heights[info.hash] = m_tip_height;
+	m_chain_timestamps.push_back(info.timestamp);
+	m_chain_max_timestamps.push_back(
+	    m_chain_max_timestamps.empty() ? info.timestamp : std::max(m_chain_max_timestamps.back(), info.timestamp));
+	m_side_blocks.erase(info.hash);
+	m_tip_bid                   = info.hash;
+	m_tip_cumulative_difficulty = info.cumulative_difficulty;
 	tip_changed();
 }
 
 void BlockChain::pop_chain() {
 	if (m_tip_height == 0)
 		throw std::logic_error("pop_chain tip_height == 0");
-	m_db.del(TIP_CHAIN_PREFIX + version_1 + "/" + common::write_varint_sqlite4(m_tip_height), true);
+	m_db.del(chain_key(version_1, m_tip_height), true);
+	m_side_blocks[m_chain.back()] = SideBlock{m_chain.at(m_tip_height - 1), m_tip_height};
+	m_chain_heights.erase(m_chain.back());
+	m_chain.pop_back();
+	m_chain_timestamps.pop_back();
+	m_chain_max_timestamps.pop_back();
 	m_tip_height -= 1;
 }
 
 bool BlockChain::read_chain(uint32_t height, Hash *bid) const {
-	BinaryArray ba;
-	if (!m_db.get(TIP_CHAIN_PREFIX + version_1 + "/" + common::write_varint_sqlite4(height), ba))
+	if (height >= m_chain.size())
 		return false;
-	seria::from_binary(*bid, ba);
+	*bid = m_chain[height];
 	return true;
 }
 
@@ -687,53 +757,113 @@ Hash BlockChain::read_chain(uint32_t height) const {
 	return ha;
 }
 
+void BlockChain::upgrade_chain_timestamps() {
+	for (Height ha = 0; ha != m_chain.size(); ++ha) {
+		BinaryArray ba = seria::to_binary(std::make_pair(m_chain[ha], m_chain_timestamps[ha]));
+		m_db.put(chain_key(version_1, ha), ba, false);
+	}
+	size_t erased = 0;
+	for (DB::Cursor cur = m_db.begin(TIMESTAMP_BLOCK_PREFIX); !cur.end(); cur.erase())
+		erased += 1;
+	std::cout << "Rewrote " << m_chain.size() << " chain records, deleted " << erased << " timestamp records"
+	          << std::endl;
+}
+
+void BlockChain::read_block_tree() {
+	for (DB::Cursor cur = m_db.begin(CHILDREN_PREFIX); !cur.end(); cur.next()) {
+		Hash bid;
+		DB::from_binary_key(cur.get_suffix(), 0, bid.data, sizeof(bid.data));
+		uint32_t counter = 1;
+		seria::from_binary(counter, cur.get_value_array());
+		m_children_counters[bid] = counter;
+	}
+	for (DB::Cursor cur = m_db.begin(CD_TIPS_PREFIX); !cur.end(); cur.next()) {
+		const std::string &suf = cur.get_suffix();
+		const char *be         = suf.data();
+		const char *en         = be + suf.size();
+		Difficulty cd          = common::read_varint_sqlite4(be, en);
+		Hash bid;
+		if (en - be != sizeof(bid.data))
+			throw std::logic_error("CD_TIPS_PREFIX corrupted");
+		DB::from_binary_key(cur.get_suffix(), cur.get_suffix().size() - sizeof(bid.data), bid.data, sizeof(bid.data));
+		m_tips.insert(std::make_pair(cd, bid));
+	}
+	for (auto &&tip : m_tips)
+		for (Hash bid = tip.second; m_chain_heights.count(bid) == 0 && m_side_blocks.count(bid) == 0;) {
+			api::BlockHeader header = read_header(bid);
+			m_side_blocks[bid]      = SideBlock{header.previous_block_hash, header.height};
+			bid                     = header.previous_block_hash;
+		}
+	std::cout << "Block tree tips=" << m_tips.size() << " forks=" << m_children_counters.size() - m_tips.size()
+	          << " side blocks=" << m_side_blocks.size() << std::endl;
+}
+
+void BlockChain::write_block_tree() {
+	for (auto &&bid : m_children_dirty) {
+		auto cit = m_children_counters.find(bid);
+		if (cit == m_children_counters.end())
+			m_db.del(children_key(bid), false);
+		else
+			m_db.put(children_key(bid), seria::to_binary(cit->second), false);
+	}
+	for (auto &&tip : m_tips_dirty) {
+		if (m_tips.count(tip) != 0)
+			m_db.put(cd_tip_key(tip.first, tip.second), std::string(), false);
+		else
+			m_db.del(cd_tip_key(tip.first, tip.second), false);
+	}
+	m_children_dirty.clear();
+	m_tips_dirty.clear();
+}
+
+void BlockChain::read_tree_node(const Hash &bid, Hash *previous_block_hash, Height *height) const {
+	auto cit = m_chain_heights.find(bid);
+	if (cit != m_chain_heights.end()) {
+		*height              = cit->second;
+		*previous_block_hash = cit->second == 0 ? Hash{} : m_chain.at(cit->second - 1);
+		return;
+	}
+	auto sit = m_side_blocks.find(bid);
+	if (sit == m_side_blocks.end())
+		throw std::logic_error("Block not in block tree " + common::pod_to_hex(bid));
+	*height              = sit->second.height;
+	*previous_block_hash = sit->second.previous_block_hash;
+}
+
 void BlockChain::check_children_counter(Difficulty cd, const Hash &bid, int value) {
-	auto key    = CHILDREN_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data));
-	auto cd_key = CD_TIPS_PREFIX + common::write_varint_sqlite4(cd) + DB::to_binary_key(bid.data, sizeof(bid.data));
-	int counter = 1;  // default is 1 when not stored in db
-	BinaryArray rb;
-	if (m_db.get(key, rb))
-		seria::from_binary(counter, rb);
+	auto cit             = m_children_counters.find(bid);
+	const int counter    = cit == m_children_counters.end() ? 1 : cit->second;  // default is 1 when not stored
+	const bool tip_found = m_tips.count(std::make_pair(cd, bid)) != 0;
 	if (counter != value)
 		throw std::logic_error("check_children_counter index corrupted");
-	if (counter == 0 && !m_db.get(cd_key, rb))
+	if (counter == 0 && !tip_found)
 		throw std::logic_error("check_children_counter tip is not in index");
-	if (counter != 0 && m_db.get(cd_key, rb))
+	if (counter != 0 && tip_found)
 		throw std::logic_error("check_children_counter non-tip is in index");
 }
 
 void BlockChain::modify_children_counter(Difficulty cd, const Hash &bid, int delta) {
-	auto key    = CHILDREN_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data));
-	auto cd_key = CD_TIPS_PREFIX + common::write_varint_sqlite4(cd) + DB::to_binary_key(bid.data, sizeof(bid.data));
-	uint32_t counter = 1;  // default is 1 when not stored in db
-	BinaryArray rb;
-	if (m_db.get(key, rb))
-		seria::from_binary(counter, rb);
+	auto cit         = m_children_counters.find(bid);
+	uint32_t counter = cit == m_children_counters.end() ? 1 : cit->second;  // default is 1 when not stored
 	counter += delta;
-	if (counter == 1) {
-		m_db.del(key, false);
-	} else {
-		BinaryArray ba = seria::to_binary(counter);
-		m_db.put(key, ba, false);
-	}
-	if (counter == 0) {
-		m_db.put(cd_key, std::string(), false);
-	} else {
-		m_db.del(cd_key, false);
-	}
+	if (counter == 1)
+		m_children_counters.erase(bid);
+	else
+		m_children_counters[bid] = counter;
+	m_children_dirty.insert(bid);
+	auto tip = std::make_pair(cd, bid);
+	if (counter == 0)
+		m_tips.insert(tip);
+	else
+		m_tips.erase(tip);
+	m_tips_dirty.insert(tip);
 }
 
 bool BlockChain::get_oldest_tip(Difficulty *cd, Hash *bid) const {
-	DB::Cursor cur = m_db.begin(CD_TIPS_PREFIX);
-	if (cur.end())
+	if (m_tips.empty())
 		return false;
-	const std::string &suf = cur.get_suffix();
-	const char *be         = suf.data();
-	const char *en         = be + suf.size();
-	*cd                     = common::read_varint_sqlite4(be, en);
-	if (en - be != sizeof(bid->data))
-		throw std::logic_error("CD_TIPS_PREFIX corrupted");
-	DB::from_binary_key(cur.get_suffix(), cur.get_suffix().size() - sizeof(bid->data), bid->data, sizeof(bid->data));
+	*cd  = m_tips.begin()->first;
+	*bid = m_tips.begin()->second;
 	return true;
 }
 
@@ -745,10 +875,10 @@ bool BlockChain::prune_branch(Difficulty cd, Hash bid) {
 	api::BlockHeader pa = read_header(me.previous_block_hash);
 	modify_children_counter(cd, bid, 1);
 	modify_children_counter(pa.cumulative_difficulty, me.previous_block_hash, -1);
-	auto key = BLOCK_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + BLOCK_SUFFIX;
-	m_db.del(key, true);
-	auto key2 = HEADER_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + HEADER_SUFFIX;
-	m_db.del(key2, true);
+	m_db.del(block_key(bid), true);
+	m_db.del(header_key(bid), true);
+	header_cache.erase(bid);
+	m_side_blocks.erase(bid);
 	return true;
 }
 
@@ -767,28 +897,16 @@ void BlockChain::test_print_structure(Height n_confirmations) const {
 	Hash obid;
 	if (get_oldest_tip(&ocd, &obid))
 		std::cout << "oldest tip cd=" << ocd << " bid=" << common::pod_to_hex(obid) << std::endl;
-	for (DB::Cursor cur = m_db.begin(CHILDREN_PREFIX); !cur.end(); cur.next()) {
-		Hash bid;
-		DB::from_binary_key(cur.get_suffix(), 0, bid.data, sizeof(bid.data));
-		uint32_t counter = 1;
-		seria::from_binary(counter, cur.get_value_array());
-
-		std::cout << "children counter=" << counter << " bid=" << common::pod_to_hex(bid) << std::endl;
-	}
+	for (auto &&cc : m_children_counters)
+		std::cout << "children counter=" << cc.second << " bid=" << common::pod_to_hex(cc.first) << std::endl;
 	size_t total_forked_transactions      = 0;
 	size_t total_possible_ds_transactions = 0;
 	Amount total_possible_ds_amount       = 0;
 	size_t total_forked_blocks            = 0;
 	size_t total_forked_blocks_not_found  = 0;
-	for (DB::Cursor cur = m_db.begin(CD_TIPS_PREFIX); !cur.end(); cur.next()) {
-		const std::string &suf = cur.get_suffix();
-		const char *be         = suf.data();
-		const char *en         = be + suf.size();
-		Difficulty cd          = common::read_varint_sqlite4(be, en);
-		Hash bid;
-		if (en - be != sizeof(bid.data))
-			throw std::logic_error("CD_TIPS_PREFIX corrupted");
-		DB::from_binary_key(cur.get_suffix(), cur.get_suffix().size() - sizeof(bid.data), bid.data, sizeof(bid.data));
+	for (auto &&tip : m_tips) {
+		const Difficulty cd = tip.first;
+		Hash bid            = tip.second;
 		std::cout << "tip cd=" << cd << " bid=" << common::pod_to_hex(bid) << std::endl;
 		Height t_height = Height(-1);
 		while (true) {
@@ -867,10 +985,16 @@ bool BlockChain::fix_consensus(Hash bid, const api::BlockHeader &was_info) {
 	if (info.cumulative_difficulty != was_info.cumulative_difficulty) {
 		//		std::cout << "Cumulative difficulty difference for height=" << start_height << " mustbe="
 		//				  << info.cumulative_difficulty << " was=" << was_info.cumulative_difficulty << std::endl;
-		auto key       = HEADER_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + HEADER_SUFFIX;
 		BinaryArray ba = seria::to_binary(info);
-		m_db.put(key, ba, false);
+		m_db.put(header_key(bid), ba, false);
 		header_cache.erase(bid);
+		auto old_tip = std::make_pair(was_info.cumulative_difficulty, bid);
+		if (m_tips.erase(old_tip) != 0) {
+			auto new_tip = std::make_pair(info.cumulative_difficulty, bid);
+			m_tips.insert(new_tip);
+			m_tips_dirty.insert(old_tip);
+			m_tips_dirty.insert(new_tip);
+		}
 		return true;
 	}
 	return false;
@@ -901,9 +1025,7 @@ void BlockChain::fix_difficulty_consensus() {
 	int fixed_counter = 0;
 	std::set<Hash> fixed_headers;
 	for (size_t ch = 0; ch != difficulty_check_count; ++ch) {
-		Hash bid;
-		if (!common::pod_from_hex(difficulty_check[ch].hash, bid))
-			throw std::logic_error("DifficultyCheck table corrupted");
+		const Hash &bid = difficulty_check[ch].hash;
 		api::BlockHeader was_info;
 		if (!read_header(bid, &was_info))
 			break;
@@ -934,16 +1056,10 @@ void BlockChain::fix_difficulty_consensus() {
 	//	std::cout << "Found header with consensus differences at height"<< start_height << ", fixing (can take several
 	//minutes)..." << std::endl;
 	int progress_counter = 0;
-	for (DB::Cursor cur = m_db.rbegin(CD_TIPS_PREFIX); !cur.end(); cur.next()) {
-		const std::string &suf = cur.get_suffix();
-		const char *be         = suf.data();
-		const char *en         = be + suf.size();
-		Difficulty cd          = common::read_varint_sqlite4(be, en);
-		Hash tip_bid;
-		if (en - be != sizeof(tip_bid.data))
-			throw std::logic_error("CD_TIPS_PREFIX corrupted");
-		DB::from_binary_key(
-		    cur.get_suffix(), cur.get_suffix().size() - sizeof(tip_bid.data), tip_bid.data, sizeof(tip_bid.data));
+	const std::vector<std::pair<Difficulty, Hash>> tips(m_tips.rbegin(), m_tips.rend());  // fixes modify m_tips
+	for (auto &&tip : tips) {
+		const Difficulty cd = tip.first;
+		const Hash tip_bid  = tip.second;
 		//		if( tip_bid == get_tip_bid())
 		//			std::cout << "Main chain" << std::endl;
 		std::vector<Hash> side_chain;
@@ -976,13 +1092,7 @@ void BlockChain::fix_difficulty_consensus() {
 	//	throw std::runtime_error("Preventing DB commit");
 }
 
-void BlockChain::check_consensus_fast(Hash bid){
-	RawBlock rb;
-	Block block;
-	if (!read_block(bid, &rb))
-		throw std::logic_error("Block for fix consensus not found - please delete " + m_coin_folder + "/blockchain");
-	PreparedBlock pb(std::move(rb), nullptr);
-
+void BlockChain::check_consensus_fast(const PreparedBlock &pb) {
 	api::BlockHeader info;
 	api::BlockHeader prev_info;
 	prev_info.height = -1;
@@ -998,54 +1108,89 @@ void BlockChain::check_consensus_fast(Hash bid){
 
 	std::string check_error = check_standalone_consensus(pb, &info, prev_info, false);
 	if (!check_error.empty())
-		throw std::runtime_error("Failed to fix consensus differences for block " + common::pod_to_hex(bid) +
-								 ", because " + check_error + ", " + delete_blockchain_message + m_coin_folder +
-								 "/blockchain");
+		throw std::runtime_error("Failed to fix consensus differences for block " + common::pod_to_hex(pb.bid) +
+		                         ", because " + check_error + ", " + delete_blockchain_message + m_coin_folder +
+		                         "/blockchain");
 }
 
-void BlockChain::check_consensus_fast(){
-	Height CHECK_DEPTH = 20000;
+void BlockChain::check_consensus_fast() {
+	const Height CHECK_DEPTH = 20000;
+	const size_t BATCH_SIZE  = 1000;  // progress is saved after each batch
 	std::set<Hash> fixed_headers;
-	int progress_counter = 0;
-	for (DB::Cursor cur = m_db.rbegin(CD_TIPS_PREFIX); !cur.end(); cur.next()) {
-		const std::string &suf = cur.get_suffix();
-		const char *be         = suf.data();
-		const char *en         = be + suf.size();
-		Difficulty cd          = common::read_varint_sqlite4(be, en);
-		Hash tip_bid;
-		if (en - be != sizeof(tip_bid.data))
-			throw std::logic_error("CD_TIPS_PREFIX corrupted");
-		DB::from_binary_key(
-				cur.get_suffix(), cur.get_suffix().size() - sizeof(tip_bid.data), tip_bid.data, sizeof(tip_bid.data));
-		//		if( tip_bid == get_tip_bid())
-		//			std::cout << "Main chain" << std::endl;
+	std::vector<Hash> work;  // side chains from oldest to newest block, so previous header is always checked before
+	const std::vector<std::pair<Difficulty, Hash>> tips(m_tips.rbegin(), m_tips.rend());  // fixes modify m_tips
+	for (auto &&tip : tips) {
+		const Difficulty cd = tip.first;
+		const Hash tip_bid  = tip.second;
 		std::vector<Hash> side_chain;
 		for (Hash bid = tip_bid;;) {
 			api::BlockHeader header = read_header(bid);
-			Hash main_bid;
 			if (fixed_headers.count(bid) != 0 || bid == m_genesis_bid || header.height + CHECK_DEPTH < get_tip_height())
 				break;  // Do not fix beyond genesis, or beyond fixed header
 			side_chain.push_back(bid);
 			bid = header.previous_block_hash;
 		}
 		std::cout << "tip cd=" << cd << " len=" << side_chain.size() << " bid=" << common::pod_to_hex(tip_bid)
-				  << std::endl;
+		          << std::endl;
 		for (; !side_chain.empty(); side_chain.pop_back()) {
-			Hash bid                  = side_chain.back();
-			if (progress_counter % 1000 == 0)
-				std::cout << "Quickly checking database indexes. Will take minute or two. Remained blocks "
-						  << side_chain.size() << std::endl; // Checking orphan tree tips
-			progress_counter += 1;
-			check_consensus_fast(bid);
-			fixed_headers.insert(bid);
+			work.push_back(side_chain.back());
+			fixed_headers.insert(side_chain.back());
+		}
+	}
+	size_t work_start = 0;
+	BinaryArray progress;
+	if (m_db.get(CHECK_CONSENSUS_FAST_PROGRESS, progress)) {
+		Hash last_checked_bid;
+		seria::from_binary(last_checked_bid, progress);
+		auto wit = std::find(work.begin(), work.end(), last_checked_bid);
+		if (wit != work.end()) {
+			work_start = wit - work.begin() + 1;
+			std::cout << "Continuing interrupted check, " << work_start << " blocks already checked" << std::endl;
 		}
 	}
+	// DB must be accessed from this thread only, so only parsing and hashing of blocks is spread across cores
+	const size_t th_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+	for (size_t batch_start = work_start; batch_start < work.size(); batch_start += BATCH_SIZE) {
+		const size_t batch_end = std::min(work.size(), batch_start + BATCH_SIZE);
+		std::cout << "Quickly checking database indexes. Will take minute or two. Remained blocks "
+		          << work.size() - batch_start << std::endl;
+		std::vector<RawBlock> raw_blocks(batch_end - batch_start);
+		for (size_t i = 0; i != raw_blocks.size(); ++i)
+			if (!read_block(work.at(batch_start + i), &raw_blocks.at(i)))
+				throw std::logic_error(
+				    "Block for fix consensus not found - please delete " + m_coin_folder + "/blockchain");
+		std::vector<PreparedBlock> prepared_blocks(raw_blocks.size());
+		std::atomic<size_t> next_index{0};
+		std::mutex mu;
+		std::exception_ptr error;
+		auto prepare = [&]() {
+			try {
+				for (size_t i; (i = next_index.fetch_add(1)) < raw_blocks.size();)
+					prepared_blocks[i] = PreparedBlock(std::move(raw_blocks[i]), nullptr);
+			} catch (...) {
+				std::unique_lock<std::mutex> lock(mu);
+				error = std::current_exception();
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < th_count; ++i)
+			threads.emplace_back(prepare);
+		prepare();
+		for (auto &&th : threads)
+			th.join();
+		if (error)
+			std::rethrow_exception(error);
+		for (auto &&pb : prepared_blocks)
+			check_consensus_fast(pb);
+		m_db.put(CHECK_CONSENSUS_FAST_PROGRESS, seria::to_binary(work.at(batch_end - 1)), false);
+		db_commit();
+	}
+	m_db.del(CHECK_CONSENSUS_FAST_PROGRESS, false);
 }
 
 bool BlockChain::read_next_internal_block(Hash *bid) const {
 	BinaryArray ba;
-	if (!m_db.get(
-	        TIP_CHAIN_PREFIX + previous_versions[0] + "/" + common::write_varint_sqlite4(get_tip_height() + 1), ba))
+	if (!m_db.get(chain_key(previous_versions[0], get_tip_height() + 1), ba))
 		return false;
 	seria::from_binary(*bid, ba);
 	return true;
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <deque>
+#include <set>
 #include <unordered_map>
 #include "VarNote.hpp"
 #include "Currency.hpp"
@@ -67,7 +68,8 @@ public:
 	BroadcastAction add_block(const PreparedBlock &pb, api::BlockHeader *info);
 
 	// Facilitate sync and download
-	std::vector<Hash> get_sparse_chain() const;
+	std::vector<Hash> get_sparse_chain() const { return get_sparse_chain(m_tip_height); }
+	std::vector<Hash> get_sparse_chain(Height start_height) const;  // start_height must be in main chain
 	std::vector<api::BlockHeader> get_sync_headers(const std::vector<Hash> &sparse_chain, size_t max_count) const;
 	std::vector<Hash> get_sync_headers_chain(
 	    const std::vector<Hash> &sparse_chain, Height *start_height, size_t max_count) const;
@@ -88,6 +90,7 @@ public:
 
 protected:
 	Difficulty get_tip_cumulative_difficulty() const { return m_tip_cumulative_difficulty; }
+	const std::set<std::pair<Difficulty, Hash>> &get_tips() const { return m_tips; }  // ordered by cd
 	bool read_next_internal_block(Hash *bid) const;
 	virtual std::string check_standalone_consensus(
 	    const PreparedBlock &pb, api::BlockHeader *info, const api::BlockHeader &prev_info, bool check_pow) const = 0;
@@ -97,10 +100,12 @@ protected:
 	    const Hash &base_transaction_hash);
 	void undo_block(const Hash &bhash, const RawBlock &raw_block, const Block &block, Height height);
 	virtual void tip_changed() {}  // Quick hack to allow BlockChainState to update next block params
+	virtual void on_db_commit() {}  // Last chance to put in-memory state into the same DB transaction
 	virtual void on_reorganization(
 	    const std::map<Hash, std::pair<Transaction, BinaryArray>> &undone_transactions, bool undone_blocks) = 0;
 	void fix_difficulty_consensus();
 	void check_consensus_fast();
+	void upgrade_chain_timestamps();
 
 	const Hash m_genesis_bid;
 	const std::string m_coin_folder;
@@ -120,8 +125,13 @@ private:
 	Height m_tip_height                    = -1;
 	Height m_internal_import_known_height  = 0;
 	void read_tip();
-	void push_chain(Hash bid, Difficulty cumulative_difficulty);
+	void push_chain(const api::BlockHeader &info);
 	void pop_chain();
+	// Main chain is duplicated in memory, because sync requests from peers and wallets look it up a lot
+	std::vector<Hash> m_chain;                         // height -> bid
+	std::unordered_map<Hash, Height> m_chain_heights;  // bid -> height
+	std::vector<Timestamp> m_chain_timestamps;         // height -> timestamp, stored in DB together with bid
+	std::vector<Timestamp> m_chain_max_timestamps;     // height -> max timestamp upto height, for binary search
 	mutable std::unordered_map<Hash, api::BlockHeader> header_cache;
 	// We cache recent headers for quick calculation in block windows
 
@@ -133,12 +143,27 @@ private:
 	bool reorganize_blocks(
 	    const Hash &switch_to_chain, const PreparedBlock &recent_pb, const api::BlockHeader &recent_info);
 
+	// Block tree index is kept in memory. Children counters and tips are also stored in DB, but written only
+	// on db_commit, side chain blocks are found by walking from tips to main chain on start
+	struct SideBlock {
+		Hash previous_block_hash;
+		Height height = 0;
+	};
+	std::unordered_map<Hash, SideBlock> m_side_blocks;      // blocks not in main chain
+	std::unordered_map<Hash, uint32_t> m_children_counters;  // only counters != 1, same as in DB
+	std::set<std::pair<Difficulty, Hash>> m_tips;           // blocks with no children
+	std::set<Hash> m_children_dirty;
+	std::set<std::pair<Difficulty, Hash>> m_tips_dirty;
+	void read_block_tree();
+	void write_block_tree();
+	void read_tree_node(const Hash &bid, Hash *previous_block_hash, Height *height) const;
+
 	void check_children_counter(Difficulty cd, const Hash &bid, int value);
 	void modify_children_counter(Difficulty cd, const Hash &bid, int delta);
 	bool get_oldest_tip(Difficulty *cd, Hash *bid) const;
 	bool prune_branch(Difficulty cd, Hash bid);
 	bool fix_consensus(Hash bid, const api::BlockHeader &was_info);
-	void check_consensus_fast(Hash bid);
+	void check_consensus_fast(const PreparedBlock &pb);
 };
 
 }  // namespace varcoin
@@ -7,6 +7,8 @@
 #include "VarNoteTools.hpp"
 #include "TransactionExtra.hpp"
 #include "common/Math.hpp"
+#include "common/Metrics.hpp"
+#include "common/Trace.hpp"
 #include "common/StringTools.hpp"
 #include "common/Varint.hpp"
 #include "crypto/crypto.hpp"
@@ -18,6 +20,7 @@ static const std::string AMOUNT_OUTPUT_PREFIX        = "a";
 static const std::string BLOCK_GLOBAL_INDICES_PREFIX = "b";
 static const std::string BLOCK_GLOBAL_INDICES_SUFFIX = "g";
 static const std::string FIRST_SEEN_PREFIX           = "f";
+static const std::string NEXT_GI_KEY                 = "$next_gi";  // amount -> output count for all amounts
 
 const bool create_unlock_index               = false;
 static const std::string UNLOCK_BLOCK_PREFIX = "u";
@@ -29,6 +32,36 @@ const size_t MAX_POOL_SIZE = 2000000;  // ~1000 "normal" transactions with 10 in
 using namespace varcoin;
 using namespace platform;
 
+static DB::Key keyimage_key(const KeyImage &keyimage) {
+	DB::Key key(KEYIMAGE_PREFIX);
+	key.append_pod(keyimage);
+	return key;
+}
+
+static DB::Key amount_output_key(Amount amount, uint32_t global_index) {
+	DB::Key key(AMOUNT_OUTPUT_PREFIX);
+	key.append_varint_sqlite4(amount).append_varint_sqlite4(global_index);
+	return key;
+}
+
+static DB::Key unlock_key(const std::string &prefix, Amount amount, uint32_t clamped_unlock_time, uint32_t global_index) {
+	DB::Key key(prefix);
+	key.append_varint_sqlite4(amount).append_varint_sqlite4(clamped_unlock_time).append_varint_sqlite4(global_index);
+	return key;
+}
+
+static DB::Key block_global_indices_key(const Hash &bid) {
+	DB::Key key(BLOCK_GLOBAL_INDICES_PREFIX);
+	key.append_pod(bid).append(BLOCK_GLOBAL_INDICES_SUFFIX);
+	return key;
+}
+
+static DB::Key first_seen_key(const Hash &tid) {
+	DB::Key key(FIRST_SEEN_PREFIX);
+	key.append_pod(tid);
+	return key;
+}
+
 BlockChainState::PoolTransaction::PoolTransaction(const Transaction &tx, const BinaryArray &binary_tx, Amount fee)
     : tx(tx), binary_tx(binary_tx), fee(fee) {}
 
@@ -174,7 +207,10 @@ BlockChainState::BlockChainState(logging::ILogger &log, const Config &config, co
     //    , m_config(config)
     , m_currency(currency)
     , m_log(log, "BlockChainState")
+    , m_check_ring_signatures(config.check_ring_signatures)
+    , ring_checker(config.ring_checker_threads)
     , log_redo_block_timestamp(std::chrono::steady_clock::now()) {
+	read_next_gi_table();
 	if (get_tip_height() == (Height)-1) {
 		Block genesis_block;
 		genesis_block.header = currency.genesis_block_template;
@@ -191,17 +227,45 @@ BlockChainState::BlockChainState(logging::ILogger &log, const Config &config, co
 	m_db.get("$version", version);
 	if (version == "1") {  // 1 -> 2
 		std::cout << "Database version 1, advancing to version 2" << std::endl;
+		auto idea_start = std::chrono::steady_clock::now();
 		fix_difficulty_consensus();
 		version = "2";
 		m_db.put("$version", version, false);
 		db_commit();
+		auto idea_ms =
+		    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - idea_start);
+		std::cout << "Database version 2 fix_difficulty_consensus seconds=" << double(idea_ms.count()) / 1000
+		          << std::endl;
 	}
 	if(version == "2") { // 2 -> 3
 		std::cout << "Database version 2, advancing to version 3" << std::endl;
+		auto idea_start = std::chrono::steady_clock::now();
 		check_consensus_fast();
 		version = "3";
 		m_db.put("$version", version, false);
 		db_commit();
+		auto idea_ms =
+		    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - idea_start);
+		std::cout << "Database version 3 check_consensus_fast seconds=" << double(idea_ms.count()) / 1000
+		          << std::endl;
+	}
+	if (version == "3") {  // 3 -> 4
+		std::cout << "Database version 3, advancing to version 4" << std::endl;
+		auto idea_start = std::chrono::steady_clock::now();
+		upgrade_chain_timestamps();
+		version = "4";
+		m_db.put("$version", version, false);
+		db_commit();
+		auto idea_ms =
+		    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - idea_start);
+		std::cout << "Database version 4 upgrade_chain_timestamps seconds=" << double(idea_ms.count()) / 1000
+		          << std::endl;
+	}
+	if (version == "4") {  // 4 -> 5, table was built by read_next_gi_table() and is written on commit
+		std::cout << "Database version 4, advancing to version 5" << std::endl;
+		version = "5";
+		m_db.put("$version", version, false);
+		db_commit();
 	}
 	if (version != version_current)
 		throw std::runtime_error("Blockchain database format unknown (version=" + version + "), please delete " +
@@ -213,6 +277,7 @@ BlockChainState::BlockChainState(logging::ILogger &log, const Config &config, co
 
 std::string BlockChainState::check_standalone_consensus(
     const PreparedBlock &pb, api::BlockHeader *info, const api::BlockHeader &prev_info, bool check_pow) const {
+	COMMON_TRACE_SPAN("check_standalone_consensus");
 	const auto &block = pb.block;
 	if (block.transactions.size() != block.header.transaction_hashes.size() || block.transactions.size() != pb.raw_block.transactions.size())
 		return "WRONG_TRANSACTIONS_COUNT";
@@ -348,7 +413,7 @@ std::string BlockChainState::check_standalone_consensus(
 		if (!m_currency.check_block_checkpoint(info->height, info->hash, is_checkpoint))
 			return "CHECKPOINT_BLOCK_HASH_MISMATCH";
 	} else {
-		if(!check_pow)
+		if (!check_pow || m_currency.skip_proof_of_work)
 			return std::string();
 		Hash long_hash = pb.long_block_hash != Hash{} ? pb.long_block_hash
 		                                              : get_block_long_hash(block.header, m_hash_crypto_context);
@@ -643,10 +708,21 @@ void BlockChainState::on_reorganization(
 
 AddTransactionResult BlockChainState::add_transaction(
     const Hash &tid, const Transaction &tx, const BinaryArray &binary_tx, Timestamp now) {
+	static auto &add_transaction_histogram = common::metrics::histogram("varcoind_add_transaction_seconds");
+	static common::metrics::Counter *result_counters[] = {
+	    &common::metrics::counter("varcoind_add_transaction_total", "result=\"ban\""),
+	    &common::metrics::counter("varcoind_add_transaction_total", "result=\"broadcast_all\""),
+	    &common::metrics::counter("varcoind_add_transaction_total", "result=\"already_in_pool\""),
+	    &common::metrics::counter("varcoind_add_transaction_total", "result=\"increase_fee\""),
+	    &common::metrics::counter("varcoind_add_transaction_total", "result=\"failed_to_redo\""),
+	    &common::metrics::counter("varcoind_add_transaction_total", "result=\"output_already_spent\"")};
+	common::metrics::ScopedTimer timer(add_transaction_histogram);
 	//	Timestamp g_timestamp = read_first_seen_timestamp(tid);
 	//	if (g_timestamp != 0 && now > g_timestamp + m_config.mempool_tx_live_time)
 	//		return AddTransactionResult::TOO_OLD;
-	return add_transaction(tid, tx, binary_tx, get_tip_height() + 1, get_tip().timestamp, true);
+	auto result = add_transaction(tid, tx, binary_tx, get_tip_height() + 1, get_tip().timestamp, true);
+	result_counters[static_cast<size_t>(result)]->add();  // Order of AddTransactionResult
+	return result;
 }
 
 AddTransactionResult BlockChainState::add_transaction(const Hash &tid, const Transaction &tx,
@@ -809,25 +885,25 @@ void BlockChainState::remove_from_pool(Hash tid) {
 
 Timestamp BlockChainState::read_first_seen_timestamp(const Hash &tid) const {
 	Timestamp ta = 0;
-	auto key     = FIRST_SEEN_PREFIX + DB::to_binary_key(tid.data, sizeof(tid.data));
 	BinaryArray ba;
-	if (m_db.get(key, ba))
+	if (m_db.get(first_seen_key(tid), ba))
 		seria::from_binary(ta, ba);
 	return ta;
 }
 
 void BlockChainState::update_first_seen_timestamp(const Hash &tid, Timestamp now) {
-	auto key = FIRST_SEEN_PREFIX + DB::to_binary_key(tid.data, sizeof(tid.data));
+	auto key = first_seen_key(tid);
 	if (now != 0)
 		m_db.put(key, seria::to_binary(now), false);
 	else
 		m_db.del(key, false);
 }
 
-RingCheckerMulticore::RingCheckerMulticore() {
-	auto th_count = std::max<size_t>(2, std::thread::hardware_concurrency() / 2);  // we use more energy but have the
-	                                                                               // same speed when using
-	                                                                               // hyperthreading
+RingCheckerMulticore::RingCheckerMulticore(size_t th_count) {
+	if (th_count == 0)
+		th_count = std::max<size_t>(2, std::thread::hardware_concurrency() / 2);  // we use more energy but have the
+		                                                                          // same speed when using
+		                                                                          // hyperthreading
 	std::cout << "Starting multicore ring checker using " << th_count << "/" << std::thread::hardware_concurrency()
 	          << " cpus" << std::endl;
 	for (size_t i = 0; i != th_count; ++i)
@@ -845,6 +921,7 @@ RingCheckerMulticore::~RingCheckerMulticore() {
 }
 
 void RingCheckerMulticore::thread_run() {
+	common::trace::set_thread_name("RingCheckerMulticore");
 	while (true) {
 		RingSignatureArg arg;
 		int local_work_counter = 0;
@@ -864,6 +941,9 @@ void RingCheckerMulticore::thread_run() {
 		output_key_pointers.reserve(arg.output_keys.size());
 		std::for_each(arg.output_keys.begin(), arg.output_keys.end(),
 		    [&output_key_pointers](const PublicKey &key) { output_key_pointers.push_back(&key); });
+		static auto &checked_counter = common::metrics::counter("varcoind_ring_signatures_checked_total");
+		checked_counter.add();
+		COMMON_TRACE_SPAN("check_ring_signature");
 		bool key_corrupted = false;
 		bool result        = check_ring_signature(arg.tx_prefix_hash, arg.key_image, output_key_pointers.data(),
 		    output_key_pointers.size(), arg.signatures.data(), true, &key_corrupted);
@@ -888,6 +968,7 @@ void RingCheckerMulticore::cancel_work() {
 
 std::string RingCheckerMulticore::start_work_get_error(IBlockChainState *state, const Currency &currency,
     const Block &block, Height unlock_height, Timestamp unlock_timestamp) {
+	COMMON_TRACE_SPAN("RingCheckerMulticore::start_work");
 	{
 		std::unique_lock<std::mutex> lock(mu);
 		args.clear();
@@ -939,6 +1020,9 @@ std::string RingCheckerMulticore::start_work_get_error(IBlockChainState *state,
 }
 
 bool RingCheckerMulticore::signatures_valid() const {
+	static auto &wait_histogram = common::metrics::histogram("varcoind_ring_signatures_wait_seconds");
+	common::metrics::ScopedTimer timer(wait_histogram);
+	COMMON_TRACE_SPAN("RingCheckerMulticore::signatures_valid");
 	while (true) {
 		std::unique_lock<std::mutex> lock(mu);
 		if (ready_counter != total_counter) {
@@ -1046,10 +1130,13 @@ bool BlockChainState::redo_block(const Block &block,
 }
 
 bool BlockChainState::redo_block(const Hash &bhash, const Block &block, const api::BlockHeader &info) {
+	static auto &redo_block_histogram = common::metrics::histogram("varcoind_redo_block_seconds");
+	common::metrics::ScopedTimer timer(redo_block_histogram);
+	COMMON_TRACE_SPAN("BlockChainState::redo_block");
 	DeltaState delta(info.height, info.timestamp, this);
 	BlockGlobalIndices global_indices;
 	global_indices.reserve(block.transactions.size() + 1);
-	const bool check_sigs = !m_currency.is_in_checkpoint_zone(info.height + 1);
+	const bool check_sigs = m_check_ring_signatures && !m_currency.is_in_checkpoint_zone(info.height + 1);
 	if (check_sigs && !ring_checker.start_work_get_error(this, m_currency, block, info.height, info.timestamp).empty())
 		return false;
 	if (!redo_block(block, info, &delta, &global_indices))
@@ -1059,10 +1146,8 @@ bool BlockChainState::redo_block(const Hash &bhash, const Block &block, const ap
 	delta.apply(this);  // Will remove from pool by keyimage
 	m_tx_pool_version = 2;
 
-	auto key =
-	    BLOCK_GLOBAL_INDICES_PREFIX + DB::to_binary_key(bhash.data, sizeof(bhash.data)) + BLOCK_GLOBAL_INDICES_SUFFIX;
 	BinaryArray ba = seria::to_binary(global_indices);
-	m_db.put(key, ba, true);
+	m_db.put(block_global_indices_key(bhash), ba, true);
 
 	for (auto th : block.header.transaction_hashes) {
 		update_first_seen_timestamp(th, 0);
@@ -1089,16 +1174,12 @@ void BlockChainState::undo_block(const Hash &bhash, const Block &block, Height h
 	}
 	undo_transaction(this, height, block.header.base_transaction);
 
-	auto key =
-	    BLOCK_GLOBAL_INDICES_PREFIX + DB::to_binary_key(bhash.data, sizeof(bhash.data)) + BLOCK_GLOBAL_INDICES_SUFFIX;
-	m_db.del(key, true);
+	m_db.del(block_global_indices_key(bhash), true);
 }
 
 bool BlockChainState::read_block_output_global_indices(const Hash &bid, BlockGlobalIndices *indices) const {
 	BinaryArray rb;
-	auto key =
-	    BLOCK_GLOBAL_INDICES_PREFIX + DB::to_binary_key(bid.data, sizeof(bid.data)) + BLOCK_GLOBAL_INDICES_SUFFIX;
-	if (!m_db.get(key, rb))
+	if (!m_db.get(block_global_indices_key(bid), rb))
 		return false;
 	seria::from_binary(*indices, rb);
 	return true;
@@ -1140,8 +1221,7 @@ std::vector<api::Output> BlockChainState::get_outputs_by_amount(
 }
 
 void BlockChainState::store_keyimage(const KeyImage &keyimage, Height height) {
-	auto key = KEYIMAGE_PREFIX + DB::to_binary_key(keyimage.data, sizeof(keyimage.data));
-	m_db.put(key, std::string(), true);
+	m_db.put(keyimage_key(keyimage), std::string(), true);
 	auto tit = m_memory_state_ki_tx.find(keyimage);
 	if (tit == m_memory_state_ki_tx.end())
 		return;
@@ -1149,14 +1229,12 @@ void BlockChainState::store_keyimage(const KeyImage &keyimage, Height height) {
 }
 
 void BlockChainState::delete_keyimage(const KeyImage &keyimage) {
-	auto key = KEYIMAGE_PREFIX + DB::to_binary_key(keyimage.data, sizeof(keyimage.data));
-	m_db.del(key, true);
+	m_db.del(keyimage_key(keyimage), true);
 }
 
 bool BlockChainState::read_keyimage(const KeyImage &keyimage) const {
-	auto key = KEYIMAGE_PREFIX + DB::to_binary_key(keyimage.data, sizeof(keyimage.data));
-	BinaryArray rb;
-	return m_db.get(key, rb);
+	DB::Value rb;  // no copy of value
+	return m_db.get(keyimage_key(keyimage), rb);
 }
 
 uint32_t BlockChainState::push_amount_output(Amount amount,
@@ -1165,23 +1243,18 @@ uint32_t BlockChainState::push_amount_output(Amount amount,
     Timestamp block_unlock_timestamp,
     const PublicKey &pk) {
 	uint32_t my_gi = next_global_index_for_amount(amount);
-	auto key       = AMOUNT_OUTPUT_PREFIX + common::write_varint_sqlite4(amount) + common::write_varint_sqlite4(my_gi);
 	BinaryArray ba = seria::to_binary(std::make_pair(unlock_time, pk));
-	m_db.put(key, ba, true);
+	m_db.put(amount_output_key(amount, my_gi), ba, true);
 
 	if (create_unlock_index &&
 	    !m_currency.is_transaction_spend_time_unlocked(unlock_time, block_height, block_unlock_timestamp)) {
-		std::string unkey;
 		uint32_t clamped_unlock_time = static_cast<uint32_t>(std::min<UnlockMoment>(unlock_time, 0xFFFFFFFF));
-		if (m_currency.is_transaction_spend_time_block(unlock_time))
-			unkey = UNLOCK_BLOCK_PREFIX;
-		else
-			unkey = UNLOCK_TIME_PREFIX;
-		unkey += common::write_varint_sqlite4(amount) + common::write_varint_sqlite4(clamped_unlock_time) +
-		         common::write_varint_sqlite4(my_gi);
-		m_db.put(unkey, std::string(), true);
+		const std::string &unprefix =
+		    m_currency.is_transaction_spend_time_block(unlock_time) ? UNLOCK_BLOCK_PREFIX : UNLOCK_TIME_PREFIX;
+		m_db.put(unlock_key(unprefix, amount, clamped_unlock_time, my_gi), std::string(), true);
 	}
 	m_next_gi_for_amount[amount] += 1;
+	m_next_gi_dirty = true;
 	return my_gi;
 }
 
@@ -1191,7 +1264,7 @@ void BlockChainState::pop_amount_output(Amount amount, UnlockMoment unlock_time,
 		throw std::logic_error("BlockChainState::pop_amount_output underflow");
 	next_gi -= 1;
 	m_next_gi_for_amount[amount] -= 1;
-	auto key = AMOUNT_OUTPUT_PREFIX + common::write_varint_sqlite4(amount) + common::write_varint_sqlite4(next_gi);
+	m_next_gi_dirty = true;
 
 	UnlockMoment was_unlock_time = 0;
 	PublicKey was_pk;
@@ -1199,38 +1272,83 @@ void BlockChainState::pop_amount_output(Amount amount, UnlockMoment unlock_time,
 		throw std::logic_error("BlockChainState::pop_amount_output element does not exist");
 	if (was_unlock_time != unlock_time || was_pk != pk)
 		throw std::logic_error("BlockChainState::pop_amount_output popping wrong element");
-	m_db.del(key, true);
+	m_db.del(amount_output_key(amount, next_gi), true);
 
 	if (create_unlock_index &&
 	    !m_currency.is_transaction_spend_time_unlocked(unlock_time, get_tip_height(), get_tip().timestamp_unlock)) {
-		std::string unkey;
 		uint32_t clamped_unlock_time = static_cast<uint32_t>(std::min<UnlockMoment>(unlock_time, 0xFFFFFFFF));
-		if (m_currency.is_transaction_spend_time_block(unlock_time))
-			unkey = UNLOCK_BLOCK_PREFIX;
-		else
-			unkey = UNLOCK_TIME_PREFIX;
-		unkey += common::write_varint_sqlite4(amount) + common::write_varint_sqlite4(clamped_unlock_time) +
-		         common::write_varint_sqlite4(next_gi);
-		m_db.del(unkey, true);
+		const std::string &unprefix =
+		    m_currency.is_transaction_spend_time_block(unlock_time) ? UNLOCK_BLOCK_PREFIX : UNLOCK_TIME_PREFIX;
+		m_db.del(unlock_key(unprefix, amount, clamped_unlock_time, next_gi), true);
 	}
 }
 
 uint32_t BlockChainState::next_global_index_for_amount(Amount amount) const {
 	auto it = m_next_gi_for_amount.find(amount);
-	if (it != m_next_gi_for_amount.end())
-		return it->second;
-	std::string prefix = AMOUNT_OUTPUT_PREFIX + common::write_varint_sqlite4(amount);
-	DB::Cursor cur2    = m_db.rbegin(prefix);
-	uint32_t alt_in = cur2.end() ? 0 : boost::lexical_cast<Height>(common::read_varint_sqlite4(cur2.get_suffix())) + 1;
-	m_next_gi_for_amount[amount] = alt_in;
-	return alt_in;
+	return it == m_next_gi_for_amount.end() ? 0 : it->second;  // Table is complete, absent amount has no outputs
+}
+
+void BlockChainState::read_next_gi_table() {
+	BinaryArray ba;
+	if (m_db.get(NEXT_GI_KEY, ba)) {
+		std::vector<std::pair<Amount, uint32_t>> table;
+		seria::from_binary(table, ba);
+		m_next_gi_for_amount.insert(table.begin(), table.end());
+		return;
+	}
+	// Record is absent in DB before version 5, rebuild with one seek per amount instead of reading all outputs
+	auto idea_start = std::chrono::steady_clock::now();
+	std::string middle;
+	while (true) {
+		DB::Cursor cur = m_db.begin(AMOUNT_OUTPUT_PREFIX, middle);
+		if (cur.end())
+			break;
+		const char *be = cur.get_suffix().data();
+		const char *en = be + cur.get_suffix().size();
+		Amount amount  = common::read_varint_sqlite4(be, en);
+		DB::Cursor cur2 = m_db.rbegin(AMOUNT_OUTPUT_PREFIX + common::write_varint_sqlite4(amount));
+		m_next_gi_for_amount[amount] =
+		    boost::lexical_cast<uint32_t>(common::read_varint_sqlite4(cur2.get_suffix())) + 1;
+		if (amount == std::numeric_limits<Amount>::max())
+			break;
+		middle = common::write_varint_sqlite4(amount + 1);
+	}
+	m_next_gi_dirty = true;
+	auto idea_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - idea_start);
+	std::cout << "Built next global index table amounts=" << m_next_gi_for_amount.size()
+	          << " seconds=" << double(idea_ms.count()) / 1000 << std::endl;
+}
+
+void BlockChainState::on_db_commit() {
+	if (!m_next_gi_dirty)
+		return;
+	std::vector<std::pair<Amount, uint32_t>> table;
+	table.reserve(m_next_gi_for_amount.size());
+	for (auto &&nit : m_next_gi_for_amount)
+		if (nit.second != 0)
+			table.push_back(nit);
+	std::sort(table.begin(), table.end());
+	m_db.put(NEXT_GI_KEY, seria::to_binary(table), false);
+	m_next_gi_dirty = false;
+}
+
+std::map<Amount, uint32_t> BlockChainState::get_output_counts(const std::vector<Amount> &amounts) const {
+	std::map<Amount, uint32_t> result;
+	if (amounts.empty()) {
+		for (auto &&nit : m_next_gi_for_amount)
+			if (nit.second != 0)
+				result.insert(nit);
+		return result;
+	}
+	for (auto amount : amounts)
+		result[amount] = next_global_index_for_amount(amount);
+	return result;
 }
 
 bool BlockChainState::read_amount_output(
     Amount amount, uint32_t global_index, UnlockMoment *unlock_time, PublicKey *pk) const {
-	auto key = AMOUNT_OUTPUT_PREFIX + common::write_varint_sqlite4(amount) + common::write_varint_sqlite4(global_index);
 	BinaryArray rb;
-	if (!m_db.get(key, rb))
+	if (!m_db.get(amount_output_key(amount, global_index), rb))
 		return false;
 	std::pair<uint64_t, PublicKey> was;
 	seria::from_binary(was, rb);
@@ -1286,3 +1404,70 @@ void BlockChainState::test_print_outputs() {
 		}
 	}
 }
+
+void BlockChainState::test_benchmark_lookups(size_t count) {
+	std::vector<Hash> bids;
+	std::vector<KeyImage> keyimages;
+	std::vector<std::pair<Amount, uint32_t>> outputs;
+	std::vector<std::vector<Hash>> locators;
+	for (size_t attempts = 0; attempts != count && keyimages.size() < count; ++attempts) {
+		Height ha = crypto::rand<Height>() % (get_tip_height() + 1);
+		Hash bid  = read_chain(ha);
+		if (locators.size() < count / 10) {  // Peer which is behind us or on fork
+			locators.push_back(get_sparse_chain(ha));
+			locators.back().insert(locators.back().begin(), crypto::rand<Hash>());
+		}
+		RawBlock rb;
+		Block block;
+		if (!read_block(bid, &rb) || !block.from_raw_block(rb))
+			throw std::logic_error("test_benchmark_lookups block not found, invariant dead");
+		bids.push_back(bid);
+		for (auto &&tx : block.transactions)
+			for (auto &&input : tx.inputs)
+				if (input.type() == typeid(KeyInput)) {
+					const KeyInput &in = boost::get<KeyInput>(input);
+					keyimages.push_back(in.key_image);
+					uint32_t total_count = next_global_index_for_amount(in.amount);
+					if (total_count != 0)
+						outputs.push_back(std::make_pair(in.amount, crypto::rand<uint32_t>() % total_count));
+				}
+	}
+	std::cout << "Benchmarking lookups, blocks=" << bids.size() << " keyimages=" << keyimages.size()
+	          << " outputs=" << outputs.size() << std::endl;
+	auto idea_start = std::chrono::steady_clock::now();
+	auto print_rate = [&](const char *name, size_t counter) {
+		auto now     = std::chrono::steady_clock::now();
+		auto idea_us = std::chrono::duration_cast<std::chrono::microseconds>(now - idea_start).count();
+		std::cout << name << " lookups/s=" << (idea_us == 0 ? 0 : counter * 1000000 / idea_us) << std::endl;
+		idea_start = now;
+	};
+	size_t found = 0;
+	for (auto &&ki : keyimages)
+		found += read_keyimage(ki) ? 1 : 0;
+	print_rate("read_keyimage", keyimages.size());
+	for (auto &&amgi : outputs) {
+		UnlockMoment unlock_time = 0;
+		PublicKey pk;
+		found += read_amount_output(amgi.first, amgi.second, &unlock_time, &pk) ? 1 : 0;
+	}
+	print_rate("read_amount_output", outputs.size());
+	for (auto &&bid : bids)
+		found += has_block(bid) ? 1 : 0;
+	print_rate("has_block", bids.size());
+	for (auto &&locator : locators) {
+		Height start_height = 0;
+		found += get_sync_headers_chain(locator, &start_height, 1000).empty() ? 0 : 1;
+	}
+	print_rate("get_sync_headers_chain", locators.size());
+	for (size_t i = 0; i != locators.size(); ++i)
+		found += get_sparse_chain().empty() ? 0 : 1;
+	print_rate("get_sparse_chain", locators.size());
+	for (auto &&tip : get_tips())  // Side chains, then deep reorgs to random main chain blocks
+		found += get_common_block(get_tip_bid(), tip.second, nullptr, nullptr) == Hash{} ? 0 : 1;
+	for (auto &&bid : bids)
+		found += get_common_block(get_tip_bid(), bid, nullptr, nullptr) == bid ? 1 : 0;
+	print_rate("get_common_block", get_tips().size() + bids.size());
+	std::cout << "Found " << found << "/"
+	          << keyimages.size() + outputs.size() + 2 * bids.size() + 2 * locators.size() + get_tips().size()
+	          << std::endl;
+}
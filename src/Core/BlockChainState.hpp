@@ -54,7 +54,7 @@ class RingCheckerMulticore {
 	void thread_run();
 
 public:
-	RingCheckerMulticore();
+	explicit RingCheckerMulticore(size_t th_count);  // 0 - half of cpus
 	~RingCheckerMulticore();
 	void cancel_work();
 	std::string start_work_get_error(IBlockChainState *state, const Currency &currency, const Block &block,
@@ -70,6 +70,7 @@ public:
 	uint32_t get_next_effective_median_size() const;
 
 	std::vector<api::Output> get_outputs_by_amount(Amount, size_t anonymity, Height, Timestamp) const;
+	std::map<Amount, uint32_t> get_output_counts(const std::vector<Amount> &amounts) const;  // empty - all amounts
 	typedef std::vector<std::vector<uint32_t>> BlockGlobalIndices;
 	bool read_block_output_global_indices(const Hash &bid, BlockGlobalIndices *) const;
 
@@ -98,6 +99,7 @@ public:
 	static api::BlockHeader fill_genesis(Hash genesis_bid, const BlockTemplate &);
 
 	void test_print_outputs();
+	void test_benchmark_lookups(size_t count);
 
 protected:
 	virtual std::string check_standalone_consensus(
@@ -152,9 +154,13 @@ private:
 	//	const Config &m_config;
 	const Currency &m_currency;
 	logging::LoggerRef m_log;
+	const bool m_check_ring_signatures;
 	mutable crypto::CryptoNightContext m_hash_crypto_context;
-	mutable std::unordered_map<Amount, uint32_t>
-	    m_next_gi_for_amount;  // Read from db on first use, write on modification
+	// Output count for every amount, loaded in one read on start and written on db_commit if modified
+	std::unordered_map<Amount, uint32_t> m_next_gi_for_amount;
+	bool m_next_gi_dirty = false;
+	void read_next_gi_table();
+	virtual void on_db_commit() override;
 
 	void update_first_seen_timestamp(const Hash &tid, Timestamp now);  // 0 to delete
 
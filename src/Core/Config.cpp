@@ -25,6 +25,10 @@ using namespace varcoin;
 
 Config::Config(common::CommandLine &cmd)
     : is_testnet(cmd.get_bool("--testnet"))
+    , is_regtest(cmd.get_bool("--regtest"))
+    , regtest_skip_pow(cmd.get_bool("--regtest-skip-pow"))
+    , regtest_max_block_size(0)
+    , regtest_unlock_window(0)
     , mempool_tx_live_time(parameters::VARNOTE_MEMPOOL_TX_LIVETIME)
     , blocks_file_name(parameters::VARNOTE_BLOCKS_FILENAME)
     , block_indexes_file_name(parameters::VARNOTE_BLOCKINDEXES_FILENAME)
@@ -37,8 +41,11 @@ Config::Config(common::CommandLine &cmd)
     , varcoind_bind_ip("127.0.0.1")  // Less attack vectors from outside for ordinary uses
     , varcoind_remote_port(0)
     , varcoind_remote_ip("127.0.0.1")
+    , varcoind_remote_connections(4)
+    , varcoind_remote_pipeline(2)
     , walletd_bind_port(WALLET_RPC_DEFAULT_PORT)
     , walletd_bind_ip("127.0.0.1")  // Connection to wallet allows spending
+    , rpc_max_in_flight(8)
     , p2p_local_white_list_limit(P2P_LOCAL_WHITE_PEERLIST_LIMIT)
     , p2p_local_gray_list_limit(P2P_LOCAL_GRAY_PEERLIST_LIMIT)
     , p2p_default_peers_in_handshake(P2P_DEFAULT_PEERS_IN_HANDSHAKE)
@@ -47,14 +54,24 @@ Config::Config(common::CommandLine &cmd)
     , p2p_whitelist_connections_percent(P2P_DEFAULT_WHITELIST_CONNECTIONS_PERCENT)
     , p2p_block_ids_sync_default_count(BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT)
     , p2p_blocks_sync_default_count(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)
-    , rpc_get_blocks_fast_max_count(COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT) {
+    , rpc_get_blocks_fast_max_count(COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT)
+    , ring_checker_threads(0)
+    , check_ring_signatures(true) {
 	common::pod_from_hex(P2P_STAT_TRUSTED_PUB_KEY, trusted_public_key);
 
+	if (const char *pa = cmd.get("--regtest-max-block-size"))
+		regtest_max_block_size = boost::lexical_cast<uint32_t>(pa);
+	if (const char *pa = cmd.get("--regtest-unlock-window"))
+		regtest_unlock_window = boost::lexical_cast<Height>(pa);
+	if (!is_regtest && (regtest_skip_pow || regtest_max_block_size != 0 || regtest_unlock_window != 0))
+		throw std::runtime_error("--regtest-* options can be used only with --regtest");
+	if (is_regtest)
+		is_testnet = true;
 	if (is_testnet) {
-		network_id.data[0] += 1;
-		p2p_bind_port += 1000;
-		p2p_external_port += 1000;
-		varcoind_bind_port += 1000;
+		network_id.data[0] += is_regtest ? 2 : 1;
+		p2p_bind_port += is_regtest ? 2000 : 1000;
+		p2p_external_port += is_regtest ? 2000 : 1000;
+		varcoind_bind_port += is_regtest ? 2000 : 1000;
 		p2p_allow_local_ip = true;
 	}
 	if (const char *pa = cmd.get("--p2p-bind-address")) {
@@ -67,6 +84,8 @@ Config::Config(common::CommandLine &cmd)
 		if (!common::parse_ip_address_and_port(pa, &walletd_bind_ip, &walletd_bind_port))
 			throw std::runtime_error("Wrong address format " + std::string(pa) + ", should be ip:port");
 	}
+	if (const char *pa = cmd.get("--rpc-max-in-flight"))
+		rpc_max_in_flight = std::max<size_t>(1, boost::lexical_cast<size_t>(pa));
 	if (const char *pa = cmd.get("--ssl-certificate-pem-file")) {
 		ssl_certificate_pem_file = pa;
 #if !platform_USE_SSL
@@ -111,6 +130,10 @@ Config::Config(common::CommandLine &cmd)
 				throw std::runtime_error("Wrong address format " + addr + ", should be ip:port");
 		}
 	}
+	if (const char *pa = cmd.get("--varcoind-connections"))
+		varcoind_remote_connections = std::max<size_t>(1, boost::lexical_cast<size_t>(pa));
+	if (const char *pa = cmd.get("--varcoind-pipeline"))
+		varcoind_remote_pipeline = std::max<size_t>(1, boost::lexical_cast<size_t>(pa));
 	if (cmd.get_bool("--allow-local-ip"))
 		p2p_allow_local_ip = true;
 	for (auto &&pa : cmd.get_array("--seed-node-address"))
@@ -140,7 +163,7 @@ Config::Config(common::CommandLine &cmd)
 
 	data_folder = platform::get_app_data_folder(crypto_note_name);
 	if (is_testnet)
-		data_folder += "_testnet";
+		data_folder += is_regtest ? "_regtest" : "_testnet";
 	if (const char *pa = cmd.get("--data-folder")) {
 		data_folder = pa;
 		if (!platform::directory_exists(data_folder))
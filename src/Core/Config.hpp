@@ -18,6 +18,10 @@ public:
 	explicit Config(common::CommandLine &cmd);
 
 	bool is_testnet;
+	bool is_regtest;  // Private chain for load tests, implies is_testnet
+	bool regtest_skip_pow;
+	uint32_t regtest_max_block_size;  // 0 - same as testnet
+	Height regtest_unlock_window;
 	Timestamp locked_tx_allowed_delta_seconds;
 	Height locked_tx_allowed_delta_blocks;
 
@@ -42,10 +46,13 @@ public:
 	std::string varcoind_bind_ip;
 	uint16_t varcoind_remote_port;
 	std::string varcoind_remote_ip;
+	size_t varcoind_remote_connections;  // walletd commands to varcoind are spread over that many connections
+	size_t varcoind_remote_pipeline;     // and pipelined that deep on each connection
 
 	std::string walletd_authorization;
 	uint16_t walletd_bind_port;
 	std::string walletd_bind_ip;
+	size_t rpc_max_in_flight;  // Pipelined requests from one RPC client processed before earlier responses are sent
 
 	size_t p2p_local_white_list_limit;
 	size_t p2p_local_gray_list_limit;
@@ -58,6 +65,10 @@ public:
 	size_t p2p_blocks_sync_default_count;
 	size_t rpc_get_blocks_fast_max_count;
 
+	// Not settable from command line, used by benchmarks
+	size_t ring_checker_threads;  // 0 - half of cpus
+	bool check_ring_signatures;   // outside checkpoint zone
+
 	std::vector<NetworkAddress> exclusive_nodes;
 	std::vector<NetworkAddress> seed_nodes;
 	std::vector<NetworkAddress> priority_nodes;  // Those nodes have reconnect and ban periods greatly reduced
@@ -2,6 +2,7 @@
 // Licensed under the GNU Lesser General Public License. See LICENSE for details.
 
 #include "Currency.hpp"
+#include "Config.hpp"
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/lexical_cast.hpp>
 #include <cctype>
@@ -103,6 +104,20 @@ Currency::Currency(bool is_testnet)
 	genesis_block_hash = get_block_hash(genesis_block_template);
 }
 
+Currency::Currency(const Config &config) : Currency(config.is_testnet) {
+	if (!config.is_regtest)
+		return;
+	is_regtest                = true;
+	skip_proof_of_work        = config.regtest_skip_pow;
+	mined_money_unlock_window = config.regtest_unlock_window;
+	if (config.regtest_max_block_size != 0) {
+		max_block_size_initial         = config.regtest_max_block_size;
+		block_granted_full_reward_zone = config.regtest_max_block_size;
+	}
+	genesis_block_template.nonce += 1;  // Regtest blocks must never be accepted by testnet nodes
+	genesis_block_hash = get_block_hash(genesis_block_template);
+}
+
 size_t Currency::checkpoint_count() const { return is_testnet ? 1 : sizeof(CHECKPOINTS) / sizeof(*CHECKPOINTS); }
 
 bool Currency::is_in_checkpoint_zone(Height index) const {
@@ -145,7 +160,7 @@ uint8_t Currency::get_block_major_version_for_height(Height height) const {
 }
 
 uint32_t Currency::block_granted_full_reward_zone_by_block_version(uint8_t block_major_version) const {
-	if (block_major_version >= 3)
+	if (block_major_version >= 3 || is_regtest)
 		return block_granted_full_reward_zone;
 	if (block_major_version == 2)
 		return varcoin::parameters::VARNOTE_BLOCK_GRANTED_FULL_REWARD_ZONE_V2;
@@ -297,21 +312,28 @@ uint64_t Currency::get_penalized_amount(uint64_t amount, size_t median_size, siz
 	return penalized_amount_lo;
 }
 
+// Binary form of AccountPublicAddress is spend key followed by view key, we avoid seria to parse without allocations
+static const size_t ACCOUNT_ADDRESS_BINARY_SIZE = 2 * sizeof(PublicKey);
+
+static void format_account_address(uint64_t prefix, const AccountPublicAddress &adr, std::string *str) {
+	uint8_t data[ACCOUNT_ADDRESS_BINARY_SIZE];
+	memcpy(data, adr.spend_public_key.data, sizeof(PublicKey));
+	memcpy(data + sizeof(PublicKey), adr.view_public_key.data, sizeof(PublicKey));
+	common::base58::encode_addr(prefix, data, sizeof(data), str);
+}
+
 std::string Currency::get_account_address_as_str(uint64_t prefix, const AccountPublicAddress &adr) {
-	BinaryArray ba = seria::to_binary(adr);
-	return common::base58::encode_addr(prefix, ba);
+	std::string result;
+	format_account_address(prefix, adr, &result);
+	return result;
 }
 
 bool Currency::parse_account_address_string(uint64_t *prefix, AccountPublicAddress *adr, const std::string &str) {
-	BinaryArray data;
-
-	if (!common::base58::decode_addr(str, prefix, &data))
-		return false;
-	try {
-		seria::from_binary(*adr, data);
-	} catch (const std::exception &) {
+	uint8_t data[ACCOUNT_ADDRESS_BINARY_SIZE];
+	if (!common::base58::decode_addr(str, prefix, data, sizeof(data)))
 		return false;
-	}
+	memcpy(adr->spend_public_key.data, data, sizeof(PublicKey));
+	memcpy(adr->view_public_key.data, data + sizeof(PublicKey), sizeof(PublicKey));
 	return key_isvalid(adr->spend_public_key) && key_isvalid(adr->view_public_key);
 }
 
@@ -332,6 +354,28 @@ bool Currency::parse_account_address_string(const std::string &str, AccountPubli
 	return true;
 }
 
+size_t Currency::parse_account_address_strings(const std::vector<std::string> &strs,
+    std::vector<AccountPublicAddress> *addrs, std::vector<bool> *valid) const {
+	addrs->resize(strs.size());
+	valid->assign(strs.size(), false);
+	size_t valid_count = 0;
+	for (size_t i = 0; i != strs.size(); ++i) {
+		uint64_t prefix = 0;
+		if (parse_account_address_string(&prefix, &(*addrs)[i], strs[i]) && prefix == public_address_base58_prefix) {
+			(*valid)[i] = true;
+			valid_count += 1;
+		}
+	}
+	return valid_count;
+}
+
+void Currency::account_addresses_as_strings(
+    const std::vector<AccountPublicAddress> &addrs, std::vector<std::string> *strs) const {
+	strs->resize(addrs.size());
+	for (size_t i = 0; i != addrs.size(); ++i)
+		format_account_address(public_address_base58_prefix, addrs[i], &(*strs)[i]);
+}
+
 std::string Currency::format_amount(size_t number_of_decimal_places, Amount amount) {
 	std::string s = common::to_string(amount);
 	if (s.size() < number_of_decimal_places + 1)
@@ -386,6 +430,8 @@ bool Currency::parse_amount(size_t number_of_decimal_places, const std::string &
 Difficulty Currency::next_difficulty(
     std::vector<Timestamp> timestamps, std::vector<Difficulty> cumulative_difficulties) const {
 	assert(difficulty_window >= 2);
+	if (is_regtest)
+		return 1;
 
 	if (timestamps.size() > difficulty_window) {
 		timestamps.resize(difficulty_window);
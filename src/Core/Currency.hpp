@@ -11,14 +11,19 @@
 
 namespace varcoin {
 
+class Config;
+
 class Currency {  // Consensus calcs depend on those parameters
 public:
 	static const std::vector<Amount> PRETTY_AMOUNTS;
 	static const std::vector<Amount> DECIMAL_PLACES;
 
 	explicit Currency(bool is_testnet);
+	explicit Currency(const Config &);  // Applies regtest parameters
 
 	bool is_testnet;
+	bool is_regtest         = false;  // Difficulty is always 1
+	bool skip_proof_of_work = false;  // Only in regtest, blocks are accepted without calculating long hash
 	BlockTemplate genesis_block_template{};
 	Hash genesis_block_hash{};
 
@@ -66,6 +71,7 @@ public:
 	size_t checkpoint_count() const;
 	bool is_in_checkpoint_zone(Height index) const;
 	bool check_block_checkpoint(Height index, const crypto::Hash &h, bool &is_checkpoint) const;
+	bool need_proof_of_work(Height index) const { return !skip_proof_of_work && !is_in_checkpoint_zone(index); }
 	std::pair<Height, crypto::Hash> last_checkpoint() const;
 
 	uint32_t block_granted_full_reward_zone_by_block_version(uint8_t block_major_version) const;
@@ -80,6 +86,12 @@ public:
 
 	std::string account_address_as_string(const AccountPublicAddress &account_public_address) const;
 	bool parse_account_address_string(const std::string &str, AccountPublicAddress *addr) const;
+	// Bulk versions for payout and deposit batches, output vectors are resized, their buffers are reused.
+	// valid[i] tells if strs[i] is address of this currency, returns number of such addresses
+	size_t parse_account_address_strings(const std::vector<std::string> &strs,
+	    std::vector<AccountPublicAddress> *addrs, std::vector<bool> *valid) const;
+	void account_addresses_as_strings(
+	    const std::vector<AccountPublicAddress> &addrs, std::vector<std::string> *strs) const;
 
 	std::string format_amount(Amount amount) const { return format_amount(number_of_decimal_places, amount); }
 	std::string format_amount(SignedAmount amount) const { return format_amount(number_of_decimal_places, amount); }
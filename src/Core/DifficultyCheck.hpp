@@ -5,7 +5,7 @@
 namespace varcoin {
 struct DifficultyCheck {
 	Height height;
-	const char *hash;
+	Hash hash;  // binary, so startup does not spend time parsing hex
 	Difficulty cumulative_difficulty;
 };
 
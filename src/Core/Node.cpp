@@ -2,12 +2,17 @@
 // Licensed under the GNU Lesser General Public License. See LICENSE for details.
 
 #include "Node.hpp"
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <iostream>
+#include <iterator>
 #include "Config.hpp"
 #include "VarNoteTools.hpp"
 #include "TransactionExtra.hpp"
 #include "common/JsonValue.hpp"
+#include "common/Metrics.hpp"
+#include "common/Trace.hpp"
+#include "p2p/PoolSketch.hpp"
 #include "platform/PathTools.hpp"
 #include "seria/BinaryInputStream.hpp"
 #include "seria/BinaryOutputStream.hpp"
@@ -44,7 +49,7 @@ Node::Node(logging::ILogger &log, const Config &config, BlockChainState &block_c
 	if (!config.varcoind_bind_ip.empty() && config.varcoind_bind_port != 0)
 		m_api.reset(new http::Server(config.varcoind_bind_ip, config.varcoind_bind_port,
 		    std::bind(&Node::on_api_http_request, this, _1, _2, _3), std::bind(&Node::on_api_http_disconnect, this, _1),
-		    config.ssl_certificate_pem_file,
+		    config.rpc_max_in_flight, config.ssl_certificate_pem_file,
 		    config.ssl_certificate_password ? config.ssl_certificate_password.get() : std::string()));
 
 	m_commit_timer.once(DB_COMMIT_PERIOD_VARCOIND);
@@ -71,8 +76,17 @@ bool Node::on_idle() {
 }
 
 void Node::sync_transactions(P2PClientVarcoin *who) {
+	if (who->get_features() & P2P_FEATURE_POOL_SKETCH) {
+		who->m_sketch_retried = false;
+		send_pool_sketch(who, POOL_SKETCH_INITIAL_CELLS);
+	} else
+		send_pool_hashes(who);
+}
+
+void Node::send_pool_hashes(P2PClientVarcoin *who) {
+	who->m_sketch_cells = 0;
 	NOTIFY_REQUEST_TX_POOL::request msg;
-	auto mytxs = m_block_chain.get_memory_state_transactions();
+	const auto &mytxs = m_block_chain.get_memory_state_transactions();
 	msg.txs.reserve(mytxs.size());
 	for (auto &&tx : mytxs) {
 		msg.txs.push_back(tx.first);
@@ -81,6 +95,23 @@ void Node::sync_transactions(P2PClientVarcoin *who) {
 	who->send(std::move(raw_msg));
 }
 
+void Node::send_pool_sketch(P2PClientVarcoin *who, size_t cell_count) {
+	const auto &mytxs = m_block_chain.get_memory_state_transactions();
+	// Small pools and large differences are cheaper to sync by sending all hashes
+	if (cell_count > PoolSketch::MAX_CELLS || cell_count * PoolSketch::CELL_SIZE >= mytxs.size() * sizeof(Hash))
+		return send_pool_hashes(who);
+	NOTIFY_REQUEST_TX_POOL_SKETCH::request msg;
+	msg.salt = crypto::rand<uint64_t>();
+	PoolSketch sketch(cell_count);
+	for (auto &&tx : mytxs)
+		sketch.insert(PoolSketch::short_id(tx.first, msg.salt));
+	msg.sketch          = sketch.to_binary();
+	who->m_sketch_cells = cell_count;
+	BinaryArray raw_msg =
+	    LevinProtocol::send_message(NOTIFY_REQUEST_TX_POOL_SKETCH::ID, LevinProtocol::encode(msg), false);
+	who->send(std::move(raw_msg));
+}
+
 void Node::P2PClientVarcoin::on_msg_bytes(size_t, size_t) {  // downloaded. uploaded
 	//    node->peers.on_peer_bytes(get_address(), downloaded, uploaded,
 	//    node->p2p.get_local_time());
@@ -139,23 +170,60 @@ void Node::P2PClientVarcoin::on_msg_notify_request_chain(NOTIFY_RESPONSE_CHAIN_E
 	m_node->m_downloader.on_msg_notify_request_chain(this, req);
 }
 
+std::shared_ptr<const BinaryArray> Node::BlockResponseCache::get(const Hash &bid) {
+	auto it = m_items.find(bid);
+	if (it == m_items.end())
+		return nullptr;
+	m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+	return it->second.encoded;
+}
+
+void Node::BlockResponseCache::put(const Hash &bid, std::shared_ptr<const BinaryArray> encoded) {
+	if (encoded->size() > m_max_size / 4 || m_items.count(bid) != 0)
+		return;  // Huge blocks would evict everything else
+	m_total_size += encoded->size();
+	m_lru.push_front(bid);
+	m_items[bid] = Item{std::move(encoded), m_lru.begin()};
+	while (m_total_size > m_max_size) {
+		auto it = m_items.find(m_lru.back());
+		m_total_size -= it->second.encoded->size();
+		m_items.erase(it);
+		m_lru.pop_back();
+	}
+}
+
 void Node::P2PClientVarcoin::on_msg_notify_request_objects(NOTIFY_REQUEST_GET_OBJECTS::request &&req) {
-	NOTIFY_RESPONSE_GET_OBJECTS::request msg;
+	static auto &hit_counter    = common::metrics::counter("varcoind_block_response_cache_hits_total");
+	static auto &miss_counter   = common::metrics::counter("varcoind_block_response_cache_misses_total");
+	static auto &cache_gauge    = common::metrics::gauge("varcoind_block_response_cache_bytes");
+	static auto &served_counter = common::metrics::counter("varcoind_p2p_served_block_bytes_total");
+	NOTIFY_RESPONSE_GET_OBJECTS::encoded_request msg;
 	msg.current_blockchain_height = m_node->m_block_chain.get_tip_height() + 1;
 	for (auto &&bh : req.blocks) {
+		auto encoded = m_node->m_block_response_cache.get(bh);
+		if (encoded) {
+			hit_counter.add();
+			msg.blocks.push_back(std::move(encoded));
+			continue;
+		}
 		RawBlock raw_block;
 		if (m_node->m_block_chain.read_block(bh, &raw_block)) {
-			msg.blocks.push_back(RawBlockLegacy{raw_block.block, raw_block.transactions});
+			miss_counter.add();
+			encoded = std::make_shared<BinaryArray>(LevinProtocol::encode(
+			    RawBlockLegacy{std::move(raw_block.block), std::move(raw_block.transactions)}));
+			m_node->m_block_response_cache.put(bh, encoded);
+			msg.blocks.push_back(std::move(encoded));
 		} else
 			msg.missed_ids.push_back(bh);
 	}
+	cache_gauge.set(m_node->m_block_response_cache.get_total_size());
 	if (!req.txs.empty()) {
 		// TODO - remove after we are sure transactions are never asked
 		throw std::runtime_error(
 		    "Transactions asked in NOTIFY_REQUEST_GET_OBJECTS by " + common::ip_address_to_string(get_address().ip));
 	}
-	BinaryArray raw_msg =
-	    LevinProtocol::send_message(NOTIFY_RESPONSE_GET_OBJECTS::ID, LevinProtocol::encode(msg), false);
+	BinaryArray raw_msg = LevinProtocol::encode_message(NOTIFY_RESPONSE_GET_OBJECTS::ID, msg, false);
+	served_counter.add(raw_msg.size());
 	send(std::move(raw_msg));
 }
 
@@ -172,7 +240,7 @@ void Node::P2PClientVarcoin::on_disconnect(const std::string &ban_reason) {
 
 void Node::P2PClientVarcoin::on_msg_notify_request_tx_pool(NOTIFY_REQUEST_TX_POOL::request &&req) {
 	NOTIFY_NEW_TRANSACTIONS::request msg;
-	auto mytxs = m_node->m_block_chain.get_memory_state_transactions();
+	const auto &mytxs = m_node->m_block_chain.get_memory_state_transactions();
 	msg.txs.reserve(mytxs.size());
 	std::sort(req.txs.begin(), req.txs.end());  // Should have been sorted on wire,
 	                                            // checked here, but alas, legacy
@@ -191,6 +259,70 @@ void Node::P2PClientVarcoin::on_msg_notify_request_tx_pool(NOTIFY_REQUEST_TX_POO
 	send(std::move(raw_msg));
 }
 
+void Node::P2PClientVarcoin::on_msg_notify_request_tx_pool(NOTIFY_REQUEST_TX_POOL_SKETCH::request &&req) {
+	static auto &decoded_counter = common::metrics::counter("varcoind_pool_sketches_total", "result=\"decoded\"");
+	static auto &failed_counter  = common::metrics::counter("varcoind_pool_sketches_total", "result=\"failed\"");
+	const size_t cell_count      = req.sketch.size() / PoolSketch::CELL_SIZE;
+	if (req.sketch.size() % (PoolSketch::CELL_SIZE * PoolSketch::HASH_COUNT) != 0 ||
+	    cell_count < PoolSketch::MIN_CELLS || cell_count > PoolSketch::MAX_CELLS) {
+		disconnect("NOTIFY_REQUEST_TX_POOL_SKETCH wrong sketch size=" + common::to_string(req.sketch.size()));
+		return;
+	}
+	const auto &mytxs = m_node->m_block_chain.get_memory_state_transactions();
+	PoolSketch sketch(cell_count);
+	std::unordered_map<uint64_t, const BlockChainState::PoolTransaction *> short_ids;
+	for (auto &&tx : mytxs) {
+		const uint64_t id = PoolSketch::short_id(tx.first, req.salt);
+		sketch.insert(id);
+		short_ids[id] = &tx.second;
+	}
+	std::vector<uint64_t> mine, theirs;
+	sketch.subtract(req.sketch);
+	if (!sketch.decode(&mine, &theirs)) {
+		failed_counter.add();
+		m_node->m_log(logging::TRACE) << "on_msg_notify_request_tx_pool from " << get_address()
+		                              << " failed to decode sketch cell_count=" << cell_count << std::endl;
+		NOTIFY_TX_POOL_SKETCH_FAILED::request msg;
+		msg.cell_count      = static_cast<uint32_t>(cell_count);
+		BinaryArray raw_msg =
+		    LevinProtocol::send_message(NOTIFY_TX_POOL_SKETCH_FAILED::ID, LevinProtocol::encode(msg), false);
+		send(std::move(raw_msg));
+		return;
+	}
+	decoded_counter.add();
+	// Transactions only peer has will come when we sync our pool to it
+	NOTIFY_NEW_TRANSACTIONS::request msg;
+	msg.txs.reserve(mine.size());
+	for (auto &&id : mine) {
+		auto sit = short_ids.find(id);
+		if (sit != short_ids.end())
+			msg.txs.push_back(sit->second->binary_tx);
+	}
+	m_node->m_log(logging::TRACE) << "on_msg_notify_request_tx_pool from " << get_address()
+	                              << " sketch cell_count=" << cell_count << " peer has=" << theirs.size()
+	                              << " we are relaying=" << msg.txs.size() << std::endl;
+	if (msg.txs.empty())
+		return;
+	BinaryArray raw_msg = LevinProtocol::send_message(NOTIFY_NEW_TRANSACTIONS::ID, LevinProtocol::encode(msg), false);
+	send(std::move(raw_msg));
+}
+
+void Node::P2PClientVarcoin::on_msg_notify_request_tx_pool(NOTIFY_TX_POOL_SKETCH_FAILED::request &&req) {
+	// Only answer to failure of our outstanding sketch, otherwise peer could make us send lots of data
+	if (m_sketch_cells == 0 || req.cell_count != m_sketch_cells) {
+		m_node->m_log(logging::TRACE) << "on_msg_notify_request_tx_pool from " << get_address()
+		                              << " ignoring unsolicited NOTIFY_TX_POOL_SKETCH_FAILED cell_count="
+		                              << req.cell_count << std::endl;
+		return;
+	}
+	const size_t cell_count = m_sketch_cells;
+	m_sketch_cells          = 0;
+	if (m_sketch_retried)
+		return m_node->send_pool_hashes(this);
+	m_sketch_retried = true;
+	m_node->send_pool_sketch(this, cell_count * 4);
+}
+
 void Node::P2PClientVarcoin::on_msg_timed_sync(COMMAND_TIMED_SYNC::request &&req) {
 	m_node->m_downloader.on_msg_timed_sync(req.payload_data);
 }
@@ -199,24 +331,10 @@ void Node::P2PClientVarcoin::on_msg_timed_sync(COMMAND_TIMED_SYNC::response &&re
 }
 
 void Node::P2PClientVarcoin::on_msg_notify_new_block(NOTIFY_NEW_BLOCK::request &&req) {
-	RawBlock raw_block{req.b.block, req.b.transactions};
-	PreparedBlock pb(std::move(raw_block), nullptr);
-	api::BlockHeader info;
-	auto action = m_node->m_block_chain.add_block(pb, &info);
-	switch (action) {
-	case BroadcastAction::BAN:
-		disconnect("NOTIFY_NEW_BLOCK add_block BAN");
-		return;
-	case BroadcastAction::BROADCAST_ALL: {
-		req.hop += 1;
-		BinaryArray raw_msg = LevinProtocol::send_message(NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(req), false);
-		m_node->m_p2p.broadcast(this, raw_msg);
-		m_node->advance_long_poll();
-		return;
-	}
-	case BroadcastAction::NOTHING:
-		break;
-	}
+	if (m_node->m_block_chain_reader1 || m_node->m_block_chain_reader2 ||
+	    m_node->m_block_chain.get_tip_height() < m_node->m_block_chain.internal_import_known_height())
+		return;  // Relayed block cannot be added before import finishes anyway
+	m_node->m_downloader.on_msg_notify_new_block(this, std::move(req));
 }
 
 void Node::P2PClientVarcoin::on_msg_notify_new_transactions(NOTIFY_NEW_TRANSACTIONS::request &&req) {
@@ -323,6 +441,7 @@ void Node::advance_long_poll() {
 	if (prevent_sleep &&
 	    m_block_chain.get_tip().timestamp > now - m_block_chain.get_currency().block_future_time_limit * 2)
 		prevent_sleep = nullptr;
+	advance_event_subscribers();
 	if (m_long_poll_http_clients.empty())
 		return;
 	api::varcoind::GetStatus::Response resp = create_status_response3();
@@ -366,11 +485,115 @@ void Node::advance_long_poll() {
 			}
 			last_http_response.set_body(gbt_json_resp.get_body());
 		}
-		lit->original_who->write(std::move(last_http_response));
+		lit->original_who->write(std::move(last_http_response), lit->original_request_number);
 		lit = m_long_poll_http_clients.erase(lit);
 	}
 }
 
+api::varcoind::SubscribeEvents::Event Node::create_tip_event() const {
+	api::BlockHeader tip = m_block_chain.get_tip();
+	api::varcoind::SubscribeEvents::Event event;
+	event.type                 = "tip";
+	event.top_block_height     = m_block_chain.get_tip_height();
+	event.top_block_hash       = m_block_chain.get_tip_bid();
+	event.top_block_timestamp  = tip.timestamp;
+	event.top_block_difficulty = tip.difficulty;
+	return event;
+}
+
+static std::string event_chunk(const api::varcoind::SubscribeEvents::Event &event) {
+	return seria::to_json_value(event).to_string() + "\n";
+}
+
+void Node::advance_event_subscribers() {
+	const Hash tip_bid          = m_block_chain.get_tip_bid();
+	const uint32_t pool_version = m_block_chain.get_tx_pool_version();
+	if (m_event_subscribers.empty() || (tip_bid == m_events_tip_bid && pool_version == m_events_pool_version))
+		return;
+	std::string tip_chunk;
+	if (tip_bid != m_events_tip_bid)
+		tip_chunk = event_chunk(create_tip_event());
+	// Pool version is reset on reorganizations, so we diff pool on any change
+	std::vector<Hash> pool;
+	pool.reserve(m_block_chain.get_memory_state_transactions().size());
+	for (auto &&tx : m_block_chain.get_memory_state_transactions())
+		pool.push_back(tx.first);  // map is sorted
+	api::varcoind::SubscribeEvents::Event pool_event;
+	pool_event.type                     = "pool";
+	pool_event.top_block_height         = m_block_chain.get_tip_height();
+	pool_event.top_block_hash           = tip_bid;
+	pool_event.transaction_pool_version = pool_version;
+	std::set_difference(pool.begin(), pool.end(), m_events_pool.begin(), m_events_pool.end(),
+	    std::back_inserter(pool_event.added_transactions));
+	std::set_difference(m_events_pool.begin(), m_events_pool.end(), pool.begin(), pool.end(),
+	    std::back_inserter(pool_event.removed_transactions));
+	std::string pool_chunk;
+	if (!pool_event.added_transactions.empty() || !pool_event.removed_transactions.empty())
+		pool_chunk = event_chunk(pool_event);
+	m_events_tip_bid      = tip_bid;
+	m_events_pool_version = pool_version;
+	m_events_pool         = std::move(pool);
+
+	std::vector<http::Client *> slow_clients;  // Disconnecting modifies m_event_subscribers
+	for (auto &&sub : m_event_subscribers) {
+		bool ok = true;
+		if (sub.filter.tip && !tip_chunk.empty())
+			ok = sub.who->write_chunk(tip_chunk) && ok;
+		if (sub.filter.pool && !pool_chunk.empty())
+			ok = sub.who->write_chunk(pool_chunk) && ok;
+		if (!ok)
+			slow_clients.push_back(sub.who);
+	}
+	for (auto who : slow_clients) {
+		m_log(logging::INFO) << "Disconnecting event subscriber reading too slowly" << std::endl;
+		who->disconnect();
+	}
+}
+
+bool Node::on_subscribe_events(http::Client *who, http::RequestData &&request, http::ResponseData &response) {
+	api::varcoind::SubscribeEvents::Request req;
+	try {  // Not a json rpc endpoint, so errors are reported as HTTP 400 with json rpc error object in body
+		if (!request.body.empty())
+			seria::from_json_value(req, common::JsonValue::from_string(request.body));
+	} catch (const std::exception &ex) {
+		const json_rpc::Error err(json_rpc::INVALID_PARAMS, std::string("Failed to parse request, ") + ex.what());
+		response.r.headers.push_back({"Content-Type", "application/json; charset=utf-8"});
+		response.set_body(seria::to_json_value(err).to_string());
+		response.r.status = 400;
+		return true;
+	}
+	if (m_event_subscribers.empty()) {  // State is not tracked without subscribers
+		m_events_tip_bid      = m_block_chain.get_tip_bid();
+		m_events_pool_version = m_block_chain.get_tx_pool_version();
+		m_events_pool.clear();
+		for (auto &&tx : m_block_chain.get_memory_state_transactions())
+			m_events_pool.push_back(tx.first);
+	} else
+		advance_event_subscribers();  // New subscriber starts from the same state as others
+	std::string body;
+	if (req.tip)
+		body += event_chunk(create_tip_event());
+	if (req.pool) {
+		api::varcoind::SubscribeEvents::Event pool_event;
+		pool_event.type                     = "pool";
+		pool_event.top_block_height         = m_block_chain.get_tip_height();
+		pool_event.top_block_hash           = m_events_tip_bid;
+		pool_event.transaction_pool_version = m_events_pool_version;
+		pool_event.added_transactions       = m_events_pool;
+		body += event_chunk(pool_event);
+	}
+	response.r.headers.push_back({"Content-Type", "application/x-ndjson; charset=utf-8"});
+	response.r.status = 200;
+	response.set_body(std::move(body));
+	who->start_stream(std::move(response), who->get_last_request_number());
+	EventSubscriber sub;
+	sub.who    = who;
+	sub.filter = req;
+	m_event_subscribers.push_back(sub);
+	common::metrics::gauge("varcoind_event_subscribers").set(static_cast<int64_t>(m_event_subscribers.size()));
+	return false;
+}
+
 static const std::string beautiful_index_start =
     R"(<html><body><table valign="middle"><tr><td width="30px">
 <svg xmlns="http://www.w3.org/2000/svg" width="30px" viewBox="0 0 215.99 215.99">
@@ -409,9 +632,13 @@ bool Node::on_api_http_request(http::Client *who, http::RequestData &&request, h
 		response.r.status = 401;
 		return true;
 	}
+	static const auto request_counters =
+	    common::metrics::counters_by_key("varcoind_http_requests_total", "uri", m_http_handlers);
+	request_counters.at(it->first)->add();
 	if (!it->second(this, who, std::move(request), response))
 		return false;
-	response.r.status = 200;
+	if (response.r.status == 0)  // Handlers set status only for errors
+		response.r.status = 200;
 	return true;
 }
 
@@ -421,6 +648,12 @@ void Node::on_api_http_disconnect(http::Client *who) {
 			lit = m_long_poll_http_clients.erase(lit);
 		else
 			++lit;
+	for (auto sit = m_event_subscribers.begin(); sit != m_event_subscribers.end();)
+		if (sit->who == who)
+			sit = m_event_subscribers.erase(sit);
+		else
+			++sit;
+	common::metrics::gauge("varcoind_event_subscribers").set(static_cast<int64_t>(m_event_subscribers.size()));
 }
 
 namespace {
@@ -443,6 +676,18 @@ Node::HTTPHandlerFunction bin_method(bool (Node::*handler)(http::Client *who, ht
 		return result;
 	};
 }
+
+bool metrics_method(Node *, http::Client *, http::RequestData &&, http::ResponseData &response) {
+	response.r.headers.push_back({"Content-Type", "text/plain; version=0.0.4"});
+	response.set_body(common::metrics::to_prometheus());
+	return true;
+}
+
+bool trace_method(Node *, http::Client *, http::RequestData &&, http::ResponseData &response) {
+	response.r.headers.push_back({"Content-Type", "application/json; charset=utf-8"});
+	response.set_body(common::trace::to_chrome_json());
+	return true;
+}
 }  // anonymous namespace
 
 const std::unordered_map<std::string, Node::HTTPHandlerFunction> Node::m_http_handlers = {
@@ -450,7 +695,9 @@ const std::unordered_map<std::string, Node::HTTPHandlerFunction> Node::m_http_ha
     {api::varcoind::SyncBlocks::bin_method(), bin_method(&Node::on_wallet_sync3)},
     {api::varcoind::SyncMemPool::bin_method(), bin_method(&Node::on_sync_mempool3)},
     {"/json_rpc", std::bind(&Node::process_json_rpc_request, std::placeholders::_1, std::placeholders::_2,
-                      std::placeholders::_3, std::placeholders::_4)}};
+                      std::placeholders::_3, std::placeholders::_4)},
+    {"/metrics", metrics_method}, {"/trace", trace_method},
+    {api::varcoind::SubscribeEvents::url(), &Node::on_subscribe_events}};
 
 const std::unordered_map<std::string, Node::JSONRPCHandlerFunction> Node::m_jsonrpc_handlers = {
     {api::varcoind::GetLastBlockHeaderLegacy::method(), json_rpc::make_member_method(&Node::on_get_last_block_header)},
@@ -465,6 +712,8 @@ const std::unordered_map<std::string, Node::JSONRPCHandlerFunction> Node::m_json
     {api::varcoind::SubmitBlock::method(), json_rpc::make_member_method(&Node::on_submitblock)},
     {api::varcoind::SubmitBlockLegacy::method(), json_rpc::make_member_method(&Node::on_submitblock_legacy)},
     {api::varcoind::GetRandomOutputs::method(), json_rpc::make_member_method(&Node::on_get_random_outputs3)},
+    {api::varcoind::GetOutputStats::method(), json_rpc::make_member_method(&Node::on_get_output_stats3)},
+    {api::varcoind::GetPeerStats::method(), json_rpc::make_member_method(&Node::on_get_peer_stats3)},
     {api::varcoind::GetStatus::method(), json_rpc::make_member_method(&Node::on_get_status3)},
     {api::varcoind::GetStatus::method2(), json_rpc::make_member_method(&Node::on_get_status3)},
     {api::varcoind::SendTransaction::method(), json_rpc::make_member_method(&Node::handle_send_transaction3)},
@@ -488,6 +737,65 @@ bool Node::on_get_random_outputs3(http::Client *, http::RequestData &&, json_rpc
 	return true;
 }
 
+bool Node::on_get_output_stats3(http::Client *, http::RequestData &&, json_rpc::Request &&,
+    api::varcoind::GetOutputStats::Request &&request, api::varcoind::GetOutputStats::Response &response) {
+	response.output_counts    = m_block_chain.get_output_counts(request.amounts);
+	response.top_block_height = m_block_chain.get_tip_height();
+	return true;
+}
+
+bool Node::on_get_peer_stats3(http::Client *, http::RequestData &&, json_rpc::Request &&,
+    api::varcoind::GetPeerStats::Request &&, api::varcoind::GetPeerStats::Response &response) {
+	if (m_config.varcoind_authorization.empty())  // Do not reveal addresses of our peers to everyone
+		throw json_rpc::Error(-301, "get_peer_stats is available only if --varcoind-authorization is set");
+	std::vector<P2PClientVarcoin *> clients;
+	for (bool incoming : {false, true})
+		for (auto &&address : m_p2p.good_clients(incoming))
+			if (auto who = dynamic_cast<P2PClientVarcoin *>(m_p2p.find_client(address, incoming)))
+				clients.push_back(who);
+	const auto &downloading = m_downloader.get_good_clients();
+	for (P2PClientVarcoin *who : clients) {
+		auto dit                      = downloading.find(who);
+		const PeerStats &stats        = who->get_stats();
+		const NetworkAddress &address = who->get_address();
+		const Height current_height   = who->get_last_received_sync_data().current_height;
+		api::varcoind::GetPeerStats::Peer peer;
+		peer.address             = common::ip_address_and_port_to_string(address.ip, address.port);
+		peer.incoming            = who->is_incoming();
+		peer.peer_id             = who->get_last_received_unique_number();
+		peer.version             = who->get_version();
+		peer.top_block_height    = current_height == 0 ? 0 : current_height - 1;  // current_height is top + 1
+		peer.downloading_blocks  = dit == downloading.end() ? 0 : static_cast<uint32_t>(dit->second);
+		peer.requests_waiting    = static_cast<uint32_t>(stats.requests_waiting);
+		peer.send_queue_messages = static_cast<uint32_t>(who->get_send_queue_messages());
+		peer.send_queue_bytes    = who->get_send_queue_bytes();
+		for (auto &&tr : stats.traffic) {
+			api::varcoind::GetPeerStats::CommandStats cs;
+			cs.command           = tr.first;
+			cs.messages_received = tr.second.messages_received;
+			cs.bytes_received    = tr.second.bytes_received;
+			cs.messages_sent     = tr.second.messages_sent;
+			cs.bytes_sent        = tr.second.bytes_sent;
+			peer.commands.push_back(cs);
+		}
+		for (auto &&la : stats.latencies) {
+			api::varcoind::GetPeerStats::LatencyStats ls;
+			ls.command = la.first;
+			ls.count   = la.second.count;
+			ls.avg_ms  = la.second.count == 0 ? 0 : la.second.sum_ms / la.second.count;
+			ls.p50_ms  = la.second.percentile_ms(50);
+			ls.p99_ms  = la.second.percentile_ms(99);
+			ls.max_ms  = la.second.max_ms;
+			ls.histogram.assign(std::begin(la.second.buckets), std::end(la.second.buckets));
+			while (!ls.histogram.empty() && ls.histogram.back() == 0)
+				ls.histogram.pop_back();
+			peer.latencies.push_back(ls);
+		}
+		response.peers.push_back(std::move(peer));
+	}
+	return true;
+}
+
 api::varcoind::GetStatus::Response Node::create_status_response3() const {
 	api::varcoind::GetStatus::Response res;
 	res.top_block_height = m_block_chain.get_tip_height();
@@ -517,10 +825,11 @@ bool Node::on_get_status3(http::Client *who, http::RequestData &&raw_request, js
 		//<<
 		// raw_request.body << std::endl;
 		LongPollClient lpc;
-		lpc.original_who          = who;
-		lpc.original_request      = raw_request;
-		lpc.original_json_request = std::move(raw_js_request);
-		lpc.original_get_status   = req;
+		lpc.original_who            = who;
+		lpc.original_request_number = who->get_last_request_number();
+		lpc.original_request        = raw_request;
+		lpc.original_json_request   = std::move(raw_js_request);
+		lpc.original_get_status     = req;
 		m_long_poll_http_clients.push_back(lpc);
 		return false;
 	}
@@ -27,6 +27,8 @@ static const int DOWNLOAD_CONCURRENCY            = 4;
 static const int DOWNLOAD_QUEUE                  = 10;  // number of block requests sent before receiving reply
 static const int DOWNLOAD_BLOCK_WINDOW           = DOWNLOAD_CONCURRENCY * DOWNLOAD_QUEUE * 2;
 static const float RETRY_DOWNLOAD_SECONDS        = 10;
+static const size_t BLOCK_RESPONSE_CACHE_SIZE    = 64 * 1024 * 1024;
+static const size_t POOL_SKETCH_INITIAL_CELLS    = 120;  // decodes difference of ~80 transactions in 1920 bytes
 
 class Node {
 public:
@@ -37,6 +39,7 @@ public:
 
 	explicit Node(logging::ILogger &, const Config &, BlockChainState &);
 	bool on_idle();
+	bool on_api_http_request(http::Client *, http::RequestData &&, http::ResponseData &);
 
 	// binary method
 	bool on_wallet_sync3(http::Client *, http::RequestData &&, json_rpc::Request &&,
@@ -52,6 +55,10 @@ public:
 	    api::varcoind::GetStatus::Request &&, api::varcoind::GetStatus::Response &);
 	bool on_get_random_outputs3(http::Client *, http::RequestData &&, json_rpc::Request &&,
 	    api::varcoind::GetRandomOutputs::Request &&, api::varcoind::GetRandomOutputs::Response &);
+	bool on_get_output_stats3(http::Client *, http::RequestData &&, json_rpc::Request &&,
+	    api::varcoind::GetOutputStats::Request &&, api::varcoind::GetOutputStats::Response &);
+	bool on_get_peer_stats3(http::Client *, http::RequestData &&, json_rpc::Request &&,
+	    api::varcoind::GetPeerStats::Request &&, api::varcoind::GetPeerStats::Response &);
 	bool handle_send_transaction3(http::Client *, http::RequestData &&, json_rpc::Request &&,
 	    api::varcoind::SendTransaction::Request &&, api::varcoind::SendTransaction::Response &);
 	bool handle_check_send_proof3(http::Client *, http::RequestData &&, json_rpc::Request &&,
@@ -86,7 +93,8 @@ protected:
 	std::unique_ptr<http::Server> m_api;
 	std::unique_ptr<platform::PreventSleep> m_prevent_sleep;
 	struct LongPollClient {
-		http::Client *original_who = nullptr;
+		http::Client *original_who     = nullptr;
+		size_t original_request_number = 0;  // pipelined requests may follow long poll
 		http::RequestData original_request;
 		json_rpc::Request original_json_request;
 		api::varcoind::GetStatus::Request original_get_status;
@@ -94,6 +102,18 @@ protected:
 	std::list<LongPollClient> m_long_poll_http_clients;
 	void advance_long_poll();
 
+	struct EventSubscriber {
+		http::Client *who = nullptr;
+		api::varcoind::SubscribeEvents::Request filter;
+	};
+	std::list<EventSubscriber> m_event_subscribers;
+	Hash m_events_tip_bid;  // State last sent to subscribers, events are deltas from it
+	uint32_t m_events_pool_version = 0;
+	std::vector<Hash> m_events_pool;  // sorted
+	api::varcoind::SubscribeEvents::Event create_tip_event() const;
+	void advance_event_subscribers();
+	bool on_subscribe_events(http::Client *, http::RequestData &&, http::ResponseData &);
+
 	bool m_block_chain_was_far_behind;
 	logging::LoggerRef m_log;
 	PeerDB m_peer_db;
@@ -105,6 +125,25 @@ protected:
 		m_commit_timer.once(DB_COMMIT_PERIOD_VARCOIND);
 	}
 
+	// KV-encoded RawBlockLegacy by bid, LRU. Many syncing peers ask for the same recent blocks
+	class BlockResponseCache {
+		struct Item {
+			std::shared_ptr<const BinaryArray> encoded;
+			std::list<Hash>::iterator lru_it;
+		};
+		std::unordered_map<Hash, Item> m_items;
+		std::list<Hash> m_lru;  // most recently used first
+		size_t m_total_size = 0;
+		const size_t m_max_size;
+
+	public:
+		explicit BlockResponseCache(size_t max_size) : m_max_size(max_size) {}
+		std::shared_ptr<const BinaryArray> get(const Hash &bid);  // nullptr if not cached
+		void put(const Hash &bid, std::shared_ptr<const BinaryArray> encoded);
+		size_t get_total_size() const { return m_total_size; }
+	};
+	BlockResponseCache m_block_response_cache{BLOCK_RESPONSE_CACHE_SIZE};
+
 	bool check_trust(const proof_of_trust &);
 	uint64_t m_last_stat_request_time = 0;
 	// Prevent replay attacks by only trusting requests with timestamp > than previous request
@@ -127,6 +166,8 @@ protected:
 		virtual void on_msg_notify_request_objects(NOTIFY_REQUEST_GET_OBJECTS::request &&) override;
 		virtual void on_msg_notify_request_objects(NOTIFY_RESPONSE_GET_OBJECTS::request &&) override;
 		virtual void on_msg_notify_request_tx_pool(NOTIFY_REQUEST_TX_POOL::request &&) override;
+		virtual void on_msg_notify_request_tx_pool(NOTIFY_REQUEST_TX_POOL_SKETCH::request &&) override;
+		virtual void on_msg_notify_request_tx_pool(NOTIFY_TX_POOL_SKETCH_FAILED::request &&) override;
 		virtual void on_msg_timed_sync(COMMAND_TIMED_SYNC::request &&) override;
 		virtual void on_msg_timed_sync(COMMAND_TIMED_SYNC::response &&) override;
 		virtual void on_msg_notify_new_block(NOTIFY_NEW_BLOCK::request &&) override;
@@ -139,6 +180,8 @@ protected:
 		explicit P2PClientVarcoin(Node *node, bool incoming, D_handler d_handler)
 		    : P2PClientBasic(node->m_config, node->m_p2p.get_unique_number(), incoming, d_handler), m_node(node) {}
 		Node *get_node() const { return m_node; }
+		size_t m_sketch_cells = 0;      // of our outstanding pool sketch, 0 if none
+		bool m_sketch_retried = false;  // we retry once with bigger sketch, then send all hashes
 	};
 	std::unique_ptr<P2PClient> client_factory(bool incoming, P2PClient::D_handler d_handler) {
 		return std::make_unique<P2PClientVarcoin>(this, incoming, d_handler);
@@ -186,6 +229,16 @@ protected:
 		void add_work(std::tuple<Hash, bool, RawBlock> &&wo);
 		void thread_run();
 
+		// Relayed blocks are prepared (including PoW) by the same threads, only add_block runs in main loop
+		struct RelayedBlock {
+			P2PClientVarcoin *who = nullptr;  // nullptr if disconnected while block was prepared
+			uint32_t current_blockchain_height = 0;
+			uint32_t hop                       = 0;
+			std::chrono::steady_clock::time_point start;
+		};
+		std::map<Hash, RelayedBlock> m_relayed_blocks;  // being prepared
+		void add_relayed_block(const RelayedBlock &rb, PreparedBlock &&pb);
+
 		void on_chain_timer();
 		void on_download_timer();
 		void advance_chain();
@@ -203,6 +256,7 @@ protected:
 		const std::map<P2PClientVarcoin *, size_t> &get_good_clients() const { return m_good_clients; }
 		void on_msg_notify_request_chain(P2PClientVarcoin *, const NOTIFY_RESPONSE_CHAIN_ENTRY::request &);
 		void on_msg_notify_request_objects(P2PClientVarcoin *, const NOTIFY_RESPONSE_GET_OBJECTS::request &);
+		void on_msg_notify_new_block(P2PClientVarcoin *, NOTIFY_NEW_BLOCK::request &&);
 		void on_msg_timed_sync(const CORE_SYNC_DATA &payload_data);
 	};
 	/*	class DownloaderV1 {  // sync&download from legacy v1 clients
@@ -237,10 +291,11 @@ protected:
 	    };*/
 	DownloaderV11 m_downloader;
 
-	bool on_api_http_request(http::Client *, http::RequestData &&, http::ResponseData &);
 	void on_api_http_disconnect(http::Client *);
 
 	void sync_transactions(P2PClientVarcoin *);
+	void send_pool_hashes(P2PClientVarcoin *);
+	void send_pool_sketch(P2PClientVarcoin *, size_t cell_count);
 
 	static const std::unordered_map<std::string, HTTPHandlerFunction> m_http_handlers;
 	static const std::unordered_map<std::string, JSONRPCHandlerFunction> m_jsonrpc_handlers;
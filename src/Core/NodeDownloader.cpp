@@ -4,6 +4,8 @@
 #include <iostream>
 #include "Config.hpp"
 #include "Node.hpp"
+#include "common/Metrics.hpp"
+#include "common/Trace.hpp"
 #include "seria/BinaryInputStream.hpp"
 #include "seria/BinaryOutputStream.hpp"
 
@@ -11,6 +13,17 @@ using namespace varcoin;
 
 static const bool multicore = true;
 
+// median, max until first response so that unmeasured peers do not win over measured ones
+static uint64_t get_objects_latency_ms(const P2PClientBasic *who) {
+	const auto &latencies = who->get_stats().latencies;
+	auto lit              = latencies.find(NOTIFY_REQUEST_GET_OBJECTS::ID);
+	if (lit == latencies.end() || lit->second.count == 0)
+		return std::numeric_limits<uint64_t>::max();
+	return lit->second.percentile_ms(50);
+}
+
+static const size_t MAX_RELAYED_BLOCKS = 20;  // being prepared, more are ignored, we will download them later
+
 Node::DownloaderV11::DownloaderV11(Node *node, BlockChainState &block_chain)
     : m_node(node)
     , m_block_chain(block_chain)
@@ -47,6 +60,7 @@ void Node::DownloaderV11::add_work(std::tuple<Hash, bool, RawBlock> &&wo) {
 }
 
 void Node::DownloaderV11::thread_run() {
+	common::trace::set_thread_name("DownloaderV11");
 	crypto::CryptoNightContext hash_crypto_context;
 	while (true) {
 		std::tuple<Hash, bool, RawBlock> wo;
@@ -94,6 +108,9 @@ void Node::DownloaderV11::on_connect(P2PClientVarcoin *who) {
 }
 
 void Node::DownloaderV11::on_disconnect(P2PClientVarcoin *who) {
+	for (auto &&rb : m_relayed_blocks)
+		if (rb.second.who == who)
+			rb.second.who = nullptr;
 	if (who->is_incoming())
 		return;
 	m_node->m_log(logging::TRACE) << "DownloaderV11::on_disconnect " << who->get_address() << std::endl;
@@ -229,6 +246,7 @@ void Node::DownloaderV11::on_msg_timed_sync(const CORE_SYNC_DATA &payload_data)
 
 void Node::DownloaderV11::on_msg_notify_request_objects(P2PClientVarcoin *who,
     const NOTIFY_RESPONSE_GET_OBJECTS::request &req) {
+	COMMON_TRACE_SPAN("DownloaderV11::on_msg_notify_request_objects");
 	for (auto &&rb : req.blocks) {
 		Hash bid;
 		try {
@@ -269,7 +287,7 @@ void Node::DownloaderV11::on_msg_notify_request_objects(P2PClientVarcoin *who,
 			if (multicore) {
 				dc.status = DownloadCell::PREPARING;
 				add_work(std::tuple<Hash, bool, RawBlock>(dc.bid,
-				    !m_node->m_block_chain.get_currency().is_in_checkpoint_zone(dc.expected_height), std::move(dc.rb)));
+				    m_node->m_block_chain.get_currency().need_proof_of_work(dc.expected_height), std::move(dc.rb)));
 			} else {
 				dc.pb     = PreparedBlock(std::move(dc.rb), nullptr);
 				dc.status = DownloadCell::PREPARED;
@@ -288,19 +306,36 @@ void Node::DownloaderV11::on_msg_notify_request_objects(P2PClientVarcoin *who,
 }
 
 bool Node::DownloaderV11::on_idle() {
+	COMMON_TRACE_SPAN("DownloaderV11::on_idle");
+	static auto &relayed_prepare_histogram = common::metrics::histogram("varcoind_relayed_block_prepare_seconds");
 	int added_counter = 0;
+	std::vector<std::pair<RelayedBlock, PreparedBlock>> relayed_blocks;
 	if (multicore) {
 		std::unique_lock<std::mutex> lock(mu);
 		for (auto &&pb : prepared_blocks) {
+			bool cell_found = false;
 			for (auto &&dc : m_download_chain)
 				if (dc.status == DownloadCell::PREPARING && dc.bid == pb.first) {
-					dc.pb     = std::move(pb.second);
-					dc.status = DownloadCell::PREPARED;
+					dc.pb      = std::move(pb.second);
+					dc.status  = DownloadCell::PREPARED;
+					cell_found = true;
 					break;
 				}
+			auto rit = m_relayed_blocks.find(pb.first);
+			if (rit == m_relayed_blocks.end())
+				continue;
+			if (!cell_found)  // otherwise block will be added from download chain
+				relayed_blocks.emplace_back(rit->second, std::move(pb.second));
+			m_relayed_blocks.erase(rit);
 		}
 		prepared_blocks.clear();
 	}
+	const auto now = std::chrono::steady_clock::now();
+	for (auto &&rb : relayed_blocks) {
+		relayed_prepare_histogram.observe_us(
+		    std::chrono::duration_cast<std::chrono::microseconds>(now - rb.first.start).count());
+		add_relayed_block(rb.first, std::move(rb.second));
+	}
 	auto idea_start = std::chrono::high_resolution_clock::now();
 	while (!m_download_chain.empty() && m_download_chain.front().status == DownloadCell::PREPARED) {
 		DownloadCell dc = std::move(m_download_chain.front());
@@ -339,6 +374,64 @@ bool Node::DownloaderV11::on_idle() {
 	return !m_download_chain.empty() && m_download_chain.front().status == DownloadCell::PREPARED;
 }
 
+void Node::DownloaderV11::on_msg_notify_new_block(P2PClientVarcoin *who, NOTIFY_NEW_BLOCK::request &&req) {
+	RawBlock raw_block{std::move(req.b.block), std::move(req.b.transactions)};
+	Hash bid;
+	try {
+		BlockTemplate bheader;
+		seria::from_binary(bheader, raw_block.block);
+		bid = varcoin::get_block_hash(bheader);
+	} catch (const std::exception &ex) {
+		who->disconnect("NOTIFY_NEW_BLOCK failed to parse block header what=" + std::string(ex.what()));
+		return;
+	}
+	if (m_relayed_blocks.count(bid) != 0 || m_block_chain.has_block(bid))
+		return;  // Same block is usually relayed by many peers
+	RelayedBlock rb;
+	rb.who                       = who;
+	rb.current_blockchain_height = req.current_blockchain_height;
+	rb.hop                       = req.hop;
+	rb.start                     = std::chrono::steady_clock::now();
+	if (!multicore) {
+		add_relayed_block(rb, PreparedBlock(std::move(raw_block), nullptr));
+		return;
+	}
+	if (m_relayed_blocks.size() >= MAX_RELAYED_BLOCKS)
+		return;
+	m_relayed_blocks[bid] = rb;
+	const bool check_pow  = m_block_chain.get_currency().need_proof_of_work(m_block_chain.get_tip_height() + 1);
+	add_work(std::tuple<Hash, bool, RawBlock>(bid, check_pow, std::move(raw_block)));
+}
+
+void Node::DownloaderV11::add_relayed_block(const RelayedBlock &rb, PreparedBlock &&pb) {
+	static auto &apply_histogram = common::metrics::histogram("varcoind_relayed_block_apply_seconds");
+	api::BlockHeader info;
+	BroadcastAction action = BroadcastAction::NOTHING;
+	{
+		common::metrics::ScopedTimer timer(apply_histogram);  // main loop is stalled for this time
+		action = m_block_chain.add_block(pb, &info);
+	}
+	switch (action) {
+	case BroadcastAction::BAN:
+		if (rb.who)
+			rb.who->disconnect("NOTIFY_NEW_BLOCK add_block BAN");
+		return;
+	case BroadcastAction::BROADCAST_ALL: {
+		NOTIFY_NEW_BLOCK::request req;
+		req.b.block                   = std::move(pb.raw_block.block);
+		req.b.transactions            = std::move(pb.raw_block.transactions);
+		req.current_blockchain_height = rb.current_blockchain_height;
+		req.hop                       = rb.hop + 1;
+		BinaryArray raw_msg = LevinProtocol::send_message(NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(req), false);
+		m_node->m_p2p.broadcast(rb.who, raw_msg);
+		m_node->advance_long_poll();
+		return;
+	}
+	case BroadcastAction::NOTHING:
+		break;
+	}
+}
+
 void Node::DownloaderV11::on_download_timer() {
 	m_download_timer.once(SYNC_TIMEOUT / 8);  // just several ticks per SYNC_TIMEOUT
 	auto idea_now = std::chrono::steady_clock::now();
@@ -356,6 +449,7 @@ void Node::DownloaderV11::on_download_timer() {
 }
 
 void Node::DownloaderV11::advance_download(Hash last_downloaded_block) {
+	COMMON_TRACE_SPAN("DownloaderV11::advance_download");
 	if (m_node->m_block_chain_reader1 || m_node->m_block_chain_reader2 ||
 	    m_block_chain.get_tip_height() < m_block_chain.internal_import_known_height())
 		return;
@@ -385,16 +479,21 @@ void Node::DownloaderV11::advance_download(Hash last_downloaded_block) {
 		P2PClientVarcoin *ready_client = nullptr;
 		size_t ready_counter            = std::numeric_limits<size_t>::max();
 		size_t ready_speed              = 1;
+		uint64_t ready_latency          = std::numeric_limits<uint64_t>::max();
 		for (auto &&who : m_good_clients) {
+			if (who.first->get_last_received_sync_data().current_height < dc.expected_height)
+				continue;
 			size_t speed =
 			    std::max<size_t>(1, std::min<size_t>(TOTAL_DOWNLOAD_BLOCKS / 4, who_downloaded_counter[who.first]));
 			// We clamp speed so that if even 1 downloaded all blocks, we will give
-			// small % of blocks to other peers
-			if (who.second * ready_speed < ready_counter * speed &&
-			    who.first->get_last_received_sync_data().current_height >= dc.expected_height) {
+			// small % of blocks to other peers. Among equally loaded peers we prefer faster responding ones
+			const uint64_t latency = get_objects_latency_ms(who.first);
+			if (who.second * ready_speed < ready_counter * speed ||
+			    (who.second * ready_speed == ready_counter * speed && latency < ready_latency)) {
 				ready_client  = who.first;
 				ready_counter = who.second;
 				ready_speed   = speed;
+				ready_latency = latency;
 			}
 		}
 		if (!ready_client)
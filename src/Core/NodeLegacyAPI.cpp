@@ -7,6 +7,7 @@
 #include "Node.hpp"
 #include "TransactionExtra.hpp"
 #include "common/JsonValue.hpp"
+#include "common/Metrics.hpp"
 #include "seria/BinaryInputStream.hpp"
 #include "seria/BinaryOutputStream.hpp"
 #include "seria/KVBinaryInputStream.hpp"
@@ -39,6 +40,9 @@ bool Node::process_json_rpc_request(http::Client *who, http::RequestData &&reque
 			m_log(logging::INFO) << "jsonrpc request method not found - " << json_req.get_method() << std::endl;
 			throw json_rpc::Error(json_rpc::METHOD_NOT_FOUND);
 		}
+		static const auto request_counters =
+		    common::metrics::counters_by_key("varcoind_json_rpc_requests_total", "method", m_jsonrpc_handlers);
+		request_counters.at(it->first)->add();
 		//		m_log(logging::INFO) << "jsonrpc request method=" <<
 		// json_req.get_method() << std::endl;
 
@@ -90,10 +94,11 @@ bool Node::on_getblocktemplate(http::Client *who, http::RequestData &&raw_reques
 		//<<
 		// raw_request.body << std::endl;
 		LongPollClient lpc;
-		lpc.original_who          = who;
-		lpc.original_request      = raw_request;
-		lpc.original_json_request = std::move(raw_js_request);
-		lpc.original_get_status   = sta;
+		lpc.original_who            = who;
+		lpc.original_request_number = who->get_last_request_number();
+		lpc.original_request        = raw_request;
+		lpc.original_json_request   = std::move(raw_js_request);
+		lpc.original_get_status     = sta;
 		m_long_poll_http_clients.push_back(lpc);
 		return false;
 	}
@@ -3,6 +3,7 @@
 
 #include "TransactionExtra.hpp"
 
+#include <algorithm>
 #include "VarNoteTools.hpp"
 #include "common/MemoryStreams.hpp"
 #include "common/StringTools.hpp"
@@ -11,86 +12,117 @@
 
 namespace varcoin {
 
-template<typename T>
-bool find_transaction_extra_field_by_type(const std::vector<TransactionExtraField> &tx_extra_fields, T &field) {
-	auto it = std::find_if(tx_extra_fields.begin(), tx_extra_fields.end(),
-	    [](const TransactionExtraField &f) { return typeid(T) == f.type(); });
+// Same rules as common::read_varint on streams, but returns false instead of throwing
+static bool read_varint(const uint8_t *&pos, const uint8_t *end, uint64_t *value) {
+	uint64_t temp = 0;
+	for (size_t shift = 0;; shift += 7) {
+		if (pos == end)
+			return false;
+		const uint8_t piece = *pos++;
+		if (shift >= 64 - 7 && piece >= 1U << (64 - shift))
+			return false;  // Overflow
+		temp |= static_cast<uint64_t>(piece & 0x7f) << shift;
+		if ((piece & 0x80) == 0) {
+			if (piece == 0 && shift != 0)
+				return false;  // Non-canonical representation
+			break;
+		}
+	}
+	*value = temp;
+	return true;
+}
 
-	if (tx_extra_fields.end() == it)
+// Body of merge mining tag field is varint depth followed by merkle root, extra bytes after them are ignored
+static bool read_merge_mining_tag(const uint8_t *data, size_t size, TransactionExtraMergeMiningTag *mm_tag) {
+	const uint8_t *pos = data;
+	const uint8_t *end = data + size;
+	uint64_t depth     = 0;
+	if (!read_varint(pos, end, &depth) || static_cast<size_t>(end - pos) < sizeof(mm_tag->merkle_root.data))
 		return false;
-
-	field = boost::get<T>(*it);
+	mm_tag->depth = static_cast<size_t>(depth);
+	memcpy(mm_tag->merkle_root.data, pos, sizeof(mm_tag->merkle_root.data));
 	return true;
 }
 
-bool parse_transaction_extra(const BinaryArray &extra, std::vector<TransactionExtraField> &extra_fields) {
-	extra_fields.clear();
-
-	if (extra.empty())
-		return true;
+bool TransactionExtraView::malformed() {
+	m_malformed = true;
+	m_pos       = m_end;
+	return false;
+}
 
-	try {
-		common::MemoryInputStream iss(extra.data(), extra.size());
-		seria::BinaryInputStream ar(iss);
-
-		int c = 0;
-
-		while (!iss.empty()) {
-			c = common::read<uint8_t>(iss);
-			switch (c) {
-			case TransactionExtraPadding::tag: {
-				size_t size = 1;
-				for (; !iss.empty() && size <= TX_EXTRA_PADDING_MAX_COUNT; ++size) {
-					if (common::read<uint8_t>(iss) != 0) {
-						return false;  // all bytes should be zero
-					}
-				}
-
-				if (size > TX_EXTRA_PADDING_MAX_COUNT) {
-					return false;
-				}
-				TransactionExtraPadding padding;
-				padding.size = size;
-				extra_fields.push_back(padding);  // TODO - return {} initializer when Google updates NDK copmiler
-				break;
-			}
-
-			case TransactionExtraPublicKey::tag: {
-				TransactionExtraPublicKey extra_pk;
-				iss.read(extra_pk.public_key.data, sizeof(extra_pk.public_key.data));
-				extra_fields.push_back(extra_pk);
-				break;
-			}
-
-			case TransactionExtraNonce::tag: {
-				TransactionExtraNonce extra_nonce;
-				uint8_t size = common::read<uint8_t>(iss);
-				if (size > 0) {
-					extra_nonce.nonce.resize(size);
-					iss.read(extra_nonce.nonce.data(), extra_nonce.nonce.size());
-					// We have some base transactions (like in blocks 558479, 558984)
-					// which have wrong
-					// extra nonce size, so they will not parse and throw here from
-					// iss.read
-				}
-
-				extra_fields.push_back(extra_nonce);
-				break;
-			}
-
-			case TransactionExtraMergeMiningTag::tag: {
-				TransactionExtraMergeMiningTag mm_tag;
-				ar(mm_tag);
-				extra_fields.push_back(mm_tag);
-				break;
-			}
-			}
+bool TransactionExtraView::next(Field *field) {
+	while (m_pos != m_end) {
+		const uint8_t *tag_pos = m_pos++;
+		const size_t remaining = m_end - m_pos;
+		switch (*tag_pos) {
+		case TransactionExtraPadding::tag:  // Takes the rest of extra, all zeroes
+			if (remaining >= TX_EXTRA_PADDING_MAX_COUNT || std::any_of(m_pos, m_end, [](uint8_t b) { return b != 0; }))
+				return malformed();
+			*field = Field{*tag_pos, tag_pos, remaining + 1};
+			m_pos  = m_end;
+			return true;
+		case TransactionExtraPublicKey::tag:
+			if (remaining < sizeof(PublicKey))
+				return malformed();
+			*field = Field{*tag_pos, m_pos, sizeof(PublicKey)};
+			m_pos += sizeof(PublicKey);
+			return true;
+		case TransactionExtraNonce::tag:
+			// We have some base transactions (like in blocks 558479, 558984) with wrong extra nonce size
+			if (remaining == 0 || remaining - 1 < m_pos[0])
+				return malformed();
+			*field = Field{*tag_pos, m_pos + 1, m_pos[0]};
+			m_pos += 1 + field->size;
+			return true;
+		case TransactionExtraMergeMiningTag::tag: {
+			const uint8_t *pos = m_pos;
+			uint64_t size      = 0;
+			TransactionExtraMergeMiningTag mm_tag;
+			if (!read_varint(pos, m_end, &size) || size > static_cast<uint64_t>(m_end - pos) ||
+			    !read_merge_mining_tag(pos, static_cast<size_t>(size), &mm_tag))
+				return malformed();
+			*field = Field{*tag_pos, pos, static_cast<size_t>(size)};
+			m_pos  = pos + size;
+			return true;
 		}
-	} catch (std::exception &) {
-		return false;
+		}  // Unknown tags are skipped byte by byte
 	}
+	return false;
+}
 
-	return true;
+bool parse_transaction_extra(const BinaryArray &extra, std::vector<TransactionExtraField> &extra_fields) {
+	extra_fields.clear();
+	TransactionExtraView view(extra);
+	TransactionExtraView::Field field;
+	while (view.next(&field)) {
+		switch (field.tag) {
+		case TransactionExtraPadding::tag: {
+			TransactionExtraPadding padding;
+			padding.size = field.size;
+			extra_fields.push_back(padding);  // TODO - return {} initializer when Google updates NDK copmiler
+			break;
+		}
+		case TransactionExtraPublicKey::tag: {
+			TransactionExtraPublicKey extra_pk;
+			memcpy(extra_pk.public_key.data, field.data, sizeof(extra_pk.public_key.data));
+			extra_fields.push_back(extra_pk);
+			break;
+		}
+		case TransactionExtraNonce::tag: {
+			TransactionExtraNonce extra_nonce;
+			extra_nonce.nonce.assign(field.data, field.data + field.size);
+			extra_fields.push_back(extra_nonce);
+			break;
+		}
+		case TransactionExtraMergeMiningTag::tag: {
+			TransactionExtraMergeMiningTag mm_tag;
+			read_merge_mining_tag(field.data, field.size, &mm_tag);
+			extra_fields.push_back(mm_tag);
+			break;
+		}
+		}
+	}
+	return !view.is_malformed();
 }
 
 struct ExtraSerializerVisitor : public boost::static_visitor<bool> {
@@ -128,14 +160,15 @@ bool write_transaction_extra(BinaryArray &tx_extra, const std::vector<Transactio
 }
 
 PublicKey get_transaction_public_key_from_extra(const BinaryArray &tx_extra) {
-	std::vector<TransactionExtraField> tx_extra_fields;
-	parse_transaction_extra(tx_extra, tx_extra_fields);
-
-	TransactionExtraPublicKey pub_key_field;
-	if (!find_transaction_extra_field_by_type(tx_extra_fields, pub_key_field))
-		return PublicKey{};
-
-	return pub_key_field.public_key;
+	TransactionExtraView view(tx_extra);
+	TransactionExtraView::Field field;
+	while (view.next(&field))
+		if (field.tag == TransactionExtraPublicKey::tag) {
+			PublicKey result;
+			memcpy(result.data, field.data, sizeof(result.data));
+			return result;
+		}
+	return PublicKey{};
 }
 
 bool add_transaction_public_key_to_extra(BinaryArray &tx_extra, const PublicKey &tx_pub_key) {
@@ -170,10 +203,12 @@ bool append_merge_mining_tag_to_extra(BinaryArray &tx_extra, const TransactionEx
 }
 
 bool get_merge_mining_tag_from_extra(const BinaryArray &tx_extra, TransactionExtraMergeMiningTag &mm_tag) {
-	std::vector<TransactionExtraField> tx_extra_fields;
-	parse_transaction_extra(tx_extra, tx_extra_fields);
-
-	return find_transaction_extra_field_by_type(tx_extra_fields, mm_tag);
+	TransactionExtraView view(tx_extra);
+	TransactionExtraView::Field field;
+	while (view.next(&field))
+		if (field.tag == TransactionExtraMergeMiningTag::tag)
+			return read_merge_mining_tag(field.data, field.size, &mm_tag);
+	return false;
 }
 
 void set_payment_id_to_transaction_extra_nonce(BinaryArray &extra_nonce, const Hash &payment_id) {
@@ -192,14 +227,16 @@ bool get_payment_id_from_transaction_extra_nonce(const BinaryArray &extra_nonce,
 }
 
 bool get_payment_id_from_tx_extra(const BinaryArray &extra, Hash &payment_id) {
-	std::vector<TransactionExtraField> tx_extra_fields;
-	parse_transaction_extra(extra, tx_extra_fields);
-	TransactionExtraNonce extra_nonce;
-	if (!find_transaction_extra_field_by_type(tx_extra_fields, extra_nonce))
-		return false;
-	if (!get_payment_id_from_transaction_extra_nonce(extra_nonce.nonce, payment_id))
-		return false;
-	return true;
+	TransactionExtraView view(extra);
+	TransactionExtraView::Field field;
+	while (view.next(&field))
+		if (field.tag == TransactionExtraNonce::tag) {  // Only first nonce can contain payment id
+			if (field.size != sizeof(Hash) + 1 || field.data[0] != TX_EXTRA_NONCE_PAYMENT_ID)
+				return false;
+			memcpy(payment_id.data, field.data + 1, sizeof(Hash));
+			return true;
+		}
+	return false;
 }
 }
 
@@ -55,6 +55,27 @@ bool get_merge_mining_tag_from_extra(const BinaryArray &tx_extra, TransactionExt
 
 bool get_payment_id_from_tx_extra(const BinaryArray &extra, crypto::Hash &payment_id);
 
+// Walks fields over raw extra without allocations, for hot paths needing single field. Follows the same rules as
+// parse_transaction_extra - unknown tags are skipped, walk stops at the first malformed field
+class TransactionExtraView {
+public:
+	struct Field {
+		uint8_t tag         = 0;
+		const uint8_t *data = nullptr;  // public key, nonce or serialized merge mining tag, points into extra
+		size_t size         = 0;        // for padding, number of bytes including tag
+	};
+	explicit TransactionExtraView(const BinaryArray &extra)
+	    : m_pos(extra.data()), m_end(extra.data() + extra.size()) {}
+	bool next(Field *field);  // false at end or at malformed field
+	bool is_malformed() const { return m_malformed; }
+
+private:
+	const uint8_t *m_pos;
+	const uint8_t *m_end;
+	bool m_malformed = false;
+	bool malformed();
+};
+
 class TransactionExtra {
 public:
 	TransactionExtra() {}
@@ -2,10 +2,15 @@
 // Licensed under the GNU Lesser General Public License. See LICENSE for details.
 
 #include <http/JsonRpc.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include "VarNoteTools.hpp"
 #include "WalletSerializationV1.h"
 #include "WalletState.hpp"
 #include "common/MemoryStreams.hpp"
+#include "common/Metrics.hpp"
 #include "common/StringTools.hpp"
 #include "crypto/crypto.hpp"
 #include "platform/Files.hpp"
@@ -15,7 +20,8 @@ using namespace varcoin;
 
 static const uint8_t SERIALIZATION_VERSION_V2 = 6;
 
-static const size_t CHECK_KEYS_COUNT = 100;
+static const size_t CHECK_KEYS_COUNT   = 100;
+static const size_t DECRYPT_CHUNK_SIZE = 4096;
 #pragma pack(push, 1)
 struct EncryptedWalletRecord {
 	crypto::chacha8_iv iv;
@@ -52,12 +58,26 @@ static void encrypt_key_pair(EncryptedWalletRecord &r, PublicKey pk, SecretKey s
 	chacha8(&rec, sizeof(r.data), key, r.iv, r.data);
 }
 
+static void check_spend_keys(const WalletRecord &wallet_record) {
+	if (wallet_record.spend_secret_key != SecretKey{}) {
+		if (!keys_match(wallet_record.spend_secret_key, wallet_record.spend_public_key))
+			throw Wallet::Exception(
+			    api::WALLET_FILE_DECRYPT_ERROR, "Restored spend public key doesn't correspond to secret key");
+	} else {
+		if (!key_isvalid(wallet_record.spend_public_key)) {
+			throw Wallet::Exception(api::WALLET_FILE_DECRYPT_ERROR, "Public spend key is incorrect");
+		}
+	}
+}
+
 size_t Wallet::wallet_file_size(size_t records) {
 	return 1 + sizeof(ContainerStoragePrefix) + sizeof(uint64_t) * 2 + sizeof(EncryptedWalletRecord) * records;
 }
 
 void Wallet::load_container_storage() {
-	uint8_t version = 0;
+	static auto &open_histogram = common::metrics::histogram("walletd_wallet_open_seconds");
+	static auto &records_gauge  = common::metrics::gauge("walletd_wallet_records");
+	uint8_t version             = 0;
 	ContainerStoragePrefix prefix{};
 	uint64_t f_item_capacity = 0;
 	uint64_t f_item_count    = 0;
@@ -77,14 +97,48 @@ void Wallet::load_container_storage() {
 
 	const size_t item_count =
 	    boost::lexical_cast<size_t>(std::min(f_item_count, f_item_capacity));  // Protection against write shredding
+	const auto open_start = std::chrono::steady_clock::now();  // Open time depends on records, we export both
 	std::vector<EncryptedWalletRecord> all_encrypted(item_count);
 	file->read(reinterpret_cast<char *>(all_encrypted.data()), sizeof(EncryptedWalletRecord) * item_count);
+	// Decryption is spread across cores by chunks, map is filled after that on this thread
+	std::vector<WalletRecord> all_records(item_count);
+	std::atomic<size_t> next_chunk{0};
+	std::mutex mu;
+	std::exception_ptr error;
+	auto decrypt = [&]() {
+		try {
+			for (size_t chunk_start; (chunk_start = next_chunk.fetch_add(DECRYPT_CHUNK_SIZE)) < item_count;)
+				for (size_t i = chunk_start; i != std::min(item_count, chunk_start + DECRYPT_CHUNK_SIZE); ++i) {
+					WalletRecord &wallet_record = all_records[i];
+					decrypt_key_pair(all_encrypted[i], wallet_record.spend_public_key,
+					    wallet_record.spend_secret_key, wallet_record.creation_timestamp, m_wallet_key);
+					if (i < CHECK_KEYS_COUNT || i >= item_count - CHECK_KEYS_COUNT)  // check only first and last
+						check_spend_keys(wallet_record);
+				}
+		} catch (...) {
+			std::unique_lock<std::mutex> lock(mu);
+			error = std::current_exception();
+		}
+	};
+	std::vector<std::thread> threads;
+	const size_t th_count = std::min<size_t>(std::max<size_t>(1, std::thread::hardware_concurrency()),
+	    (item_count + DECRYPT_CHUNK_SIZE - 1) / DECRYPT_CHUNK_SIZE);
+	threads.reserve(th_count);
+	for (size_t i = 1; i < th_count; ++i)
+		try {
+			threads.emplace_back(decrypt);
+		} catch (const std::exception &) {  // Started threads must be joined below, we decrypt with what we have
+			break;
+		}
+	decrypt();
+	for (auto &&th : threads)
+		th.join();
+	if (error)
+		std::rethrow_exception(error);
+	m_wallet_records.reserve(item_count);
 	bool tracking_mode = false;
 	for (size_t i = 0; i != item_count; ++i) {
-		WalletRecord wallet_record;
-		decrypt_key_pair(all_encrypted[i], wallet_record.spend_public_key, wallet_record.spend_secret_key,
-		    wallet_record.creation_timestamp, m_wallet_key);
-
+		const WalletRecord &wallet_record = all_records[i];
 		if (i == 0) {
 			tracking_mode = wallet_record.spend_secret_key == SecretKey{};
 			first_record  = wallet_record;
@@ -92,21 +146,12 @@ void Wallet::load_container_storage() {
 		           (!tracking_mode && wallet_record.spend_secret_key == SecretKey{})) {
 			throw Exception(api::WALLET_FILE_DECRYPT_ERROR, "All addresses must be either tracking or not");
 		}
-
-		if (i < CHECK_KEYS_COUNT || i >= item_count - CHECK_KEYS_COUNT) {  // check only first and last spend keys
-			if (wallet_record.spend_secret_key != SecretKey{}) {
-				if (!keys_match(wallet_record.spend_secret_key, wallet_record.spend_public_key))
-					throw Exception(
-					    api::WALLET_FILE_DECRYPT_ERROR, "Restored spend public key doesn't correspond to secret key");
-			} else {
-				if (!key_isvalid(wallet_record.spend_public_key)) {
-					throw Exception(api::WALLET_FILE_DECRYPT_ERROR, "Public spend key is incorrect");
-				}
-			}
-		}
 		m_oldest_timestamp = std::min(m_oldest_timestamp, wallet_record.creation_timestamp);
 		m_wallet_records.insert(std::make_pair(wallet_record.spend_public_key, wallet_record));
 	}
+	const auto open_time = std::chrono::steady_clock::now() - open_start;
+	open_histogram.observe_us(std::chrono::duration_cast<std::chrono::microseconds>(open_time).count());
+	records_gauge.set(static_cast<int64_t>(item_count));
 	auto file_size           = file->seek(0, SEEK_END);
 	auto should_be_file_size = wallet_file_size(item_count);
 	if (file_size > should_be_file_size) {  // We truncate legacy wallet cache
@@ -345,26 +390,52 @@ std::vector<WalletRecord> Wallet::generate_new_addresses(const std::vector<Secre
 	if (!file.get()) {  // Legacy format, now overwrite
 		save_and_check();
 	}
-	size_t append_pos = wallet_file_size(m_wallet_records.size());
-	file->seek(append_pos, SEEK_SET);
-	for (auto &&sk : sks) {
-		auto new_rit = generate_new_address(sk, ct);
-		if (!new_rit.second) {
+	// Instead of save_and_check we append new records and then update count in header. If we crash in between,
+	// excess records are truncated on next load. Count is written twice, load uses min, protecting against
+	// partial write. So creating address takes the same time for any wallet size
+	const size_t was_count     = m_wallet_records.size();
+	const Timestamp was_oldest = m_oldest_timestamp;
+	std::vector<WalletRecord> appended;
+	std::vector<EncryptedWalletRecord> encrypted;
+	try {
+		for (auto &&sk : sks) {
+			auto new_rit = generate_new_address(sk, ct);
 			result.push_back(new_rit.first);
-			continue;  // Existed before, do not append
+			if (!new_rit.second)
+				continue;  // Existed before, do not append
+			appended.push_back(new_rit.first);
+			encrypted.emplace_back();
+			encrypt_key_pair(encrypted.back(), new_rit.first.spend_public_key, new_rit.first.spend_secret_key,
+			    new_rit.first.creation_timestamp, m_wallet_key);
 		}
-		EncryptedWalletRecord record;
-		encrypt_key_pair(record, new_rit.first.spend_public_key, new_rit.first.spend_secret_key,
-		    new_rit.first.creation_timestamp, m_wallet_key);
-		file->write(&record, sizeof(record));
-		result.push_back(new_rit.first);
+		if (encrypted.empty())
+			return result;
+		const size_t append_pos = wallet_file_size(was_count);
+		file->seek(append_pos, SEEK_SET);
+		file->write(encrypted.data(), sizeof(EncryptedWalletRecord) * encrypted.size());
+		file->fsync();
+		// Check only appended records, old ones were checked when written
+		std::vector<EncryptedWalletRecord> written(encrypted.size());
+		file->seek(append_pos, SEEK_SET);
+		file->read(reinterpret_cast<char *>(written.data()), sizeof(EncryptedWalletRecord) * written.size());
+		for (size_t i = 0; i != written.size(); ++i) {
+			WalletRecord record;
+			decrypt_key_pair(
+			    written[i], record.spend_public_key, record.spend_secret_key, record.creation_timestamp, m_wallet_key);
+			if (record != appended[i])
+				throw Exception(api::WALLET_FILE_WRITE_ERROR, "Error writing wallet file - records do not match");
+		}
+		file->seek(1 + sizeof(ContainerStoragePrefix), SEEK_SET);
+		uint64_t item_count = m_wallet_records.size();
+		file->write(&item_count, sizeof(item_count));
+		file->write(&item_count, sizeof(item_count));
+		file->fsync();
+	} catch (...) {  // Wallet in memory must stay the same as in file
+		for (auto &&rec : appended)
+			m_wallet_records.erase(rec.spend_public_key);
+		m_oldest_timestamp = was_oldest;
+		throw;
 	}
-	file->fsync();
-	file->seek(1 + sizeof(ContainerStoragePrefix), SEEK_SET);
-	uint64_t item_count = m_wallet_records.size();
-	file->write(&item_count, sizeof(item_count));
-	file->write(&item_count, sizeof(item_count));
-	file->fsync();
 	return result;
 }
 
@@ -405,53 +476,269 @@ bool Wallet::get_only_record(
 	return true;
 }
 
-bool Wallet::save_history(const Hash &bid, const History &used_addresses) const {
-	std::string history_folder = get_history_folder();
-	if (!platform::create_directories_if_necessary(history_folder))
-		return false;
-	crypto::chacha8_iv iv = crypto::rand<crypto::chacha8_iv>();
-	BinaryArray data;
+// History file is a sequence of records - key (hash of tid and history filename seed), size of encrypted data
+// (uint32 LE), iv, then tid and view+spend public keys of used addresses encrypted with history key.
+// Records are only appended, in-memory index points to the last record for each key.
+static const size_t HISTORY_HEADER_SIZE   = sizeof(Hash) + 4 + sizeof(crypto::chacha8_iv);
+static const size_t HISTORY_ADDRESS_SIZE  = 2 * sizeof(PublicKey);
+static const size_t HISTORY_MAX_DATA_SIZE = 64 * 1024 * 1024;  // Protection against garbage
+static const size_t HISTORY_READ_CHUNK    = 1024 * 1024;
+
+static size_t get_history_data_size(const uint8_t *record) {
+	uint32_t data_size = 0;
+	for (size_t i = 0; i != 4; ++i)
+		data_size |= uint32_t(record[sizeof(Hash) + i]) << (8 * i);
+	return data_size;
+}
 
+static bool is_history_data_size_valid(size_t data_size) {
+	return data_size >= sizeof(Hash) && data_size <= HISTORY_MAX_DATA_SIZE &&
+	       (data_size - sizeof(Hash)) % HISTORY_ADDRESS_SIZE == 0;
+}
+
+static void append_history_record(BinaryArray &records, const Hash &key, const Hash &tid,
+    const Wallet::History &used_addresses, const HistoryKey &history_key) {
+	BinaryArray data(std::begin(tid.data), std::end(tid.data));
 	for (auto &&to : used_addresses) {
 		common::append(data, std::begin(to.view_public_key.data), std::end(to.view_public_key.data));
 		common::append(data, std::begin(to.spend_public_key.data), std::end(to.spend_public_key.data));
 	}
-	BinaryArray encrypted_data;
-	encrypted_data.resize(data.size(), 0);
-	crypto::chacha8(data.data(), data.size(), m_history_key, iv, encrypted_data.data());
-	encrypted_data.insert(encrypted_data.begin(), std::begin(iv.data), std::end(iv.data));
-
-	BinaryArray filename_data(std::begin(bid.data), std::end(bid.data));
-	common::append(filename_data, std::begin(m_history_filename_seed.data), std::end(m_history_filename_seed.data));
-	Hash filename_hash = crypto::cn_fast_hash(filename_data.data(), filename_data.size());
+	const crypto::chacha8_iv iv = crypto::rand<crypto::chacha8_iv>();
+	common::append(records, std::begin(key.data), std::end(key.data));
+	for (size_t i = 0; i != 4; ++i)
+		records.push_back(static_cast<uint8_t>(data.size() >> (8 * i)));
+	common::append(records, std::begin(iv.data), std::end(iv.data));
+	records.resize(records.size() + data.size());
+	crypto::chacha8(data.data(), data.size(), history_key, iv, records.data() + records.size() - data.size());
+}
 
-	const auto tmp_path = history_folder + "/_tmp.txh";
-	if( !common::save_file(tmp_path, encrypted_data.data(), encrypted_data.size()) )
-		return false;
-	return platform::atomic_replace_file(tmp_path, history_folder + "/" + common::pod_to_hex(filename_hash) + ".txh");
+// Returns tid
+static Hash decrypt_history_record(
+    const uint8_t *record, const HistoryKey &history_key, Wallet::History *used_addresses) {
+	const size_t data_size = get_history_data_size(record);
+	crypto::chacha8_iv iv;
+	memcpy(iv.data, record + sizeof(Hash) + 4, sizeof(iv.data));
+	BinaryArray dec(data_size);
+	crypto::chacha8(record + HISTORY_HEADER_SIZE, data_size, history_key, iv, dec.data());
+	Hash tid;
+	memcpy(tid.data, dec.data(), sizeof(tid.data));
+	for (size_t pos = sizeof(Hash); pos != dec.size(); pos += HISTORY_ADDRESS_SIZE) {
+		AccountPublicAddress ad;
+		memcpy(ad.view_public_key.data, dec.data() + pos, sizeof(PublicKey));
+		memcpy(ad.spend_public_key.data, dec.data() + pos + sizeof(PublicKey), sizeof(PublicKey));
+		used_addresses->insert(ad);
+	}
+	return tid;
 }
 
-Wallet::History Wallet::load_history(const Hash &bid) const {
-	Wallet::History used_addresses;
-	std::string history_folder = get_history_folder();
-	BinaryArray filename_data(std::begin(bid.data), std::end(bid.data));
-	common::append(filename_data, std::begin(m_history_filename_seed.data), std::end(m_history_filename_seed.data));
-	Hash filename_hash = crypto::cn_fast_hash(filename_data.data(), filename_data.size());
+// Reads history file sequentially by big chunks, calls fun(offset, record) for each complete record.
+// Returns offset after the last such record, anything after it is a torn write or garbage
+template<typename F>
+static uint64_t read_history_records(platform::FileStream &file, F &&fun) {
+	const uint64_t file_size = file.seek(0, SEEK_END);
+	file.seek(0, SEEK_SET);
+	BinaryArray buf;
+	uint64_t buf_offset = 0;  // file offset of buf[0]
+	auto fill           = [&](uint64_t pos, size_t need) -> bool {
+		if (pos + need <= buf_offset + buf.size())
+			return true;
+		if (pos + need > file_size)
+			return false;
+		const size_t drop = static_cast<size_t>(pos - buf_offset);
+		if (drop != 0) {
+			memmove(buf.data(), buf.data() + drop, buf.size() - drop);
+			buf.resize(buf.size() - drop);
+		}
+		buf_offset       = pos;
+		const size_t was = buf.size();
+		const size_t add = static_cast<size_t>(
+		    std::min<uint64_t>(std::max(need - was, HISTORY_READ_CHUNK), file_size - buf_offset - was));
+		buf.resize(was + add);
+		file.read(buf.data() + was, add);
+		return true;
+	};
+	uint64_t pos = 0;
+	while (fill(pos, HISTORY_HEADER_SIZE)) {
+		const size_t data_size = get_history_data_size(buf.data() + static_cast<size_t>(pos - buf_offset));
+		if (!is_history_data_size_valid(data_size) || !fill(pos, HISTORY_HEADER_SIZE + data_size))
+			break;
+		fun(pos, buf.data() + static_cast<size_t>(pos - buf_offset));
+		pos += HISTORY_HEADER_SIZE + data_size;
+	}
+	return pos;
+}
 
+static bool load_legacy_history_file(
+    const std::string &path, const HistoryKey &history_key, Wallet::History *used_addresses) {
 	BinaryArray hist;
-	if (!common::load_file(history_folder + "/" + common::pod_to_hex(filename_hash) + ".txh", hist) ||
-	    hist.size() < sizeof(crypto::chacha8_iv) ||
-	    (hist.size() - sizeof(crypto::chacha8_iv)) % (2 * sizeof(PublicKey)) != 0)
-		return used_addresses;
+	if (!common::load_file(path, hist) || hist.size() < sizeof(crypto::chacha8_iv) ||
+	    (hist.size() - sizeof(crypto::chacha8_iv)) % HISTORY_ADDRESS_SIZE != 0)
+		return false;
 	const crypto::chacha8_iv *iv = (const crypto::chacha8_iv *)hist.data();
 	BinaryArray dec(hist.size() - sizeof(crypto::chacha8_iv), 0);
-	crypto::chacha8(hist.data() + sizeof(crypto::chacha8_iv), hist.size() - sizeof(crypto::chacha8_iv), m_history_key,
-	    *iv, dec.data());
-	for (size_t i = 0; i != dec.size() / (2 * sizeof(PublicKey)); ++i) {
+	crypto::chacha8(
+	    hist.data() + sizeof(crypto::chacha8_iv), hist.size() - sizeof(crypto::chacha8_iv), history_key, *iv, dec.data());
+	for (size_t i = 0; i != dec.size() / HISTORY_ADDRESS_SIZE; ++i) {
 		AccountPublicAddress ad;
-		memcpy(ad.view_public_key.data, dec.data() + i * 2 * sizeof(PublicKey), sizeof(PublicKey));
-		memcpy(ad.spend_public_key.data, dec.data() + i * 2 * sizeof(PublicKey) + sizeof(PublicKey), sizeof(PublicKey));
-		used_addresses.insert(ad);
+		memcpy(ad.view_public_key.data, dec.data() + i * HISTORY_ADDRESS_SIZE, sizeof(PublicKey));
+		memcpy(ad.spend_public_key.data, dec.data() + i * HISTORY_ADDRESS_SIZE + sizeof(PublicKey), sizeof(PublicKey));
+		used_addresses->insert(ad);
 	}
+	return true;
+}
+
+Hash Wallet::get_history_record_key(const Hash &tid) const {
+	BinaryArray key_data(std::begin(tid.data), std::end(tid.data));
+	common::append(key_data, std::begin(m_history_filename_seed.data), std::end(m_history_filename_seed.data));
+	return crypto::cn_fast_hash(key_data.data(), key_data.size());
+}
+
+void Wallet::load_history_index() const {
+	if (m_history_index_loaded)
+		return;
+	m_history_index_loaded = true;
+	try {
+		m_history_file.reset(new platform::FileStream(get_history_path(), platform::FileStream::READ_WRITE_EXISTING));
+	} catch (const common::StreamError &) {
+		try {  // probably read only
+			m_history_file.reset(new platform::FileStream(get_history_path(), platform::FileStream::READ_EXISTING));
+		} catch (const common::StreamError &) {  // no history yet
+		}
+	}
+	if (m_history_file) {
+		const uint64_t file_size = m_history_file->seek(0, SEEK_END);
+		const uint64_t good_size = read_history_records(*m_history_file, [&](uint64_t offset, const uint8_t *record) {
+			Hash key;
+			memcpy(key.data, record, sizeof(key.data));
+			m_history_index[key] = offset;
+		});
+		if (good_size != file_size) {
+			try {
+				m_history_file->truncate(good_size);
+				std::cout << "Truncated torn write in wallet history file to size=" << good_size << std::endl;
+			} catch (const std::exception &) {  // probably read only, ignore
+			}
+		}
+	}
+	m_history_legacy_left = !import_legacy_history();
+}
+
+bool Wallet::append_history(const BinaryArray &records) const {
+	if (!m_history_file) {
+		if (!platform::create_directories_if_necessary(get_history_folder()))
+			return false;
+		try {  // file could appear or become writable after load_history_index
+			m_history_file.reset(new platform::FileStream(get_history_path(), platform::FileStream::READ_WRITE_EXISTING));
+		} catch (const common::StreamError &) {
+		}
+	}
+	if (!m_history_file) {
+		try {  // exists, but not writable, must never be truncated
+			platform::FileStream(get_history_path(), platform::FileStream::READ_EXISTING);
+			return false;
+		} catch (const common::StreamError &) {
+		}
+		try {
+			m_history_file.reset(new platform::FileStream(get_history_path(), platform::FileStream::TRUNCATE_READ_WRITE));
+		} catch (const common::StreamError &) {
+			return false;
+		}
+	}
+	uint64_t offset = 0;
+	try {
+		offset = m_history_file->seek(0, SEEK_END);
+		m_history_file->write(records.data(), records.size());
+		m_history_file->fsync();
+	} catch (const std::exception &) {
+		try {  // next records should not be appended after garbage
+			m_history_file->truncate(offset);
+		} catch (const std::exception &) {
+		}
+		return false;
+	}
+	for (size_t pos = 0; pos != records.size(); pos += HISTORY_HEADER_SIZE + get_history_data_size(records.data() + pos)) {
+		Hash key;
+		memcpy(key.data, records.data() + pos, sizeof(key.data));
+		m_history_index[key] = offset + pos;
+	}
+	return true;
+}
+
+// Before history file, each record was saved into <history folder>/<hex of record key>.txh, without tid.
+// We move them into history file once, millions of tiny files make every directory operation slow
+bool Wallet::import_legacy_history() const {
+	const std::string history_folder = get_history_folder();
+	std::vector<std::string> imported_paths;
+	BinaryArray records;
+	for (auto &&name : platform::get_filenames_in_folder(history_folder)) {
+		Hash key;
+		if (name.size() != 2 * sizeof(Hash) + 4 || name.substr(2 * sizeof(Hash)) != ".txh" ||
+		    !common::pod_from_hex(name.substr(0, 2 * sizeof(Hash)), key))
+			continue;
+		const std::string path = history_folder + "/" + name;
+		History used_addresses;
+		if (m_history_index.count(key) == 0) {  // otherwise imported, but not removed last time
+			if (!load_legacy_history_file(path, m_history_key, &used_addresses))
+				continue;
+			append_history_record(records, key, Hash{}, used_addresses, m_history_key);
+		}
+		imported_paths.push_back(path);
+	}
+	if (imported_paths.empty())
+		return true;
+	if (!records.empty() && !append_history(records))
+		return false;
+	for (auto &&path : imported_paths)
+		std::remove(path.c_str());
+	std::cout << "Imported " << imported_paths.size() << " legacy history files into " << get_history_path()
+	          << std::endl;
+	return true;
+}
+
+bool Wallet::save_history(const Hash &tid, const History &used_addresses) const {
+	load_history_index();
+	BinaryArray record;
+	append_history_record(record, get_history_record_key(tid), tid, used_addresses, m_history_key);
+	return append_history(record);
+}
+
+Wallet::History Wallet::load_history(const Hash &tid) const {
+	Wallet::History used_addresses;
+	load_history_index();
+	const Hash key = get_history_record_key(tid);
+	auto iit       = m_history_index.find(key);
+	if (iit == m_history_index.end()) {
+		if (m_history_legacy_left)
+			load_legacy_history_file(
+			    get_history_folder() + "/" + common::pod_to_hex(key) + ".txh", m_history_key, &used_addresses);
+		return used_addresses;
+	}
+	BinaryArray record(HISTORY_HEADER_SIZE);
+	try {
+		m_history_file->seek(iit->second, SEEK_SET);
+		m_history_file->read(record.data(), HISTORY_HEADER_SIZE);
+		record.resize(HISTORY_HEADER_SIZE + get_history_data_size(record.data()));
+		m_history_file->read(record.data() + HISTORY_HEADER_SIZE, record.size() - HISTORY_HEADER_SIZE);
+	} catch (const std::exception &) {
+		return used_addresses;
+	}
+	decrypt_history_record(record.data(), m_history_key, &used_addresses);
 	return used_addresses;
 }
+
+void Wallet::for_each_history(
+    std::function<void(const Hash &tid, const History &used_addresses)> &&fun) const {
+	load_history_index();
+	if (!m_history_file)
+		return;
+	read_history_records(*m_history_file, [&](uint64_t offset, const uint8_t *record) {
+		Hash key;
+		memcpy(key.data, record, sizeof(key.data));
+		auto iit = m_history_index.find(key);
+		if (iit == m_history_index.end() || iit->second != offset)
+			return;  // superseded by later record for the same transaction
+		History used_addresses;
+		const Hash tid = decrypt_history_record(record, m_history_key, &used_addresses);
+		fun(tid, used_addresses);
+	});
+}
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <functional>
 #include <set>
 #include <unordered_map>
 #include "VarNote.hpp"
@@ -48,6 +49,16 @@ class Wallet {
 	HistoryKey m_history_key;      // Hashed from seed
 	Hash m_history_filename_seed;  // Hashed from seed
 
+	// History file and index are loaded lazily, history methods are logically const
+	mutable std::unique_ptr<platform::FileStream> m_history_file;  // nullptr until first history saved or found
+	mutable std::unordered_map<Hash, uint64_t> m_history_index;    // record key -> record offset in history file
+	mutable bool m_history_index_loaded = false;
+	mutable bool m_history_legacy_left  = false;  // .txh files we could not import, read-only media
+	Hash get_history_record_key(const Hash &tid) const;
+	void load_history_index() const;
+	bool append_history(const BinaryArray &records) const;  // one write and fsync for all records
+	bool import_legacy_history() const;
+
 	void load_container_storage();
 	void load_legacy_wallet_file();
 	bool operator==(const Wallet &) const;
@@ -87,13 +98,17 @@ public:
 	const HistoryKey &get_history_key() const { return m_history_key; }
 	const Hash &get_history_filename_seed() const { return m_history_filename_seed; }
 	std::string get_history_folder() const { return m_path + ".history"; }
+	std::string get_history_path() const { return get_history_folder() + "/history.bin"; }
 
 	Timestamp get_oldest_timestamp() const { return m_oldest_timestamp; }
 	void on_first_output_found(Timestamp ts);  // called by WalletState, updates creation timestamp for imported wallet
 
 	typedef std::set<AccountPublicAddress> History;
-	bool save_history(const Hash &bid, const History &used_addresses) const;
-	History load_history(const Hash &bid) const;
+	bool save_history(const Hash &tid, const History &used_addresses) const;
+	History load_history(const Hash &tid) const;
+	// Streams records in file order, later record for the same tid supersedes earlier ones. tid is Hash{} for
+	// records imported from legacy .txh files, they did not store it
+	void for_each_history(std::function<void(const Hash &tid, const History &used_addresses)> &&fun) const;
 };
 
 }  // namespace varcoin
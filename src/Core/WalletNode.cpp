@@ -31,14 +31,38 @@ WalletNode::WalletNode(Node *inproc_node, logging::ILogger &log, const Config &c
 	if (!config.walletd_bind_ip.empty() && config.walletd_bind_port != 0)
 		m_api.reset(new http::Server(config.walletd_bind_ip, config.walletd_bind_port,
 		    std::bind(&WalletNode::on_api_http_request, this, _1, _2, _3),
-		    std::bind(&WalletNode::on_api_http_disconnect, this, _1)));
+		    std::bind(&WalletNode::on_api_http_disconnect, this, _1), config.rpc_max_in_flight));
 }
 
 bool WalletNode::on_api_http_request(http::Client *who, http::RequestData &&request, http::ResponseData &response) {
 	response.r.add_headers_nocache();
 	bool method_found = false;
+	if (request.r.uri == "/metrics") {  // Registry is process-wide, so includes in-process node metrics
+		if (!m_config.walletd_authorization.empty() &&
+		    request.r.basic_authorization != m_config.walletd_authorization) {
+			response.r.headers.push_back({"WWW-Authenticate", "Basic realm=\"Wallet\", charset=\"UTF-8\""});
+			response.r.status = 401;
+			return true;
+		}
+		response.r.headers.push_back({"Content-Type", "text/plain; version=0.0.4"});
+		response.set_body(common::metrics::to_prometheus());
+		response.r.status = 200;
+		return true;
+	}
+	if (request.r.uri == api::walletd::SubscribeEvents::url()) {
+		if (!m_config.walletd_authorization.empty() &&
+		    request.r.basic_authorization != m_config.walletd_authorization) {
+			response.r.headers.push_back({"WWW-Authenticate", "Basic realm=\"Wallet\", charset=\"UTF-8\""});
+			response.r.status = 401;
+			return true;
+		}
+		return on_subscribe_events(who, std::move(request), response);
+	}
 	if (request.r.uri == api::walletd::url()) {
-		bool result = process_json_rpc_request(m_jsonrpc3_handlers, who, std::move(request), response, method_found);
+		static const CountersMap counters =
+		    common::metrics::counters_by_key("walletd_json_rpc_requests_total", "method", m_jsonrpc3_handlers);
+		bool result =
+		    process_json_rpc_request(m_jsonrpc3_handlers, counters, who, std::move(request), response, method_found);
 		if (method_found)
 			return result;
 	}
@@ -58,7 +82,7 @@ bool WalletNode::on_api_http_request(http::Client *who, http::RequestData &&requ
 		    send_response.r.keep_alive         = wc.original_request.r.keep_alive;
 		    // varcoind never sends connection-close, so we are safe to retain all
 		    // headers
-		    wc.original_who->write(std::move(send_response));
+		    wc.original_who->write(std::move(send_response), wc.original_request_number);
 		},
 	    [=](const WaitingClient &wc, std::string err) {
 		    http::ResponseData send_response;
@@ -66,7 +90,7 @@ bool WalletNode::on_api_http_request(http::Client *who, http::RequestData &&requ
 		    send_response.r.http_version_minor = wc.original_request.r.http_version_minor;
 		    send_response.r.keep_alive         = wc.original_request.r.keep_alive;
 		    send_response.r.status             = 504;  // TODO -test this code path
-		    wc.original_who->write(std::move(send_response));
+		    wc.original_who->write(std::move(send_response), wc.original_request_number);
 		});
 	return false;
 }
@@ -81,9 +105,15 @@ void WalletNode::on_api_http_disconnect(http::Client *who) {
 			lit = m_long_poll_http_clients.erase(lit);
 		else
 			++lit;
+	for (auto sit = m_event_subscribers.begin(); sit != m_event_subscribers.end();)
+		if (sit->who == who)
+			sit = m_event_subscribers.erase(sit);
+		else
+			++sit;
 }
 
 bool WalletNode::process_json_rpc_request(const HandlersMap &handlers,
+    const CountersMap &counters,
     http::Client *who,
     http::RequestData &&request,
     http::ResponseData &response,
@@ -112,6 +142,9 @@ bool WalletNode::process_json_rpc_request(const HandlersMap &handlers,
 			response.r.status = 401;
 			return true;
 		}
+		auto cit = counters.find(it->first);
+		if (cit != counters.end())
+			cit->second->add();
 		//		m_log(logging::INFO) << "json request method=" <<
 		// json_req.get_method()
 		//<< std::endl;
@@ -156,10 +189,11 @@ bool WalletNode::handle_get_status3(http::Client *who, http::RequestData &&raw_r
 		//<<
 		// raw_request.body << std::endl;
 		LongPollClient lpc;
-		lpc.original_who        = who;
-		lpc.original_request    = raw_request;
-		lpc.original_jsonrpc_id = raw_js_request.get_id();
-		lpc.original_get_status = request;
+		lpc.original_who            = who;
+		lpc.original_request_number = who->get_last_request_number();
+		lpc.original_request        = raw_request;
+		lpc.original_jsonrpc_id     = raw_js_request.get_id();
+		lpc.original_get_status     = request;
 		m_long_poll_http_clients.push_back(lpc);
 		return false;
 	}
@@ -458,13 +492,13 @@ bool WalletNode::handle_create_transaction3(http::Client *who, http::RequestData
 			    throw json_rpc::Error(json_rpc::INTERNAL_ERROR, "Created trsnsaction cannot be parsed");
 		    http::ResponseData last_http_response =
 		        json_rpc::create_response(wc.original_request, last_response, wc.original_jsonrpc_id);
-		    wc.original_who->write(std::move(last_http_response));
+		    wc.original_who->write(std::move(last_http_response), wc.original_request_number);
 		},
 	    [=](const WaitingClient &wc, std::string err) mutable {
 		    m_log(logging::INFO) << "got error to get_random_outputs from varcoind, " << err << std::endl;
 		    http::ResponseData last_http_response = json_rpc::create_error_response(
 		        wc.original_request, json_rpc::Error(json_rpc::INTERNAL_ERROR, err), wc.original_jsonrpc_id);
-		    wc.original_who->write(std::move(last_http_response));
+		    wc.original_who->write(std::move(last_http_response), wc.original_request_number);
 		});
 	return false;
 }
@@ -523,22 +557,22 @@ bool WalletNode::handle_send_transaction3(http::Client *who, http::RequestData &
 			    resp.r.http_version_major = wc2.original_request.r.http_version_major;
 			    resp.r.http_version_minor = wc2.original_request.r.http_version_minor;
 			    resp.r.keep_alive         = wc2.original_request.r.keep_alive;
-			    wc2.original_who->write(std::move(resp));
+			    wc2.original_who->write(std::move(resp), wc2.original_request_number);
 		    } catch (const std::exception &ex) {
 			    http::ResponseData resp = json_rpc::create_error_response(wc2.original_request,
 			        json_rpc::Error(json_rpc::INTERNAL_ERROR, ex.what()), wc2.original_jsonrpc_id);
-			    wc2.original_who->write(std::move(resp));
+			    wc2.original_who->write(std::move(resp), wc2.original_request_number);
 		    } catch (...) {
 			    http::ResponseData resp = json_rpc::create_error_response(wc2.original_request,
 			        json_rpc::Error(json_rpc::INTERNAL_ERROR, "catch..."), wc2.original_jsonrpc_id);
-			    wc2.original_who->write(std::move(resp));
+			    wc2.original_who->write(std::move(resp), wc2.original_request_number);
 		    }
 		},
 	    [=](const WaitingClient &wc2, std::string err) {
 		    transient_transactions_counter -= 1;
 		    http::ResponseData resp = json_rpc::create_error_response(
 		        wc2.original_request, json_rpc::Error(json_rpc::INTERNAL_ERROR, err), wc2.original_jsonrpc_id);
-		    wc2.original_who->write(std::move(resp));
+		    wc2.original_who->write(std::move(resp), wc2.original_request_number);
 		});
 	return false;
 }
@@ -550,10 +584,10 @@ bool WalletNode::handle_get_transaction3(http::Client *, http::RequestData &&, j
 	return true;
 }
 
-void WalletNode::process_waiting_command_response(http::ResponseData &&resp) {
-	WaitingClient cli = std::move(m_waiting_command_requests.front());
-	m_waiting_command_requests.pop_front();
-	m_command_request.reset();
+void WalletNode::process_waiting_command_response(
+    std::list<WaitingClient>::iterator wit, http::ResponseData &&resp) {
+	WaitingClient cli = std::move(*wit);
+	m_waiting_command_requests.erase(wit);
 
 	if (cli.original_who) {
 		auto err_fun = std::move(cli.err_fun);
@@ -568,46 +602,38 @@ void WalletNode::process_waiting_command_response(http::ResponseData &&resp) {
 			err_fun(cli, "catch ...");
 		}
 	}
-	send_next_waiting_command();
 }
 
-void WalletNode::process_waiting_command_error(std::string err) {
-	WaitingClient cli = std::move(m_waiting_command_requests.front());
-	m_waiting_command_requests.pop_front();
-	m_command_request.reset();
+void WalletNode::process_waiting_command_error(std::list<WaitingClient>::iterator wit, std::string err) {
+	WaitingClient cli = std::move(*wit);
+	m_waiting_command_requests.erase(wit);
 
 	if (cli.original_who) {
 		auto err_fun = std::move(cli.err_fun);
 		err_fun(cli, err);
 	}
-	send_next_waiting_command();
-}
-
-void WalletNode::send_next_waiting_command() {
-	if (m_waiting_command_requests.empty() || m_command_request)
-		return;
-	auto fun          = std::bind(&WalletNode::process_waiting_command_response, this, _1);
-	auto e_fun        = std::bind(&WalletNode::process_waiting_command_error, this, _1);
-	m_command_request = std::make_unique<http::Request>(
-	    m_commands_agent, std::move(m_waiting_command_requests.front().request), fun, e_fun);
 }
 
 void WalletNode::add_waiting_command(http::Client *who, http::RequestData &&original_request,
     const json_rpc::OptionalJsonValue &original_rpc_id, http::RequestData &&request,
     std::function<void(const WalletNode::WaitingClient &wc, http::ResponseData &&resp)> fun,
     std::function<void(const WalletNode::WaitingClient &wc, std::string)> err_fun) {
-	WaitingClient wc2;
-	wc2.original_who        = who;
-	wc2.original_request    = std::move(original_request);
-	wc2.original_jsonrpc_id = original_rpc_id;
-	wc2.fun                 = fun;
-	wc2.err_fun             = err_fun;
-	wc2.request             = std::move(request);
-	m_waiting_command_requests.push_back(wc2);
-	send_next_waiting_command();
+	m_waiting_command_requests.emplace_back();
+	auto wit                 = std::prev(m_waiting_command_requests.end());
+	wit->original_who            = who;
+	wit->original_request_number = who ? who->get_last_request_number() : 0;
+	wit->original_request        = std::move(original_request);
+	wit->original_jsonrpc_id     = original_rpc_id;
+	wit->fun                     = fun;
+	wit->err_fun                 = err_fun;
+	// Sent at once, agent queues commands it cannot send yet
+	wit->sent_request = std::make_unique<http::Request>(m_commands_agent, std::move(request),
+	    std::bind(&WalletNode::process_waiting_command_response, this, wit, _1),
+	    std::bind(&WalletNode::process_waiting_command_error, this, wit, _1));
 }
 
 void WalletNode::advance_long_poll() {
+	advance_event_subscribers();
 	if (m_long_poll_http_clients.empty())
 		return;
 	api::walletd::GetStatus::Response resp = create_status_response3();
@@ -626,8 +652,123 @@ void WalletNode::advance_long_poll() {
 			last_http_response.set_body(last_json_resp.get_body());
 			//			m_log(logging::INFO) << "advance_long_poll will
 			// reply to long poll json=" << last_http_response.body << std::endl;
-			lit->original_who->write(std::move(last_http_response));
+			lit->original_who->write(std::move(last_http_response), lit->original_request_number);
 			lit = m_long_poll_http_clients.erase(lit);
 		} else
 			++lit;
 }
+
+static std::string event_chunk(const api::walletd::SubscribeEvents::Event &event) {
+	return seria::to_json_value(event).to_string() + "\n";
+}
+
+void WalletNode::advance_event_subscribers() {
+	const Height tip_height     = m_wallet_state.get_tip_height();
+	const Hash tip_bid          = m_wallet_state.get_tip_bid();
+	const uint32_t pool_version = m_wallet_state.get_tx_pool_version();
+	if (m_event_subscribers.empty() || (tip_bid == m_events_tip_bid && pool_version == m_events_pool_version))
+		return;
+	api::walletd::SubscribeEvents::Event event;
+	event.top_block_height = tip_height;
+	event.top_block_hash   = tip_bid;
+	std::string undo_chunk;
+	Height from_height = m_events_height;
+	if (m_wallet_state.get_lowest_undone_height() <= m_events_height) {
+		from_height            = m_wallet_state.get_lowest_undone_height() - 1;
+		event.type             = "undo";
+		event.undo_from_height = from_height;
+		undo_chunk             = event_chunk(event);
+	}
+	m_wallet_state.clear_lowest_undone_height();
+	// Dashboards usually watch few addresses, so we prepare each distinct chunk once
+	std::map<std::string, std::string> blocks_chunks;
+	std::map<std::string, std::string> pool_jsons;
+	std::map<std::string, std::string> pool_chunks;
+	for (auto &&sub : m_event_subscribers) {
+		const std::string &address = sub.filter.address;
+		if ((tip_bid != m_events_tip_bid || !undo_chunk.empty()) && blocks_chunks.count(address) == 0) {
+			Height transfers_from  = from_height;
+			Height transfers_to    = tip_height;
+			event.type             = "blocks";  // Even without transfers, so that clients see new tip
+			event.blocks           = m_wallet_state.api_get_transfers(address, transfers_from, transfers_to, true);
+			blocks_chunks[address] = event_chunk(event);
+			event.blocks.clear();
+		}
+		if (sub.filter.pool && pool_jsons.count(address) == 0) {
+			event.type           = "pool";
+			event.pool           = m_wallet_state.api_get_pool_as_history(address);
+			pool_jsons[address]  = seria::to_json_value(event.pool).to_string();
+			pool_chunks[address] = event_chunk(event);
+		}
+	}
+	m_events_height       = tip_height;
+	m_events_tip_bid      = tip_bid;
+	m_events_pool_version = pool_version;
+
+	std::vector<http::Client *> slow_clients;  // Disconnecting modifies m_event_subscribers
+	for (auto &&sub : m_event_subscribers) {
+		bool ok = sub.who->write_chunk(undo_chunk);
+		ok      = sub.who->write_chunk(blocks_chunks[sub.filter.address]) && ok;
+		if (sub.filter.pool && sub.last_pool != pool_jsons[sub.filter.address]) {
+			sub.last_pool = pool_jsons[sub.filter.address];
+			ok            = sub.who->write_chunk(pool_chunks[sub.filter.address]) && ok;
+		}
+		if (!ok)
+			slow_clients.push_back(sub.who);
+	}
+	for (auto who : slow_clients) {
+		m_log(logging::INFO) << "Disconnecting event subscriber reading too slowly" << std::endl;
+		who->disconnect();
+	}
+}
+
+bool WalletNode::on_subscribe_events(http::Client *who, http::RequestData &&request, http::ResponseData &response) {
+	api::walletd::SubscribeEvents::Request req;
+	try {  // Not a json rpc endpoint, so errors are reported as HTTP 400 with json rpc error object in body
+		try {
+			if (!request.body.empty())
+				seria::from_json_value(req, common::JsonValue::from_string(request.body));
+		} catch (const std::exception &ex) {
+			throw json_rpc::Error(json_rpc::INVALID_PARAMS, std::string("Failed to parse request, ") + ex.what());
+		}
+		check_address_in_wallet_or_throw(req.address);
+	} catch (const json_rpc::Error &err) {
+		response.r.headers.push_back({"Content-Type", "application/json; charset=utf-8"});
+		response.set_body(seria::to_json_value(err).to_string());
+		response.r.status = 400;
+		return true;
+	}
+	if (m_event_subscribers.empty()) {  // State is not tracked without subscribers
+		m_events_height       = m_wallet_state.get_tip_height();
+		m_events_tip_bid      = m_wallet_state.get_tip_bid();
+		m_events_pool_version = m_wallet_state.get_tx_pool_version();
+		m_wallet_state.clear_lowest_undone_height();
+	} else
+		advance_event_subscribers();  // New subscriber starts from the same state as others
+	EventSubscriber sub;
+	sub.who    = who;
+	sub.filter = req;
+	api::walletd::SubscribeEvents::Event event;
+	event.top_block_height = m_events_height;
+	event.top_block_hash   = m_events_tip_bid;
+	std::string body;
+	if (req.from_height < m_events_height) {
+		Height to_height = m_events_height;
+		event.type       = "blocks";
+		event.blocks     = m_wallet_state.api_get_transfers(req.address, req.from_height, to_height, true);
+		body += event_chunk(event);
+		event.blocks.clear();
+	}
+	if (req.pool) {
+		event.type    = "pool";
+		event.pool    = m_wallet_state.api_get_pool_as_history(req.address);
+		sub.last_pool = seria::to_json_value(event.pool).to_string();
+		body += event_chunk(event);
+	}
+	response.r.headers.push_back({"Content-Type", "application/x-ndjson; charset=utf-8"});
+	response.r.status = 200;
+	response.set_body(std::move(body));
+	who->start_stream(std::move(response), who->get_last_request_number());
+	m_event_subscribers.push_back(std::move(sub));
+	return false;
+}
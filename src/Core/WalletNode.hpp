@@ -5,6 +5,7 @@
 
 #include "Node.hpp"
 #include "WalletSync.hpp"
+#include "common/Metrics.hpp"
 #include "http/Server.hpp"
 
 namespace varcoin {
@@ -48,24 +49,25 @@ private:
 	std::unique_ptr<http::Server> m_api;
 
 	struct WaitingClient {
-		http::Client *original_who = nullptr;
-		http::RequestData request;
+		http::Client *original_who     = nullptr;
+		size_t original_request_number = 0;  // Commands complete in any order, so we write response to its request
 		http::RequestData original_request;
 		json_rpc::OptionalJsonValue original_jsonrpc_id;
 		std::function<void(const WaitingClient &wc, http::ResponseData &&resp)> fun;
 		std::function<void(const WaitingClient &wc, std::string)> err_fun;
+		std::unique_ptr<http::Request> sent_request;
 	};
-	std::deque<WaitingClient> m_waiting_command_requests;
+	std::list<WaitingClient> m_waiting_command_requests;
 	void add_waiting_command(http::Client *who, http::RequestData &&original_request,
 	    const json_rpc::OptionalJsonValue &original_rpc_id, http::RequestData &&request,
 	    std::function<void(const WaitingClient &wc, http::ResponseData &&resp)> fun,
 	    std::function<void(const WaitingClient &wc, std::string)> err_fun);
-	void send_next_waiting_command();
-	void process_waiting_command_response(http::ResponseData &&resp);
-	void process_waiting_command_error(std::string err);
+	void process_waiting_command_response(std::list<WaitingClient>::iterator wit, http::ResponseData &&resp);
+	void process_waiting_command_error(std::list<WaitingClient>::iterator wit, std::string err);
 
 	struct LongPollClient {
-		http::Client *original_who = nullptr;
+		http::Client *original_who     = nullptr;
+		size_t original_request_number = 0;  // pipelined requests may follow long poll
 		http::RequestData original_request;
 		json_rpc::OptionalJsonValue original_jsonrpc_id;
 		varcoin::api::walletd::GetStatus::Request original_get_status;
@@ -73,7 +75,20 @@ private:
 	std::list<LongPollClient> m_long_poll_http_clients;
 	void advance_long_poll();
 
+	struct EventSubscriber {
+		http::Client *who = nullptr;
+		api::walletd::SubscribeEvents::Request filter;
+		std::string last_pool;  // Pool transfers are sent only when they change
+	};
+	std::list<EventSubscriber> m_event_subscribers;
+	Height m_events_height = 0;  // State last sent to subscribers, events are deltas from it
+	Hash m_events_tip_bid;
+	uint32_t m_events_pool_version = 0;
+	void advance_event_subscribers();
+	bool on_subscribe_events(http::Client *, http::RequestData &&, http::ResponseData &);
+
 	typedef std::unordered_map<std::string, JSONRPCHandlerFunction> HandlersMap;
+	typedef std::unordered_map<std::string, common::metrics::Counter *> CountersMap;  // by method, for each HandlersMap
 	static const HandlersMap m_jsonrpc3_handlers;
 
 	api::walletd::GetStatus::Response create_status_response3() const;
@@ -81,8 +96,8 @@ private:
 	bool on_api_http_request(http::Client *, http::RequestData &&, http::ResponseData &);
 	void on_api_http_disconnect(http::Client *);
 
-	bool process_json_rpc_request(
-	    const HandlersMap &, http::Client *, http::RequestData &&, http::ResponseData &, bool &method_found);
+	bool process_json_rpc_request(const HandlersMap &, const CountersMap &, http::Client *, http::RequestData &&,
+	    http::ResponseData &, bool &method_found);
 	void check_address_in_wallet_or_throw(const std::string & addr)const;
 };
 
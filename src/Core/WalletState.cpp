@@ -6,6 +6,7 @@
 #include "VarNoteTools.hpp"
 #include "TransactionBuilder.hpp"
 #include "TransactionExtra.hpp"
+#include "common/Metrics.hpp"
 #include "common/string.hpp"
 #include "crypto/crypto.hpp"
 #include "seria/BinaryInputStream.hpp"
@@ -153,16 +154,66 @@ PreparedWalletBlock WalletPreparatorMulticore::get_ready_work(Height height) {
 }
 
 template<class T>
-std::string to_binary_key(const T &s) {
+void from_binary_key(const std::string &key, T &s) {
 	static_assert(std::is_standard_layout<T>::value, "T must be Standard Layout");
-	return common::to_hex(&s, sizeof(s));  // WalletState::DB::to_binary_key((const unsigned char *)&s, sizeof(s));
+	if (!common::pod_from_hex(key, s))  // WalletState::DB::to_binary_key((const unsigned char *)&s, sizeof(s));
+		throw std::logic_error("from_binary_key failed for key " + key);
 }
 
 template<class T>
-void from_binary_key(const std::string &key, T &s) {
+DB::Key hex_key(const std::string &prefix, const T &s) {  // prefix + to_binary_key(s) without allocations
 	static_assert(std::is_standard_layout<T>::value, "T must be Standard Layout");
-	if (!common::pod_from_hex(key, s))  // WalletState::DB::to_binary_key((const unsigned char *)&s, sizeof(s));
-		throw std::logic_error("from_binary_key failed for key " + key);
+	DB::Key key(prefix);
+	key.append_hex(&s, sizeof(s));
+	return key;
+}
+
+template<class T>
+DB::Key height_hex_key(const std::string &prefix, Height height, const T &s) {
+	static_assert(std::is_standard_layout<T>::value, "T must be Standard Layout");
+	DB::Key key(prefix);
+	key.append_ascending(height).append("/", 1).append_hex(&s, sizeof(s));
+	return key;
+}
+
+static DB::Key address_height_hex_key(const std::string &address, Height height, const Hash &tid) {
+	DB::Key key(ADDRESS_HEIGHT_TRANSACTION_PREFIX);
+	key.append(address).append("/", 1).append_ascending(height).append("/", 1).append_hex(tid.data, sizeof(tid.data));
+	return key;
+}
+
+static DB::Key unlock_key(const std::string &prefix, uint32_t clamped_unlock_time, const api::Output &output) {
+	DB::Key key(prefix);
+	key.append_ascending(clamped_unlock_time).append("/", 1).append_decimal(output.amount).append("/", 1);
+	key.append_decimal(output.global_index);
+	return key;
+}
+
+static DB::Key unspent_key(const api::Output &output) {
+	DB::Key key(UNSPENT_HEIGHT_PREFIX);
+	key.append(output.address).append("/", 1).append_ascending(output.height).append("/", 1);
+	key.append_decimal(output.amount).append("/", 1).append_decimal(output.global_index);
+	return key;
+}
+
+static DB::Key height_unspent_key(const api::Output &output) {
+	DB::Key key(HEIGHT_UNSPENT_PREFIX);
+	key.append_ascending(output.height).append("/", 1).append(output.address).append("/", 1);
+	key.append_decimal(output.amount).append("/", 1).append_decimal(output.global_index);
+	return key;
+}
+
+static DB::Key height_output_key(const api::Output &output) {
+	DB::Key key(HEIGHT_OUTPUT_PREFIX);
+	key.append_ascending(output.height).append("/", 1).append_decimal(output.amount).append("/", 1);
+	key.append_decimal(output.global_index);
+	return key;
+}
+
+static DB::Key chain_key(Height height) {
+	DB::Key key(TIP_CHAIN_PREFIX);
+	key.append_ascending(height);
+	return key;
 }
 
 void WalletState::DeltaState::redo_transaction(
@@ -291,7 +342,7 @@ void WalletState::wallet_addresses_updated() {
 	Timestamp undo_timestamp = std::numeric_limits<Timestamp>::max();
 	for (auto rec : m_wallet.get_records()) {
 		const WalletRecord &wa = rec.second;
-		auto keyuns            = ADDRESSES_PREFIX + to_binary_key(wa.spend_public_key);
+		auto keyuns            = hex_key(ADDRESSES_PREFIX, wa.spend_public_key);
 		std::string st;
 		if (!m_db.get(keyuns, st) || wa.creation_timestamp < boost::lexical_cast<Timestamp>(st)) {
 			undo_timestamp = std::min(undo_timestamp, wa.creation_timestamp);
@@ -322,7 +373,7 @@ std::vector<WalletRecord> WalletState::generate_new_addresses(const std::vector<
 	Timestamp undo_timestamp = std::numeric_limits<Timestamp>::max();
 	for (size_t i = 0; i != std::min(result.size(), sks.size()); ++i) {
 		const WalletRecord &wa = result.at(i);
-		auto keyuns            = ADDRESSES_PREFIX + to_binary_key(wa.spend_public_key);
+		auto keyuns            = hex_key(ADDRESSES_PREFIX, wa.spend_public_key);
 		std::string st;
 		if (!m_db.get(keyuns, st) || wa.creation_timestamp < boost::lexical_cast<Timestamp>(st)) {
 			if (sks.at(i) != SecretKey{})  // Newly generated addresses never lead to undo
@@ -496,10 +547,14 @@ void WalletState::test_print_everything(const std::string &str) {
 
 bool WalletState::redo_block(const api::BlockHeader &header, const PreparedWalletBlock &pb,
     const BlockChainState::BlockGlobalIndices &global_indices, Height height) {
+	static auto &redo_block_histogram = common::metrics::histogram("walletd_redo_block_seconds");
+	static auto &scanned_counter      = common::metrics::counter("walletd_scanned_transactions_total");
 	if (height != m_tip_height + 1)
 		throw std::runtime_error("Redo of incorrect block");
 	if (global_indices.size() != pb.transactions.size() + 1)
 		return false;  // Bad node
+	common::metrics::ScopedTimer timer(redo_block_histogram);
+	scanned_counter.add(pb.transactions.size() + 1);
 	// order is important here. Unlock before redo, or will lock/unlock twice ->
 	// invariant dead
 	// If we are redoing first block, there is nothing to unlock
@@ -530,6 +585,7 @@ bool WalletState::redo_block(const api::BlockHeader &header, const PreparedWalle
 }
 
 void WalletState::undo_block(Height height) {
+	m_lowest_undone_height = std::min(m_lowest_undone_height, height);
 	try {
 		auto prefix = HEIGHT_KEYIMAGE_PREFIX + DB::to_ascending_key(height) + "/";
 		for (DB::Cursor cur = m_db.begin(prefix); !cur.end(); cur.erase()) {
@@ -581,7 +637,7 @@ bool WalletState::parse_raw_transaction(api::Transaction &ptx, const Transaction
 			input_amount += in.amount;
 			ptx.fee += in.amount;
 			ptx.anonymity = std::min(ptx.anonymity, static_cast<uint32_t>(in.output_indexes.size() - 1));
-			auto key      = KEYIMAGE_PREFIX + to_binary_key(in.key_image);
+			auto key      = hex_key(KEYIMAGE_PREFIX, in.key_image);
 			BinaryArray rb;
 			if (m_db.get(key, rb)) {
 				api::Output output;
@@ -737,7 +793,7 @@ bool WalletState::redo_transaction(const PreparedWalletTransaction &pwtx, const
 			input_amount += in.amount;
 			ptx.fee += in.amount;
 			ptx.anonymity = std::min(ptx.anonymity, static_cast<uint32_t>(in.output_indexes.size()));
-			auto key      = KEYIMAGE_PREFIX + to_binary_key(in.key_image);
+			auto key      = hex_key(KEYIMAGE_PREFIX, in.key_image);
 			BinaryArray rb;
 			if (m_db.get(key, rb)) {
 				api::Output output;
@@ -789,7 +845,7 @@ bool WalletState::read_tips() {
 void WalletState::push_chain(const api::BlockHeader &header) {
 	m_tip_height += 1;
 	BinaryArray ba = seria::to_binary(header);
-	m_db.put(TIP_CHAIN_PREFIX + DB::to_ascending_key(m_tip_height), ba, true);
+	m_db.put(chain_key(m_tip_height), ba, true);
 	m_db.put("$tip_height", common::to_string(m_tip_height), false);
 	m_tip = header;
 	m_db.put("$tail_height", common::to_string(m_tail_height), false);
@@ -799,7 +855,7 @@ void WalletState::push_chain(const api::BlockHeader &header) {
 void WalletState::pop_chain() {
 	if (m_tip_height + 1 == m_tail_height)
 		throw std::logic_error("pop_chain tip_height == -1");
-	m_db.del(TIP_CHAIN_PREFIX + DB::to_ascending_key(m_tip_height), true);
+	m_db.del(chain_key(m_tip_height), true);
 	m_tip_height -= 1;
 	m_db.put("$tip_height", common::to_string(m_tip_height), false);
 	m_tip = (m_tip_height + 1 == m_tail_height) ? api::BlockHeader{} : read_chain(m_tip_height);
@@ -807,7 +863,7 @@ void WalletState::pop_chain() {
 
 bool WalletState::read_chain(uint32_t height, api::BlockHeader &header) const {
 	BinaryArray rb;
-	if (!m_db.get(TIP_CHAIN_PREFIX + DB::to_ascending_key(height), rb))
+	if (!m_db.get(chain_key(height), rb))
 		return false;
 	seria::from_binary(header, rb);
 	return true;
@@ -825,8 +881,8 @@ void WalletState::redo_transaction(
 	auto cur = m_db.begin(TRANSACTION_PREFIX);
 	if (cur.end())
 		m_wallet.on_first_output_found(ptx.timestamp);
-	auto trkey         = TRANSACTION_PREFIX + to_binary_key(tid);
-	auto hetrkey       = HEIGHT_TRANSACTION_PREFIX + DB::to_ascending_key(height) + "/" + to_binary_key(tid);
+	auto trkey         = hex_key(TRANSACTION_PREFIX, tid);
+	auto hetrkey       = height_hex_key(HEIGHT_TRANSACTION_PREFIX, height, tid);
 	BinaryArray str_pa = seria::to_binary(std::make_pair(tx, ptx));
 	BinaryArray str    = seria::to_binary(ptx);
 	m_db.put(trkey, str_pa, true);
@@ -836,15 +892,12 @@ void WalletState::redo_transaction(
 		addresses.insert(transfer.address);
 	}
 	for (auto &&addr : addresses) {
-		auto adtrkey =
-		    ADDRESS_HEIGHT_TRANSACTION_PREFIX + addr + "/" + DB::to_ascending_key(height) + "/" + to_binary_key(tid);
-		m_db.put(adtrkey, str, true);
+		m_db.put(address_height_hex_key(addr, height, tid), str, true);
 	}
 }
 
 void WalletState::undo_transaction(Height height, const Hash &tid) {
-	auto trkey   = TRANSACTION_PREFIX + to_binary_key(tid);
-	auto hetrkey = HEIGHT_TRANSACTION_PREFIX + DB::to_ascending_key(height) + "/" + to_binary_key(tid);
+	auto trkey = hex_key(TRANSACTION_PREFIX, tid);
 	BinaryArray data;
 	if (!m_db.get(trkey, data))
 		throw std::logic_error("Invariant dead - transaction does not exist in undo_transaction");
@@ -857,9 +910,7 @@ void WalletState::undo_transaction(Height height, const Hash &tid) {
 		addresses.insert(transfer.address);
 	}
 	for (auto &&addr : addresses) {
-		auto adtrkey =
-		    ADDRESS_HEIGHT_TRANSACTION_PREFIX + addr + "/" + DB::to_ascending_key(height) + "/" + to_binary_key(tid);
-		m_db.del(adtrkey, true);
+		m_db.del(address_height_hex_key(addr, height, tid), true);
 	}
 }
 
@@ -868,28 +919,19 @@ void WalletState::add_to_lock_index(const api::Output &output) {
 	// output.global_index << " un=" << output.unlock_time << std::endl;
 	BinaryArray ba = seria::to_binary(output);
 
-	std::string unkey;
 	uint32_t clamped_unlock_time = static_cast<uint32_t>(std::min<UnlockMoment>(output.unlock_time, 0xFFFFFFFF));
-	if (m_currency.is_transaction_spend_time_block(output.unlock_time))
-		unkey = UNLOCK_BLOCK_PREFIX + DB::to_ascending_key(clamped_unlock_time) + "/" +
-		        common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-	else
-		unkey = UNLOCK_TIME_PREFIX + DB::to_ascending_key(clamped_unlock_time) + "/" +
-		        common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-	m_db.put(unkey, ba, true);
+	const std::string &unprefix =
+	    m_currency.is_transaction_spend_time_block(output.unlock_time) ? UNLOCK_BLOCK_PREFIX : UNLOCK_TIME_PREFIX;
+	m_db.put(unlock_key(unprefix, clamped_unlock_time, output), ba, true);
 }
 
 bool WalletState::remove_from_lock_index(const api::Output &output, bool mustexist) {
 	//	std::cout << "Unlock am=" << output.amount / 1E8 << " gi=" <<
 	// output.global_index << " un=" << output.unlock_time << std::endl;
-	std::string unkey;
 	uint32_t clamped_unlock_time = static_cast<uint32_t>(std::min<UnlockMoment>(output.unlock_time, 0xFFFFFFFF));
-	if (m_currency.is_transaction_spend_time_block(output.unlock_time))
-		unkey = UNLOCK_BLOCK_PREFIX + DB::to_ascending_key(clamped_unlock_time) + "/" +
-		        common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-	else
-		unkey = UNLOCK_TIME_PREFIX + DB::to_ascending_key(clamped_unlock_time) + "/" +
-		        common::to_string(output.amount) + "/" + common::to_string(output.global_index);
+	const std::string &unprefix =
+	    m_currency.is_transaction_spend_time_block(output.unlock_time) ? UNLOCK_BLOCK_PREFIX : UNLOCK_TIME_PREFIX;
+	auto unkey = unlock_key(unprefix, clamped_unlock_time, output);
 	std::string was_value;
 	if (!mustexist && !m_db.get(unkey, was_value))
 		return false;
@@ -903,14 +945,9 @@ void WalletState::add_to_unspent_index(const api::Output &output) {
 	//	<< output.global_index
 	//		          << " un=" << output.unlock_time << std::endl;
 	modify_balance(output, 0, 1);
-	auto keyuns = UNSPENT_HEIGHT_PREFIX + output.address + "/" + DB::to_ascending_key(output.height) + "/" +
-	              common::to_string(output.amount) + "/" + common::to_string(output.global_index);
 	BinaryArray ba2 = seria::to_binary(output);
-	m_db.put(keyuns, ba2, true);
-
-	auto hekeyuns = HEIGHT_UNSPENT_PREFIX + DB::to_ascending_key(output.height) + "/" + output.address + "/" +
-	                common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-	m_db.put(hekeyuns, ba2, true);
+	m_db.put(unspent_key(output), ba2, true);
+	m_db.put(height_unspent_key(output), ba2, true);
 }
 
 void WalletState::remove_from_unspent_index(const api::Output &output) {
@@ -919,19 +956,13 @@ void WalletState::remove_from_unspent_index(const api::Output &output) {
 	// gi=" << output.global_index
 	//		          << " un=" << output.unlock_time << std::endl;
 	modify_balance(output, 0, -1);
-	auto keyuns = UNSPENT_HEIGHT_PREFIX + output.address + "/" + DB::to_ascending_key(output.height) + "/" +
-	              common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-	m_db.del(keyuns, true);
-	auto hekeyuns = HEIGHT_UNSPENT_PREFIX + DB::to_ascending_key(output.height) + "/" + output.address + "/" +
-	                common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-	m_db.del(hekeyuns, true);
+	m_db.del(unspent_key(output), true);
+	m_db.del(height_unspent_key(output), true);
 }
 
 bool WalletState::is_unspent(const api::Output &output) const {
-	BinaryArray ba = seria::to_binary(output);
-	auto keyuns    = UNSPENT_HEIGHT_PREFIX + output.address + "/" + DB::to_ascending_key(output.height) + "/" +
-	              common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-	return m_db.get(keyuns, ba);
+	BinaryArray ba;
+	return m_db.get(unspent_key(output), ba);
 }
 
 static void combine_balance(api::Balance &balance, const api::Output &output, int locked_op, int spendable_op) {
@@ -976,7 +1007,7 @@ void WalletState::redo_keyimage_output(const api::Output &output,
     Timestamp block_unlock_timestamp) {
 	BinaryArray ba = seria::to_binary(output);
 
-	auto kikey = KEYIMAGE_PREFIX + to_binary_key(output.key_image);
+	auto kikey = hex_key(KEYIMAGE_PREFIX, output.key_image);
 	BinaryArray ba2;
 	if (m_db.get(kikey, ba2)) {
 		// Protect against an attack with 2 identical output.public_key (and hence
@@ -984,9 +1015,7 @@ void WalletState::redo_keyimage_output(const api::Output &output,
 		return;
 	}
 	m_db.put(kikey, ba, true);
-	auto keyout = HEIGHT_OUTPUT_PREFIX + DB::to_ascending_key(output.height) + "/" + common::to_string(output.amount) +
-	              "/" + common::to_string(output.global_index);
-	m_db.put(keyout, ba, true);
+	m_db.put(height_output_key(output), ba, true);
 
 	if (!m_currency.is_transaction_spend_time_unlocked(output.unlock_time, block_height, block_unlock_timestamp)) {
 		add_to_lock_index(output);
@@ -998,7 +1027,7 @@ void WalletState::redo_keyimage_output(const api::Output &output,
 
 // Undo unspent
 void WalletState::undo_keyimage_output(const api::Output &output) {
-	auto kikey = KEYIMAGE_PREFIX + to_binary_key(output.key_image);
+	auto kikey = hex_key(KEYIMAGE_PREFIX, output.key_image);
 	BinaryArray ba2;
 	if (!m_db.get(kikey, ba2))
 		throw std::logic_error("Keyimage not found for undo, invariant dead");
@@ -1061,7 +1090,7 @@ void WalletState::lock_unlock(Height prev_height, Height now_height, Timestamp p
 
 // Spend unspent
 void WalletState::redo_height_keyimage(Height height, const KeyImage &keyimage) {
-	auto key = KEYIMAGE_PREFIX + to_binary_key(keyimage);
+	auto key = hex_key(KEYIMAGE_PREFIX, keyimage);
 	BinaryArray rb;
 	if (m_db.get(key, rb)) {
 		api::Output output;
@@ -1069,27 +1098,25 @@ void WalletState::redo_height_keyimage(Height height, const KeyImage &keyimage)
 
 		// Code below is used temporarily to allow spending locked outputs (due to
 		// changes to unlock code in new version)
-		auto keyuns = UNSPENT_HEIGHT_PREFIX + output.address + "/" + DB::to_ascending_key(output.height) + "/" +
-		              common::to_string(output.amount) + "/" + common::to_string(output.global_index);
-		bool was_unlocked = m_db.get(keyuns, rb);
+		bool was_unlocked = m_db.get(unspent_key(output), rb);
 		if (was_unlocked)
 			remove_from_unspent_index(output);
 		bool was_in_lockindex = remove_from_lock_index(output, false);
 
-		auto hekey = HEIGHT_KEYIMAGE_PREFIX + DB::to_ascending_key(height) + "/" + to_binary_key(keyimage);
+		auto hekey = height_hex_key(HEIGHT_KEYIMAGE_PREFIX, height, keyimage);
 		m_db.put(hekey, seria::to_binary(std::make_pair(was_unlocked, was_in_lockindex)), true);
 	}
 }
 
 // Undo spend
 void WalletState::undo_height_keyimage(Height height, const KeyImage &keyimage) {
-	auto key = KEYIMAGE_PREFIX + to_binary_key(keyimage);
+	auto key = hex_key(KEYIMAGE_PREFIX, keyimage);
 	BinaryArray rb;
 	if (!m_db.get(key, rb))
 		throw std::logic_error("Invariant dead undo_height_keyimage keyimage does not exist");
 	api::Output output;
 	seria::from_binary(output, rb);
-	auto hekey = HEIGHT_KEYIMAGE_PREFIX + DB::to_ascending_key(height) + "/" + to_binary_key(keyimage);
+	auto hekey = height_hex_key(HEIGHT_KEYIMAGE_PREFIX, height, keyimage);
 	BinaryArray ba;
 	m_db.get(hekey, ba);
 	std::pair<bool, bool> was_unlocked_was_in_lockindex{};
@@ -1220,7 +1247,7 @@ bool WalletState::api_has_transaction(Hash tid) const {
 	auto mit = m_memory_state.get_transactions().find(tid);
 	if (mit != m_memory_state.get_transactions().end())
 		return true;
-	auto trkey = TRANSACTION_PREFIX + to_binary_key(tid);
+	auto trkey = hex_key(TRANSACTION_PREFIX, tid);
 	BinaryArray data;
 	return m_db.get(trkey, data);
 }
@@ -1232,7 +1259,7 @@ bool WalletState::api_get_transaction(Hash tid, TransactionPrefix &tx, api::Tran
 		ptx = mit->second.second;
 		return true;
 	}
-	auto trkey = TRANSACTION_PREFIX + to_binary_key(tid);
+	auto trkey = hex_key(TRANSACTION_PREFIX, tid);
 	BinaryArray data;
 	if (!m_db.get(trkey, data))
 		return false;
@@ -145,6 +145,9 @@ public:
 
 	uint32_t get_tx_pool_version() const { return m_tx_pool_version; }
 	std::vector<Hash> get_tx_pool_hashes() const;
+	// Lowest height undone since last clear, max if none. Lets incremental readers detect reorganizations
+	Height get_lowest_undone_height() const { return m_lowest_undone_height; }
+	void clear_lowest_undone_height() { m_lowest_undone_height = std::numeric_limits<Height>::max(); }
 
 	bool test_check_transaction(const TransactionPrefix &tx);
 	const Wallet &get_wallet() const { return m_wallet; }
@@ -198,7 +201,8 @@ private:
 	Height m_tip_height  = -1;
 	Height m_tail_height = 0;
 	api::BlockHeader m_tip;
-	uint32_t m_tx_pool_version = 1;
+	uint32_t m_tx_pool_version    = 1;
+	Height m_lowest_undone_height = std::numeric_limits<Height>::max();
 	std::chrono::steady_clock::time_point log_redo_block;
 
 	bool read_tips();
@@ -25,7 +25,8 @@ WalletSync::WalletSync(
     , m_sync_agent(config.varcoind_remote_ip,
           config.varcoind_remote_port ? config.varcoind_remote_port : config.varcoind_bind_port)
     , m_commands_agent(config.varcoind_remote_ip,
-          config.varcoind_remote_port ? config.varcoind_remote_port : config.varcoind_bind_port)
+          config.varcoind_remote_port ? config.varcoind_remote_port : config.varcoind_bind_port,
+          config.varcoind_remote_connections, config.varcoind_remote_pipeline)
     , m_wallet_state(wallet_state)
     , m_commit_timer(std::bind(&WalletSync::db_commit, this)) {
 	advance_sync();
@@ -31,8 +31,7 @@ protected:
 	void advance_sync();
 	int transient_transactions_counter = 0;  // This works as mutex for create_raw_transaction and sync_pool
 
-	http::Agent m_commands_agent;
-	std::unique_ptr<http::Request> m_command_request;
+	http::Agent m_commands_agent;  // Pooled and pipelined, commands of different clients go concurrently
 
 	WalletState &m_wallet_state;
 
@@ -443,6 +443,59 @@ void ser_members(api::varcoind::GetRandomOutputs::Request &v, ISeria &s) {
 	seria_kv("confirmed_height_or_depth", v.confirmed_height_or_depth, s);
 }
 void ser_members(api::varcoind::GetRandomOutputs::Response &v, ISeria &s) { seria_kv("outputs", v.outputs, s); }
+void ser_members(api::varcoind::GetOutputStats::Request &v, ISeria &s) { seria_kv("amounts", v.amounts, s); }
+void ser_members(api::varcoind::GetOutputStats::Response &v, ISeria &s) {
+	seria_kv("output_counts", v.output_counts, s);
+	seria_kv("top_block_height", v.top_block_height, s);
+}
+void ser_members(api::varcoind::GetPeerStats::CommandStats &v, ISeria &s) {
+	seria_kv("command", v.command, s);
+	seria_kv("messages_received", v.messages_received, s);
+	seria_kv("bytes_received", v.bytes_received, s);
+	seria_kv("messages_sent", v.messages_sent, s);
+	seria_kv("bytes_sent", v.bytes_sent, s);
+}
+void ser_members(api::varcoind::GetPeerStats::LatencyStats &v, ISeria &s) {
+	seria_kv("command", v.command, s);
+	seria_kv("count", v.count, s);
+	seria_kv("avg_ms", v.avg_ms, s);
+	seria_kv("p50_ms", v.p50_ms, s);
+	seria_kv("p99_ms", v.p99_ms, s);
+	seria_kv("max_ms", v.max_ms, s);
+	seria_kv("histogram", v.histogram, s);
+}
+void ser_members(api::varcoind::GetPeerStats::Peer &v, ISeria &s) {
+	seria_kv("address", v.address, s);
+	seria_kv("incoming", v.incoming, s);
+	seria_kv("peer_id", v.peer_id, s);
+	seria_kv("version", v.version, s);
+	seria_kv("top_block_height", v.top_block_height, s);
+	seria_kv("downloading_blocks", v.downloading_blocks, s);
+	seria_kv("requests_waiting", v.requests_waiting, s);
+	seria_kv("send_queue_messages", v.send_queue_messages, s);
+	seria_kv("send_queue_bytes", v.send_queue_bytes, s);
+	seria_kv("commands", v.commands, s);
+	seria_kv("latencies", v.latencies, s);
+}
+void ser_members(api::varcoind::GetPeerStats::Response &v, ISeria &s) { seria_kv("peers", v.peers, s); }
+void ser_members(api::varcoind::SubscribeEvents::Request &v, ISeria &s) {
+	seria_kv("tip", v.tip, s);
+	seria_kv("pool", v.pool, s);
+}
+void ser_members(api::varcoind::SubscribeEvents::Event &v, ISeria &s) {  // Only fields of event type are written
+	seria_kv("type", v.type, s);
+	seria_kv("top_block_height", v.top_block_height, s);
+	seria_kv("top_block_hash", v.top_block_hash, s);
+	if (s.is_input() || v.type == "tip") {
+		seria_kv("top_block_timestamp", v.top_block_timestamp, s);
+		seria_kv("top_block_difficulty", v.top_block_difficulty, s);
+	}
+	if (s.is_input() || v.type == "pool") {
+		seria_kv("transaction_pool_version", v.transaction_pool_version, s);
+		seria_kv("added_transactions", v.added_transactions, s);
+		seria_kv("removed_transactions", v.removed_transactions, s);
+	}
+}
 void ser_members(api::varcoind::SendTransaction::Request &v, ISeria &s) {
 	seria_kv("binary_transaction", v.binary_transaction, s);
 }
@@ -461,6 +514,22 @@ void ser_members(varcoin::api::walletd::GetTransaction::Request &v, ISeria &s) {
 void ser_members(varcoin::api::walletd::GetTransaction::Response &v, ISeria &s) {
 	seria_kv("transaction", v.transaction, s);
 }
+void ser_members(varcoin::api::walletd::SubscribeEvents::Request &v, ISeria &s) {
+	seria_kv("address", v.address, s);
+	seria_kv("from_height", v.from_height, s);
+	seria_kv("pool", v.pool, s);
+}
+void ser_members(varcoin::api::walletd::SubscribeEvents::Event &v, ISeria &s) {  // Only fields of event type
+	seria_kv("type", v.type, s);
+	seria_kv("top_block_height", v.top_block_height, s);
+	seria_kv("top_block_hash", v.top_block_hash, s);
+	if (s.is_input() || v.type == "blocks")
+		seria_kv("blocks", v.blocks, s);
+	if (s.is_input() || v.type == "undo")
+		seria_kv("undo_from_height", v.undo_from_height, s);
+	if (s.is_input() || v.type == "pool")
+		seria_kv("pool", v.pool, s);
+}
 
 void ser_members(varcoin::api::varcoind::GetBlockTemplate::Request &v, ISeria &s) {
 	seria_kv("reserve_size", v.reserve_size, s);
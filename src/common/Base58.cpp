@@ -3,8 +3,8 @@
 
 #include "Base58.hpp"
 
-#include <assert.h>
-#include <vector>
+#include <algorithm>
+#include <cstring>
 
 #include "Varint.hpp"
 #include "crypto/hash.hpp"
@@ -19,220 +19,242 @@ const size_t alphabet_size           = sizeof(alphabet) - 1;
 const size_t encoded_block_sizes[]   = {0, 2, 3, 5, 6, 7, 9, 10, 11};
 const size_t full_block_size         = sizeof(encoded_block_sizes) / sizeof(encoded_block_sizes[0]) - 1;
 const size_t full_encoded_block_size = encoded_block_sizes[full_block_size];
+const int decoded_block_sizes[]      = {0, -1, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8};  // by encoded size, -1 if invalid
 const size_t addr_checksum_size      = 4;
-
-struct reverse_alphabet {
-	reverse_alphabet() {
-		m_data.resize(alphabet[alphabet_size - 1] - alphabet[0] + 1, -1);
-
-		for (size_t i = 0; i < alphabet_size; ++i) {
-			size_t idx  = static_cast<size_t>(alphabet[i] - alphabet[0]);
-			m_data[idx] = static_cast<int8_t>(i);
-		}
-	}
-
-	int operator()(char letter) const {
-		size_t idx = static_cast<size_t>(letter - alphabet[0]);
-		return idx < m_data.size() ? m_data[idx] : -1;
+const size_t max_varint_size         = (64 + 6) / 7;
+const uint32_t alphabet_size_pow5    = 58 * 58 * 58 * 58 * 58;  // 5 digits fit in uint32_t arithmetic
+
+// 256 entries, so that lookup needs no range check. Invalid symbols are -1, so OR of all digits is negative
+struct ReverseAlphabet {
+	ReverseAlphabet() {
+		std::fill(std::begin(m_data), std::end(m_data), int8_t(-1));
+		for (size_t i = 0; i < alphabet_size; ++i)
+			m_data[static_cast<uint8_t>(alphabet[i])] = static_cast<int8_t>(i);
 	}
-
-	static reverse_alphabet instance;
+	int operator()(char letter) const { return m_data[static_cast<uint8_t>(letter)]; }
 
 private:
-	std::vector<int8_t> m_data;
+	int8_t m_data[256];
 };
 
-reverse_alphabet reverse_alphabet::instance;
-
-struct decoded_block_sizes {
-	decoded_block_sizes() {
-		m_data.resize(encoded_block_sizes[full_block_size] + 1, -1);
-		for (size_t i = 0; i <= full_block_size; ++i) {
-			m_data[encoded_block_sizes[i]] = static_cast<int>(i);
-		}
-	}
+const ReverseAlphabet reverse_alphabet;
 
-	int operator()(size_t encoded_block_size) const {
-		assert(encoded_block_size <= full_encoded_block_size);
-		return m_data[encoded_block_size];
+// Small addresses are decoded on stack, big proofs go to heap
+class ScratchBuffer {
+public:
+	uint8_t *get(size_t size) {
+		if (size <= sizeof(m_stack))
+			return m_stack;
+		m_heap.resize(size);
+		return m_heap.data();
 	}
 
-	static decoded_block_sizes instance;
-
 private:
-	std::vector<int> m_data;
+	uint8_t m_stack[256];
+	BinaryArray m_heap;
 };
 
-decoded_block_sizes decoded_block_sizes::instance;
-
 uint64_t uint_8be_to_64(const uint8_t *data, size_t size) {
-	assert(1 <= size && size <= sizeof(uint64_t));
-
-	uint64_t res = 0;
-	switch (9 - size) {
-	case 1:
-		res |= *data++;
-	case 2:
-		res <<= 8;
-		res |= *data++;
-	case 3:
-		res <<= 8;
-		res |= *data++;
-	case 4:
-		res <<= 8;
-		res |= *data++;
-	case 5:
-		res <<= 8;
-		res |= *data++;
-	case 6:
-		res <<= 8;
-		res |= *data++;
-	case 7:
-		res <<= 8;
-		res |= *data++;
-	case 8:
-		res <<= 8;
-		res |= *data;
-		break;
-	default:
-		assert(false);
+	if (size == full_block_size) {
+		uint64_t num = 0;
+		memcpy(&num, data, sizeof(num));
+		return SWAP64BE(num);
 	}
-
+	uint64_t res = 0;
+	for (size_t i = 0; i != size; ++i)
+		res = (res << 8) | data[i];
 	return res;
 }
 
 void uint_64_to_8be(uint64_t num, size_t size, uint8_t *data) {
-	assert(1 <= size && size <= sizeof(uint64_t));
-
 	uint64_t num_be = SWAP64BE(num);
 	memcpy(data, reinterpret_cast<uint8_t *>(&num_be) + sizeof(uint64_t) - size, size);
 }
 
-void encode_block(const uint8_t *block, size_t size, char *res) {
-	assert(1 <= size && size <= full_block_size);
-
-	uint64_t num = uint_8be_to_64(block, size);
-	int i        = static_cast<int>(encoded_block_sizes[size]) - 1;  // TODO - size_t i?
-	while (0 < num) {
-		uint64_t remainder = num % alphabet_size;
-		num /= alphabet_size;
-		res[i] = alphabet[remainder];
-		--i;
+// Two symbols per division, halves dependency chain when encoding
+struct DigitPairs {
+	enum { COUNT = 58 * 58 };
+	DigitPairs() {
+		for (size_t i = 0; i != COUNT; ++i) {
+			m_data[i][0] = alphabet[i / alphabet_size];
+			m_data[i][1] = alphabet[i % alphabet_size];
+		}
 	}
+	const char *operator()(uint32_t pair) const { return m_data[pair]; }
+
+private:
+	char m_data[COUNT][2];
+};
+
+const DigitPairs digit_pairs;
+
+void encode_5_digits(uint32_t num, char *res) {
+	memcpy(res + 3, digit_pairs(num % DigitPairs::COUNT), 2);
+	num /= DigitPairs::COUNT;
+	memcpy(res + 1, digit_pairs(num % DigitPairs::COUNT), 2);
+	res[0] = alphabet[num / DigitPairs::COUNT];
 }
 
-bool decode_block(const char *block, size_t size, uint8_t *res) {
-	assert(1 <= size && size <= full_encoded_block_size);
+// Instead of 11 dependent 64-bit divisions, we split number into 1 + 5 + 5 digits with 3 divisions by constants,
+// then convert halves in 32-bit arithmetic. Leading zeroes of short blocks are encoded as alphabet[0] naturally
+void encode_block(const uint8_t *block, size_t size, char *res) {
+	const uint64_t num = uint_8be_to_64(block, size);
+	const uint64_t hi  = num / alphabet_size_pow5;  // < 58^6
+	char digits[full_encoded_block_size];
+	digits[0] = alphabet[hi / alphabet_size_pow5];  // < 43, because 2^64 < 43 * 58^10
+	encode_5_digits(static_cast<uint32_t>(hi % alphabet_size_pow5), digits + 1);
+	encode_5_digits(static_cast<uint32_t>(num % alphabet_size_pow5), digits + 6);
+	const size_t encoded_size = encoded_block_sizes[size];
+	memcpy(res, digits + full_encoded_block_size - encoded_size, encoded_size);
+}
 
-	int res_size = decoded_block_sizes::instance(size);
+bool decode_block(const char *block, size_t size, uint8_t *res) {
+	const int res_size = decoded_block_sizes[size];
 	if (res_size <= 0)
 		return false;  // Invalid block size
 
-	uint64_t res_num = 0;
-	uint64_t order   = 1;
-	for (size_t i = size - 1; i < size; --i) {
-		int digit = reverse_alphabet::instance(block[i]);
-		if (digit < 0)
-			return false;  // Invalid symbol
-
+	// 58^10 < 2^64, so first 10 digits never overflow
+	const size_t safe_size = std::min(size, full_encoded_block_size - 1);
+	uint64_t res_num       = 0;
+	int invalid            = 0;
+	for (size_t i = 0; i != safe_size; ++i) {
+		const int digit = reverse_alphabet(block[i]);
+		invalid |= digit;
+		res_num = res_num * alphabet_size + static_cast<uint64_t>(digit);
+	}
+	if (size == full_encoded_block_size) {
+		const int digit = reverse_alphabet(block[size - 1]);
+		invalid |= digit;
 		uint64_t product_hi;
-		uint64_t tmp = res_num + mul128(order, digit, &product_hi);
-		if (tmp < res_num || 0 != product_hi)
+		const uint64_t product_lo = mul128(res_num, alphabet_size, &product_hi);
+		res_num                   = product_lo + static_cast<uint64_t>(digit);
+		if (product_hi != 0 || res_num < product_lo)
 			return false;  // Overflow
-
-		res_num = tmp;
-		order *= alphabet_size;  // Never overflows, 58^10 < 2^64
 	}
+	if (invalid < 0)
+		return false;  // Invalid symbol
 
 	if (static_cast<size_t>(res_size) < full_block_size && (UINT64_C(1) << (8 * res_size)) <= res_num)
 		return false;  // Overflow
 
 	uint_64_to_8be(res_num, res_size, res);
+	return true;
+}
 
+// On success body points into buf after tag
+bool decode_addr_to(
+    const char *addr, size_t addr_size, uint8_t *buf, uint64_t *tag, const uint8_t **body, size_t *body_size) {
+	size_t size = 0;
+	if (!decoded_size(addr_size, &size) || !decode(addr, addr_size, buf))
+		return false;
+	if (size <= addr_checksum_size)
+		return false;
+	size -= addr_checksum_size;
+	const crypto::Hash hash = crypto::cn_fast_hash(buf, size);
+	if (memcmp(hash.data, buf + size, addr_checksum_size) != 0)
+		return false;
+	const int read = common::read_varint(buf + 0, buf + size, *tag);
+	if (read <= 0)
+		return false;
+	*body      = buf + read;
+	*body_size = size - read;
 	return true;
 }
 }  // namespace
 
-std::string encode(const BinaryArray &data) {
-	if (data.empty())
-		return std::string();
-
-	size_t full_block_count = data.size() / full_block_size;
-	size_t last_block_size  = data.size() % full_block_size;
-	size_t res_size         = full_block_count * full_encoded_block_size + encoded_block_sizes[last_block_size];
-
-	std::string res(res_size, alphabet[0]);
-	for (size_t i = 0; i < full_block_count; ++i) {
-		encode_block(data.data() + i * full_block_size, full_block_size, &res[i * full_encoded_block_size]);
-	}
-
-	if (0 < last_block_size) {
-		encode_block(data.data() + full_block_count * full_block_size, last_block_size,
-		    &res[full_block_count * full_encoded_block_size]);
-	}
-
-	return res;
+size_t encoded_size(size_t data_size) {
+	return data_size / full_block_size * full_encoded_block_size + encoded_block_sizes[data_size % full_block_size];
 }
 
-bool decode(const std::string &enc, BinaryArray *data) {
-	if (enc.empty()) {
-		data->clear();
-		return true;
-	}
-
-	size_t full_block_count     = enc.size() / full_encoded_block_size;
-	size_t last_block_size      = enc.size() % full_encoded_block_size;
-	int last_block_decoded_size = decoded_block_sizes::instance(last_block_size);
+bool decoded_size(size_t enc_size, size_t *data_size) {
+	const int last_block_decoded_size = decoded_block_sizes[enc_size % full_encoded_block_size];
 	if (last_block_decoded_size < 0)
 		return false;  // Invalid enc length
-	size_t data_size = full_block_count * full_block_size + last_block_decoded_size;
+	*data_size = enc_size / full_encoded_block_size * full_block_size + last_block_decoded_size;
+	return true;
+}
 
-	data->resize(data_size, 0);
-	for (size_t i = 0; i < full_block_count; ++i) {
-		if (!decode_block(
-		        enc.data() + i * full_encoded_block_size, full_encoded_block_size, &(*data)[i * full_block_size]))
-			return false;
-	}
+void encode(const uint8_t *data, size_t size, char *enc) {
+	const size_t full_block_count = size / full_block_size;
+	const size_t last_block_size  = size % full_block_size;
+	for (size_t i = 0; i != full_block_count; ++i)  // Blocks are independent, CPU overlaps their divisions
+		encode_block(data + i * full_block_size, full_block_size, enc + i * full_encoded_block_size);
+	if (last_block_size != 0)
+		encode_block(data + full_block_count * full_block_size, last_block_size,
+		    enc + full_block_count * full_encoded_block_size);
+}
 
-	if (0 < last_block_size) {
-		if (!decode_block(enc.data() + full_block_count * full_encoded_block_size, last_block_size,
-		        &(*data)[full_block_count * full_block_size]))
+bool decode(const char *enc, size_t enc_size, uint8_t *data) {
+	const size_t full_block_count = enc_size / full_encoded_block_size;
+	const size_t last_block_size  = enc_size % full_encoded_block_size;
+	if (decoded_block_sizes[last_block_size] < 0)
+		return false;  // Invalid enc length
+	for (size_t i = 0; i != full_block_count; ++i)
+		if (!decode_block(enc + i * full_encoded_block_size, full_encoded_block_size, data + i * full_block_size))
 			return false;
-	}
-
+	if (last_block_size != 0)
+		return decode_block(enc + full_block_count * full_encoded_block_size, last_block_size,
+		    data + full_block_count * full_block_size);
 	return true;
 }
 
-std::string encode_addr(uint64_t tag, const BinaryArray &data) {
-	BinaryArray buf = get_varint_data(tag);
-	append(buf, data.begin(), data.end());
-	crypto::Hash hash = crypto::cn_fast_hash(buf.data(), buf.size());
-	append(buf, hash.data, hash.data + addr_checksum_size);
-	return encode(buf);
+std::string encode(const BinaryArray &data) {
+	std::string res(encoded_size(data.size()), alphabet[0]);
+	encode(data.data(), data.size(), &res[0]);
+	return res;
 }
 
-bool decode_addr(std::string addr, uint64_t *tag, BinaryArray *data) {
-	BinaryArray addr_data;
-	bool r = decode(addr, &addr_data);
-	if (!r)
-		return false;
-	if (addr_data.size() <= addr_checksum_size)
+bool decode(const std::string &enc, BinaryArray *data) {
+	size_t data_size = 0;
+	if (!decoded_size(enc.size(), &data_size))
 		return false;
+	data->resize(data_size);
+	return decode(enc.data(), enc.size(), data->data());
+}
 
-	std::vector<uint8_t> checksum(addr_data.end() - addr_checksum_size, addr_data.end());
+void encode_addr(uint64_t tag, const uint8_t *data, size_t size, std::string *addr) {
+	ScratchBuffer scratch;
+	uint8_t *buf = scratch.get(max_varint_size + size + addr_checksum_size);
+	uint8_t *end = buf;
+	write_varint(end, tag);
+	std::copy(data, data + size, end);
+	end += size;
+	const crypto::Hash hash = crypto::cn_fast_hash(buf, end - buf);
+	memcpy(end, hash.data, addr_checksum_size);
+	end += addr_checksum_size;
+	addr->resize(encoded_size(end - buf));  // Keeps capacity when reused for many addresses
+	encode(buf, end - buf, &(*addr)[0]);
+}
 
-	addr_data.resize(addr_data.size() - addr_checksum_size);
-	crypto::Hash hash = crypto::cn_fast_hash(addr_data.data(), addr_data.size());
+std::string encode_addr(uint64_t tag, const BinaryArray &data) {
+	std::string addr;
+	encode_addr(tag, data.data(), data.size(), &addr);
+	return addr;
+}
 
-	std::vector<uint8_t> expected_checksum(hash.data, hash.data + addr_checksum_size);
-	if (expected_checksum != checksum)
+bool decode_addr(const std::string &addr, uint64_t *tag, uint8_t *data, size_t size) {
+	size_t decoded = 0;
+	if (!decoded_size(addr.size(), &decoded))
 		return false;
-
-	int read = common::read_varint(addr_data.begin(), addr_data.end(), *tag);
-	if (read <= 0)
+	ScratchBuffer scratch;
+	const uint8_t *body = nullptr;
+	size_t body_size    = 0;
+	if (!decode_addr_to(addr.data(), addr.size(), scratch.get(decoded), tag, &body, &body_size) || body_size != size)
 		return false;
+	std::copy(body, body + size, data);
+	return true;
+}
 
-	data->assign(addr_data.begin() + read, addr_data.end());  // addr_data.substr(read);
+bool decode_addr(const std::string &addr, uint64_t *tag, BinaryArray *data) {
+	size_t decoded = 0;
+	if (!decoded_size(addr.size(), &decoded))
+		return false;
+	ScratchBuffer scratch;
+	const uint8_t *body = nullptr;
+	size_t body_size    = 0;
+	if (!decode_addr_to(addr.data(), addr.size(), scratch.get(decoded), tag, &body, &body_size))
+		return false;
+	data->assign(body, body + body_size);
 	return true;
 }
 }
@@ -14,6 +14,15 @@ std::string encode(const BinaryArray &data);
 bool decode(const std::string &enc, BinaryArray *data);
 
 std::string encode_addr(uint64_t tag, const BinaryArray &data);
-bool decode_addr(std::string addr, uint64_t *tag, BinaryArray *data);
+bool decode_addr(const std::string &addr, uint64_t *tag, BinaryArray *data);
+
+// Allocation-free versions for bulk processing. Buffers must be exactly of encoded_size/decoded_size
+size_t encoded_size(size_t data_size);
+bool decoded_size(size_t enc_size, size_t *data_size);  // false if no data encodes to enc_size symbols
+void encode(const uint8_t *data, size_t size, char *enc);
+bool decode(const char *enc, size_t enc_size, uint8_t *data);
+
+void encode_addr(uint64_t tag, const uint8_t *data, size_t size, std::string *addr);  // reuses addr capacity
+bool decode_addr(const std::string &addr, uint64_t *tag, uint8_t *data, size_t size);  // false if size differs
 }
 }
@@ -37,18 +37,18 @@ public:
 		alloc(other.size());
 		good_memmove(m_data, other.m_data, m_size);
 	}
-	void swap(BinaryArrayImpl &other) {
+	void swap(BinaryArrayImpl &other) noexcept {
 		std::swap(m_data, other.m_data);
 		std::swap(m_size, other.m_size);
 		std::swap(m_reserved, other.m_reserved);
 	}
-	BinaryArrayImpl(BinaryArrayImpl &&other) { swap(other); }
+	BinaryArrayImpl(BinaryArrayImpl &&other) noexcept { swap(other); }  // noexcept lets std::vector move on growth
 	BinaryArrayImpl &operator=(const BinaryArrayImpl &other) {
 		BinaryArrayImpl copy(other);
 		swap(copy);
 		return *this;
 	}
-	BinaryArrayImpl &operator=(BinaryArrayImpl &&other) {
+	BinaryArrayImpl &operator=(BinaryArrayImpl &&other) noexcept {
 		swap(other);
 		return *this;
 	}
@@ -522,22 +522,25 @@ std::string JsonValue::to_string() const {
 	return stream.str();
 }
 
-static std::string escape_string(const std::string &str) {
-	std::string result;
-	static const std::string escape_table[32] = {"\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005",
+// Writes runs of characters not needing escaping in one go, so big hex strings need no intermediate copy
+static void write_escaped_string(std::ostream &out, const std::string &str) {
+	static const char *const escape_table[32] = {"\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005",
 	    "\\u0006", "\\u0007", "\\b", "\\t", "\\n", "\\u000B", "\\f", "\\r", "\\u000E", "\\u000F", "\\u0010", "\\u0011",
 	    "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017", "\\u0018", "\\u0019", "\\u001A", "\\u001B",
 	    "\\u001C", "\\u001D", "\\u001E", "\\u001F"};
-	for (auto &&c : str)
-		if (c == '\\' || c == '"') {
-			result += '\\';
-			result += c;
-		} else if (static_cast<unsigned char>(c) < ' ') {
-			result += escape_table[static_cast<unsigned char>(c)];
-		} else {
-			result += c;
-		}
-	return result;
+	size_t run_start = 0;
+	for (size_t i = 0; i != str.size(); ++i) {
+		const unsigned char c = static_cast<unsigned char>(str[i]);
+		if (c != '\\' && c != '"' && c >= ' ')
+			continue;
+		out.write(str.data() + run_start, i - run_start);
+		run_start = i + 1;
+		if (c == '\\' || c == '"')
+			out << '\\' << static_cast<char>(c);
+		else
+			out << escape_table[c];
+	}
+	out.write(str.data() + run_start, str.size() - run_start);
 }
 
 std::ostream &operator<<(std::ostream &out, const JsonValue &json_value) {
@@ -572,10 +575,14 @@ std::ostream &operator<<(std::ostream &out, const JsonValue &json_value) {
 		out << '{';
 		auto iter = object.begin();
 		if (iter != object.end()) {
-			out << '"' << escape_string(iter->first) << "\":" << iter->second;
+			out << '"';
+			write_escaped_string(out, iter->first);
+			out << "\":" << iter->second;
 			++iter;
 			for (; iter != object.end(); ++iter) {
-				out << ",\"" << escape_string(iter->first) << "\":" << iter->second;
+				out << ",\"";
+				write_escaped_string(out, iter->first);
+				out << "\":" << iter->second;
 			}
 		}
 
@@ -594,7 +601,9 @@ std::ostream &operator<<(std::ostream &out, const JsonValue &json_value) {
 		break;
 	}
 	case JsonValue::STRING:
-		out << '"' << escape_string(*reinterpret_cast<const JsonValue::String *>(&json_value.value_string)) << '"';
+		out << '"';
+		write_escaped_string(out, *reinterpret_cast<const JsonValue::String *>(&json_value.value_string));
+		out << '"';
 		break;
 	}
 
@@ -42,6 +42,7 @@ class StringOutputStream : public IOutputStream {
 public:
 	StringOutputStream(std::string &out) : out(&out) {}
 	size_t write_some(const void *data, size_t size) override;
+	void reserve_write(size_t size) override { out->reserve(out->size() + size); }
 
 protected:
 	std::string *out;
@@ -98,6 +99,7 @@ class VectorOutputStream : public IOutputStream {
 public:
 	explicit VectorOutputStream(BinaryArray &out) : out(&out) {}
 	size_t write_some(const void *data, size_t size) override;
+	void reserve_write(size_t size) override { out->reserve(out->size() + size); }
 
 protected:
 	BinaryArray *out;
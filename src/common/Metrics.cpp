@@ -0,0 +1,100 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#include "Metrics.hpp"
+#include <iomanip>
+#include <sstream>
+
+namespace common {
+namespace metrics {
+
+namespace {
+
+struct Registry {
+	std::mutex mu;
+	typedef std::pair<std::string, std::string> Key;  // name, labels
+	std::map<Key, Counter> counters;                  // std::map never moves its elements
+	std::map<Key, Gauge> gauges;
+	std::map<Key, Histogram> histograms;
+};
+
+Registry &registry() {
+	static Registry *instance = new Registry();  // Never destroyed, references are used from static destructors
+	return *instance;
+}
+
+template<class T>
+T &find_or_create(std::map<Registry::Key, T> &metrics, const std::string &name, const std::string &labels) {
+	std::unique_lock<std::mutex> lock(registry().mu);
+	auto key = std::make_pair(name, labels);
+	auto mit = metrics.find(key);
+	if (mit == metrics.end())
+		mit = metrics.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first;
+	return mit->second;
+}
+
+std::string with_labels(const std::string &name, const std::string &labels, const std::string &more_labels) {
+	if (labels.empty() && more_labels.empty())
+		return name;
+	if (labels.empty() || more_labels.empty())
+		return name + "{" + labels + more_labels + "}";
+	return name + "{" + labels + "," + more_labels + "}";
+}
+
+template<class T, class F>
+void write_metrics(std::ostream &out, const std::map<Registry::Key, T> &metrics, const char *type, F &&write_value) {
+	const std::string *last_name = nullptr;
+	for (auto &&mit : metrics) {
+		if (!last_name || *last_name != mit.first.first)
+			out << "# TYPE " << mit.first.first << " " << type << "\n";
+		last_name = &mit.first.first;
+		write_value(mit.first.first, mit.first.second, mit.second);
+	}
+}
+}
+
+Counter &counter(const std::string &name, const std::string &labels) {
+	return find_or_create(registry().counters, name, labels);
+}
+
+Gauge &gauge(const std::string &name, const std::string &labels) {
+	return find_or_create(registry().gauges, name, labels);
+}
+
+Histogram &histogram(const std::string &name, const std::string &labels) {
+	return find_or_create(registry().histograms, name, labels);
+}
+
+std::string to_prometheus() {
+	Registry &reg = registry();
+	std::unique_lock<std::mutex> lock(reg.mu);
+	std::ostringstream out;
+	out << std::setprecision(12);
+	write_metrics(out, reg.counters, "counter", [&](const std::string &name, const std::string &labels,
+	                                                const Counter &c) {
+		out << with_labels(name, labels, std::string()) << " " << c.get() << "\n";
+	});
+	write_metrics(out, reg.gauges, "gauge", [&](const std::string &name, const std::string &labels, const Gauge &g) {
+		out << with_labels(name, labels, std::string()) << " " << g.get() << "\n";
+	});
+	write_metrics(out, reg.histograms, "histogram", [&](const std::string &name, const std::string &labels,
+	                                                    const Histogram &h) {
+		uint64_t total = 0;
+		for (size_t i = 0; i != Histogram::BUCKET_COUNT; ++i) {
+			total += h.get_bucket(i);
+			std::ostringstream le;
+			le << std::setprecision(12);
+			if (i + 1 == Histogram::BUCKET_COUNT)
+				le << "+Inf";
+			else
+				le << static_cast<double>(uint64_t(1) << i) / 1000000;
+			out << with_labels(name + "_bucket", labels, "le=\"" + le.str() + "\"") << " " << total << "\n";
+		}
+		out << with_labels(name + "_sum", labels, std::string()) << " " << static_cast<double>(h.get_sum_us()) / 1000000
+		    << "\n";
+		out << with_labels(name + "_count", labels, std::string()) << " " << total << "\n";
+	});
+	return out.str();
+}
+}
+}
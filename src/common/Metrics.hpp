@@ -0,0 +1,97 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Nocopy.hpp"
+
+// Process-wide metrics, exposed in Prometheus text format on /metrics of varcoind and walletd.
+// Updating metric is a single relaxed atomic operation. Finding metric by name takes a lock, so on hot paths
+// metric references should be looked up once and kept, usually in function-level static variable
+//	static auto &counter = common::metrics::counter("varcoind_blocks_added_total");
+//	counter.add();
+namespace common {
+namespace metrics {
+
+class Counter : private Nocopy {
+public:
+	void add(uint64_t value = 1) { m_value.fetch_add(value, std::memory_order_relaxed); }
+	uint64_t get() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> m_value{0};
+};
+
+class Gauge : private Nocopy {
+public:
+	void set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+	void add(int64_t value) { m_value.fetch_add(value, std::memory_order_relaxed); }
+	int64_t get() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64_t> m_value{0};
+};
+
+// Latency histogram with power of 2 buckets in microseconds, from 1us to ~67s. Relative error is within 2x, which
+// is enough to see where time goes. Exported as Prometheus histogram with 'le' in seconds
+class Histogram : private Nocopy {
+public:
+	enum { BUCKET_COUNT = 27 };  // bucket i counts values <= 2^i us, last bucket counts everything above
+	void observe_us(uint64_t microseconds) {
+		size_t bucket = 0;
+		while (bucket + 1 < BUCKET_COUNT && (uint64_t(1) << bucket) < microseconds)
+			bucket += 1;
+		m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		m_sum_us.fetch_add(microseconds, std::memory_order_relaxed);
+	}
+	uint64_t get_bucket(size_t bucket) const { return m_buckets[bucket].load(std::memory_order_relaxed); }
+	uint64_t get_sum_us() const { return m_sum_us.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> m_buckets[BUCKET_COUNT] = {};
+	std::atomic<uint64_t> m_sum_us{0};
+};
+
+// Measures time from construction till destruction
+class ScopedTimer : private Nocopy {
+public:
+	explicit ScopedTimer(Histogram &histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+	~ScopedTimer() {
+		auto elapsed = std::chrono::steady_clock::now() - m_start;
+		m_histogram.observe_us(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+	}
+
+private:
+	Histogram &m_histogram;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// labels are in Prometheus format without braces, for example R"(command="2001")"
+// Returned references are valid until process exit
+Counter &counter(const std::string &name, const std::string &labels = std::string());
+Gauge &gauge(const std::string &name, const std::string &labels = std::string());
+Histogram &histogram(const std::string &name, const std::string &labels = std::string());
+
+// Counter per key of handler table, labeled label_name="key", for handlers which would otherwise build labels
+// on every request
+//	static const auto counters = common::metrics::counters_by_key("walletd_requests_total", "method", handlers);
+//	counters.at(it->first)->add();
+template<typename Map>
+std::unordered_map<std::string, Counter *> counters_by_key(
+    const std::string &name, const std::string &label_name, const Map &table) {
+	std::unordered_map<std::string, Counter *> result;
+	for (auto &&kv : table)
+		result[kv.first] = &counter(name, label_name + "=\"" + kv.first + "\"");
+	return result;
+}
+
+std::string to_prometheus();  // Text exposition format 0.0.4
+}
+}
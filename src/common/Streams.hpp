@@ -25,6 +25,7 @@ public:
 	virtual ~IOutputStream() {}
 	virtual size_t write_some(const void *data, size_t size) = 0;
 	void write(const void *data, size_t size);
+	virtual void reserve_write(size_t size) {}  // hint that 'size' more bytes will be written, allows preallocation
 };
 
 class StreamError : public std::runtime_error {
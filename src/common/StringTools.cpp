@@ -128,39 +128,46 @@ bool from_hex(const std::string &text, BinaryArray &data) {
 	return true;
 }
 
-std::string to_hex(const void *data, size_t size) {
-	std::string text;
-	for (size_t i = 0; i < size; ++i) {
-		text += "0123456789abcdef"[static_cast<const uint8_t *>(data)[i] >> 4];
-		text += "0123456789abcdef"[static_cast<const uint8_t *>(data)[i] & 15];
+namespace {
+
+// Both digits of every byte value, so encoder does one lookup and one 2-byte store per byte instead of
+// two lookups and two (possibly reallocating) appends
+struct HexPairs {
+	char pairs[256][2];
+	HexPairs() {
+		for (size_t i = 0; i != 256; ++i) {
+			pairs[i][0] = "0123456789abcdef"[i >> 4];
+			pairs[i][1] = "0123456789abcdef"[i & 15];
+		}
 	}
+};
 
-	return text;
+void append_hex_impl(const void *data, size_t size, std::string &text) {
+	static const HexPairs table;
+	const size_t pos = text.size();
+	text.resize(pos + size * 2);
+	const uint8_t *src = static_cast<const uint8_t *>(data);
+	char *dst          = &text[0] + pos;  // text.data() is const before C++17
+	for (size_t i = 0; i != size; ++i, dst += 2)
+		memcpy(dst, table.pairs[src[i]], 2);
+}
 }
 
-void append_hex(const void *data, size_t size, std::string &text) {
-	for (size_t i = 0; i < size; ++i) {
-		text += "0123456789abcdef"[static_cast<const uint8_t *>(data)[i] >> 4];
-		text += "0123456789abcdef"[static_cast<const uint8_t *>(data)[i] & 15];
-	}
+std::string to_hex(const void *data, size_t size) {
+	std::string text;
+	append_hex_impl(data, size, text);
+	return text;
 }
 
+void append_hex(const void *data, size_t size, std::string &text) { append_hex_impl(data, size, text); }
+
 std::string to_hex(const BinaryArray &data) {
 	std::string text;
-	for (size_t i = 0; i < data.size(); ++i) {
-		text += "0123456789abcdef"[data[i] >> 4];
-		text += "0123456789abcdef"[data[i] & 15];
-	}
-
+	append_hex_impl(data.data(), data.size(), text);
 	return text;
 }
 
-void append_hex(const BinaryArray &data, std::string &text) {
-	for (size_t i = 0; i < data.size(); ++i) {
-		text += "0123456789abcdef"[data[i] >> 4];
-		text += "0123456789abcdef"[data[i] & 15];
-	}
-}
+void append_hex(const BinaryArray &data, std::string &text) { append_hex_impl(data.data(), data.size(), text); }
 
 std::string extract(std::string &text, char delimiter) {
 	size_t delimiter_pos = text.find(delimiter);
@@ -0,0 +1,149 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#include "Trace.hpp"
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace common {
+namespace trace {
+
+#if common_USE_TRACE
+
+namespace {
+
+struct Event {
+	std::atomic<const char *> name{nullptr};
+	std::atomic<uint64_t> start_us{0};
+	std::atomic<uint64_t> finish_us{0};
+};
+
+// Single writer (owning thread), any number of readers. Writer announces overwrite of the oldest slot by
+// incrementing 'started' before writing and publishes event by incrementing 'written' after, so reader can
+// detect slots overwritten while it was copying them (seqlock-style)
+struct ThreadBuffer {
+	enum { CAPACITY = 65536 };
+	std::atomic<uint64_t> started{0};
+	std::atomic<uint64_t> written{0};
+	std::atomic<const char *> name{nullptr};
+	std::atomic<bool> in_use{true};
+	size_t tid = 0;
+	Event events[CAPACITY];
+};
+
+struct Registry {
+	std::mutex mu;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;  // never shrinks, buffers of finished threads are reused
+};
+
+Registry &registry() {
+	static Registry *instance = new Registry();  // Never destroyed, threads can finish after static destructors
+	return *instance;
+}
+
+struct ThreadSlot {
+	ThreadBuffer *buffer = nullptr;
+	~ThreadSlot() {
+		if (buffer)
+			buffer->in_use = false;
+	}
+	ThreadBuffer *get() {
+		if (buffer)
+			return buffer;
+		Registry &reg = registry();
+		std::unique_lock<std::mutex> lock(reg.mu);
+		for (auto &&b : reg.buffers)
+			if (!b->in_use) {
+				b->in_use = true;
+				b->name   = nullptr;
+				buffer    = b.get();
+				return buffer;
+			}
+		reg.buffers.emplace_back(new ThreadBuffer());
+		buffer      = reg.buffers.back().get();
+		buffer->tid = reg.buffers.size();
+		return buffer;
+	}
+};
+
+thread_local ThreadSlot thread_slot;
+
+struct RawEvent {
+	const char *name;
+	uint64_t start_us;
+	uint64_t finish_us;
+	uint64_t index;
+};
+
+}  // anonymous namespace
+
+void Span::record(const char *name, uint64_t start_us, uint64_t finish_us) {
+	ThreadBuffer *b = thread_slot.get();
+	uint64_t pos    = b->written.load(std::memory_order_relaxed);
+	Event &ev       = b->events[pos % ThreadBuffer::CAPACITY];
+	b->started.store(pos + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	ev.name.store(name, std::memory_order_relaxed);
+	ev.start_us.store(start_us, std::memory_order_relaxed);
+	ev.finish_us.store(finish_us, std::memory_order_relaxed);
+	b->written.store(pos + 1, std::memory_order_release);
+}
+
+bool enabled() { return true; }
+
+void set_thread_name(const char *name) { thread_slot.get()->name = name; }
+
+std::string to_chrome_json() {
+	std::vector<ThreadBuffer *> buffers;
+	{
+		Registry &reg = registry();
+		std::unique_lock<std::mutex> lock(reg.mu);
+		for (auto &&b : reg.buffers)
+			buffers.push_back(b.get());
+	}
+	std::ostringstream out;
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	std::vector<RawEvent> events;
+	for (auto b : buffers) {
+		const char *name = b->name.load();
+		if (name) {
+			out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+			    << ",\"args\":{\"name\":\"" << name << "\"}}";
+			first = false;
+		}
+		const uint64_t written = b->written.load(std::memory_order_acquire);
+		events.clear();
+		for (uint64_t i = written > ThreadBuffer::CAPACITY ? written - ThreadBuffer::CAPACITY : 0; i != written; ++i) {
+			const Event &ev = b->events[i % ThreadBuffer::CAPACITY];
+			events.push_back(RawEvent{ev.name.load(std::memory_order_relaxed),
+			    ev.start_us.load(std::memory_order_relaxed), ev.finish_us.load(std::memory_order_relaxed), i});
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t started = b->started.load(std::memory_order_relaxed);
+		const uint64_t valid_from = started > ThreadBuffer::CAPACITY ? started - ThreadBuffer::CAPACITY : 0;
+		for (auto &&ev : events) {
+			if (ev.index < valid_from)
+				continue;  // overwritten while we were copying
+			out << (first ? "" : ",") << "\n{\"name\":\"" << ev.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid
+			    << ",\"ts\":" << ev.start_us << ",\"dur\":" << ev.finish_us - ev.start_us << "}";
+			first = false;
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}";
+	return out.str();
+}
+
+#else
+
+bool enabled() { return false; }
+
+void set_thread_name(const char *) {}
+
+std::string to_chrome_json() { return "{\"traceEvents\":[]}"; }
+
+#endif
+}
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "Nocopy.hpp"
+
+// Span tracer for profiling, compiled in only with common_USE_TRACE (cmake -DUSE_TRACE=ON).
+// Each thread writes finished spans into its own ring buffer without locks, to_chrome_json() can be called from any
+// thread at any moment and returns last spans of every thread in Chrome trace format (load in chrome://tracing).
+//	void BlockChain::db_commit() {
+//		COMMON_TRACE_SPAN("db_commit");  // name must be string literal
+//		...
+// Without common_USE_TRACE macro expands to nothing, so spans can be put on hottest paths.
+namespace common {
+namespace trace {
+
+#if common_USE_TRACE
+class Span : private Nocopy {
+public:
+	explicit Span(const char *name) : m_name(name), m_start(now_us()) {}
+	~Span() { record(m_name, m_start, now_us()); }
+
+	static uint64_t now_us() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+		    std::chrono::steady_clock::now().time_since_epoch())
+		    .count();
+	}
+	static void record(const char *name, uint64_t start_us, uint64_t finish_us);
+
+private:
+	const char *m_name;
+	uint64_t m_start;
+};
+
+#define COMMON_TRACE_CONCAT2(a, b) a##b
+#define COMMON_TRACE_CONCAT(a, b) COMMON_TRACE_CONCAT2(a, b)
+#define COMMON_TRACE_SPAN(name) common::trace::Span COMMON_TRACE_CONCAT(common_trace_span_, __LINE__)(name)
+#else
+#define COMMON_TRACE_SPAN(name)
+#endif
+
+bool enabled();  // false if compiled without common_USE_TRACE
+void set_thread_name(const char *name);  // name must be string literal, shown instead of thread number
+std::string to_chrome_json();
+}
+}
@@ -82,52 +82,33 @@ uint64_t read_varint_sqlite4(const unsigned char *&begin, const unsigned char *e
 	return uint_be_from_bytes<uint64_t>(buf, bytes);
 }
 
-std::string str(const unsigned char *buf, size_t len) { return std::string((const char *)buf, len); }
-
-std::string write_varint_sqlite4(uint64_t val) {
-	unsigned char buf[9];
+size_t write_varint_sqlite4(unsigned char *buf, size_t buf_size, uint64_t val) {
+	const size_t len = get_varint_sqlite4_size(val);
+	if (buf_size < len)
+		throw std::runtime_error("write_varint_sqlite4 buffer too small");
 	if (val <= 240) {
 		buf[0] = static_cast<unsigned char>(val);
-		return str(buf, 1);
+		return len;
 	}
 	if (val <= 2287) {
 		buf[0] = static_cast<unsigned char>((val - 240) / 256 + 241);
 		buf[1] = static_cast<unsigned char>(val - 240);
-		return str(buf, 2);
+		return len;
 	}
 	if (val <= 67823) {
 		buf[0] = 249;
 		buf[1] = static_cast<unsigned char>((val - 2288) / 256);
 		buf[2] = static_cast<unsigned char>(val - 2288);
-		return str(buf, 3);
-	}
-	if (val <= 16777215) {
-		buf[0] = 250;
-		uint_be_to_bytes<uint64_t>(buf + 1, 3, val);
-		return str(buf, 4);
-	}
-	if (val <= 4294967295) {
-		buf[0] = 251;
-		uint_be_to_bytes<uint64_t>(buf + 1, 4, val);
-		return str(buf, 5);
-	}
-	if (val <= 1099511627775) {
-		buf[0] = 252;
-		uint_be_to_bytes<uint64_t>(buf + 1, 5, val);
-		return str(buf, 6);
+		return len;
 	}
-	if (val <= 281474976710655) {
-		buf[0] = 253;
-		uint_be_to_bytes<uint64_t>(buf + 1, 6, val);
-		return str(buf, 7);
-	}
-	if (val <= 72057594037927935) {
-		buf[0] = 254;
-		uint_be_to_bytes<uint64_t>(buf + 1, 7, val);
-		return str(buf, 8);
-	}
-	buf[0] = 255;
-	uint_be_to_bytes<uint64_t>(buf + 1, 8, val);
-	return str(buf, 9);
+	buf[0] = static_cast<unsigned char>(250 + len - 4);  // 250..255 for 3..8 big-endian bytes
+	uint_be_to_bytes<uint64_t>(buf + 1, len - 1, val);
+	return len;
+}
+
+std::string write_varint_sqlite4(uint64_t val) {
+	unsigned char buf[9];
+	size_t len = write_varint_sqlite4(buf, sizeof(buf), val);
+	return std::string(reinterpret_cast<const char *>(buf), len);
 }
 }
@@ -70,4 +70,6 @@ inline uint64_t read_varint_sqlite4(const char *&begin, const char *end) {
 
 uint64_t read_varint_sqlite4(const std::string &str);
 std::string write_varint_sqlite4(uint64_t val);
+size_t write_varint_sqlite4(unsigned char *buf, size_t buf_size, uint64_t val);  // returns bytes written, throws if
+                                                                               // buf_size is not enough
 }
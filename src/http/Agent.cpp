@@ -15,15 +15,14 @@ static const int REQUEST_TIMEOUT = 30;
 Agent::Connection::Connection(handler r_handler, handler d_handler)
     : buffer(8192)
     , receiving_body(false)
-    , waiting_write_response(false)
+    , waiting_responses(0)
     , r_handler(r_handler)
     , d_handler(d_handler)
-    , sock([this](bool, bool) { advance_state(true); }, std::bind(&Connection::on_disconnect, this))
+    , sock([this](bool, bool) { advance_state(); }, std::bind(&Connection::on_disconnect, this))
     , keep_alive(true) {}
 
 bool Agent::Connection::connect(const std::string &address, uint16_t port) {
 	clear();
-	waiting_write_response = true;
 	return sock.connect(address, port);
 }
 
@@ -33,8 +32,8 @@ void Agent::Connection::disconnect() {
 }
 
 void Agent::Connection::clear() {
-	waiting_write_response = false;
-	keep_alive             = true;
+	waiting_responses = 0;
+	keep_alive        = true;
 	parser.reset();
 	buffer.clear();
 	responses.clear();
@@ -46,8 +45,6 @@ void Agent::Connection::clear() {
 }
 
 bool Agent::Connection::read_next(ResponseData &req) {
-	if (waiting_write_response)
-		return false;
 	if (!receiving_body)
 		return false;
 	size_t expect_count = request.has_content_length() ? request.content_length : 0;
@@ -58,8 +55,8 @@ bool Agent::Connection::read_next(ResponseData &req) {
 	req.r   = std::move(request);
 	request = http::response{};
 	parser.reset();
-	receiving_body         = false;
-	waiting_write_response = true;
+	receiving_body = false;
+	waiting_responses -= 1;
 	return true;
 }
 
@@ -70,18 +67,16 @@ void Agent::Connection::write() {
 			break;
 		responses.pop_front();
 	}
-	if (!waiting_write_response && responses.empty() && !keep_alive) {
+	if (waiting_responses == 0 && responses.empty() && !keep_alive) {
 		sock.shutdown_both();
 		keep_alive = true;
 	}
 }
 
 void Agent::Connection::write(RequestData &&response) {
-	if (!waiting_write_response)
-		throw std::logic_error("Client unexpected write");
-	waiting_write_response = false;
 	if (!response.r.http_version_major)
 		throw std::logic_error("Someone forgot to set version, method, status or url");
+	waiting_responses += 1;
 	this->keep_alive = response.r.keep_alive;
 	std::string str  = response.r.to_string();
 	responses.emplace_back();
@@ -90,111 +85,157 @@ void Agent::Connection::write(RequestData &&response) {
 	write();
 }
 
-void Agent::Connection::advance_state(bool called_from_runloop) {
+void Agent::Connection::advance_state() {
 	write();
-	if (!responses.empty() || waiting_write_response) {
-		return;  // do not process new request until previous response completely sent. TODO - process.short responses
-	}
-	if (!receiving_body) {
-		buffer.copy_from(sock);
-		// Twice to have a chance to read both parts of buffer
-		auto ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
-		buffer.did_read(ptr - buffer.read_ptr());
-		ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
-		buffer.did_read(ptr - buffer.read_ptr());
-		if (!parser.is_bad() && !parser.is_good())
-			return;
-		receiving_body = true;
-		receiving_body_stream.clear();
-	}
-	while (true) {
-		size_t expect_count = request.has_content_length() ? request.content_length : 0;
-		size_t max_count    = expect_count - receiving_body_stream.size();
-		buffer.copy_to(receiving_body_stream, max_count);
-		if (expect_count == receiving_body_stream.size()) {
-			if (called_from_runloop)
-				r_handler();
-			return;
+	while (waiting_responses != 0) {  // Responses to pipelined requests can be already in buffer
+		if (!receiving_body) {
+			buffer.copy_from(sock);
+			// Twice to have a chance to read both parts of buffer
+			auto ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
+			buffer.did_read(ptr - buffer.read_ptr());
+			ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
+			buffer.did_read(ptr - buffer.read_ptr());
+			if (!parser.is_bad() && !parser.is_good())
+				return;
+			receiving_body = true;
+			receiving_body_stream.clear();
 		}
-		buffer.copy_from(sock);
-		if (buffer.empty())
-			break;
+		while (true) {
+			size_t expect_count = request.has_content_length() ? request.content_length : 0;
+			size_t max_count    = expect_count - receiving_body_stream.size();
+			buffer.copy_to(receiving_body_stream, max_count);
+			if (expect_count == receiving_body_stream.size())
+				break;
+			buffer.copy_from(sock);
+			if (buffer.empty())
+				return;
+		}
+		r_handler();  // Can write, cancel or disconnect
+		if (receiving_body)
+			return;  // Response was not read, should not happen
 	}
 }
 
 void Agent::Connection::on_disconnect() { disconnect(); }
 
-Agent::Agent(const std::string &address, uint16_t port)
-    : sent_request(nullptr)
-    , address(address)
+Agent::Agent(const std::string &address, uint16_t port, size_t max_connections, size_t max_pipeline)
+    : address(address)
     , port(port)
-    , client(std::bind(&Agent::on_client_response, this), std::bind(&Agent::on_client_disconnect, this))
-    , reconnect_timer(std::bind(&Agent::on_reconnect_timer, this)) {}
+    , max_pipeline(std::max<size_t>(1, max_pipeline))
+    , reconnect_timer(std::bind(&Agent::on_reconnect_timer, this)) {
+	for (size_t i = 0; i != std::max<size_t>(1, max_connections); ++i)
+		clients.emplace_back(new Connection(
+		    std::bind(&Agent::on_client_response, this, i), std::bind(&Agent::on_client_disconnect, this, i)));
+}
 
-Agent::~Agent() { assert(!sent_request); }
+Agent::~Agent() { assert(queued_requests.empty()); }
 
 void Agent::set_request(Request *req) {
-	if (sent_request)
-		throw std::logic_error("Agent is busy with previous request");
-	sent_request  = req;
-	request_start = std::chrono::steady_clock::now();
-	if (!client.is_open() && !client.connect(address, port)) {
-		reconnect_timer.once(10);
-		return;
+	req->start = std::chrono::steady_clock::now();
+	queued_requests.push_back(req);
+	send_queued_requests();
+}
+
+void Agent::send_queued_requests() {
+	while (!queued_requests.empty()) {
+		Connection *best = nullptr;
+		for (auto &&cl : clients)
+			if (cl->is_open() && cl->sent_requests.size() < max_pipeline &&
+			    (!best || cl->sent_requests.size() < best->sent_requests.size()))
+				best = cl.get();
+		if ((!best || !best->sent_requests.empty()) && !waiting_reconnect) {  // New connection is better than pipelining
+			for (auto &&cl : clients)
+				if (!cl->is_open()) {
+					if (cl->connect(address, port)) {
+						best = cl.get();
+					} else {
+						waiting_reconnect = true;
+						reconnect_timer.once(10);
+					}
+					break;
+				}
+		}
+		if (!best)
+			return;
+		Request *req = queued_requests.front();
+		queued_requests.pop_front();
+		best->sent_requests.push_back(req);
+		best->write(RequestData(req->req));
 	}
-	client.write(RequestData(sent_request->req));
 }
 
 void Agent::cancel_request(Request *req) {
-	if (sent_request == req) {
-		sent_request = nullptr;
-		client.disconnect();
-		reconnect_timer.cancel();
+	auto qit = std::find(queued_requests.begin(), queued_requests.end(), req);
+	if (qit != queued_requests.end()) {
+		queued_requests.erase(qit);
+		return;
+	}
+	for (auto &&cl : clients) {
+		auto sit = std::find(cl->sent_requests.begin(), cl->sent_requests.end(), req);
+		if (sit == cl->sent_requests.end())
+			continue;
+		*sit = nullptr;  // Response will be skipped, so following pipelined responses keep their order
+		if (std::count(cl->sent_requests.begin(), cl->sent_requests.end(), nullptr) ==
+		    static_cast<std::ptrdiff_t>(cl->sent_requests.size())) {
+			cl->sent_requests.clear();  // Nothing useful in flight, and we do not want to wait for long poll
+			cl->disconnect();
+		}
+		return;
 	}
 }
 
-void Agent::on_client_response() {
+void Agent::on_client_response(size_t index) {
+	Connection *client = clients.at(index).get();
 	ResponseData response;
-	if (client.read_next(response)) {
-		auto was_sent_request = sent_request;
-		sent_request          = nullptr;
-		if (was_sent_request) {
-			Request::R_handler r_handler = std::move(was_sent_request->r_handler);
-			Request::E_handler e_handler = std::move(was_sent_request->e_handler);
-			try {
-				r_handler(std::move(response));
-			} catch (std::exception &ex) {
-				std::cout << "    Parsing received submit leads to throw/catch what=" << ex.what() << std::endl;
-				e_handler(ex.what());
-			} catch (...) {
-				std::cout << "    Parsing received submit leads to throw/catch" << std::endl;
-				e_handler("catch ...");
-			}
+	if (!client->read_next(response) || client->sent_requests.empty())
+		return;
+	Request *was_sent_request = client->sent_requests.front();
+	client->sent_requests.pop_front();
+	if (was_sent_request) {
+		Request::R_handler r_handler = std::move(was_sent_request->r_handler);
+		Request::E_handler e_handler = std::move(was_sent_request->e_handler);
+		try {
+			r_handler(std::move(response));
+		} catch (std::exception &ex) {
+			std::cout << "    Parsing received submit leads to throw/catch what=" << ex.what() << std::endl;
+			e_handler(ex.what());
+		} catch (...) {
+			std::cout << "    Parsing received submit leads to throw/catch" << std::endl;
+			e_handler("catch ...");
 		}
 	}
+	send_queued_requests();
 }
 
-void Agent::on_client_disconnect() {
-	if (sent_request)
+void Agent::on_client_disconnect(size_t index) {
+	Connection *client = clients.at(index).get();
+	bool resend        = false;
+	for (; !client->sent_requests.empty(); client->sent_requests.pop_back())
+		if (client->sent_requests.back()) {
+			queued_requests.push_front(client->sent_requests.back());
+			resend = true;
+		}
+	if (resend && !waiting_reconnect) {
+		waiting_reconnect = true;
 		reconnect_timer.once(10);
+	}
 }
 
 void Agent::on_reconnect_timer() {
-	if (!sent_request)
-		return;  // Should not happen
-	auto idea_sec = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - request_start);
-	if (idea_sec.count() > REQUEST_TIMEOUT) {
-		auto was_sent_request        = sent_request;
-		sent_request                 = nullptr;
+	waiting_reconnect = false;
+	while (true) {  // Handler can cancel other requests, so we look for expired requests again after each call
+		const auto now = std::chrono::steady_clock::now();
+		auto qit       = std::find_if(queued_requests.begin(), queued_requests.end(), [&](Request *req) {
+			return std::chrono::duration_cast<std::chrono::seconds>(now - req->start).count() > REQUEST_TIMEOUT;
+		});
+		if (qit == queued_requests.end())
+			break;
+		Request *was_sent_request = *qit;
+		queued_requests.erase(qit);
 		Request::E_handler e_handler = std::move(was_sent_request->e_handler);
 		e_handler("Timeout");
-		return;
-	}
-	if (!client.is_open() && !client.connect(address, port)) {
-		reconnect_timer.once(10);
-		return;
 	}
-	client.write(RequestData(sent_request->req));
+	send_queued_requests();
 }
 
 Request::Request(Agent &agent, RequestData &&req, R_handler r_handler, E_handler e_handler)
@@ -8,6 +8,7 @@
 #include <deque>
 #include <memory>
 #include <set>
+#include <vector>
 #include "ResponseParser.hpp"
 #include "common/MemoryStreams.hpp"
 #include "platform/Network.hpp"
@@ -16,6 +17,9 @@ namespace http {
 
 class Request;
 
+// Keeps up to max_connections keep-alive connections to single server. Requests are queued and sent to idle
+// connection first, then pipelined up to max_pipeline deep, responses come in order of requests on each connection.
+// Requests in flight on broken connection are sent again after reconnect, queued requests fail after timeout.
 class Agent {
 	class Connection {
 	public:
@@ -26,10 +30,12 @@ class Agent {
 		bool connect(const std::string &address, uint16_t port);
 		bool is_open() const { return sock.is_open(); }
 		bool read_next(ResponseData &request);
-		void write(RequestData &&response);
+		void write(RequestData &&response);  // can be called again before previous response is read
 
 		void disconnect();
 
+		std::deque<Request *> sent_requests;  // in order of responses, nullptr if cancelled after sending
+
 	private:
 		common::CircularBuffer buffer;
 		std::deque<common::StringStream> responses;
@@ -39,9 +45,9 @@ class Agent {
 		bool receiving_body;
 		common::StringStream receiving_body_stream;
 
-		bool waiting_write_response;
+		size_t waiting_responses;  // written requests minus read responses
 
-		void advance_state(bool called_from_runloop);
+		void advance_state();
 		void write();
 		void on_disconnect();
 		void clear();
@@ -55,22 +61,24 @@ class Agent {
 
 	friend class Request;
 
-	Request *sent_request;
+	std::deque<Request *> queued_requests;
 	std::string address;
 	uint16_t port;
-	Connection client;
+	const size_t max_pipeline;
+	std::vector<std::unique_ptr<Connection>> clients;
 	platform::Timer reconnect_timer;
-	std::chrono::steady_clock::time_point request_start;
+	bool waiting_reconnect = false;
 
-	void on_client_response();
-	void on_client_disconnect();
+	void on_client_response(size_t index);
+	void on_client_disconnect(size_t index);
 	void on_reconnect_timer();
 
+	void send_queued_requests();
 	void set_request(Request *req);
 	void cancel_request(Request *req);
 
 public:
-	Agent(const std::string &address, uint16_t port);
+	Agent(const std::string &address, uint16_t port, size_t max_connections = 1, size_t max_pipeline = 1);
 	~Agent();
 };
 
@@ -88,5 +96,6 @@ private:
 	RequestData req;
 	R_handler r_handler;
 	E_handler e_handler;
+	std::chrono::steady_clock::time_point start;
 };
 }
@@ -4,6 +4,7 @@
 #include "Server.hpp"
 #include <algorithm>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 // to test
@@ -21,20 +22,27 @@ void Client::disconnect() {
 }
 
 void Client::clear() {
-	waiting_write_response = false;
-	keep_alive             = true;
+	keep_alive = true;
+	closing    = false;
 	parser.reset();
 	buffer.clear();
 	responses.clear();
-	receiving_body = false;
+	pending_responses.clear();
+	requests_read         = 0;
+	responses_sent        = 0;
+	stream_request_number = size_t(-1);
+	stream_chunked        = true;
+	streaming             = false;
+	receiving_body        = false;
 	receiving_body_stream.clear();
 	request = http::request();
+	resume_timer.cancel();
 
 	sock.close();
 }
 
 bool Client::read_next(RequestData &req) {
-	if (waiting_write_response)
+	if (reading_stopped() || pending_responses.size() >= max_in_flight)
 		return false;
 	if (!receiving_body)
 		return false;
@@ -46,8 +54,9 @@ bool Client::read_next(RequestData &req) {
 	req.r   = std::move(request);
 	request = http::request();
 	parser.reset();
-	receiving_body         = false;
-	waiting_write_response = true;
+	receiving_body = false;
+	pending_responses.emplace_back();
+	requests_read += 1;
 	return true;
 }
 
@@ -58,59 +67,127 @@ void Client::write() {
 			break;
 		responses.pop_front();
 	}
-	if (!waiting_write_response && responses.empty() && !keep_alive) {
+	if (responses.empty() && !keep_alive) {
 		sock.shutdown_both();
 		keep_alive = true;
 	}
 }
 
-void Client::write(ResponseData &&response) {
-	if (!waiting_write_response)
-		throw std::logic_error("Client unexpected write");
-	waiting_write_response = false;
+void Client::write(ResponseData &&response, size_t request_number) {
+	if (closing)
+		return;  // Pipelined request after one without keep-alive, nobody will read response
 	if (!response.r.http_version_major)
 		throw std::logic_error("Someone forgot to set version, method, status or url");
-	this->keep_alive = response.r.keep_alive;
-	std::string str  = response.r.to_string();
-	responses.emplace_back();
-	responses.back().write(str.data(), str.size());
-	responses.emplace_back(std::move(response.body));
+	if (request_number < responses_sent)
+		throw std::logic_error("Client response written twice");
+	auto &pending    = pending_responses.at(request_number - responses_sent);
+	pending.ready    = true;
+	pending.response = std::move(response);
+	while (!pending_responses.empty() && pending_responses.front().ready && !closing) {
+		ResponseData &ready = pending_responses.front().response;
+		std::string str     = ready.r.to_string();
+		responses.emplace_back();
+		responses.back().write(str.data(), str.size());
+		responses.emplace_back(std::move(ready.body));
+		if (responses_sent == stream_request_number) {
+			streaming = true;
+			closing   = true;  // Stream is the last response, but connection stays open
+		} else if (!ready.r.keep_alive) {
+			keep_alive = false;
+			closing    = true;
+		}
+		pending_responses.pop_front();
+		responses_sent += 1;
+	}
 	write();
+	if (!reading_stopped() && pending_responses.size() < max_in_flight && (receiving_body || !buffer.empty()))
+		resume_timer.once(0);  // Pipelined requests in buffer, not from here, we can be deep inside some handler
+}
+
+void Client::start_stream(ResponseData &&response, size_t request_number) {
+	if (stream_request_number != size_t(-1))
+		throw std::logic_error("Client stream already started");
+	stream_request_number = request_number;
+	if (closing)
+		return;
+	std::string body          = std::move(response.body);
+	response.body             = std::string();
+	response.r.content_length = size_t(-1);
+	stream_chunked = response.r.http_version_major > 1 ||
+	                 (response.r.http_version_major == 1 && response.r.http_version_minor >= 1);
+	if (stream_chunked)
+		response.r.headers.push_back({"Transfer-Encoding", "chunked"});
+	else
+		response.r.keep_alive = false;  // HTTP/1.0 has no chunks, body ends when connection closes
+	write(std::move(response), request_number);
+	write_chunk(body, std::numeric_limits<size_t>::max());  // Initial snapshot can be big, we never drop it
+}
+
+bool Client::write_chunk(const std::string &data) { return write_chunk(data, MAX_STREAM_BACKLOG); }
+
+bool Client::write_chunk(const std::string &data, size_t max_backlog) {
+	if (stream_request_number == size_t(-1))
+		throw std::logic_error("Client write_chunk without stream");
+	if (data.empty())
+		return true;  // Empty chunk would finish stream
+	std::string chunk;
+	if (stream_chunked) {
+		std::stringstream ss;
+		ss << std::hex << data.size() << "\r\n";
+		chunk = ss.str() + data + "\r\n";
+	} else
+		chunk = data;
+	if (!streaming) {  // Headers wait for responses to earlier requests
+		if (closing)
+			return true;
+		auto &pending = pending_responses.at(stream_request_number - responses_sent);
+		if (pending.response.body.size() + chunk.size() > max_backlog)
+			return false;
+		pending.response.body += chunk;
+		return true;
+	}
+	size_t backlog = 0;
+	for (auto &&r : responses)
+		backlog += r.size();
+	if (backlog + chunk.size() > max_backlog)
+		return false;
+	responses.emplace_back(std::move(chunk));
+	write();
+	return true;
 }
 
 void Client::advance_state(bool called_from_runloop) {
 	write();
-	if (!responses.empty() || waiting_write_response) {
-		return;  // do not process new request until previous response completely sent. TODO - process.short responses
-	}
-	if (!receiving_body) {
-		buffer.copy_from(sock);
-		// Twice to have a chance to read both parts of buffer
-		auto ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
-		buffer.did_read(ptr - buffer.read_ptr());
-		ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
-		buffer.did_read(ptr - buffer.read_ptr());
-		if (!parser.is_bad() && !parser.is_good())
-			return;
-		if (parser.is_bad()) {
-			sock.shutdown_both();  // Will potentially be called many times
-			return;
+	if (!reading_stopped() && pending_responses.size() < max_in_flight) {
+		if (!receiving_body) {
+			buffer.copy_from(sock);
+			// Twice to have a chance to read both parts of buffer
+			auto ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
+			buffer.did_read(ptr - buffer.read_ptr());
+			ptr = parser.parse(request, buffer.read_ptr(), buffer.read_ptr() + buffer.read_count());
+			buffer.did_read(ptr - buffer.read_ptr());
+			if (!parser.is_bad() && !parser.is_good())
+				return;
+			if (parser.is_bad()) {
+				sock.shutdown_both();  // Will potentially be called many times
+				return;
+			}
+			receiving_body = true;
+			receiving_body_stream.clear();
 		}
-		receiving_body = true;
-		receiving_body_stream.clear();
-	}
-	while (true) {
-		size_t expect_count = request.has_content_length() ? request.content_length : 0;
-		size_t max_count    = expect_count - receiving_body_stream.size();
-		buffer.copy_to(receiving_body_stream, max_count);
-		if (expect_count == receiving_body_stream.size()) {
-			if (called_from_runloop)
-				r_handler();
-			return;
+		while (true) {
+			size_t expect_count = request.has_content_length() ? request.content_length : 0;
+			size_t max_count    = expect_count - receiving_body_stream.size();
+			buffer.copy_to(receiving_body_stream, max_count);
+			if (expect_count == receiving_body_stream.size())
+				break;
+			buffer.copy_from(sock);
+			if (buffer.empty())
+				return;
 		}
-		buffer.copy_from(sock);
-		if (buffer.empty())
-			break;
+		if (called_from_runloop)
+			r_handler();  // Reads all requests it can, can disconnect and destroy us
+		return;
 	}
 }
 
@@ -128,6 +205,7 @@ void Server::on_client_disconnected(Client *who) {
 void Server::on_client_handler(Client *who) {
 	RequestData request;
 	while (who->read_next(request)) {
+		const size_t request_number = who->requests_read - 1;
 		ResponseData response(request.r);
 		response.r.status = 422;
 		response.set_body(std::string());
@@ -143,8 +221,10 @@ void Server::on_client_handler(Client *who) {
 			std::cout << "HTTP request leads to throw/catch" << std::endl;
 			response.r.status = 422;
 		}
+		if (clients.count(who) == 0)
+			return;  // Disconnected by handler
 		if (result)
-			who->write(std::move(response));
+			who->write(std::move(response), request_number);
 	}
 }
 
@@ -153,7 +233,7 @@ void Server::accept_all() {
 		return;
 	while (true) {
 		if (!next_client) {
-			next_client            = std::make_unique<Client>([]() {}, []() {});  // We do not know Client * yet
+			next_client = std::make_unique<Client>([]() {}, []() {}, max_in_flight);  // We do not know Client * yet
 			next_client->r_handler = std::bind(&Server::on_client_handler, this, next_client.get());
 			next_client->d_handler = std::bind(&Server::on_client_disconnected, this, next_client.get());
 		}
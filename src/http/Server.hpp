@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <deque>
 #include <map>
 #include <memory>
@@ -13,25 +14,39 @@
 
 namespace http {
 
+// Pipelined requests are read while previous responses are pending, up to max_in_flight. Responses are sent in
+// order of requests. Response returned by handler goes to its request, asynchronous response must be written with
+// request number remembered by get_last_request_number() when handler returned false.
+// Handlers run on the event loop thread, one at a time. Pipelining only overlaps reading and writing within a
+// connection, so slow handler delays responses on all connections ('benchmarks http_load' measures this)
+// Streamed response (Transfer-Encoding: chunked) never finishes, write_chunk() sends more of it until client
+// disconnects. No requests are read after one being streamed, requests already read get no responses
 class Client {
 public:
 	typedef std::function<void()> handler;
 
-	explicit Client(handler r_handler, handler d_handler)
+	explicit Client(handler r_handler, handler d_handler, size_t max_in_flight)
 	    : buffer(8192)
 	    , receiving_body(false)
-	    , waiting_write_response(false)
+	    , max_in_flight(std::max<size_t>(1, max_in_flight))
 	    , r_handler(r_handler)
 	    , d_handler(d_handler)
 	    , sock([this](bool, bool) { advance_state(true); }, std::bind(&Client::on_disconnect, this))
+	    , resume_timer([this]() { advance_state(true); })
 	    , keep_alive(true) {}
 	bool read_next(RequestData &request);
-	void write(ResponseData &&response);
+	size_t get_last_request_number() const { return requests_read - 1; }  // remember to respond asynchronously
+	void write(ResponseData &&response, size_t request_number);
+	void start_stream(ResponseData &&response, size_t request_number);  // Content-Length is ignored
+	bool write_chunk(const std::string &data);  // false if client does not keep up, data is dropped
 
 	void disconnect();
 
+	enum { MAX_STREAM_BACKLOG = 1024 * 1024 };
+
 private:
 	void clear();
+	bool write_chunk(const std::string &data, size_t max_backlog);
 	friend class Server;
 
 	common::CircularBuffer buffer;
@@ -42,7 +57,19 @@ private:
 	bool receiving_body;
 	common::StringStream receiving_body_stream;
 
-	bool waiting_write_response;
+	struct PendingResponse {
+		bool ready = false;
+		ResponseData response;
+	};
+	std::deque<PendingResponse> pending_responses;  // One per request read, in order
+	size_t requests_read  = 0;
+	size_t responses_sent = 0;  // Number of request for pending_responses.front()
+	const size_t max_in_flight;
+	bool closing = false;  // Response without keep-alive sent, we read no more requests
+	size_t stream_request_number = size_t(-1);
+	bool stream_chunked          = true;   // false for HTTP/1.0, where stream ends with connection
+	bool streaming               = false;  // Headers of streamed response sent, chunks go directly to responses
+	bool reading_stopped() const { return closing || stream_request_number != size_t(-1); }
 
 	void advance_state(bool called_from_runloop);
 	void write();
@@ -52,6 +79,7 @@ private:
 	handler d_handler;
 
 	platform::TCPSocket sock;
+	platform::Timer resume_timer;  // Asynchronous write can free slot for requests already in buffer
 	bool keep_alive;
 };
 
@@ -61,9 +89,11 @@ public:
 	typedef std::function<void(Client *who)> disconnect_handler;
 
 	explicit Server(const std::string &address, uint16_t port, request_handler r_handler, disconnect_handler d_handler,
-	    const std::string &ssl_pem_file = std::string(), const std::string &ssl_certificate_password = std::string())
+	    size_t max_in_flight = 1, const std::string &ssl_pem_file = std::string(),
+	    const std::string &ssl_certificate_password = std::string())
 	    : la_socket{new platform::TCPAcceptor{
 	          address, port, std::bind(&Server::accept_all, this), ssl_pem_file, ssl_certificate_password}}
+	    , max_in_flight(max_in_flight)
 	    , r_handler(r_handler)
 	    , d_handler(d_handler) {
 		accept_all();
@@ -76,6 +106,7 @@ private:
 
 	std::map<Client *, std::unique_ptr<Client>> clients;  // Alas, no way to look for an element in set<unique_ptr<_>>
 	std::unique_ptr<Client> next_client;
+	const size_t max_in_flight;  // Per client
 
 	void on_client_disconnected(Client *who);
 	void on_client_handler(Client *who);
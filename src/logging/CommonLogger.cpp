@@ -46,18 +46,21 @@ std::string format_pattern(
 
 void CommonLogger::operator()(
     const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) {
-	if (level <= log_level && m_disabled_categories.count(category) == 0) {
-		std::string body2 = body;
-		if (!pattern.empty()) {
-			size_t insert_pos = 0;
-			if (body2.size() >= 2 && body2[0] == ILogger::COLOR_PREFIX) {
-				insert_pos = 2;
-			}
-			body2.insert(insert_pos, format_pattern(pattern, category, level, time));
-		}
+	if (is_enabled(category, level))
+		do_log_string(format_message(category, level, time, body));
+}
 
-		do_log_string(body2);
+std::string CommonLogger::format_message(
+    const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) const {
+	std::string body2 = body;
+	if (!pattern.empty()) {
+		size_t insert_pos = 0;
+		if (body2.size() >= 2 && body2[0] == ILogger::COLOR_PREFIX) {
+			insert_pos = 2;
+		}
+		body2.insert(insert_pos, format_pattern(pattern, category, level, time));
 	}
+	return body2;
 }
 
 void CommonLogger::set_pattern(const std::string &pattern) { this->pattern = pattern; }
@@ -15,6 +15,7 @@ public:
 	virtual void enable_category(const std::string &category);
 	virtual void disable_category(const std::string &category);
 	virtual void set_max_level(Level level);
+	virtual bool is_level_enabled(Level level) const override { return level <= log_level; }
 
 	void set_pattern(const std::string &pattern);
 
@@ -24,6 +25,11 @@ protected:
 	std::string pattern;
 
 	CommonLogger(Level level);
+	bool is_enabled(const std::string &category, Level level) const {
+		return level <= log_level && m_disabled_categories.count(category) == 0;
+	}
+	std::string format_message(
+	    const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) const;
 	virtual void do_log_string(const std::string &message);
 };
 }
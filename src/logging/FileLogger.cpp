@@ -16,23 +16,69 @@ FileLogger::FileLogger(const std::string &fullfilenamenoext, size_t max_size, Le
 		file_stream = std::make_unique<platform::FileStream>(
 		    this->fullfilenamenoext + ".log", platform::FileStream::TRUNCATE_READ_WRITE);
 	}
+	writer = std::thread(&FileLogger::thread_run, this);
 }
 
-void FileLogger::do_log_string(const std::string &message) {
-	std::lock_guard<std::mutex> lock(mutex);
-	std::string real_message;
-	real_message.reserve(message.size());
+FileLogger::~FileLogger() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		quit = true;
+		have_work.notify_all();
+	}
+	writer.join();  // writer drains queue before exiting
+}
+
+void FileLogger::operator()(
+    const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) {
+	if (!is_enabled(category, level))
+		return;
+	std::unique_lock<std::mutex> lock(mutex);
+	queue_written.wait(lock, [&] { return queue.size() < MAX_QUEUE_SIZE; });
+	queue.push_back(Record{category, level, time, body});
+	have_work.notify_all();
+	if (level == FATAL)  // process is probably going down, make sure message gets to disk
+		queue_written.wait(lock, [&] { return queue.empty() && !writing; });
+}
 
-	for (size_t char_pos = 0; char_pos < message.size(); ++char_pos) {
-		if (message[char_pos] == ILogger::COLOR_PREFIX) {
-			char_pos += 1;
-		} else {
-			real_message += message[char_pos];
+void FileLogger::thread_run() {
+	std::vector<Record> batch;
+	std::string text;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			writing = false;
+			queue_written.notify_all();
+			have_work.wait(lock, [&] { return quit || !queue.empty(); });
+			if (queue.empty())
+				return;  // quit and nothing left to write
+			batch.swap(queue);
+			writing = true;
+			queue_written.notify_all();  // wake up callers waiting for space in queue
 		}
+		text.clear();
+		for (auto &&record : batch) {
+			const std::string message = format_message(record.category, record.level, record.time, record.body);
+			for (size_t char_pos = 0; char_pos < message.size(); ++char_pos) {
+				if (message[char_pos] == ILogger::COLOR_PREFIX) {
+					char_pos += 1;
+				} else {
+					text += message[char_pos];
+				}
+			}
+			if (text.size() >= WRITE_CHUNK_SIZE) {  // keep rotation reasonably precise
+				write_text(text);
+				text.clear();
+			}
+		}
+		batch.clear();
+		write_text(text);
 	}
+}
+
+void FileLogger::write_text(const std::string &text) {
 	try {
 		if (file_stream)
-			file_stream->write(real_message.data(), real_message.size());
+			file_stream->write(text.data(), text.size());
 	} catch (...) {  // Will continue trying to write when space becomes available
 	}
 
@@ -3,25 +3,48 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include "CommonLogger.hpp"
 #include "platform/Files.hpp"
 
 namespace logging {
 
+// Callers only append record to a queue, formatting, writing and rotation are done in batches by writer thread
 class FileLogger : public CommonLogger {
 public:
 	explicit FileLogger(const std::string &fullfilenamenoext, size_t max_size, Level level = DEBUGGING);
-
-protected:
-	virtual void do_log_string(const std::string &message) override;
+	~FileLogger();
+	virtual void operator()(
+	    const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) override;
 
 private:
-	std::mutex mutex;
+	struct Record {
+		std::string category;
+		Level level;
+		boost::posix_time::ptime time;
+		std::string body;
+	};
+	enum { MAX_QUEUE_SIZE = 100000 };  // if writer cannot keep up, callers wait instead of growing memory
+	enum { WRITE_CHUNK_SIZE = 65536 };
+
+	std::mutex mutex;  // protects queue only, file is accessed by writer thread only
+	std::condition_variable have_work;
+	std::condition_variable queue_written;
+	std::vector<Record> queue;
+	bool writing = false;
+	bool quit    = false;
+
 	const size_t initial_max_size;
 	size_t max_size;
 	bool using_prev = false;  // atomic_replaced success, but create new file failed
 	const std::string fullfilenamenoext;
 	std::unique_ptr<platform::FileStream> file_stream;
+
+	std::thread writer;  // must be last, started after all other members are constructed
+	void thread_run();
+	void write_text(const std::string &text);
 };
 }
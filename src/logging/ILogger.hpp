@@ -23,6 +23,8 @@ public:
 
 	virtual void operator()(
 	    const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) = 0;
+	// Cheap check done before message is formatted, categories are still checked in operator()
+	virtual bool is_level_enabled(Level level) const { return true; }
 	virtual ~ILogger() {}
 };
 
@@ -14,6 +14,13 @@ void LoggerGroup::remove_logger(ILogger &logger) {
 	loggers.erase(std::remove(loggers.begin(), loggers.end(), &logger), loggers.end());
 }
 
+bool LoggerGroup::is_level_enabled(Level level) const {
+	if (level > log_level)
+		return false;
+	return std::any_of(
+	    loggers.begin(), loggers.end(), [&](const ILogger *logger) { return logger->is_level_enabled(level); });
+}
+
 void LoggerGroup::operator()(
     const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) {
 	if (level <= log_level && m_disabled_categories.count(category) == 0) {
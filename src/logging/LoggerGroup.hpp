@@ -16,6 +16,7 @@ public:
 	void remove_logger(ILogger &logger);
 	virtual void operator()(
 	    const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) override;
+	virtual bool is_level_enabled(Level level) const override;
 
 protected:
 	std::vector<ILogger *> loggers;
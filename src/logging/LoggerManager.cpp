@@ -19,6 +19,20 @@ void LoggerManager::operator()(
 	LoggerGroup::operator()(category, level, time, body);
 }
 
+void LoggerManager::set_max_level(Level level) {
+	std::unique_lock<std::mutex> lock(reconfigure_lock);
+	LoggerGroup::set_max_level(level);
+	update_max_enabled_level();
+}
+
+void LoggerManager::update_max_enabled_level() {
+	int level = FATAL - 1;  // nothing enabled
+	for (int l = FATAL; l <= TRACE; ++l)
+		if (LoggerGroup::is_level_enabled(static_cast<Level>(l)))
+			level = l;
+	max_enabled_level = level;
+}
+
 void LoggerManager::configure_default(const std::string &log_folder, const std::string &log_prefix) {
 	{
 		std::unique_lock<std::mutex> lock(reconfigure_lock);  // TODO - investigate possible deadlocks
@@ -38,6 +52,7 @@ void LoggerManager::configure_default(const std::string &log_folder, const std::
 		logger->set_pattern("%T %l %C ");
 		loggers.emplace_back(std::move(logger));
 		add_logger(*loggers.back());
+		update_max_enabled_level();
 	}
 	(*this)(
 	    "START", TRACE, boost::posix_time::microsec_clock::local_time(), "----------------------------------------\n");
@@ -125,9 +140,10 @@ void LoggerManager::configure(const JsonValue &val) {
 	} else {
 		throw std::runtime_error("loggers parameter missing");
 	}
-	set_max_level(global_level);
+	LoggerGroup::set_max_level(global_level);
 	for (const auto &category : global_disabled_categories) {
 		disable_category(category);
 	}
+	update_max_enabled_level();
 }
 }
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -19,9 +20,13 @@ public:
 	void configure(const common::JsonValue &val);
 	virtual void operator()(
 	    const std::string &category, Level level, boost::posix_time::ptime time, const std::string &body) override;
+	virtual void set_max_level(Level level) override;
+	virtual bool is_level_enabled(Level level) const override { return level <= max_enabled_level; }
 
 private:
 	std::vector<std::unique_ptr<CommonLogger>> loggers;
 	std::mutex reconfigure_lock;
+	std::atomic<int> max_enabled_level{TRACE};  // Cached from loggers on reconfigure, read without lock
+	void update_max_enabled_level();            // call under reconfigure_lock
 };
 }
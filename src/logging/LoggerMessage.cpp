@@ -5,12 +5,16 @@
 
 namespace logging {
 
+// Messages at filtered levels are never formatted - stream is put into bad state, so operator<< returns immediately
 LoggerMessage::LoggerMessage(ILogger &logger, const std::string &category, Level level)
     : std::ostream(this)
     , logger(logger)
     , category(category)
     , log_level(level)
-    , timestamp(boost::posix_time::microsec_clock::local_time()) {
+    , timestamp(logger.is_level_enabled(level) ? boost::posix_time::microsec_clock::local_time()
+                                               : boost::posix_time::ptime()) {
+	if (timestamp.is_not_a_date_time())
+		setstate(std::ios::badbit);
 	//	(*this) << std::string{ILogger::COLOR_PREFIX, static_cast<char>(ILogger::COLOR_LETTER_DEFAULT + color)};
 	//	(*this) << color;
 }
@@ -25,7 +29,8 @@ LoggerMessage::LoggerMessage(LoggerMessage &&other)
     , logger(other.logger)
     , category(other.category)
     , log_level(other.log_level)
-    , timestamp(boost::posix_time::microsec_clock::local_time()) {
+    , timestamp(other.timestamp) {
+	setstate(other.rdstate());
 	(*this) << other.str();
 	other.str(std::string());
 }
@@ -0,0 +1,605 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <random>
+#include "Core/BlockChainFileFormat.hpp"
+#include "Core/BlockChainState.hpp"
+#include "Core/Config.hpp"
+#include "Core/TransactionExtra.hpp"
+#include "common/CommandLine.hpp"
+#include "common/Metrics.hpp"
+#include "crypto/crypto.hpp"
+#include "http/Agent.hpp"
+#include "http/Server.hpp"
+#include "logging/ConsoleLogger.hpp"
+#include "p2p/PeerDB.hpp"
+#include "platform/PathTools.hpp"
+#include "version.hpp"
+
+static const char USAGE[] =
+    R"(benchmarks. prints one line per stage, compare numbers only between runs on the same machine
+
+Usage:
+  benchmarks replay --blocks-folder=<folder> --data-folder=<folder> [options]
+  benchmarks http_load [options]
+  benchmarks peers --data-folder=<folder> [options]
+  benchmarks base58 [options]
+  benchmarks extra --blocks-folder=<folder> [options]
+  benchmarks --help | -h
+  benchmarks --version | -v
+
+Modes:
+  replay                           Replay blocks from blocks.bin/blockindexes.bin into fresh blockchain DB.
+  http_load                        Fast requests to in-process http::Server while other clients send slow ones, prints latency percentiles.
+  peers                            Handshakes, peer exchanges and connection attempts against PeerDB.
+  base58                           Formatting and parsing of addresses, one by one and in bulk.
+  extra                            Finding fields in transaction extra of blocks from blocks.bin.
+
+Replay options:
+  --blocks-folder=<folder>         Folder with blocks.bin and blockindexes.bin, as written by varcoind --export-blocks.
+  --data-folder=<folder>           Folder for benchmark DB. Existing blockchain there is DELETED.
+  --testnet                        Blocks are from testnet.
+  --from-height=<height>           Blocks below are imported as separate 'prefix' stage [default: 1].
+  --to-height=<height>             Last block to replay [default: last block in blocks.bin].
+  --commit-interval=<blocks>       Commit DB every so many blocks, as varcoind import does [default: 50000].
+  --report-interval=<blocks>       Print replay stage every so many blocks [default: 10000].
+  --ring-checker-threads=<count>   Threads checking ring signatures [default: half of cpus].
+  --no-check-sigs                  Do not check ring signatures outside checkpoint zone.
+
+Http_load options (compare with --slow-clients=0 to see how slow handlers delay everyone else):
+  --port=<port>                    Server port on 127.0.0.1 [default: 18099].
+  --clients=<count>                Client connections sending fast requests [default: 16].
+  --slow-clients=<count>           Client connections sending only slow requests, like big sync_blocks [default: 1].
+  --pipeline=<depth>               Requests each client keeps in flight [default: 4].
+  --max-in-flight=<count>          Server limit of pipelined requests per client [default: 8].
+  --requests=<count>               Fast requests, slow clients keep sending until they are answered [default: 20000].
+  --slow-ms=<ms>                   Handler time of slow request [default: 20].
+
+Peers options:
+  --data-folder=<folder>           Folder for peer_db.bin. Existing one there is loaded, then OVERWRITTEN.
+  --updates=<count>                Operations, a quarter of each kind [default: 2000000].
+  --addresses=<count>              Distinct peer addresses seen in handshakes and exchanges [default: 1000000].
+  --networks=<count>               /16 networks addresses belong to [default: 4096].
+  --white-limit=<count>            Whitelist size limit [default: 10000].
+  --gray-limit=<count>             Graylist size limit [default: 100000].
+
+Base58 options:
+  --addresses=<count>              Addresses in batch [default: 200000].
+  --rounds=<count>                 Times each batch is processed [default: 5].
+
+Extra options:
+  --blocks-folder=<folder>         Folder with blocks.bin and blockindexes.bin, as written by varcoind --export-blocks.
+  --from-height=<height>           First block of sample [default: 1].
+  --blocks=<count>                 Blocks in sample [default: 100000].
+  --rounds=<count>                 Times sample is processed [default: 10].
+)";
+
+using namespace varcoin;
+
+namespace {
+
+// Counts work and resources from creation until print()
+class Stage {
+public:
+	explicit Stage(const std::string &name, Height first_height)
+	    : m_name(name)
+	    , m_first_height(first_height)
+	    , m_start(std::chrono::steady_clock::now())
+	    , m_start_put_bytes(put_bytes_counter().get()) {}
+	void add_block(const PreparedBlock &pb) {
+		m_blocks += 1;
+		m_transactions += pb.block.transactions.size() + 1;  // with coinbase
+		for (auto &&tx : pb.block.transactions)
+			m_inputs += tx.inputs.size();
+	}
+	void print(Height last_height) const {
+		auto ms =
+		    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count();
+		const double seconds = double(std::max<int64_t>(ms, 1)) / 1000;
+		std::cout << "stage=" << m_name << " heights=" << m_first_height << "-" << last_height
+		          << " seconds=" << seconds << " blocks/s=" << m_blocks / seconds
+		          << " tx/s=" << m_transactions / seconds << " inputs/s=" << m_inputs / seconds
+		          << " db_bytes_written=" << put_bytes_counter().get() - m_start_put_bytes
+		          << " peak_rss_mb=" << platform::get_peak_memory_usage() / (1024 * 1024) << std::endl;
+	}
+
+private:
+	static common::metrics::Counter &put_bytes_counter() {
+		return common::metrics::counter("varcoin_db_put_bytes_total");
+	}
+	const std::string m_name;
+	const Height m_first_height;
+	const std::chrono::steady_clock::time_point m_start;
+	const uint64_t m_start_put_bytes;
+	size_t m_blocks       = 0;
+	size_t m_transactions = 0;
+	size_t m_inputs       = 0;
+};
+
+template<typename T>
+T get_number(common::CommandLine &cmd, const char *key, T default_value) {
+	if (const char *pa = cmd.get(key))
+		return boost::lexical_cast<T>(pa);
+	return default_value;
+}
+
+int replay(common::CommandLine &cmd) {
+	const char *blocks_folder    = cmd.get("--blocks-folder");
+	const bool has_data_folder   = cmd.get("--data-folder") != nullptr;
+	const Height from_height     = get_number<Height>(cmd, "--from-height", 1);
+	Height to_height             = get_number<Height>(cmd, "--to-height", Height(-1));
+	const Height commit_interval = get_number<Height>(cmd, "--commit-interval", 50000);
+	const Height report_interval = get_number<Height>(cmd, "--report-interval", 10000);
+	Config config(cmd);
+	config.ring_checker_threads  = get_number<size_t>(cmd, "--ring-checker-threads", 0);
+	config.check_ring_signatures = !cmd.get_bool("--no-check-sigs");
+	if (cmd.should_quit(USAGE, varcoin::app_version()))
+		return 0;
+	if (!blocks_folder || !has_data_folder) {  // Default data folder is real one, we would delete blockchain there
+		std::cout << "Both --blocks-folder and --data-folder must be specified" << std::endl;
+		return 1;
+	}
+	if (from_height == 0 || commit_interval == 0 || report_interval == 0) {
+		std::cout << "--from-height, --commit-interval and --report-interval must be positive" << std::endl;
+		return 1;
+	}
+	LegacyBlockChainReader reader(
+	    std::string(blocks_folder) + "/blockindexes.bin", std::string(blocks_folder) + "/blocks.bin");
+	if (reader.get_block_count() < 2) {
+		std::cout << "No blocks to replay in " << blocks_folder << std::endl;
+		return 1;
+	}
+	to_height = std::min(to_height, reader.get_block_count() - 1);
+	if (from_height > to_height) {
+		std::cout << "--from-height must not be above --to-height=" << to_height << std::endl;
+		return 1;
+	}
+	std::cout << "Replaying heights " << from_height << "-" << to_height << " commit_interval=" << commit_interval
+	          << " check_sigs=" << config.check_ring_signatures << std::endl;
+
+	logging::ConsoleLogger logger(logging::WARNING);
+	Currency currency(config);
+	BlockChain::DB::delete_db(config.get_data_folder() + "/blockchain");
+	Stage open_stage("open", 0);
+	BlockChainState block_chain(logger, config, currency, false);
+	open_stage.print(0);
+
+	auto apply_block = [&](Height height, Stage *stage, Stage *total_stage) {
+		PreparedBlock pb = reader.get_prepared_block_by_index(height);
+		stage->add_block(pb);
+		if (total_stage)
+			total_stage->add_block(pb);
+		api::BlockHeader info;
+		if (block_chain.add_block(pb, &info) != BroadcastAction::BROADCAST_ALL)
+			throw std::runtime_error("Block not added to main chain height=" + common::to_string(height));
+		if (height % commit_interval == 0)
+			block_chain.db_commit();
+	};
+	if (from_height > 1) {
+		Stage prefix_stage("prefix", 1);
+		for (Height ha = 1; ha != from_height; ++ha)
+			apply_block(ha, &prefix_stage, nullptr);
+		prefix_stage.print(from_height - 1);
+	}
+	Stage replay_stage("replay_total", from_height);  // including final commit
+	std::unique_ptr<Stage> interval_stage;
+	for (Height ha = from_height; ha <= to_height; ++ha) {
+		if (!interval_stage)
+			interval_stage.reset(new Stage("replay_interval", ha));
+		apply_block(ha, interval_stage.get(), &replay_stage);
+		if ((ha - from_height + 1) % report_interval == 0 || ha == to_height) {
+			interval_stage->print(ha);
+			interval_stage.reset();
+		}
+	}
+	Stage commit_stage("final_commit", to_height);
+	block_chain.db_commit();
+	commit_stage.print(to_height);
+	replay_stage.print(to_height);
+	return 0;
+}
+
+void print_latencies(const std::string &name, std::vector<double> &latencies_ms, double seconds) {
+	std::sort(latencies_ms.begin(), latencies_ms.end());
+	auto percentile = [&](size_t pc) {
+		return latencies_ms.at(std::min(latencies_ms.size() - 1, latencies_ms.size() * pc / 100));
+	};
+	std::cout << "stage=" << name << " requests=" << latencies_ms.size()
+	          << " requests/s=" << latencies_ms.size() / seconds;
+	if (!latencies_ms.empty())
+		std::cout << " p50_ms=" << percentile(50) << " p99_ms=" << percentile(99) << " max_ms=" << latencies_ms.back();
+	std::cout << std::endl;
+}
+
+int http_load(common::CommandLine &cmd) {
+	const uint16_t port        = get_number<uint16_t>(cmd, "--port", 18099);
+	const size_t client_count      = get_number<size_t>(cmd, "--clients", 16);
+	const size_t slow_client_count = get_number<size_t>(cmd, "--slow-clients", 1);
+	const size_t pipeline          = get_number<size_t>(cmd, "--pipeline", 4);
+	const size_t max_in_flight     = get_number<size_t>(cmd, "--max-in-flight", 8);
+	const size_t request_count     = get_number<size_t>(cmd, "--requests", 20000);
+	const double slow_ms           = get_number<double>(cmd, "--slow-ms", 20);
+	if (cmd.should_quit(USAGE, varcoin::app_version()))
+		return 0;
+	if (client_count == 0 || pipeline == 0 || request_count == 0) {
+		std::cout << "--clients, --pipeline and --requests must be positive" << std::endl;
+		return 1;
+	}
+	boost::asio::io_service io;
+	platform::EventLoop run_loop(io);
+	http::Server server("127.0.0.1", port,
+	    [&](http::Client *, http::RequestData &&request, http::ResponseData &response) {
+		    if (request.r.uri == "/slow") {  // Handlers run on event loop, so we burn cpu instead of sleeping
+			    const auto until =
+			        std::chrono::steady_clock::now() + std::chrono::microseconds(int64_t(slow_ms * 1000));
+			    while (std::chrono::steady_clock::now() < until) {
+			    }
+		    }
+		    response.r.status = 200;
+		    response.set_body(std::move(request.body));
+		    return true;
+	    },
+	    [](http::Client *) {}, max_in_flight);
+
+	std::vector<std::unique_ptr<http::Agent>> agents;
+	std::list<std::unique_ptr<http::Request>> requests;
+	std::vector<double> fast_latencies_ms;
+	std::vector<double> slow_latencies_ms;
+	size_t sent_count  = 0;  // fast only
+	size_t error_count = 0;
+	std::function<void(http::Agent *, bool)> send_next = [&](http::Agent *agent, bool slow) {
+		if (sent_count == request_count)
+			return;  // slow clients stop with fast ones
+		if (!slow)
+			sent_count += 1;
+		http::RequestData req;
+		req.r.set_firstline("POST", slow ? "/slow" : "/fast", 1, 1);
+		req.set_body(std::string(64, 'x'));
+		const auto start = std::chrono::steady_clock::now();
+		requests.emplace_back();
+		auto rit     = std::prev(requests.end());
+		auto on_done = [&, agent, rit, slow, start](bool ok) {
+			const auto us =
+			    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+			(slow ? slow_latencies_ms : fast_latencies_ms).push_back(double(us) / 1000);
+			error_count += ok ? 0 : 1;
+			requests.erase(rit);
+			if (fast_latencies_ms.size() == request_count)
+				run_loop.cancel();  // slow requests still in flight are abandoned
+			send_next(agent, slow);
+		};
+		rit->reset(new http::Request(*agent, std::move(req),
+		    [on_done](http::ResponseData &&response) { on_done(response.r.status == 200); },
+		    [on_done](std::string) { on_done(false); }));
+	};
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i != slow_client_count + client_count; ++i) {
+		agents.emplace_back(new http::Agent("127.0.0.1", port, 1, pipeline));
+		for (size_t j = 0; j != pipeline; ++j)
+			send_next(agents.back().get(), i < slow_client_count);
+	}
+	run_loop.run();
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	const double seconds = double(std::max<int64_t>(ms, 1)) / 1000;
+	std::cout << "clients=" << client_count << " slow_clients=" << slow_client_count << " pipeline=" << pipeline
+	          << " max_in_flight=" << max_in_flight << " errors=" << error_count << std::endl;
+	print_latencies("fast_on_other_clients", fast_latencies_ms, seconds);
+	print_latencies("slow", slow_latencies_ms, seconds);
+	return 0;
+}
+
+struct OpStats {
+	size_t count = 0;
+	std::chrono::steady_clock::duration time{};
+	void print(const std::string &name) const {
+		const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(time).count();
+		std::cout << "stage=" << name << " ops=" << count << " seconds=" << seconds
+		          << " ops/s=" << count / std::max(seconds, 1e-9)
+		          << " avg_us=" << seconds * 1000000 / std::max<size_t>(count, 1) << std::endl;
+	}
+};
+
+int peers(common::CommandLine &cmd) {
+	const bool has_data_folder = cmd.get("--data-folder") != nullptr;
+	const size_t update_count  = get_number<size_t>(cmd, "--updates", 2000000);
+	const size_t address_count = get_number<size_t>(cmd, "--addresses", 1000000);
+	const size_t network_count = get_number<size_t>(cmd, "--networks", 4096);
+	Config config(cmd);
+	config.p2p_local_white_list_limit = get_number<size_t>(cmd, "--white-limit", 10000);
+	config.p2p_local_gray_list_limit  = get_number<size_t>(cmd, "--gray-limit", 100000);
+	config.seed_nodes.clear();
+	config.priority_nodes.clear();
+	config.exclusive_nodes.clear();
+	if (cmd.should_quit(USAGE, varcoin::app_version()))
+		return 0;
+	if (!has_data_folder) {  // Default data folder is real one, we would overwrite peer lists there
+		std::cout << "--data-folder must be specified" << std::endl;
+		return 1;
+	}
+	if (address_count == 0 || network_count == 0 || network_count > 0x5f00) {
+		std::cout << "--addresses must be positive, --networks from 1 to " << 0x5f00 << std::endl;
+		return 1;
+	}
+	boost::asio::io_service io;
+	platform::EventLoop run_loop(io);  // PeerDB commit timer needs one, but we never run it
+
+	std::mt19937_64 rng(12345);  // Same sequence on each run
+	auto random_address = [&]() {
+		const size_t index = rng() % address_count;
+		NetworkAddress addr;
+		addr.ip   = (uint32_t(0x2000 + index % network_count) << 16) | uint32_t(index / network_count % 0xfffe + 1);
+		addr.port = 8080 + uint32_t(index / network_count / 0xfffe);
+		return addr;
+	};
+	Timestamp now = 1500000000;
+
+	auto start = std::chrono::steady_clock::now();
+	std::unique_ptr<PeerDB> peer_db(new PeerDB(config));
+	OpStats open_stats;
+	open_stats.count = peer_db->get_white_size() + peer_db->get_gray_size();
+	open_stats.time  = std::chrono::steady_clock::now() - start;
+	open_stats.print("open");
+
+	OpStats handshake_stats, exchange_stats, connect_stats, peerlist_stats;
+	std::set<NetworkAddress> connected;
+	std::vector<PeerlistEntry> exchange(config.p2p_default_peers_in_handshake);
+	for (size_t i = 0; i != update_count; ++i) {
+		if (i % 1000 == 0)
+			now += 1;
+		start = std::chrono::steady_clock::now();
+		switch (i % 4) {
+		case 0: {  // Incoming connection, as in on_msg_handshake
+			const NetworkAddress addr = random_address();
+			peer_db->add_incoming_peer(addr, rng(), now);
+			peer_db->set_peer_just_seen(rng(), addr, now);
+			handshake_stats.time += std::chrono::steady_clock::now() - start;
+			handshake_stats.count += 1;
+			break;
+		}
+		case 1: {  // Peer list received in handshake or timed sync
+			for (auto &&pe : exchange) {
+				pe.adr = random_address();
+				pe.id  = rng();
+			}
+			start = std::chrono::steady_clock::now();
+			peer_db->merge_peerlist_from_p2p(exchange, now);
+			exchange_stats.time += std::chrono::steady_clock::now() - start;
+			exchange_stats.count += 1;
+			break;
+		}
+		case 2: {  // Outgoing connection attempt, succeeds, fails or peer gets banned
+			NetworkAddress addr;
+			if (peer_db->get_peer_to_connect(addr, connected, now)) {
+				if (rng() % 4 == 0)
+					peer_db->set_peer_banned(addr, "benchmark", now);
+				else if (rng() % 2 == 0)
+					peer_db->delay_connection_attempt(addr, now);
+				else {
+					peer_db->set_peer_just_seen(rng(), addr, now);
+					connected.insert(addr);
+					if (connected.size() > 64)
+						connected.erase(connected.begin());
+				}
+			}
+			connect_stats.time += std::chrono::steady_clock::now() - start;
+			connect_stats.count += 1;
+			break;
+		}
+		default:  // Peer list we send in handshake or timed sync
+			peer_db->get_peerlist_to_p2p(now, config.p2p_default_peers_in_handshake);
+			peerlist_stats.time += std::chrono::steady_clock::now() - start;
+			peerlist_stats.count += 1;
+		}
+	}
+	handshake_stats.print("handshake");
+	exchange_stats.print("peer_exchange");
+	connect_stats.print("connect_attempt");
+	peerlist_stats.print("peerlist_to_p2p");
+	start = std::chrono::steady_clock::now();
+	peer_db->save();
+	OpStats save_stats;
+	save_stats.count = peer_db->get_white_size() + peer_db->get_gray_size();
+	save_stats.time  = std::chrono::steady_clock::now() - start;
+	save_stats.print("save");
+	std::cout << "white=" << peer_db->get_white_size() << " gray=" << peer_db->get_gray_size()
+	          << " peak_rss_mb=" << platform::get_peak_memory_usage() / (1024 * 1024) << std::endl;
+	return 0;
+}
+
+int base58(common::CommandLine &cmd) {
+	const size_t address_count = get_number<size_t>(cmd, "--addresses", 200000);
+	const size_t round_count   = get_number<size_t>(cmd, "--rounds", 5);
+	Config config(cmd);
+	if (cmd.should_quit(USAGE, varcoin::app_version()))
+		return 0;
+	const Currency currency(config);
+
+	// Key generation is much slower than base58, so we combine spend and view keys from small set
+	std::vector<PublicKey> keys(std::max<size_t>(2, std::min<size_t>(1024, address_count)));
+	for (auto &&key : keys)
+		key = crypto::random_keypair().public_key;
+	std::vector<AccountPublicAddress> addresses(address_count);
+	for (size_t i = 0; i != address_count; ++i) {
+		addresses[i].spend_public_key = keys[i % keys.size()];
+		addresses[i].view_public_key  = keys[(i / keys.size() + i + 1) % keys.size()];
+	}
+	std::vector<std::string> strs;
+	std::vector<AccountPublicAddress> parsed;
+	std::vector<bool> valid;
+
+	OpStats format_stats, format_bulk_stats, parse_stats, parse_bulk_stats, parse_invalid_stats;
+	for (size_t round = 0; round != round_count; ++round) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::string> single_strs;
+		single_strs.reserve(address_count);
+		for (auto &&addr : addresses)
+			single_strs.push_back(currency.account_address_as_string(addr));
+		format_stats.time += std::chrono::steady_clock::now() - start;
+		format_stats.count += address_count;
+
+		start = std::chrono::steady_clock::now();
+		currency.account_addresses_as_strings(addresses, &strs);
+		format_bulk_stats.time += std::chrono::steady_clock::now() - start;
+		format_bulk_stats.count += address_count;
+		if (strs != single_strs) {
+			std::cout << "Bulk and single formatting differ" << std::endl;
+			return 1;
+		}
+
+		start = std::chrono::steady_clock::now();
+		size_t valid_count = 0;
+		for (auto &&str : strs) {
+			AccountPublicAddress addr;
+			valid_count += currency.parse_account_address_string(str, &addr);
+		}
+		parse_stats.time += std::chrono::steady_clock::now() - start;
+		parse_stats.count += address_count;
+
+		start = std::chrono::steady_clock::now();
+		valid_count += currency.parse_account_address_strings(strs, &parsed, &valid);
+		parse_bulk_stats.time += std::chrono::steady_clock::now() - start;
+		parse_bulk_stats.count += address_count;
+		if (valid_count != 2 * address_count || parsed != addresses) {
+			std::cout << "Parsing failed to round-trip, valid_count=" << valid_count << std::endl;
+			return 1;
+		}
+
+		for (size_t i = 0; i != strs.size(); ++i)  // Typos in deposit requests, checksum catches them
+			strs[i][(i * 7) % strs[i].size()] = strs[i][(i * 7) % strs[i].size()] == 'z' ? 'y' : 'z';
+		start = std::chrono::steady_clock::now();
+		valid_count = currency.parse_account_address_strings(strs, &parsed, &valid);
+		parse_invalid_stats.time += std::chrono::steady_clock::now() - start;
+		parse_invalid_stats.count += address_count;
+		if (valid_count != 0) {
+			std::cout << "Corrupted addresses parsed, valid_count=" << valid_count << std::endl;
+			return 1;
+		}
+	}
+	format_stats.print("format");
+	format_bulk_stats.print("format_bulk");
+	parse_stats.print("parse");
+	parse_bulk_stats.print("parse_bulk");
+	parse_invalid_stats.print("parse_invalid");
+	return 0;
+}
+
+int extra(common::CommandLine &cmd) {
+	const char *blocks_folder = cmd.get("--blocks-folder");
+	const Height from_height  = get_number<Height>(cmd, "--from-height", 1);
+	const Height block_count  = get_number<Height>(cmd, "--blocks", 100000);
+	const size_t round_count  = get_number<size_t>(cmd, "--rounds", 10);
+	if (cmd.should_quit(USAGE, varcoin::app_version()))
+		return 0;
+	if (!blocks_folder) {
+		std::cout << "--blocks-folder must be specified" << std::endl;
+		return 1;
+	}
+	LegacyBlockChainReader reader(
+	    std::string(blocks_folder) + "/blockindexes.bin", std::string(blocks_folder) + "/blocks.bin");
+	const Height to_height = std::min<Height>(reader.get_block_count(), from_height + block_count);
+	std::vector<BinaryArray> extras;  // Coinbase and ordinary transactions, as node and wallets see them
+	for (Height ha = from_height; ha < to_height; ++ha) {
+		PreparedBlock pb(reader.get_block_data_by_index(ha), nullptr);
+		extras.push_back(pb.block.header.base_transaction.extra);
+		for (auto &&tx : pb.block.transactions)
+			extras.push_back(tx.extra);
+	}
+	if (extras.empty()) {
+		std::cout << "No blocks in sample from " << blocks_folder << std::endl;
+		return 1;
+	}
+	size_t extra_bytes = 0;
+	for (auto &&ex : extras)
+		extra_bytes += ex.size();
+	std::cout << "heights=" << from_height << "-" << to_height - 1 << " extras=" << extras.size()
+	          << " avg_size=" << extra_bytes / extras.size() << std::endl;
+
+	OpStats fields_stats, public_key_stats, payment_id_stats, walk_stats;
+	size_t public_key_count = 0, payment_id_count = 0, malformed_count = 0;
+	std::vector<TransactionExtraField> fields;
+	for (size_t round = 0; round != round_count; ++round) {
+		std::vector<PublicKey> field_keys(extras.size());
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i != extras.size(); ++i) {  // As we did before TransactionExtraView
+			parse_transaction_extra(extras[i], fields);
+			for (auto &&field : fields)
+				if (field.type() == typeid(TransactionExtraPublicKey)) {
+					field_keys[i] = boost::get<TransactionExtraPublicKey>(field).public_key;
+					break;
+				}
+		}
+		fields_stats.time += std::chrono::steady_clock::now() - start;
+		fields_stats.count += extras.size();
+
+		public_key_count = 0;
+		start            = std::chrono::steady_clock::now();
+		for (size_t i = 0; i != extras.size(); ++i) {
+			const PublicKey key = get_transaction_public_key_from_extra(extras[i]);
+			if (key != field_keys[i]) {
+				std::cout << "Public key differs from parse_transaction_extra, extra index=" << i << std::endl;
+				return 1;
+			}
+			public_key_count += key != PublicKey{};
+		}
+		public_key_stats.time += std::chrono::steady_clock::now() - start;
+		public_key_stats.count += extras.size();
+
+		payment_id_count = 0;
+		start            = std::chrono::steady_clock::now();
+		for (auto &&ex : extras) {
+			Hash payment_id;
+			payment_id_count += get_payment_id_from_tx_extra(ex, payment_id);
+		}
+		payment_id_stats.time += std::chrono::steady_clock::now() - start;
+		payment_id_stats.count += extras.size();
+
+		malformed_count = 0;
+		start           = std::chrono::steady_clock::now();
+		for (auto &&ex : extras) {
+			TransactionExtraView view(ex);
+			TransactionExtraView::Field field;
+			while (view.next(&field)) {
+			}
+			malformed_count += view.is_malformed();
+		}
+		walk_stats.time += std::chrono::steady_clock::now() - start;
+		walk_stats.count += extras.size();
+	}
+	fields_stats.print("parse_fields");
+	public_key_stats.print("public_key");
+	payment_id_stats.print("payment_id");
+	walk_stats.print("view_walk");
+	std::cout << "with_public_key=" << public_key_count << " with_payment_id=" << payment_id_count
+	          << " malformed=" << malformed_count << std::endl;
+	return 0;
+}
+
+}  // anonymous namespace
+
+int main(int argc, const char *argv[]) try {
+	common::CommandLine cmd(argc, argv);
+	const auto &positional = cmd.get_positional();
+	const std::string mode = positional.empty() ? std::string() : positional.front();
+	if (mode == "replay")
+		return replay(cmd);
+	if (mode == "http_load")
+		return http_load(cmd);
+	if (mode == "peers")
+		return peers(cmd);
+	if (mode == "base58")
+		return base58(cmd);
+	if (mode == "extra")
+		return extra(cmd);
+	if (cmd.should_quit(USAGE, varcoin::app_version()))
+		return 0;
+	std::cout << "Unknown or absent mode, see benchmarks --help" << std::endl;
+	return 1;
+} catch (const std::exception &ex) {  // On Windows what() is not printed if thrown from main
+	std::cout << "Exception in main() - " << ex.what() << std::endl;
+	return 1;
+}
@@ -1,13 +1,21 @@
 // Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
 // Licensed under the GNU Lesser General Public License. See LICENSE for details.
 
+#include <set>
 #include <thread>
 #include "Core/BlockChainState.hpp"
 #include "Core/Config.hpp"
 #include "Core/Difficulty.hpp"
+#include "Core/Node.hpp"
 #include "Core/TransactionExtra.hpp"
+#include "common/Base58.hpp"
 #include "crypto/crypto.hpp"
 #include "logging/ConsoleLogger.hpp"
+#include "p2p/LevinProtocol.hpp"
+#include "p2p/PoolSketch.hpp"
+#include "p2p/VarNoteProtocolDefinitions.hpp"
+#include "platform/Network.hpp"
+#include "platform/PathTools.hpp"
 #include "seria/BinaryInputStream.hpp"
 #include "seria/BinaryOutputStream.hpp"
 #include "seria/KVBinaryInputStream.hpp"
@@ -48,9 +56,12 @@ static void fix_merge_mining_tag(BlockTemplate &block) {
 void test_blockchain(common::CommandLine &cmd) {
 	logging::ConsoleLogger logger;
 	Config config(cmd);
-	config.data_folder = "../tests";
+	config.data_folder      = "../tests";
+	config.is_testnet       = true;
+	config.is_regtest       = true;  // Difficulty 1, no need to grind nonces
+	config.regtest_skip_pow = true;
 	varcoin::BlockChain::DB::delete_db(config.data_folder + "/blockchain");
-	Currency currency(config.is_testnet);
+	Currency currency(config);
 	BlockChainState block_chain(logger, config, currency, false);
 	block_chain.test_print_structure(0);
 	AccountPublicAddress address;
@@ -72,7 +83,7 @@ void test_blockchain(common::CommandLine &cmd) {
 		templates.push_back(block);
 		difficulties.push_back(difficulty);
 		block.nonce = crypto::rand<uint32_t>();
-		while (true) {
+		while (!currency.skip_proof_of_work) {
 			crypto::Hash hash = get_block_long_hash(block, cryptoContext);
 			if (check_hash(hash, difficulty))
 				break;
@@ -93,7 +104,7 @@ void test_blockchain(common::CommandLine &cmd) {
 		BlockTemplate block   = templates.at(ha);
 		Difficulty difficulty = difficulties.at(ha);
 		block.nonce           = crypto::rand<uint32_t>();
-		while (true) {
+		while (!currency.skip_proof_of_work) {
 			crypto::Hash hash = get_block_long_hash(block, cryptoContext);
 			if (check_hash(hash, difficulty))
 				break;
@@ -115,6 +126,265 @@ void test_blockchain(common::CommandLine &cmd) {
 	}
 }
 
+// Big NOTIFY_RESPONSE_GET_OBJECTS (100 blocks, 1MB each) must encode identically via both paths and decode back
+void test_kv_blobs() {
+	NOTIFY_RESPONSE_GET_OBJECTS::request msg;
+	msg.current_blockchain_height = 100;
+	for (size_t i = 0; i != 100; ++i) {
+		RawBlockLegacy rb;
+		rb.block = BinaryArray(256 * 1024, static_cast<uint8_t>(i));
+		for (size_t j = 0; j != 3; ++j)
+			rb.transactions.push_back(BinaryArray(256 * 1024, static_cast<uint8_t>(i + j)));
+		msg.blocks.push_back(std::move(rb));
+	}
+	msg.missed_ids.push_back(crypto::rand<Hash>());
+	auto encode_start = std::chrono::steady_clock::now();
+	BinaryArray raw_msg = LevinProtocol::encode_message(NOTIFY_RESPONSE_GET_OBJECTS::ID, msg, false);
+	auto encode_ms =
+	    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - encode_start);
+	std::cout << "encoded " << raw_msg.size() << " bytes in " << encode_ms.count() << " ms" << std::endl;
+	if (raw_msg != LevinProtocol::send_message(NOTIFY_RESPONSE_GET_OBJECTS::ID, LevinProtocol::encode(msg), false))
+		throw std::runtime_error("encode_message differs from send_message");
+	NOTIFY_RESPONSE_GET_OBJECTS::request msg2;
+	seria::from_binary_key_value(
+	    msg2, BinaryArray(raw_msg.data() + LevinProtocol::HEADER_SIZE(), raw_msg.data() + raw_msg.size()));
+	if (msg2.blocks.size() != msg.blocks.size() || msg2.missed_ids != msg.missed_ids ||
+	    msg2.current_blockchain_height != msg.current_blockchain_height)
+		throw std::runtime_error("NOTIFY_RESPONSE_GET_OBJECTS round trip failed");
+	for (size_t i = 0; i != msg.blocks.size(); ++i)
+		if (msg2.blocks[i].block != msg.blocks[i].block || msg2.blocks[i].transactions != msg.blocks[i].transactions)
+			throw std::runtime_error("NOTIFY_RESPONSE_GET_OBJECTS round trip failed for block " + std::to_string(i));
+	if (common::to_hex(msg.blocks[1].block.data(), 2) != "0101" || common::to_hex(BinaryArray{0x0f, 0xa0}) != "0fa0")
+		throw std::runtime_error("to_hex failed");
+	NOTIFY_RESPONSE_GET_OBJECTS::encoded_request encoded_msg;
+	encoded_msg.current_blockchain_height = msg.current_blockchain_height;
+	encoded_msg.missed_ids                = msg.missed_ids;
+	for (auto &&rb : msg.blocks)
+		encoded_msg.blocks.push_back(std::make_shared<BinaryArray>(LevinProtocol::encode(rb)));
+	if (raw_msg != LevinProtocol::encode_message(NOTIFY_RESPONSE_GET_OBJECTS::ID, encoded_msg, false))
+		throw std::runtime_error("NOTIFY_RESPONSE_GET_OBJECTS with encoded blocks differs");
+	msg.blocks.clear();
+	encoded_msg.blocks.clear();
+	if (LevinProtocol::encode(msg) != LevinProtocol::encode(encoded_msg))
+		throw std::runtime_error("NOTIFY_RESPONSE_GET_OBJECTS with no encoded blocks differs");
+}
+
+// Pools of 1000 transactions differing by 10 on each side must reconcile via sketch of default size
+void test_pool_sketch() {
+	const uint64_t salt = crypto::rand<uint64_t>();
+	PoolSketch mine(120), theirs(120);
+	std::set<uint64_t> only_mine, only_theirs;
+	for (size_t i = 0; i != 1020; ++i) {
+		const uint64_t id = PoolSketch::short_id(crypto::rand<Hash>(), salt);
+		if (i < 1000 || i % 2 == 0)
+			mine.insert(id);
+		if (i < 1000 || i % 2 == 1)
+			theirs.insert(id);
+		if (i >= 1000)
+			(i % 2 == 0 ? only_mine : only_theirs).insert(id);
+	}
+	std::vector<uint64_t> decoded_mine, decoded_theirs;
+	if (!mine.subtract(theirs.to_binary()) || !mine.decode(&decoded_mine, &decoded_theirs))
+		throw std::runtime_error("PoolSketch failed to decode");
+	if (std::set<uint64_t>(decoded_mine.begin(), decoded_mine.end()) != only_mine ||
+	    std::set<uint64_t>(decoded_theirs.begin(), decoded_theirs.end()) != only_theirs)
+		throw std::runtime_error("PoolSketch decoded wrong difference");
+	PoolSketch garbage(PoolSketch::MIN_CELLS);
+	if (garbage.subtract(BinaryArray(PoolSketch::MIN_CELLS * PoolSketch::CELL_SIZE, 1)) &&
+	    garbage.decode(&decoded_mine, &decoded_theirs))
+		throw std::runtime_error("PoolSketch decoded garbage");
+}
+
+// Vectors of reference cryptonote implementation, blocks of every size, maximum and overflowing values
+void test_base58() {
+	const std::pair<std::string, std::string> blocks[] = {{"00", "11"}, {"39", "1z"}, {"ff", "5Q"}, {"0000", "111"},
+	    {"0039", "11z"}, {"0100", "15R"}, {"ffff", "LUv"}, {"000000", "11111"}, {"ffffff", "2UzHL"},
+	    {"ffffffff", "7YXq9G"}, {"ffffffffff", "VtB5VXc"}, {"ffffffffffff", "3CUsUpv9t"},
+	    {"ffffffffffffff", "Ahg1opVcGW"}, {"0000000000000001", "11111111112"}, {"0000000000000039", "1111111111z"},
+	    {"0000000000000040", "11111111127"}, {"ffffffffffffffff", "jpXCZedGfVQ"},
+	    {"06156013762879f7ffffffffff", "22222222222VtB5VXc"}};
+	for (auto &&b : blocks) {
+		const BinaryArray data = common::from_hex(b.first);
+		BinaryArray decoded;
+		if (common::base58::encode(data) != b.second || !common::base58::decode(b.second, &decoded) || decoded != data)
+			throw std::runtime_error("base58 vector failed for " + b.first);
+	}
+	const std::string overflows[] = {"5R", "LUw", "2UzHM", "7YXq9H", "VtB5VXd", "3CUsUpv9u", "Ahg1opVcGX",
+	    "jpXCZedGfVR", "zzzzzzzzzzz", "11111111111zzzzzzzzzzz"};
+	BinaryArray decoded;
+	for (auto &&o : overflows)
+		if (common::base58::decode(o, &decoded))
+			throw std::runtime_error("base58 decoded overflowing block " + o);
+	for (size_t size : {1, 4, 8, 12, 15, 19}) {
+		size_t data_size = 0;
+		if (common::base58::decoded_size(size, &data_size) || common::base58::decode(std::string(size, '1'), &decoded))
+			throw std::runtime_error("base58 decoded invalid length " + std::to_string(size));
+	}
+	// Same keys with bytecoin and our prefix, 69 bytes, so last block is 5 bytes (7 symbols)
+	const std::string foreign_addr =
+	    "24xTx43fFtNBUn5f6Fj1wC7y8JsbD4N1XS2s3Q8HzWxtfvERccTPX6e5ua1mf55Wm7Z4MiaWT7LPeiBxPtD8kU9V7z3kuex";
+	const std::string addr =
+	    "BGXTiT5nhbpBUn5f6Fj1wC7y8JsbD4N1XS2s3Q8HzWxtfvERccTPX6e5ua1mf55Wm7Z4MiaWT7LPeiBxPtD8kU9V7uAEWuu";
+	uint64_t foreign_tag = 0, tag = 0;
+	BinaryArray foreign_body, body;
+	if (!common::base58::decode_addr(foreign_addr, &foreign_tag, &foreign_body) || foreign_tag != 6 ||
+	    !common::base58::decode_addr(addr, &tag, &body) || tag != 61 || body != foreign_body || body.size() != 64)
+		throw std::runtime_error("base58 address vector failed to decode");
+	std::string encoded;
+	common::base58::encode_addr(tag, body.data(), body.size(), &encoded);
+	if (encoded != addr || common::base58::encode_addr(foreign_tag, body) != foreign_addr)
+		throw std::runtime_error("base58 address vector failed to encode");
+	uint8_t key_data[64];
+	if (!common::base58::decode_addr(addr, &tag, key_data, sizeof(key_data)) ||
+	    common::base58::decode_addr(addr, &tag, key_data, sizeof(key_data) - 1))
+		throw std::runtime_error("base58 decode_addr ignores body size");
+	for (size_t len = 0; len <= 2 * 8 + 1; ++len) {  // short last blocks of every size, with tag of 1 and 2 bytes
+		const BinaryArray data(len, static_cast<uint8_t>(len * 37));
+		for (uint64_t t : {uint64_t(6), uint64_t(0x1234)}) {
+			if (!common::base58::decode_addr(common::base58::encode_addr(t, data), &tag, &decoded) || tag != t ||
+			    decoded != data)
+				throw std::runtime_error("base58 address round trip failed for size " + std::to_string(len));
+		}
+	}
+	for (size_t cut : {1, 4, 8})  // last block of 1, 4, 8 symbols, address is 8 full blocks + 7 symbols
+		if (common::base58::decode_addr((addr + "1").substr(0, 88 + cut), &tag, &decoded))
+			throw std::runtime_error("base58 decoded address of invalid length " + std::to_string(88 + cut));
+	for (size_t pos = 0; pos != addr.size(); ++pos)
+		for (char bad : {'0', 'O', 'I', 'l', '+', '\0', '\x80'}) {
+			std::string broken = addr;
+			broken[pos]        = bad;
+			if (common::base58::decode_addr(broken, &tag, &decoded))
+				throw std::runtime_error("base58 decoded invalid symbol at " + std::to_string(pos));
+		}
+	BinaryArray raw;
+	if (!common::base58::decode(addr, &raw))
+		throw std::runtime_error("base58 failed to decode address as raw data");
+	for (size_t pos : {size_t(0), size_t(1), raw.size() - 5, raw.size() - 1}) {  // tag, body, checksum
+		BinaryArray broken = raw;
+		broken[pos] ^= 1;
+		if (common::base58::decode_addr(common::base58::encode(broken), &tag, &decoded))
+			throw std::runtime_error("base58 ignored checksum mismatch at " + std::to_string(pos));
+	}
+}
+
+// Fields before malformed one are reported, lookup helpers must agree with full parse on every extra
+void test_transaction_extra() {
+	const PublicKey pk     = crypto::rand<PublicKey>();
+	const Hash payment_id  = crypto::rand<Hash>();
+	const Hash merkle_root = crypto::rand<Hash>();
+	const auto with        = [](BinaryArray extra, const BinaryArray &tail) {
+		common::append(extra, tail.begin(), tail.end());
+		return extra;
+	};
+	const auto padding = [](size_t size) { return BinaryArray(size, 0); };  // size includes tag
+	BinaryArray pk_field{TransactionExtraPublicKey::tag};
+	common::append(pk_field, std::begin(pk.data), std::end(pk.data));
+	BinaryArray nonce_field{TransactionExtraNonce::tag, 1 + sizeof(Hash), TX_EXTRA_NONCE_PAYMENT_ID};
+	common::append(nonce_field, std::begin(payment_id.data), std::end(payment_id.data));
+	BinaryArray mm_field{TransactionExtraMergeMiningTag::tag, 1 + sizeof(Hash), 3};
+	common::append(mm_field, std::begin(merkle_root.data), std::end(merkle_root.data));
+	const BinaryArray root(std::begin(merkle_root.data), std::end(merkle_root.data));
+	const uint8_t mm_tag_tag = TransactionExtraMergeMiningTag::tag;
+	const struct {
+		std::string name;
+		BinaryArray extra;
+		std::vector<uint8_t> tags;
+		bool malformed;
+	} cases[] = {{"all fields", with(with(with(pk_field, nonce_field), mm_field), padding(4)), {1, 2, 3, 0}, false},
+	    {"padding max - 1", with(pk_field, padding(TX_EXTRA_PADDING_MAX_COUNT - 1)), {1, 0}, false},
+	    {"padding max", with(pk_field, padding(TX_EXTRA_PADDING_MAX_COUNT)), {1, 0}, false},
+	    {"padding max + 1", with(pk_field, padding(TX_EXTRA_PADDING_MAX_COUNT + 1)), {1}, true},
+	    {"non-zero padding", with(pk_field, BinaryArray{0, 0, 1}), {1}, true},
+	    {"truncated public key", with(nonce_field, BinaryArray(pk_field.begin(), pk_field.end() - 1)), {2}, true},
+	    {"nonce size over remaining (block 558479)",
+	        with(pk_field, BinaryArray{TransactionExtraNonce::tag, 4, 1, 2, 3}), {1}, true},
+	    {"nonce without size", with(pk_field, BinaryArray{TransactionExtraNonce::tag}), {1}, true},
+	    {"mm tag size overflow",
+	        with(pk_field, BinaryArray{mm_tag_tag, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x02}), {1},
+	        true},
+	    {"mm tag size non-canonical", with(with(pk_field, BinaryArray{mm_tag_tag, 0xa1, 0x00, 3}), root), {1}, true},
+	    {"mm tag size over remaining", with(with(pk_field, BinaryArray{mm_tag_tag, 40, 3}), root), {1}, true},
+	    {"mm tag depth non-canonical",
+	        with(with(nonce_field, BinaryArray{mm_tag_tag, 2 + sizeof(Hash), 0x83, 0x00}), root), {2}, true},
+	    {"unknown tag skipped", with(BinaryArray{0xde}, pk_field), {1}, false}};
+	for (auto &&c : cases) {
+		TransactionExtraView view(c.extra);
+		TransactionExtraView::Field field;
+		std::vector<uint8_t> tags;
+		while (view.next(&field)) {
+			if (field.tag == TransactionExtraPadding::tag && field.data + field.size != c.extra.data() + c.extra.size())
+				throw std::runtime_error("TransactionExtraView wrong padding size for " + c.name);
+			tags.push_back(field.tag);
+		}
+		if (tags != c.tags || view.is_malformed() != c.malformed)
+			throw std::runtime_error("TransactionExtraView wrong fields for " + c.name);
+		std::vector<TransactionExtraField> fields;
+		if (parse_transaction_extra(c.extra, fields) == c.malformed || fields.size() != c.tags.size())
+			throw std::runtime_error("parse_transaction_extra disagrees with view for " + c.name);
+		PublicKey parsed_pk;
+		bool parsed_payment_id = false, has_nonce = false, has_mm_tag = false;
+		TransactionExtraMergeMiningTag parsed_mm_tag;
+		for (auto &&f : fields) {
+			if (f.type() == typeid(TransactionExtraPublicKey) && parsed_pk == PublicKey{})
+				parsed_pk = boost::get<TransactionExtraPublicKey>(f).public_key;
+			if (f.type() == typeid(TransactionExtraNonce) && !has_nonce) {
+				Hash pid;
+				has_nonce         = true;
+				parsed_payment_id = get_payment_id_from_transaction_extra_nonce(
+				                        boost::get<TransactionExtraNonce>(f).nonce, pid) &&
+				                    pid == payment_id;
+			}
+			if (f.type() == typeid(TransactionExtraMergeMiningTag) && !has_mm_tag) {
+				has_mm_tag    = true;
+				parsed_mm_tag = boost::get<TransactionExtraMergeMiningTag>(f);
+			}
+		}
+		Hash pid;
+		TransactionExtraMergeMiningTag mm_tag;
+		const bool found_pid    = get_payment_id_from_tx_extra(c.extra, pid);
+		const bool found_mm_tag = get_merge_mining_tag_from_extra(c.extra, mm_tag);
+		if (get_transaction_public_key_from_extra(c.extra) != parsed_pk || found_pid != parsed_payment_id ||
+		    (found_pid && pid != payment_id) || found_mm_tag != has_mm_tag ||
+		    (found_mm_tag && (mm_tag.depth != parsed_mm_tag.depth || mm_tag.merkle_root != parsed_mm_tag.merkle_root)))
+			throw std::runtime_error("lookup helpers disagree with parse_transaction_extra for " + c.name);
+		if ((parsed_pk != PublicKey{} && parsed_pk != pk) ||
+		    (has_mm_tag && (parsed_mm_tag.depth != 3 || parsed_mm_tag.merkle_root != merkle_root)))
+			throw std::runtime_error("parse_transaction_extra wrong field values for " + c.name);
+	}
+}
+
+// Errors of non json rpc endpoints must keep their HTTP status through generic dispatch
+void test_node_http() {
+	const std::string data_folder = "test_node.tmp";
+	if (!platform::create_directory_if_necessary(data_folder))
+		throw std::runtime_error("failed to create " + data_folder);
+	const std::string data_folder_arg = "--data-folder=" + data_folder;
+	const char *const argv[] = {
+	    "tests", "--testnet", data_folder_arg.c_str(), "--p2p-bind-address=127.0.0.1:0"};
+	common::CommandLine cmd(4, argv);
+	Config config(cmd);
+	config.varcoind_bind_port = 0;  // We call handlers directly
+	logging::ConsoleLogger logger(logging::ERROR);
+	Currency currency(config);
+	boost::asio::io_service io;
+	platform::EventLoop run_loop(io);
+	{
+		BlockChainState block_chain(logger, config, currency, false);
+		Node node(logger, config, block_chain);
+		http::RequestData request;
+		request.r.uri = api::varcoind::SubscribeEvents::url();
+		request.body  = "{\"tip\": ";
+		http::ResponseData response;
+		if (!node.on_api_http_request(nullptr, std::move(request), response) || response.r.status != 400 ||
+		    response.body.find("\"code\"") == std::string::npos)
+			throw std::runtime_error("malformed /events request not answered with 400, status=" +
+			                         std::to_string(response.r.status));
+	}
+	BlockChain::DB::delete_db(data_folder + "/blockchain");
+	std::remove((data_folder + "/peer_db.bin").c_str());
+	std::remove(data_folder.c_str());
+}
+
 int main(int argc, const char *argv[]) {
 	common::CommandLine cmd(argc, argv);
 
@@ -126,6 +396,16 @@ int main(int argc, const char *argv[]) {
 	test_hashes("../tests/hash");
 	std::cout << "Testing Crypto" << std::endl;
 	test_crypto("../tests/crypto/tests.txt");
+	std::cout << "Testing KV-binary blobs" << std::endl;
+	test_kv_blobs();
+	std::cout << "Testing pool sketches" << std::endl;
+	test_pool_sketch();
+	std::cout << "Testing base58" << std::endl;
+	test_base58();
+	std::cout << "Testing transaction extra" << std::endl;
+	test_transaction_extra();
+	std::cout << "Testing node HTTP dispatch" << std::endl;
+	test_node_http();
 	//	test_blockchain(cmd); TODO - make this test runnable again
 	if (cmd.should_quit(USAGE, varcoin::app_version()))
 		return 0;
@@ -28,6 +28,7 @@ Options:
   --p2p-bind-address=<ip:port>         Interface and port for P2P network protocol [default: 0.0.0.0:8080].
   --p2p-external-port=<port>           External port for P2P network protocol, if port forwarding used with NAT [default: 8080].
   --varcoind-bind-address=<ip:port>   Interface and port for varcoind RPC [default: 127.0.0.1:8081].
+  --rpc-max-in-flight=<count>          Pipelined RPC requests per connection processed before responses are sent [default: 8].
   --seed-node-address=<ip:port>        Specify list (one or more) of nodes to start connecting to.
   --priority-node-address=<ip:port>    Specify list (one or more) of nodes to connect to and attempt to keep the connection open.
   --exclusive-node-address=<ip:port>   Specify list (one or more) of nodes to connect to only. All other nodes including seed nodes will be ignored.
@@ -36,6 +37,10 @@ Options:
   --data-folder=<full-path>            Folder for blockchain, logs and peer DB [default: )" platform_DEFAULT_DATA_FOLDER_PATH_PREFIX
     R"(varcoin].
   --varcoind-authorization=<usr:pass> HTTP authorization for RPC.
+  --regtest                            Private chain with difficulty 1 and own genesis, for load tests. Implies --testnet.
+  --regtest-skip-pow                   Accept blocks without calculating proof of work.
+  --regtest-max-block-size=<bytes>     Initial block size limit and full reward zone.
+  --regtest-unlock-window=<blocks>     Coinbase unlock window [default: 0].
 )"
 #if platform_USE_SSL
     R"(  --ssl-certificate-pem-file=<file>    Full path to file containing both server SSL certificate and private key in PEM format.
@@ -56,12 +61,13 @@ int main(int argc, const char *argv[]) try {
 	if (const char *pa = cmd.get("--backup-blockchain")) // TODO - document
 		backup_blockchain = pa;
 	varcoin::Config config(cmd);
-	varcoin::Currency currency(config.is_testnet);
+	varcoin::Currency currency(config);
 
 	Height print_structure = Height(-1);
 	if (const char *pa = cmd.get("--print-structure"))
 		print_structure      = std::stoi(pa);
 	const bool print_outputs = cmd.get_bool("--print-outputs");
+	const bool test_lookups  = cmd.get_bool("--test-lookups");
 	Height test_consensus    = Height(-1);
 	if (const char *pa = cmd.get("--test-consensus"))
 		test_consensus = std::stoi(pa);
@@ -109,19 +115,31 @@ int main(int argc, const char *argv[]) try {
 	logging::LoggerManager log_manager;
 	log_manager.configure_default(config.get_data_folder("logs"), "varcoind-");
 
+	auto phase_start = std::chrono::high_resolution_clock::now();
+	auto log_phase   = [&](const char *phase) {
+		auto now      = std::chrono::high_resolution_clock::now();
+		auto phase_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - phase_start);
+		std::cout << "varcoind startup phase '" << phase << "' seconds=" << double(phase_ms.count()) / 1000
+		          << std::endl;
+		phase_start = now;
+	};
 	BlockChainState block_chain(log_manager, config, currency, false);
+	log_phase("open blockchain");
 	if (test_consensus != Height(-1))
 		block_chain.test_consensus(test_consensus);
 	if (print_structure != Height(-1))
 		block_chain.test_print_structure(print_structure);
 	if (print_outputs)
 		block_chain.test_print_outputs();
+	if (test_lookups)
+		block_chain.test_benchmark_lookups(100000);
 //	block_chain.test_undo_everything(1531961);
 
 	boost::asio::io_service io;
 	platform::EventLoop run_loop(io);
 
 	Node node(log_manager, config, block_chain);
+	log_phase("start node");
 
 	auto idea_ms =
 	    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - idea_start);
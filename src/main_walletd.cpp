@@ -33,12 +33,20 @@ Options:
   --set-password                       Read new password as a line from stdin (twice) and reencrypt wallet file.
   --export-view-only=<file>            Export view-only version of wallet file with the same password, then exit.
   --export-keys                        Export wallet keys to stdout, then exit.
+  --export-history                     Export saved transaction history to stdout, line per transaction with hash and addresses, then exit.
   --walletd-bind-address=<ip:port>     Interface and port for walletd RPC [default: 127.0.0.1:8070].
+  --rpc-max-in-flight=<count>          Pipelined RPC requests per connection processed before responses are sent [default: 8].
   --data-folder=<full-path>            Folder for wallet cache, blockchain, logs and peer DB [default: )" platform_DEFAULT_DATA_FOLDER_PATH_PREFIX
     R"(varcoin].
   --varcoind-remote-address=<ip:port> Connect to remote varcoind and suppress running built-in varcoind.
   --varcoind-authorization=<usr:pass> HTTP authorization for RCP.
+  --varcoind-connections=<count>       Connections to varcoind for concurrent commands [default: 4].
+  --varcoind-pipeline=<depth>          Commands sent on each connection before previous responses arrive [default: 2].
   --backup-wallet=<folder>             Perform hot backup of wallet file and wallet cache into specified backup data folder, then exit.
+  --regtest                            Private chain with difficulty 1 and own genesis, for load tests. Implies --testnet.
+  --regtest-skip-pow                   Accept blocks without calculating proof of work.
+  --regtest-max-block-size=<bytes>     Initial block size limit and full reward zone.
+  --regtest-unlock-window=<blocks>     Coinbase unlock window [default: 0].
 
 Options for built-in varcoind (run when no --varcoind-remote-address specified):
   --allow-local-ip                     Allow local ip add to peer list, mostly in debug purposes.
@@ -57,11 +65,12 @@ int main(int argc, const char *argv[]) try {
 	common::CommandLine cmd(argc, argv);
 	std::string wallet_file, password, new_password, export_view_only, import_keys_value, backup_wallet;
 //	const bool set_password_and_continue  = cmd.get_bool("--set-password-and-continue"); // Run normally after set password, used by GUI wallet
-	const bool set_password  = cmd.get_bool("--set-password");// || set_password_and_continue;
-	bool ask_password        = true;
-	const bool export_keys   = cmd.get_bool("--export-keys");
-	const bool create_wallet = cmd.get_bool("--create-wallet");
-	const bool import_keys   = cmd.get_bool("--import-keys");
+	const bool set_password   = cmd.get_bool("--set-password");// || set_password_and_continue;
+	bool ask_password         = true;
+	const bool export_keys    = cmd.get_bool("--export-keys");
+	const bool export_history = cmd.get_bool("--export-history");
+	const bool create_wallet  = cmd.get_bool("--create-wallet");
+	const bool import_keys    = cmd.get_bool("--import-keys");
 	if (import_keys && !create_wallet){
 		std::cout << "When importing keys, you should use --create-wallet. You cannot import into existing wallet."
 		          << std::endl;
@@ -94,7 +103,7 @@ int main(int argc, const char *argv[]) try {
 	}
 
 	varcoin::Config config(cmd);
-	varcoin::Currency currency(config.is_testnet);
+	varcoin::Currency currency(config);
 
 	if (cmd.should_quit(USAGE, varcoin::app_version()))
 		return api::WALLETD_WRONG_ARGS;
@@ -195,6 +204,16 @@ int main(int argc, const char *argv[]) try {
 			std::cout << common::to_hex(wallet->export_keys()) << std::endl;
 			return 0;
 		}
+		if (export_history) {  // Hash is zero for transactions saved before history file, they did not store it
+			wallet->for_each_history([&](const Hash &tid, const Wallet::History &used_addresses) {
+				std::cout << common::pod_to_hex(tid);
+				for (auto &&address : used_addresses)
+					std::cout << " " << currency.account_address_as_string(address);
+				std::cout << "\n";
+			});
+			std::cout << std::flush;
+			return 0;
+		}
 		if (set_password){
 			wallet->set_password(new_password);
 //			if( !set_password_and_continue ){
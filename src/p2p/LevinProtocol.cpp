@@ -28,26 +28,50 @@ struct bucket_head2 {
 }
 
 BinaryArray LevinProtocol::send_message(uint32_t command, const BinaryArray &out, bool need_response) {
+	// write header and body in one operation
+	BinaryArray write_buffer;
+	write_buffer.reserve(sizeof(bucket_head2) + out.size());
+	write_buffer.resize(sizeof(bucket_head2));
+	common::append(write_buffer, out.begin(), out.end());
+
+	fill_message_header(write_buffer, command, need_response);
+	return write_buffer;
+}
+
+void LevinProtocol::fill_message_header(BinaryArray &write_buffer, uint32_t command, bool need_response) {
+	if (write_buffer.size() < sizeof(bucket_head2))
+		throw std::logic_error("LevinProtocol::fill_message_header no space for header");
 	bucket_head2 head          = {};
 	head.m_signature           = LEVIN_SIGNATURE;
-	head.m_cb                  = out.size();
+	head.m_cb                  = write_buffer.size() - sizeof(head);
 	head.m_have_to_return_data = need_response;
 	head.m_command             = command;
 	head.m_protocol_version    = LEVIN_PROTOCOL_VER_1;
 	head.m_flags               = LEVIN_PACKET_REQUEST;
 
-	// write header and body in one operation
-	BinaryArray write_buffer;
-	write_buffer.reserve(sizeof(head) + out.size());
+	memmove(write_buffer.data(), &head, sizeof(head));
+}
 
-	common::VectorOutputStream stream(write_buffer);
-	stream.write_some(&head, sizeof(head));
-	stream.write_some(out.data(), out.size());
+size_t LevinProtocol::HEADER_SIZE() { return sizeof(bucket_head2); }
 
-	return write_buffer;
+uint32_t LevinProtocol::read_message_command(const BinaryArray &message) {
+	bucket_head2 head = {};
+	if (message.size() < sizeof(head))
+		return 0;
+	memmove(&head, message.data(), sizeof(head));
+	return head.m_command;
 }
 
-size_t LevinProtocol::HEADER_SIZE() { return sizeof(bucket_head2); }
+bool LevinProtocol::read_message_command(const BinaryArray &message, Command &cmd) {
+	bucket_head2 head = {};
+	if (message.size() < sizeof(head))
+		return false;
+	memmove(&head, message.data(), sizeof(head));
+	cmd.command     = head.m_command;
+	cmd.is_notify   = !head.m_have_to_return_data;
+	cmd.is_response = (head.m_flags & LEVIN_PACKET_RESPONSE) == LEVIN_PACKET_RESPONSE;
+	return true;
+}
 
 size_t LevinProtocol::read_command_header(const BinaryArray &raw_header, Command &cmd, std::string &ban_reason) {
 	bucket_head2 head = {};
@@ -42,8 +42,21 @@ public:
 
 	static size_t HEADER_SIZE();
 	static size_t read_command_header(const BinaryArray &raw_header, Command &cmd, std::string &ban_reason);
+	static uint32_t read_message_command(const BinaryArray &message);  // of complete message, 0 if no header
+	static bool read_message_command(const BinaryArray &message, Command &cmd);  // false if no header
 
 	static BinaryArray send_message(uint32_t command, const BinaryArray &out, bool need_response);
+	// Same as send_message(command, encode(value), need_response), but body is encoded directly after header.
+	// Saves copying body, which is important for big messages like NOTIFY_RESPONSE_GET_OBJECTS
+	template<typename T>
+	static BinaryArray encode_message(uint32_t command, const T &value, bool need_response) {
+		BinaryArray write_buffer(HEADER_SIZE());  // header is filled after body size is known
+		common::VectorOutputStream stream(write_buffer);
+		seria::KVBinaryOutputStream s(stream);
+		s(const_cast<T &>(value));
+		fill_message_header(write_buffer, command, need_response);
+		return write_buffer;
+	}
 	static BinaryArray send_reply(uint32_t command, const BinaryArray &out, int32_t return_code);
 
 	template<typename T>
@@ -60,5 +73,8 @@ public:
 	static BinaryArray encode(const T &value) {
 		return seria::to_binary_key_value(value);
 	}
+
+private:
+	static void fill_message_header(BinaryArray &write_buffer, uint32_t command, bool need_response);
 };
 }
@@ -88,6 +88,13 @@ void P2PClient::send(BinaryArray &&body) {
 	write();
 }
 
+size_t P2PClient::get_send_queue_bytes() const {
+	size_t result = 0;
+	for (auto &&r : responses)
+		result += r.size();
+	return result;
+}
+
 void P2PClient::send_shutdown() {
 	waiting_shutdown = true;
 	write();
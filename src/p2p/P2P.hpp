@@ -33,6 +33,8 @@ public:
 	void send_shutdown();
 	void disconnect(const std::string &ban_reason);  // empty for no ban
 	bool test_connect(const NetworkAddress &addr);   // for single connects without p2p
+	size_t get_send_queue_messages() const { return responses.size(); }
+	size_t get_send_queue_bytes() const;  // not yet written to socket
 	virtual ~P2PClient() {}
 
 protected:
@@ -2,15 +2,71 @@
 // Licensed under the GNU Lesser General Public License. See LICENSE for details.
 
 #include "P2PClientBasic.hpp"
+#include <algorithm>
 #include <iostream>
 #include "Core/Config.hpp"
+#include "common/Metrics.hpp"
 
 const float HANDSHAKE_TIMEOUT  = 30;
 const float MESSAGE_TIMEOUT    = 60 * 6;
 const float TIMED_SYNC_TIMEOUT = 60 * 4;
+const size_t MAX_SENT_REQUESTS = 256;  // per expected response, older are forgotten, protects from silent peers
 
 using namespace varcoin;
 
+// P2P runs in the single network thread, so caches need no locking
+static void count_command_bytes(bool sent, uint32_t command, size_t bytes) {
+	static std::map<uint32_t, common::metrics::Counter *> sent_counters;
+	static std::map<uint32_t, common::metrics::Counter *> received_counters;
+	auto &counters = sent ? sent_counters : received_counters;
+	auto cit       = counters.find(command);
+	if (cit == counters.end()) {
+		auto &counter = common::metrics::counter(
+		    sent ? "varcoind_p2p_sent_bytes_total" : "varcoind_p2p_received_bytes_total",
+		    "command=\"" + std::to_string(command) + "\"");
+		cit = counters.emplace(command, &counter).first;
+	}
+	cit->second->add(bytes);
+}
+
+void PeerStats::Latency::observe_ms(uint64_t ms) {
+	size_t bucket = 0;
+	while (bucket + 1 < BUCKET_COUNT && (uint64_t(1) << bucket) < ms)
+		bucket += 1;
+	buckets[bucket] += 1;
+	count += 1;
+	sum_ms += ms;
+	max_ms = std::max(max_ms, ms);
+}
+
+uint64_t PeerStats::Latency::percentile_ms(size_t percent) const {
+	const uint64_t rank = std::max<uint64_t>(1, (count * percent + 99) / 100);
+	uint64_t seen       = 0;
+	for (size_t i = 0; i != BUCKET_COUNT && count != 0; ++i) {
+		seen += buckets[i];
+		if (seen >= rank)
+			return std::min(uint64_t(1) << i, max_ms);
+	}
+	return max_ms;
+}
+
+// Levin invokes are answered with the same command, some notifications are answered with another one
+static bool expected_response(const LevinProtocol::Command &cmd, std::pair<uint32_t, bool> *response) {
+	if (cmd.need_reply()) {
+		*response = std::make_pair(cmd.command, true);
+		return true;
+	}
+	if (cmd.command == NOTIFY_REQUEST_GET_OBJECTS::ID) {
+		*response = std::make_pair(NOTIFY_RESPONSE_GET_OBJECTS::ID, false);
+		return true;
+	}
+	if (cmd.command == NOTIFY_REQUEST_CHAIN::ID) {
+		*response = std::make_pair(NOTIFY_RESPONSE_CHAIN_ENTRY::ID, false);
+		return true;
+	}
+	return false;
+}
+
 template<typename Cmd>
 varcoin::P2PClientBasic::LevinHandlerFunction levin_method(void (varcoin::P2PClientBasic::*handler)(Cmd &&)) {
 	return [handler](P2PClientBasic *who, BinaryArray &&body) {
@@ -49,6 +105,10 @@ std::map<std::pair<uint32_t, bool>, P2PClientBasic::LevinHandlerFunction> P2PCli
         levin_method<NOTIFY_NEW_TRANSACTIONS::request>(&P2PClientBasic::on_msg_notify_new_transactions)},
     {{NOTIFY_REQUEST_TX_POOL::ID, false},
         levin_method<NOTIFY_REQUEST_TX_POOL::request>(&P2PClientBasic::on_msg_notify_request_tx_pool)},
+    {{NOTIFY_REQUEST_TX_POOL_SKETCH::ID, false},
+        levin_method<NOTIFY_REQUEST_TX_POOL_SKETCH::request>(&P2PClientBasic::on_msg_notify_request_tx_pool)},
+    {{NOTIFY_TX_POOL_SKETCH_FAILED::ID, false},
+        levin_method<NOTIFY_TX_POOL_SKETCH_FAILED::request>(&P2PClientBasic::on_msg_notify_request_tx_pool)},
     {{NOTIFY_REQUEST_CHAIN::ID, false},
         levin_method<NOTIFY_REQUEST_CHAIN::request>(&P2PClientBasic::on_msg_notify_request_chain)},
     {{NOTIFY_RESPONSE_CHAIN_ENTRY::ID, false},
@@ -79,9 +139,43 @@ void P2PClientBasic::send_timed_sync() {
 void P2PClientBasic::send(BinaryArray &&body) {
 	timed_sync_timer.once(TIMED_SYNC_TIMEOUT);
 	on_msg_bytes(0, body.size());
+	count_command_bytes(true, LevinProtocol::read_message_command(body), body.size());
+	stats_on_sent(body);
 	P2PClient::send(std::move(body));
 }
 
+void P2PClientBasic::stats_on_sent(const BinaryArray &message) {
+	LevinProtocol::Command cmd;
+	if (!LevinProtocol::read_message_command(message, cmd))
+		return;
+	auto &traffic = stats.traffic[cmd.command];
+	traffic.messages_sent += 1;
+	traffic.bytes_sent += message.size();
+	std::pair<uint32_t, bool> response;
+	if (!expected_response(cmd, &response))
+		return;
+	auto &queue = sent_requests[response];
+	queue.push_back(SentRequest{cmd.command, std::chrono::steady_clock::now()});
+	if (queue.size() > MAX_SENT_REQUESTS)
+		queue.pop_front();
+	else
+		stats.requests_waiting += 1;
+}
+
+void P2PClientBasic::stats_on_received(const LevinProtocol::Command &cmd, size_t size) {
+	auto &traffic = stats.traffic[cmd.command];
+	traffic.messages_received += 1;
+	traffic.bytes_received += size;
+	auto sit = sent_requests.find(std::make_pair(cmd.command, cmd.is_response));
+	if (sit == sent_requests.end() || sit->second.empty())
+		return;
+	const auto elapsed = std::chrono::steady_clock::now() - sit->second.front().time;
+	stats.latencies[sit->second.front().command].observe_ms(
+	    std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+	sit->second.pop_front();
+	stats.requests_waiting -= 1;
+}
+
 Timestamp P2PClientBasic::get_local_time() const { return static_cast<Timestamp>(time(nullptr)); }
 
 basic_node_data P2PClientBasic::get_node_data() const {
@@ -91,6 +185,7 @@ basic_node_data P2PClientBasic::get_node_data() const {
 	node_data.peer_id    = unique_number;
 	node_data.my_port    = config.p2p_external_port;
 	node_data.network_id = config.network_id;
+	node_data.features   = P2P_FEATURE_POOL_SKETCH;
 	return node_data;
 }
 
@@ -109,9 +204,12 @@ void P2PClientBasic::on_connect() {
 
 void P2PClientBasic::on_disconnect(const std::string &ban_reason) {
 	version                                 = 0;  // We reuse client instances between connects, so we reinit vars here
+	features                                = 0;
 	first_message_after_handshake_processed = false;
 	last_received_sync_data                 = CORE_SYNC_DATA{};
 	last_received_unique_number             = 0;
+	stats                                   = PeerStats{};
+	sent_requests.clear();
 }
 
 size_t P2PClientBasic::on_request_header(const BinaryArray &header, std::string &ban_reason) const {
@@ -137,6 +235,7 @@ void P2PClientBasic::msg_handshake(COMMAND_HANDSHAKE::request &&req) {
 	BinaryArray raw_msg = LevinProtocol::send_reply(COMMAND_HANDSHAKE::ID, LevinProtocol::encode(msg), 0);
 	send(std::move(raw_msg));
 	version                     = req.node_data.version;
+	features                    = req.node_data.features;
 	last_received_sync_data     = req.payload_data;
 	last_received_unique_number = req.node_data.peer_id;
 	std::cout << "P2p COMMAND_HANDSHAKE request version=" << int(req.node_data.version)
@@ -160,6 +259,7 @@ void P2PClientBasic::msg_handshake(COMMAND_HANDSHAKE::response &&req) {
 		return;
 	}
 	version                     = req.node_data.version;
+	features                    = req.node_data.features;
 	last_received_unique_number = req.node_data.peer_id;
 	last_received_sync_data     = req.payload_data;
 	std::cout << "P2p COMMAND_HANDSHAKE response version=" << int(req.node_data.version)
@@ -223,6 +323,8 @@ void P2PClientBasic::on_request_ready() {
 				disconnect(ban_reason);
 				return;
 			}
+			count_command_bytes(false, cmd.command, header.size() + body.size());
+			stats_on_received(cmd, header.size() + body.size());
 			if (!handshake_ok()) {
 				auto ha = before_handshake_handlers.find({cmd.command, cmd.is_response});
 				if (ha != before_handshake_handlers.end()) {
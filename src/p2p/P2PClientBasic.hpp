@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <deque>
 #include "VarNoteProtocolDefinitions.hpp"
 #include "LevinProtocol.hpp"
 #include "P2P.hpp"
@@ -12,6 +14,29 @@ namespace varcoin {
 
 class Config;
 
+// Per-connection traffic and latency, reset on disconnect. Used by get_peer_stats and by downloader to pick peers
+struct PeerStats {
+	struct Traffic {
+		uint64_t messages_received = 0;
+		uint64_t bytes_received    = 0;
+		uint64_t messages_sent     = 0;
+		uint64_t bytes_sent        = 0;
+	};
+	// Power of 2 buckets, bucket i counts latencies in (2^(i-1), 2^i] milliseconds, last one also larger
+	struct Latency {
+		enum { BUCKET_COUNT = 20 };
+		uint64_t buckets[BUCKET_COUNT] = {};
+		uint64_t count                 = 0;
+		uint64_t sum_ms                = 0;
+		uint64_t max_ms                = 0;
+		void observe_ms(uint64_t ms);
+		uint64_t percentile_ms(size_t percent) const;  // upper bound of bucket, 0 if nothing observed
+	};
+	std::map<uint32_t, Traffic> traffic;    // by Levin command
+	std::map<uint32_t, Latency> latencies;  // by request command
+	size_t requests_waiting = 0;            // sent requests with response not yet received
+};
+
 class P2PClientBasic : public P2PClient {
 public:
 	typedef std::function<void(P2PClientBasic *who, BinaryArray &&body)> LevinHandlerFunction;
@@ -20,6 +45,7 @@ private:
 	platform::Timer no_activity_timer;
 	platform::Timer timed_sync_timer;
 	int version                                  = 0;  // 0 means no handshake yet
+	uint32_t features                            = 0;  // P2PFeatures of peer
 	bool first_message_after_handshake_processed = false;
 	// we add node to peerdb after first non-handshake message received to avoid adding seed nodes
 	const uint64_t unique_number;
@@ -29,6 +55,15 @@ private:
 	static std::map<std::pair<uint32_t, bool>, LevinHandlerFunction> before_handshake_handlers;
 	static std::map<std::pair<uint32_t, bool>, LevinHandlerFunction> after_handshake_handlers;
 
+	PeerStats stats;
+	struct SentRequest {
+		uint32_t command = 0;
+		std::chrono::steady_clock::time_point time;
+	};
+	std::map<std::pair<uint32_t, bool>, std::deque<SentRequest>> sent_requests;  // by expected response
+	void stats_on_sent(const BinaryArray &message);
+	void stats_on_received(const LevinProtocol::Command &cmd, size_t size);
+
 	void send_timed_sync();
 	void msg_handshake(COMMAND_HANDSHAKE::request &&req);
 	void msg_handshake(COMMAND_HANDSHAKE::response &&req);
@@ -62,6 +97,8 @@ protected:
 	virtual void on_msg_notify_new_block(NOTIFY_NEW_BLOCK::request &&) {}
 	virtual void on_msg_notify_new_transactions(NOTIFY_NEW_TRANSACTIONS::request &&) {}
 	virtual void on_msg_notify_request_tx_pool(NOTIFY_REQUEST_TX_POOL::request &&) {}
+	virtual void on_msg_notify_request_tx_pool(NOTIFY_REQUEST_TX_POOL_SKETCH::request &&) {}
+	virtual void on_msg_notify_request_tx_pool(NOTIFY_TX_POOL_SKETCH_FAILED::request &&) {}
 	virtual void on_msg_notify_request_chain(NOTIFY_REQUEST_CHAIN::request &&) {}
 	virtual void on_msg_notify_request_chain(NOTIFY_RESPONSE_CHAIN_ENTRY::request &&) {}
 	virtual void on_msg_notify_request_objects(NOTIFY_REQUEST_GET_OBJECTS::request &&) {}
@@ -72,10 +109,12 @@ protected:
 public:
 	explicit P2PClientBasic(const Config &config, uint64_t unique_number, bool incoming, D_handler d_handler);
 	int get_version() const { return version; }
+	uint32_t get_features() const { return features; }
 	uint64_t get_unique_number() const { return unique_number; }
 	virtual void send(BinaryArray &&body) override;
 	basic_node_data get_node_data() const;
 	CORE_SYNC_DATA get_last_received_sync_data() const { return last_received_sync_data; }
 	uint64_t get_last_received_unique_number() const { return last_received_unique_number; }
+	const PeerStats &get_stats() const { return stats; }
 };
 }
@@ -22,12 +22,16 @@ struct network_config {
 
 enum P2PProtocolVersion : uint8_t { V0 = 0, V1 = 1, CURRENT = V1 };
 
+// Optional protocol extensions, advertised in handshake. Legacy nodes do not send field and ignore it
+enum P2PFeatures : uint32_t { P2P_FEATURE_POOL_SKETCH = 1 };
+
 struct basic_node_data {
 	UUID network_id;
 	uint8_t version     = 0;
 	uint64_t local_time = 0;
 	uint32_t my_port    = 0;
 	PeerIdType peer_id  = 0;
+	uint32_t features   = 0;
 };
 
 struct CORE_SYNC_DATA {
@@ -5,6 +5,7 @@
 #include "P2pProtocolDefinitions.hpp"
 #include "P2pProtocolTypes.hpp"
 #include "crypto/hash.hpp"
+#include "seria/KVBinaryOutputStream.hpp"
 
 crypto::Hash varcoin::proof_of_trust::get_hash() const {
 	std::string s;
@@ -83,6 +84,7 @@ void ser_members(varcoin::basic_node_data &v, seria::ISeria &s) {
 	seria_kv("peer_id", v.peer_id, s);
 	seria_kv("local_time", v.local_time, s);
 	seria_kv("my_port", v.my_port, s);
+	seria_kv("features", v.features, s);
 }
 
 void ser_members(varcoin::CORE_SYNC_DATA &v, seria::ISeria &s) {
@@ -167,14 +169,9 @@ void ser_members(varcoin::RawBlockLegacy &v, seria::ISeria &s) {
 		std::copy(other_block.begin(), other_block.end(), std::back_inserter(v.block));
 		std::transform(other_transactions.begin(), other_transactions.end(), std::back_inserter(v.transactions),
 		    [](const std::string &s) { return varcoin::BinaryArray(s.data(), s.data() + s.size()); });
-	} else {
-		other_block.reserve(v.block.size());
-		other_transactions.reserve(v.transactions.size());
-		std::copy(v.block.begin(), v.block.end(), std::back_inserter(other_block));
-		std::transform(v.transactions.begin(), v.transactions.end(), std::back_inserter(other_transactions),
-		    [](varcoin::BinaryArray &s) { return std::string(s.begin(), s.end()); });
-		seria::seria_kv("block", other_block, s);
-		seria::seria_kv("txs", other_transactions, s);
+	} else {  // BinaryArray and std::string have the same KV-binary representation, no need to copy
+		seria::seria_kv("block", v.block, s);
+		seria::seria_kv("txs", v.transactions, s);
 	}
 }
 
@@ -191,12 +188,8 @@ void ser_members(varcoin::NOTIFY_NEW_TRANSACTIONS::request &v, seria::ISeria &s)
 		v.txs.reserve(transactions.size());
 		std::transform(transactions.begin(), transactions.end(), std::back_inserter(v.txs),
 		    [](const std::string &s) { return varcoin::BinaryArray(s.data(), s.data() + s.size()); });
-	} else {
-		transactions.reserve(v.txs.size());
-		std::transform(v.txs.begin(), v.txs.end(), std::back_inserter(transactions),
-		    [](const varcoin::BinaryArray &s) { return std::string(s.begin(), s.end()); });
-		seria::seria_kv("txs", transactions, s);
-	}
+	} else  // BinaryArray and std::string have the same KV-binary representation, no need to copy
+		seria::seria_kv("txs", v.txs, s);
 }
 
 void ser_members(varcoin::NOTIFY_REQUEST_GET_OBJECTS::request &v, seria::ISeria &s) {
@@ -211,6 +204,22 @@ void ser_members(varcoin::NOTIFY_RESPONSE_GET_OBJECTS::request &v, seria::ISeria
 	seria_kv("current_blockchain_height", v.current_blockchain_height, s);
 }
 
+void ser_members(varcoin::NOTIFY_RESPONSE_GET_OBJECTS::encoded_request &v, seria::ISeria &s) {
+	auto kv = dynamic_cast<seria::KVBinaryOutputStream *>(&s);
+	if (!kv)
+		throw std::logic_error("NOTIFY_RESPONSE_GET_OBJECTS::encoded_request can only be written as KV-binary");
+	std::vector<std::string> txs;
+	seria_kv("txs", txs, s);
+	s.object_key("blocks");
+	size_t size = v.blocks.size();
+	s.begin_array(size);
+	for (auto &&block : v.blocks)
+		kv->seria_encoded_object(*block);
+	s.end_array();
+	serialize_as_binary(v.missed_ids, "missed_ids", s);
+	seria_kv("current_blockchain_height", v.current_blockchain_height, s);
+}
+
 void ser_members(varcoin::NOTIFY_REQUEST_CHAIN::request &v, seria::ISeria &s) {
 	serialize_as_binary(v.block_ids, "block_ids", s);
 }
@@ -224,4 +233,13 @@ void ser_members(varcoin::NOTIFY_RESPONSE_CHAIN_ENTRY::request &v, seria::ISeria
 void ser_members(varcoin::NOTIFY_REQUEST_TX_POOL::request &v, seria::ISeria &s) {
 	serialize_as_binary(v.txs, "txs", s);
 }
+
+void ser_members(varcoin::NOTIFY_REQUEST_TX_POOL_SKETCH::request &v, seria::ISeria &s) {
+	seria_kv("salt", v.salt, s);
+	seria_kv("sketch", v.sketch, s);
+}
+
+void ser_members(varcoin::NOTIFY_TX_POOL_SKETCH_FAILED::request &v, seria::ISeria &s) {
+	seria_kv("cell_count", v.cell_count, s);
+}
 }
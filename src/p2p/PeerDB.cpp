@@ -5,13 +5,17 @@
 #include "Core/Config.hpp"
 
 #include <time.h>
+#include <algorithm>
 #include <iostream>
 #include "seria/BinaryInputStream.hpp"
 #include "seria/BinaryOutputStream.hpp"
 
 #include "common/Ipv4Address.hpp"
+#include "common/StringTools.hpp"
 #include "common/string.hpp"
 #include "crypto/crypto.hpp"
+#include "platform/DB.hpp"
+#include "platform/PathTools.hpp"
 #include "seria/ISeria.hpp"
 
 using namespace varcoin;
@@ -19,346 +23,424 @@ using namespace platform;
 
 namespace seria {
 void ser_members(PeerDB::Entry &v, ISeria &s) {
+	ser_members(static_cast<PeerlistEntry &>(v), s);
+	seria_kv("ban_until", v.ban_until, s);
+	seria_kv("next_connection_attempt", v.next_connection_attempt, s);
+	seria_kv("error", v.error, s);
+}
+}
+
+namespace {
+struct LegacyEntry : public PeerDB::Entry {
+	uint64_t shuffle_random = 0;  // Only read from legacy DB, not used
+};
+struct SavedLists {
+	uint32_t version = 1;
+	std::vector<PeerDB::Entry> whitelist;
+	std::vector<PeerDB::Entry> graylist;
+};
+}
+
+namespace seria {
+void ser_members(LegacyEntry &v, ISeria &s) {
 	ser_members(static_cast<PeerlistEntry &>(v), s);
 	seria_kv("ban_until", v.ban_until, s);
 	seria_kv("shuffle_random", v.shuffle_random, s);
 	seria_kv("next_connection_attempt", v.next_connection_attempt, s);
 	seria_kv("error", v.error, s);
 }
+void ser_members(SavedLists &v, ISeria &s) {
+	seria_kv("version", v.version, s);
+	seria_kv("whitelist", v.whitelist, s);
+	seria_kv("graylist", v.graylist, s);
+}
 }
 
-static const std::string GRAY_LIST("graylist/");
-static const std::string WHITE_LIST("whitelist/");
 const Timestamp BAN_PERIOD                = 600;
 const Timestamp RECONNECT_PERIOD          = 300;
 const Timestamp PRIORITY_RECONNECT_PERIOD = 30;
 static const float DB_COMMIT_PERIOD       = 180;  // 3 minutes sounds good compromise
+static const size_t SELECT_TRIES          = 64;   // Random probes per selection, lists this small are scanned fully
+static const size_t SELECT_CANDIDATES     = 4;    // Of good candidates found, we connect to best one
+static const size_t EVICT_SAMPLES         = 4;    // Of random addresses, we evict worst one
+
+PeerDB::Entry *PeerDB::PeerList::find(const NetworkAddress &addr) {
+	auto it = m_index.find(addr);
+	return it == m_index.end() ? nullptr : &m_items[it->second].entry;
+}
+
+const PeerDB::Entry *PeerDB::PeerList::find(const NetworkAddress &addr) const {
+	auto it = m_index.find(addr);
+	return it == m_index.end() ? nullptr : &m_items[it->second].entry;
+}
+
+PeerDB::Entry *PeerDB::PeerList::insert(const Entry &entry) {
+	if (Entry *existing = find(entry.adr)) {
+		*existing = entry;
+		return existing;
+	}
+	const uint32_t prefix = entry.adr.ip >> 16;
+	auto bit              = m_bucket_index.find(prefix);
+	if (bit == m_bucket_index.end()) {
+		bit = m_bucket_index.emplace(prefix, m_buckets.size()).first;
+		m_buckets.emplace_back();
+		m_buckets.back().prefix = prefix;
+	}
+	Bucket &bucket = m_buckets[bit->second];
+	Item item;
+	item.entry      = entry;
+	item.bucket_pos = bucket.positions.size();
+	bucket.positions.push_back(m_items.size());
+	m_index[entry.adr] = m_items.size();
+	m_items.push_back(std::move(item));
+	return &m_items.back().entry;
+}
+
+bool PeerDB::PeerList::erase(const NetworkAddress &addr) {
+	auto it = m_index.find(addr);
+	if (it == m_index.end())
+		return false;
+	const size_t pos = it->second;
+	m_index.erase(it);
+	const size_t bucket_index     = m_bucket_index.at(addr.ip >> 16);
+	Bucket &bucket                = m_buckets[bucket_index];
+	const size_t bucket_pos       = m_items[pos].bucket_pos;
+	const size_t moved_pos        = bucket.positions.back();
+	bucket.positions[bucket_pos]  = moved_pos;
+	m_items[moved_pos].bucket_pos = bucket_pos;
+	bucket.positions.pop_back();
+	if (bucket.positions.empty()) {
+		m_bucket_index.erase(bucket.prefix);
+		if (bucket_index != m_buckets.size() - 1) {
+			m_buckets[bucket_index]                        = std::move(m_buckets.back());
+			m_bucket_index[m_buckets[bucket_index].prefix] = bucket_index;
+		}
+		m_buckets.pop_back();
+	}
+	const size_t last_pos = m_items.size() - 1;
+	if (pos != last_pos) {  // Move last item into the hole
+		m_items[pos]                    = std::move(m_items[last_pos]);
+		const NetworkAddress &moved_adr = m_items[pos].entry.adr;
+		Bucket &moved_bucket            = m_buckets[m_bucket_index.at(moved_adr.ip >> 16)];
+		m_index[moved_adr]              = pos;
+		moved_bucket.positions[m_items[pos].bucket_pos] = pos;
+	}
+	m_items.pop_back();
+	return true;
+}
+
+PeerDB::Entry *PeerDB::PeerList::random_entry() {
+	if (m_buckets.empty())
+		return nullptr;
+	const Bucket &bucket = m_buckets[crypto::rand<size_t>() % m_buckets.size()];
+	return &m_items[bucket.positions[crypto::rand<size_t>() % bucket.positions.size()]].entry;
+}
+
+PeerDB::Entry *PeerDB::PeerList::random_address() {
+	if (m_items.empty())
+		return nullptr;
+	return &m_items[crypto::rand<size_t>() % m_items.size()].entry;
+}
+
+void PeerDB::PeerList::clear() {
+	m_items.clear();
+	m_index.clear();
+	m_buckets.clear();
+	m_bucket_index.clear();
+}
 
 PeerDB::PeerDB(const Config &config)
     : config(config)
-    , db(false, config.get_data_folder() + "/peer_db", 1024 * 1024 * 128)
-    ,  // make sure this is enough for seed node
-    commit_timer(std::bind(&PeerDB::db_commit, this)) {
-	read_db(WHITE_LIST, whitelist);
-	read_db(GRAY_LIST, graylist);
+    , db_path(config.get_data_folder() + "/peer_db.bin")
+    , commit_timer(std::bind(&PeerDB::db_commit, this)) {
+	load();
 	for (auto &&addr : config.exclusive_nodes) {
 		Entry new_entry{};
-		new_entry.adr            = addr;
-		new_entry.shuffle_random = crypto::rand<uint64_t>();
+		new_entry.adr = addr;
 		exclusivelist.insert(new_entry);
 	}
 	for (auto &&addr : config.seed_nodes) {
-		auto &by_addr_index = whitelist.get<by_addr>();
-		auto git            = by_addr_index.find(addr);
-		if (git != by_addr_index.end())  // Already in whitelist
+		if (whitelist.find(addr))  // Already in whitelist
 			continue;
 		Entry new_entry{};
-		new_entry.adr            = addr;
-		new_entry.shuffle_random = crypto::rand<uint64_t>();
+		new_entry.adr = addr;
 		whitelist.insert(new_entry);
 	}
 	commit_timer.once(DB_COMMIT_PERIOD);
 }
 
-void PeerDB::db_commit() {
-	db.commit_db_txn();
-	commit_timer.once(DB_COMMIT_PERIOD);
-}
-
-void PeerDB::read_db(const std::string &prefix, peers_indexed &list) {
-	//	std::cout << "PeerDB known peers:" << std::endl;
-	list.clear();
-	for (auto db_cur = db.begin(prefix); !db_cur.end(); db_cur.next()) {
-		//        std::cout << db_cur.get_suffix() << std::endl;
-		try {
-			Entry peer{};
-			seria::from_binary(peer, db_cur.get_value_array());
-			//            std::cout << common::ip_address_and_port_to_string(peer.adr.ip, peer.adr.port) << std::endl;
-			list.insert(peer);
-		} catch (...) {
-			// No problem, will get everything from seed nodes
-			// TODO - log
-		}
+PeerDB::~PeerDB() {
+	try {
+		save();
+	} catch (const std::exception &) {  // Lists will be refilled from seed nodes
 	}
 }
 
-void PeerDB::update_db(const std::string &prefix, const Entry &entry) {
-	auto key = prefix + common::to_string(entry.adr.ip) + ":" + common::to_string(entry.adr.port);
-	db.put(key, seria::to_binary(entry), false);
-}
-
-void PeerDB::del_db(const std::string &prefix, const NetworkAddress &addr) {
-	auto key = prefix + common::to_string(addr.ip) + ":" + common::to_string(addr.port);
-	db.del(key, false);
+void PeerDB::db_commit() {
+	save();
+	commit_timer.once(DB_COMMIT_PERIOD);
 }
 
-void PeerDB::print() {
-	auto &by_time_index = whitelist.get<by_addr>();
-	for (auto it = by_time_index.begin(); it != by_time_index.end(); ++it) {
-		std::string a = common::ip_address_and_port_to_string(it->adr.ip, it->adr.port);
-		std::cout << a << " b=" << it->ban_until << " na=" << it->next_connection_attempt << " ls=" << it->last_seen
-		          << std::endl;
+void PeerDB::load() {
+	common::BinaryArray data;
+	if (!common::load_file(db_path, data)) {
+		import_legacy_db();  // No problem if none, will get everything from seed nodes
+		return;
+	}
+	try {
+		SavedLists lists;
+		seria::from_binary(lists, data);
+		for (auto &&entry : lists.whitelist)
+			whitelist.insert(entry);
+		for (auto &&entry : lists.graylist)
+			graylist.insert(entry);
+	} catch (const std::exception &ex) {
+		std::cout << "PeerDB ignoring corrupted " << db_path << " " << ex.what() << std::endl;
+		whitelist.clear();
+		graylist.clear();
 	}
 }
 
-void PeerDB::trim(Timestamp now) {
-	trim(GRAY_LIST, now, graylist, config.p2p_local_gray_list_limit);
-	trim(WHITE_LIST, now, whitelist, config.p2p_local_white_list_limit);
-}
-
-size_t PeerDB::get_gray_size() const {
-	auto &by_time_index = graylist.get<by_addr>();
-	return by_time_index.size();
-}
-size_t PeerDB::get_white_size() const {
-	auto &by_time_index = whitelist.get<by_addr>();
-	return by_time_index.size();
+// Before peer_db.bin, each entry was saved into DB at <data folder>/peer_db with key <list>/<ip>:<port>.
+// We import it once, then delete it, otherwise it would lie in data folder forever
+void PeerDB::import_legacy_db() {
+	const std::string legacy_path = config.get_data_folder() + "/peer_db";
+	if (!platform::directory_exists(legacy_path))
+		return;
+	size_t imported = 0;
+	try {
+		platform::DB db(false, legacy_path, 1024 * 1024 * 128);
+		for (auto db_cur = db.begin("whitelist/"); !db_cur.end(); db_cur.next()) {
+			LegacyEntry entry;
+			seria::from_binary(entry, db_cur.get_value_array());
+			whitelist.insert(entry);
+			imported += 1;
+		}
+		for (auto db_cur = db.begin("graylist/"); !db_cur.end(); db_cur.next()) {
+			LegacyEntry entry;
+			seria::from_binary(entry, db_cur.get_value_array());
+			graylist.insert(entry);
+			imported += 1;
+		}
+	} catch (const std::exception &ex) {
+		std::cout << "PeerDB ignoring corrupted " << legacy_path << " " << ex.what() << std::endl;
+		whitelist.clear();
+		graylist.clear();
+	}
+	db_dirty = true;
+	save();
+	if (db_dirty)
+		return;  // Will retry import next time
+	platform::DB::delete_db(legacy_path);
+	std::cout << "PeerDB imported " << imported << " entries from " << legacy_path << std::endl;
 }
 
-void PeerDB::trim(const std::string &prefix, Timestamp now, peers_indexed &list, size_t count) {
-	auto &by_ban_index = list.get<by_ban_until>();
-	while (by_ban_index.size() > count) {
-		auto lit = --by_ban_index.end();
-		del_db(prefix, lit->adr);
-		by_ban_index.erase(lit);
+void PeerDB::save() {
+	if (!db_dirty)
+		return;
+	SavedLists lists;
+	lists.whitelist.reserve(whitelist.size());
+	for (size_t i = 0; i != whitelist.size(); ++i)
+		lists.whitelist.push_back(whitelist.at(i));
+	lists.graylist.reserve(graylist.size());
+	for (size_t i = 0; i != graylist.size(); ++i)
+		lists.graylist.push_back(graylist.at(i));
+	const common::BinaryArray data = seria::to_binary(lists);
+	const std::string tmp_path     = db_path + ".tmp";
+	if (!common::save_file(tmp_path, data.data(), data.size()) || !platform::atomic_replace_file(tmp_path, db_path)) {
+		std::cout << "PeerDB failed to save " << db_path << std::endl;
+		return;
 	}
+	db_dirty = false;
 }
 
-void PeerDB::unban(Timestamp now) {
-	unban(GRAY_LIST, now, graylist);
-	unban(WHITE_LIST, now, whitelist);
+void PeerDB::print() {
+	for (size_t i = 0; i != whitelist.size(); ++i) {
+		const Entry &entry = whitelist.at(i);
+		std::string a      = common::ip_address_and_port_to_string(entry.adr.ip, entry.adr.port);
+		std::cout << a << " b=" << entry.ban_until << " na=" << entry.next_connection_attempt
+		          << " ls=" << entry.last_seen << std::endl;
+	}
 }
 
-void PeerDB::unban(const std::string &prefix, Timestamp now, peers_indexed &list) {
-	auto &by_time_index = list.get<by_ban_until>();
-	std::vector<Entry> unbanned;
-	auto sta = by_time_index.lower_bound(boost::make_tuple(Timestamp(1), Timestamp(0), 0));
-	auto fin = by_time_index.lower_bound(boost::make_tuple(now, Timestamp(0), 0));
-	for (auto iit = sta; iit != fin; ++iit) {
-		unbanned.push_back(*iit);
-		unbanned.back().ban_until               = 0;
-		unbanned.back().next_connection_attempt = 0;
-		update_db(prefix, unbanned.back());
+size_t PeerDB::get_gray_size() const { return graylist.size(); }
+size_t PeerDB::get_white_size() const { return whitelist.size(); }
+
+void PeerDB::trim(PeerList &list, size_t count) {
+	while (list.size() > count) {
+		const Entry *worst = nullptr;
+		for (size_t i = 0; i != EVICT_SAMPLES; ++i) {
+			const Entry *entry = list.random_address();
+			if (!worst || entry->ban_until > worst->ban_until ||
+			    (entry->ban_until == worst->ban_until && entry->last_seen < worst->last_seen))
+				worst = entry;
+		}
+		const NetworkAddress addr = worst->adr;  // erase moves entries
+		list.erase(addr);
+		db_dirty = true;
 	}
-	by_time_index.erase(sta, fin);
-	for (auto &&unb : unbanned)
-		list.insert(unb);
 }
 
 std::vector<PeerlistEntry> PeerDB::get_peerlist_to_p2p(Timestamp now, size_t depth) {
 	std::vector<PeerlistEntry> bs_head;
-	unban(now);
-	auto &by_time_index = whitelist.get<by_ban_until>();
-	auto fin            = by_time_index.lower_bound(boost::make_tuple(Timestamp(1), Timestamp(0), 0));
-	for (auto it = by_time_index.begin(); it != fin; ++it) {
-		bs_head.push_back(static_cast<PeerlistEntry>(*it));
+	std::set<NetworkAddress> added;
+	auto add = [&](const Entry &entry) {
+		if (now < entry.ban_until || !added.insert(entry.adr).second)
+			return;
+		bs_head.push_back(static_cast<PeerlistEntry>(entry));
 		bs_head.back().last_seen = 0;
-		if (bs_head.size() >= depth)
-			break;
+	};
+	if (whitelist.size() <= depth * 2) {
+		for (size_t i = 0; i != whitelist.size(); ++i)
+			add(whitelist.at(i));
+	} else {
+		for (size_t i = 0; i != depth * 4 && bs_head.size() < depth; ++i)
+			add(*whitelist.random_entry());
 	}
 	std::shuffle(bs_head.begin(), bs_head.end(), crypto::random_engine<size_t>{});
+	if (bs_head.size() > depth)
+		bs_head.resize(depth);
 	return bs_head;
 }
 
 void PeerDB::merge_peerlist_from_p2p(const std::vector<PeerlistEntry> &outer_bs, Timestamp now) {
-	unban(now);
 	for (auto &&pp : outer_bs) {
 		add_incoming_peer_impl(pp.adr, pp.id, now);
 	}
-	trim(now);
+	trim(graylist, config.p2p_local_gray_list_limit);
 }
 void PeerDB::add_incoming_peer(const NetworkAddress &addr, PeerIdType peer_id, Timestamp now) {
-	unban(now);
 	add_incoming_peer_impl(addr, peer_id, now);
-	trim(now);
+	trim(graylist, config.p2p_local_gray_list_limit);
 }
 
 void PeerDB::add_incoming_peer_impl(const NetworkAddress &addr, PeerIdType peer_id, Timestamp now) {
 	if (!is_ip_allowed(addr.ip))
 		return;
-	auto &by_addr_index = whitelist.get<by_addr>();
-	auto git            = by_addr_index.find(addr);
-	if (git != by_addr_index.end())  // Already in whitelist
-		return;
-	auto &gray_by_addr_index = graylist.get<by_addr>();
-	git                      = gray_by_addr_index.find(addr);
-	if (git != gray_by_addr_index.end())  // Already in gray list
+	if (whitelist.find(addr) || graylist.find(addr))  // Already known
 		return;
 	Entry new_entry{};
 	new_entry.adr = addr;
 	new_entry.id  = peer_id;
 	// We ignore last_seen here
-	new_entry.shuffle_random = crypto::rand<uint64_t>();
 	graylist.insert(new_entry);
-	update_db(GRAY_LIST, new_entry);
+	db_dirty = true;
 }
 
 void PeerDB::set_peer_just_seen(PeerIdType peer_id,
     const NetworkAddress &addr,
     Timestamp now,
     bool reset_next_connection_attempt) {
-	auto &exclusive_by_addr_index = exclusivelist.get<by_addr>();
-	auto git                      = exclusive_by_addr_index.find(addr);
-	if (git != exclusive_by_addr_index.end()) {
+	if (exclusivelist.find(addr))
 		return;
+	graylist.erase(addr);
+	Entry *entry = whitelist.find(addr);
+	if (!entry) {
+		Entry new_entry{};
+		new_entry.adr = addr;
+		entry         = whitelist.insert(new_entry);
 	}
-	auto &gray_by_addr_index = graylist.get<by_addr>();
-	git                      = gray_by_addr_index.find(addr);
-	if (git != gray_by_addr_index.end()) {
-		gray_by_addr_index.erase(git);
-		del_db(GRAY_LIST, addr);
-	}
-	Entry new_entry{};
-	new_entry.adr            = addr;
-	new_entry.shuffle_random = crypto::rand<uint64_t>();
-	auto &by_addr_index      = whitelist.get<by_addr>();
-	git                      = by_addr_index.find(addr);
-	if (git != by_addr_index.end()) {
-		new_entry = *git;
-		by_addr_index.erase(git);
-	}
-	new_entry.id        = peer_id;
-	new_entry.ban_until = 0;
+	entry->id        = peer_id;
+	entry->ban_until = 0;
 	// do not reconnect immediately if called inside seed node or if connecting to seed node
 	if (reset_next_connection_attempt && !is_seed(addr))
-		new_entry.next_connection_attempt = 0;
-	new_entry.last_seen                   = now;
-	whitelist.insert(new_entry);
-	update_db(WHITE_LIST, new_entry);
+		entry->next_connection_attempt = 0;
+	entry->last_seen                   = now;
+	db_dirty                           = true;
+	trim(whitelist, config.p2p_local_white_list_limit);
 }
 
 void PeerDB::delay_connection_attempt(const NetworkAddress &addr, Timestamp now) {
-	auto &white_by_addr_index = whitelist.get<by_addr>();
-	auto git                  = white_by_addr_index.find(addr);
-	if (git != white_by_addr_index.end()) {
-		Entry entry = *git;
-		white_by_addr_index.erase(git);
-		entry.next_connection_attempt = now + (!is_priority(addr) ? BAN_PERIOD : PRIORITY_RECONNECT_PERIOD);
-		whitelist.insert(entry);
-		update_db(WHITE_LIST, entry);
+	if (Entry *entry = whitelist.find(addr)) {
+		entry->next_connection_attempt = now + (!is_priority(addr) ? BAN_PERIOD : PRIORITY_RECONNECT_PERIOD);
+		db_dirty                       = true;
 	}
 }
 
 void PeerDB::set_peer_banned(const NetworkAddress &addr, const std::string &error, Timestamp now) {
-	auto &exclusive_by_addr_index = exclusivelist.get<by_addr>();
-	auto git                      = exclusive_by_addr_index.find(addr);
-	if (git != exclusive_by_addr_index.end()) {
-		Entry entry = *git;
-		exclusive_by_addr_index.erase(git);
-		entry.error                   = error;
-		entry.ban_until               = now + PRIORITY_RECONNECT_PERIOD;
-		entry.next_connection_attempt = entry.ban_until;
-		exclusive_by_addr_index.insert(entry);
+	if (Entry *entry = exclusivelist.find(addr)) {
+		entry->error                   = error;
+		entry->ban_until               = now + PRIORITY_RECONNECT_PERIOD;
+		entry->next_connection_attempt = entry->ban_until;
 		return;
 	}
-	auto &gray_by_addr_index = graylist.get<by_addr>();
-	git                      = gray_by_addr_index.find(addr);
-	if (git != gray_by_addr_index.end()) {
-		Entry entry = *git;
-		gray_by_addr_index.erase(git);
-		entry.error                   = error;
-		entry.ban_until               = now + (is_priority(addr) ? PRIORITY_RECONNECT_PERIOD : BAN_PERIOD);
-		entry.next_connection_attempt = entry.ban_until;
-		graylist.insert(entry);
-		update_db(GRAY_LIST, entry);
+	if (Entry *entry = graylist.find(addr)) {
+		entry->error                   = error;
+		entry->ban_until               = now + (is_priority(addr) ? PRIORITY_RECONNECT_PERIOD : BAN_PERIOD);
+		entry->next_connection_attempt = entry->ban_until;
+		db_dirty                       = true;
 	}
-	auto &white_by_addr_index = whitelist.get<by_addr>();
-	git                       = white_by_addr_index.find(addr);
-	if (git != white_by_addr_index.end()) {
-		Entry entry = *git;
-		white_by_addr_index.erase(git);
-		entry.error     = error;
-		entry.ban_until = now + (is_seed(addr) ? PRIORITY_RECONNECT_PERIOD
-		                                       : is_priority(addr) ? PRIORITY_RECONNECT_PERIOD : BAN_PERIOD);
-		entry.next_connection_attempt = entry.ban_until;
-		whitelist.insert(entry);
-		update_db(WHITE_LIST, entry);
+	if (Entry *entry = whitelist.find(addr)) {
+		entry->error     = error;
+		entry->ban_until = now + (is_seed(addr) ? PRIORITY_RECONNECT_PERIOD
+		                                        : is_priority(addr) ? PRIORITY_RECONNECT_PERIOD : BAN_PERIOD);
+		entry->next_connection_attempt = entry->ban_until;
+		db_dirty                       = true;
 	}
 }
 
 bool PeerDB::is_peer_banned(NetworkAddress address, Timestamp now) const {
-	auto &gray_by_addr_index = graylist.get<by_addr>();
-	auto git                 = gray_by_addr_index.find(address);
-	if (git != gray_by_addr_index.end()) {
-		if (now < git->ban_until)
+	if (const Entry *entry = graylist.find(address))
+		if (now < entry->ban_until)
 			return true;
-	}
-	auto &white_by_addr_index = whitelist.get<by_addr>();
-	git                       = white_by_addr_index.find(address);
-	if (git != white_by_addr_index.end()) {
-		if (now < git->ban_until)
+	if (const Entry *entry = whitelist.find(address))
+		if (now < entry->ban_until)
 			return true;
-	}
 	return false;
 }
 
+PeerDB::Entry *PeerDB::select_to_connect(
+    PeerList &list, const std::set<NetworkAddress> &connected, bool skip_seeds, Timestamp now) const {
+	Entry *best  = nullptr;
+	size_t found = 0;
+	auto consider = [&](Entry *entry) {
+		if (now < entry->ban_until || now < entry->next_connection_attempt || connected.count(entry->adr) != 0 ||
+		    (skip_seeds && is_seed(entry->adr)))
+			return;
+		found += 1;
+		// Never tried or tried longest ago first, then most recently seen
+		if (!best || entry->next_connection_attempt < best->next_connection_attempt ||
+		    (entry->next_connection_attempt == best->next_connection_attempt && entry->last_seen > best->last_seen))
+			best = entry;
+	};
+	if (list.size() <= SELECT_TRIES) {
+		const size_t offset = list.size() == 0 ? 0 : crypto::rand<size_t>() % list.size();
+		for (size_t i = 0; i != list.size(); ++i)
+			consider(&list.at((offset + i) % list.size()));
+	} else {
+		for (size_t i = 0; i != SELECT_TRIES && found < SELECT_CANDIDATES; ++i)
+			consider(list.random_entry());
+	}
+	return best;
+}
+
 bool PeerDB::get_peer_to_connect(NetworkAddress &best_address,
     const std::set<NetworkAddress> &connected,
     Timestamp now) {
-	auto &exclusive_by_time_index = exclusivelist.get<by_next_connection_attempt>();
-	if (!exclusive_by_time_index.empty()) {
-		auto exclusive_sta = exclusive_by_time_index.begin();
-		auto exclusive_fin = exclusive_by_time_index.lower_bound(boost::make_tuple(now, Timestamp(0), 0));
-		while (exclusive_sta != exclusive_fin && connected.count(exclusive_sta->adr) != 0)
-			++exclusive_sta;
-		if (exclusive_sta == exclusive_fin)
+	if (exclusivelist.size() != 0) {
+		Entry *entry = select_to_connect(exclusivelist, connected, false, now);
+		if (!entry)
 			return false;
-		Entry entry = *exclusive_sta;
-		exclusive_by_time_index.erase(exclusive_sta);
-		entry.next_connection_attempt = now + PRIORITY_RECONNECT_PERIOD;
-		exclusivelist.insert(entry);
-		best_address = entry.adr;
+		entry->next_connection_attempt = now + PRIORITY_RECONNECT_PERIOD;
+		best_address                   = entry->adr;
 		return true;
 	}
-	unban(now);
-	std::vector<NetworkAddress> connected_seeds;
-	std::vector<NetworkAddress> not_connected_seeds;
+	size_t connected_seeds = 0;
 	for (auto &&cc : config.seed_nodes)
-		if (connected.count(cc) == 0)
-			not_connected_seeds.push_back(cc);
-		else
-			connected_seeds.push_back(cc);
-	const bool enough_connected_seeds = connected_seeds.size() >= 2;
-	auto &white_by_time_index         = whitelist.get<by_next_connection_attempt>();
-	auto white_sta                    = white_by_time_index.begin();
-	auto white_fin                    = white_by_time_index.lower_bound(boost::make_tuple(now, Timestamp(0), 0));
-	while (white_sta != white_fin &&
-	       (connected.count(white_sta->adr) != 0 ||
-	           (enough_connected_seeds && is_seed(white_sta->adr))))  // Skip connected and seeds if enough connected
-		++white_sta;
-	auto &gray_by_time_index = graylist.get<by_next_connection_attempt>();
-	auto gray_sta            = gray_by_time_index.begin();
-	auto gray_fin            = gray_by_time_index.lower_bound(boost::make_tuple(now, Timestamp(0), 0));
-	while (gray_sta != gray_fin && (connected.count(gray_sta->adr) != 0 ||
-	                                   (enough_connected_seeds && is_seed(gray_sta->adr))))  // Skip connected and seeds
-		++gray_sta;
-	bool use_white = (crypto::rand<uint32_t>() % 100 < config.p2p_whitelist_connections_percent) &&
-	                 white_sta != white_fin && now >= white_sta->next_connection_attempt;
-	if (use_white) {
-		Entry entry = *white_sta;
-		white_by_time_index.erase(white_sta);
-		entry.next_connection_attempt = now + (is_priority(entry.adr) ? PRIORITY_RECONNECT_PERIOD : RECONNECT_PERIOD);
-		whitelist.insert(entry);
-		update_db(WHITE_LIST, entry);
-		best_address = entry.adr;
-		return true;
-	}
-	if (gray_sta != gray_fin && now >= gray_sta->next_connection_attempt) {
-		Entry entry = *gray_sta;
-		gray_by_time_index.erase(gray_sta);
-		entry.next_connection_attempt = now + (is_priority(entry.adr) ? PRIORITY_RECONNECT_PERIOD : RECONNECT_PERIOD);
-		graylist.insert(entry);
-		update_db(GRAY_LIST, entry);
-		best_address = entry.adr;
-		return true;
-	}
-	/*	if (connected_seeds.size() >= 2) // Already connected/connecting to 2 seed node
-	        return false;
-	    if (not_connected_seeds.empty())
-	        return false;
-	    size_t pos = crypto::rand<uint32_t>() % not_connected_seeds.size();
-	    best_address = not_connected_seeds[pos];*/
-	return false;
+		if (connected.count(cc) != 0)
+			connected_seeds += 1;
+	const bool enough_connected_seeds = connected_seeds >= 2;  // Skip seeds if enough connected
+	Entry *entry                      = nullptr;
+	if (crypto::rand<uint32_t>() % 100 < config.p2p_whitelist_connections_percent)
+		entry = select_to_connect(whitelist, connected, enough_connected_seeds, now);
+	if (!entry)
+		entry = select_to_connect(graylist, connected, enough_connected_seeds, now);
+	if (!entry)
+		return false;
+	entry->next_connection_attempt = now + (is_priority(entry->adr) ? PRIORITY_RECONNECT_PERIOD : RECONNECT_PERIOD);
+	db_dirty                       = true;
+	best_address                   = entry->adr;
+	return true;
 }
 
 bool PeerDB::is_priority(const NetworkAddress &addr) const {
@@ -412,5 +494,5 @@ void PeerDB::test() {
 	get_peer_to_connect(ad3, connected, 501);
 
 	list = get_peerlist_to_p2p(900, 3);
-	db_commit();
+	save();
 }
@@ -6,60 +6,32 @@
 #include <list>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include "VarNote.hpp"
 
 #include "Core/Currency.hpp"
 #include "p2p/P2pProtocolTypes.hpp"
-#include "platform/DB.hpp"
 #include "platform/Network.hpp"
 
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index_container.hpp>
-
 namespace varcoin {
 class Config;
+
+// All operations are constant time (expected), independent of list sizes. Candidates to connect and peers to
+// exchange are selected randomly, first choosing /16 network, then address in it, so that networks with lots of
+// addresses do not dominate our connections. Lists are saved to single binary file every few minutes
 class PeerDB {
 public:
-	typedef platform::DB DB;
-
 	struct Entry : public PeerlistEntry {
 		Entry()
 		    : PeerlistEntry{}  // Initialize all fields
 		{}
 		Timestamp ban_until               = 0;
 		Timestamp next_connection_attempt = 0;
-		uint64_t shuffle_random = 0;  // We assign random number to each record, for deterministic order of equal items
-		std::string error;            // last ban reason
+		std::string error;  // last ban reason
 	};
 
-	struct by_addr {};
-	struct by_ban_until {};
-	struct by_next_connection_attempt {};
-
-	typedef boost::multi_index_container<Entry,
-	    boost::multi_index::indexed_by<
-	        boost::multi_index::ordered_unique<boost::multi_index::tag<by_addr>,
-	            boost::multi_index::member<PeerlistEntry, NetworkAddress, &PeerlistEntry::adr>>,
-	        boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_ban_until>,
-	            boost::multi_index::composite_key<Entry,
-	                boost::multi_index::member<Entry, Timestamp, &Entry::ban_until>,
-	                boost::multi_index::member<PeerlistEntry, Timestamp, &PeerlistEntry::last_seen>,
-	                boost::multi_index::member<Entry, uint64_t, &Entry::shuffle_random>>,
-	            boost::multi_index::composite_key_compare<std::less<Timestamp>, std::greater<Timestamp>,
-	                std::less<uint64_t>>>,
-	        boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_next_connection_attempt>,
-	            boost::multi_index::composite_key<Entry,
-	                boost::multi_index::member<Entry, Timestamp, &Entry::next_connection_attempt>,
-	                boost::multi_index::member<PeerlistEntry, Timestamp, &PeerlistEntry::last_seen>,
-	                boost::multi_index::member<Entry, uint64_t, &Entry::shuffle_random>>,
-	            boost::multi_index::composite_key_compare<std::less<Timestamp>, std::greater<Timestamp>,
-	                std::less<uint64_t>>>>>
-	    peers_indexed;
-
 	explicit PeerDB(const Config &config);
+	~PeerDB();
 
 	void merge_peerlist_from_p2p(const std::vector<PeerlistEntry> &outer_bs, Timestamp now);
 	void add_incoming_peer(const NetworkAddress &addr, PeerIdType peer_id, Timestamp now);
@@ -80,26 +52,60 @@ public:
 	size_t get_gray_size() const;
 	size_t get_white_size() const;
 
+	void save();  // If anything changed since last save
+
 	void test();
 
 private:
+	struct AddressHash {
+		size_t operator()(const NetworkAddress &addr) const {
+			return std::hash<uint64_t>{}((uint64_t(addr.ip) << 32) | addr.port);
+		}
+	};
+	// Entries live in a vector, buckets keep positions in it, so both can be sampled uniformly
+	class PeerList {
+	public:
+		size_t size() const { return m_items.size(); }
+		Entry *find(const NetworkAddress &addr);
+		const Entry *find(const NetworkAddress &addr) const;
+		Entry *insert(const Entry &entry);  // replaces entry with the same address
+		bool erase(const NetworkAddress &addr);
+		Entry &at(size_t pos) { return m_items.at(pos).entry; }
+		Entry *random_entry();    // Uniformly chosen network, then uniformly chosen address in it
+		Entry *random_address();  // Uniformly chosen address, used for eviction
+		void clear();
+
+	private:
+		struct Item {
+			Entry entry;
+			size_t bucket_pos = 0;  // index in bucket.positions
+		};
+		struct Bucket {
+			uint32_t prefix = 0;  // ip >> 16
+			std::vector<size_t> positions;
+		};
+		std::vector<Item> m_items;
+		std::unordered_map<NetworkAddress, size_t, AddressHash> m_index;
+		std::vector<Bucket> m_buckets;  // only non-empty
+		std::unordered_map<uint32_t, size_t> m_bucket_index;
+	};
+
 	void add_incoming_peer_impl(const NetworkAddress &addr, PeerIdType peer_id, Timestamp now);
+	Entry *select_to_connect(
+	    PeerList &list, const std::set<NetworkAddress> &connected, bool skip_seeds, Timestamp now) const;
 
 	const Config &config;
-	peers_indexed exclusivelist;
-	peers_indexed whitelist;
-	peers_indexed graylist;
-	DB db;
+	PeerList exclusivelist;
+	PeerList whitelist;
+	PeerList graylist;
+	const std::string db_path;
+	bool db_dirty = false;
 	platform::Timer commit_timer;
 	void db_commit();
 
-	void read_db(const std::string &prefix, peers_indexed &list);
-	void update_db(const std::string &prefix, const Entry &entry);
-	void del_db(const std::string &prefix, const NetworkAddress &addr);
-	void trim(Timestamp now);
-	void trim(const std::string &prefix, Timestamp now, peers_indexed &list, size_t count);
-	void unban(Timestamp now);
-	void unban(const std::string &prefix, Timestamp now, peers_indexed &list);
+	void load();
+	void import_legacy_db();
+	void trim(PeerList &list, size_t count);
 	void print();
 };
 }
@@ -0,0 +1,114 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#include "PoolSketch.hpp"
+#include <algorithm>
+#include <cstring>
+#include "crypto/hash.hpp"
+
+using namespace varcoin;
+
+static uint64_t mix(uint64_t x) {  // splitmix64 finalizer
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static uint32_t check_hash(uint64_t id) { return static_cast<uint32_t>(mix(id ^ 0x5bd1e9955bd1e995ULL) >> 32); }
+
+static void write_le(uint8_t *dst, uint64_t value, size_t size) {
+	for (size_t i = 0; i != size; ++i)
+		dst[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static uint64_t read_le(const uint8_t *src, size_t size) {
+	uint64_t value = 0;
+	for (size_t i = 0; i != size; ++i)
+		value |= uint64_t(src[i]) << (8 * i);
+	return value;
+}
+
+PoolSketch::PoolSketch(size_t cell_count)
+    : m_cells((std::max<size_t>(cell_count, 1) + HASH_COUNT - 1) / HASH_COUNT * HASH_COUNT) {}
+
+uint64_t PoolSketch::short_id(const crypto::Hash &tid, uint64_t salt) {
+	uint8_t buf[8 + sizeof(tid.data)];
+	write_le(buf, salt, 8);
+	memcpy(buf + 8, tid.data, sizeof(tid.data));
+	const crypto::Hash h = crypto::cn_fast_hash(buf, sizeof(buf));
+	return read_le(h.data, 8);
+}
+
+size_t PoolSketch::cell_index(uint64_t id, size_t hash_num) const {
+	// Each hash function has its own subtable, so id never hits the same cell twice
+	const size_t subtable_size = m_cells.size() / HASH_COUNT;
+	return hash_num * subtable_size + mix(id + hash_num * 0x9e3779b97f4a7c15ULL) % subtable_size;
+}
+
+void PoolSketch::update(uint64_t id, int32_t count) {
+	const uint32_t check = check_hash(id);
+	for (size_t h = 0; h != HASH_COUNT; ++h) {
+		Cell &cell = m_cells.at(cell_index(id, h));
+		cell.count += count;
+		cell.key_sum ^= id;
+		cell.check_sum ^= check;
+	}
+}
+
+bool PoolSketch::is_pure(const Cell &cell) const {
+	return (cell.count == 1 || cell.count == -1) && cell.check_sum == check_hash(cell.key_sum);
+}
+
+common::BinaryArray PoolSketch::to_binary() const {
+	common::BinaryArray result(m_cells.size() * CELL_SIZE);
+	uint8_t *dst = result.data();
+	for (auto &&cell : m_cells) {
+		write_le(dst, static_cast<uint32_t>(cell.count), 4);
+		write_le(dst + 4, cell.key_sum, 8);
+		write_le(dst + 12, cell.check_sum, 4);
+		dst += CELL_SIZE;
+	}
+	return result;
+}
+
+bool PoolSketch::subtract(const common::BinaryArray &other) {
+	if (other.size() != m_cells.size() * CELL_SIZE)
+		return false;
+	const uint8_t *src = other.data();
+	for (auto &&cell : m_cells) {
+		cell.count -= static_cast<int32_t>(read_le(src, 4));
+		cell.key_sum ^= read_le(src + 4, 8);
+		cell.check_sum ^= static_cast<uint32_t>(read_le(src + 12, 4));
+		src += CELL_SIZE;
+	}
+	return true;
+}
+
+bool PoolSketch::decode(std::vector<uint64_t> *mine, std::vector<uint64_t> *theirs) {
+	std::vector<size_t> pure;
+	for (size_t i = 0; i != m_cells.size(); ++i)
+		if (is_pure(m_cells[i]))
+			pure.push_back(i);
+	while (!pure.empty()) {
+		const Cell cell = m_cells[pure.back()];
+		pure.pop_back();
+		if (!is_pure(cell))
+			continue;  // changed by peeling other ids after being queued
+		if (mine->size() + theirs->size() >= m_cells.size())
+			return false;  // malformed sketch can make peeling cycle forever
+		(cell.count == 1 ? mine : theirs)->push_back(cell.key_sum);
+		update(cell.key_sum, -cell.count);
+		for (size_t h = 0; h != HASH_COUNT; ++h) {
+			const size_t index = cell_index(cell.key_sum, h);
+			if (is_pure(m_cells[index]))
+				pure.push_back(index);
+		}
+	}
+	for (auto &&cell : m_cells)
+		if (!cell.empty())
+			return false;
+	return true;
+}
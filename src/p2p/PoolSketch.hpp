@@ -0,0 +1,45 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#pragma once
+
+#include <vector>
+#include "common/BinaryArray.hpp"
+#include "crypto/types.hpp"
+
+namespace varcoin {
+
+// Invertible Bloom lookup table of 64-bit short transaction ids, used to sync pools between peers.
+// Sketch size depends only on the size of the difference, not on the size of the pools. Peer subtracts sketch
+// of our pool from sketch of its pool built with the same salt and cell count, and decodes ids only one of us has.
+// Decoding succeeds with high probability while difference has less than ~cell_count/1.5 elements.
+class PoolSketch {
+public:
+	enum { HASH_COUNT = 3, CELL_SIZE = 16, MIN_CELLS = 3 * 8, MAX_CELLS = 3 * 65536 };
+
+	explicit PoolSketch(size_t cell_count);  // rounded up to multiple of HASH_COUNT
+
+	static uint64_t short_id(const crypto::Hash &tid, uint64_t salt);
+
+	void insert(uint64_t id) { update(id, 1); }
+	size_t get_cell_count() const { return m_cells.size(); }
+
+	common::BinaryArray to_binary() const;
+	bool subtract(const common::BinaryArray &other);  // false if other has different size
+	// Destroys sketch. mine are ids inserted only into this sketch, theirs only into subtracted one
+	bool decode(std::vector<uint64_t> *mine, std::vector<uint64_t> *theirs);
+
+private:
+	struct Cell {
+		int32_t count      = 0;
+		uint64_t key_sum   = 0;
+		uint32_t check_sum = 0;
+		bool empty() const { return count == 0 && key_sum == 0 && check_sum == 0; }
+	};
+	std::vector<Cell> m_cells;
+
+	size_t cell_index(uint64_t id, size_t hash_num) const;
+	void update(uint64_t id, int32_t count);
+	bool is_pure(const Cell &cell) const;
+};
+}
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include "VarNote.hpp"
 
 namespace varcoin {
@@ -48,6 +49,13 @@ struct NOTIFY_RESPONSE_GET_OBJECTS {
 		std::vector<crypto::Hash> missed_ids;
 		uint32_t current_blockchain_height = 0;  // top block height + 1
 	};
+	// Output only, same wire format as request. Blocks are RawBlockLegacy already encoded with to_binary_key_value,
+	// so blocks requested by many syncing peers are encoded once
+	struct encoded_request {
+		std::vector<std::shared_ptr<const BinaryArray>> blocks;
+		std::vector<crypto::Hash> missed_ids;
+		uint32_t current_blockchain_height = 0;
+	};
 };
 
 struct NOTIFY_REQUEST_CHAIN {
@@ -75,6 +83,24 @@ struct NOTIFY_REQUEST_TX_POOL {
 		std::vector<crypto::Hash> txs;
 	};
 };
+
+// Sent instead of NOTIFY_REQUEST_TX_POOL to peers with P2P_FEATURE_POOL_SKETCH. Peer replies with
+// NOTIFY_NEW_TRANSACTIONS containing transactions we do not have, or NOTIFY_TX_POOL_SKETCH_FAILED if difference
+// is too large for sketch, then we retry with larger sketch or fall back to NOTIFY_REQUEST_TX_POOL
+struct NOTIFY_REQUEST_TX_POOL_SKETCH {
+	enum { ID = BC_COMMANDS_POOL_BASE + 9 };
+	struct request {
+		uint64_t salt = 0;
+		BinaryArray sketch;  // PoolSketch of short ids of our pool
+	};
+};
+
+struct NOTIFY_TX_POOL_SKETCH_FAILED {
+	enum { ID = BC_COMMANDS_POOL_BASE + 10 };
+	struct request {
+		uint32_t cell_count = 0;  // of sketch which failed to decode
+	};
+};
 }
 
 namespace seria {
@@ -83,7 +109,10 @@ void ser_members(varcoin::NOTIFY_NEW_BLOCK::request &v, seria::ISeria &s);
 void ser_members(varcoin::NOTIFY_NEW_TRANSACTIONS::request &v, seria::ISeria &s);
 void ser_members(varcoin::NOTIFY_REQUEST_GET_OBJECTS::request &v, seria::ISeria &s);
 void ser_members(varcoin::NOTIFY_RESPONSE_GET_OBJECTS::request &v, seria::ISeria &s);
+void ser_members(varcoin::NOTIFY_RESPONSE_GET_OBJECTS::encoded_request &v, seria::ISeria &s);
 void ser_members(varcoin::NOTIFY_REQUEST_CHAIN::request &v, seria::ISeria &s);
 void ser_members(varcoin::NOTIFY_RESPONSE_CHAIN_ENTRY::request &v, seria::ISeria &s);
 void ser_members(varcoin::NOTIFY_REQUEST_TX_POOL::request &v, seria::ISeria &s);
+void ser_members(varcoin::NOTIFY_REQUEST_TX_POOL_SKETCH::request &v, seria::ISeria &s);
+void ser_members(varcoin::NOTIFY_TX_POOL_SKETCH_FAILED::request &v, seria::ISeria &s);
 }
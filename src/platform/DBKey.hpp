@@ -0,0 +1,82 @@
+// Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
+// Licensed under the GNU Lesser General Public License. See LICENSE for details.
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "common/Varint.hpp"
+
+namespace platform {
+
+// Fixed-capacity key builder living on stack. Hot paths (read_keyimage, read_amount_output, read_header) used
+// to build keys with std::string concatenation, costing 2-3 heap allocations per lookup.
+// Resulting bytes are identical to those produced by old concatenation code, so DB format is unchanged.
+class DBKey {
+public:
+	enum { MAX_SIZE = 256 };  // longest keys are wallet keys with address inside, ~180 bytes
+
+	DBKey() {}
+	explicit DBKey(const std::string &prefix) { append(prefix); }
+
+	DBKey &append(const void *data, size_t size) {
+		char *dst = grow(size);
+		std::char_traits<char>::copy(dst, reinterpret_cast<const char *>(data), size);
+		return *this;
+	}
+	DBKey &append(const std::string &str) { return append(str.data(), str.size()); }
+	template<class T>
+	DBKey &append_pod(const T &s) {  // same as DB::to_binary_key(s.data, sizeof(s.data))
+		static_assert(std::is_standard_layout<T>::value, "T must be Standard Layout");
+		return append(&s, sizeof(s));
+	}
+	DBKey &append_varint_sqlite4(uint64_t val) {
+		unsigned char *dst = reinterpret_cast<unsigned char *>(grow(0));
+		m_size += common::write_varint_sqlite4(dst, MAX_SIZE - m_size, val);
+		return *this;
+	}
+	DBKey &append_ascending(uint32_t val) {  // same as DB::to_ascending_key
+		static const char digits[] = "0123456789ABCDEF";
+		char *dst                  = grow(8);
+		for (size_t i = 8; i-- > 0; val >>= 4)
+			dst[i] = digits[val & 0xF];
+		return *this;
+	}
+	DBKey &append_decimal(uint64_t val) {  // same as common::to_string
+		char buf[20];
+		size_t pos = sizeof(buf);
+		do {
+			buf[--pos] = static_cast<char>('0' + val % 10);
+			val /= 10;
+		} while (val != 0);
+		return append(buf + pos, sizeof(buf) - pos);
+	}
+	DBKey &append_hex(const void *data, size_t size) {  // same as common::to_hex
+		static const char digits[] = "0123456789abcdef";
+		char *dst                  = grow(size * 2);
+		const unsigned char *src   = reinterpret_cast<const unsigned char *>(data);
+		for (size_t i = 0; i != size; ++i) {
+			dst[i * 2]     = digits[src[i] >> 4];
+			dst[i * 2 + 1] = digits[src[i] & 0xF];
+		}
+		return *this;
+	}
+
+	const char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	std::string to_string() const { return std::string(m_data, m_size); }
+
+private:
+	char *grow(size_t size) {
+		if (size > MAX_SIZE - m_size)
+			throw std::logic_error("DBKey::MAX_SIZE exceeded");
+		char *result = m_data + m_size;
+		m_size += size;
+		return result;
+	}
+	char m_data[MAX_SIZE];
+	size_t m_size = 0;
+};
+}
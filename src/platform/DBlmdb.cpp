@@ -5,6 +5,7 @@
 #include <boost/lexical_cast.hpp>
 #include <iostream>
 #include "PathTools.hpp"
+#include "common/Metrics.hpp"
 
 using namespace platform;
 
@@ -151,16 +152,25 @@ DBlmdb::Cursor DBlmdb::rbegin(const std::string &prefix, const std::string &midd
 	return Cursor(lmdb::Cur(*db_txn, *db_dbi), prefix, middle, max_key_size, false);
 }
 
+static common::metrics::Counter &db_get_counter = common::metrics::counter("varcoin_db_get_total");
+static common::metrics::Counter &db_put_counter = common::metrics::counter("varcoin_db_put_total");
+static common::metrics::Counter &db_put_bytes_counter = common::metrics::counter("varcoin_db_put_bytes_total");
+static common::metrics::Counter &db_del_counter = common::metrics::counter("varcoin_db_del_total");
+static common::metrics::Histogram &db_commit_histogram = common::metrics::histogram("varcoin_db_commit_seconds");
+
 void DBlmdb::commit_db_txn() {
+	common::metrics::ScopedTimer timer(db_commit_histogram);
 	db_txn->commit();
 	db_txn.reset();
 	db_txn.reset(new lmdb::Txn(db_env));
 }
 
-void DBlmdb::put(const std::string &key, const common::BinaryArray &value, bool nooverwrite) {
-	lmdb::Val temp_value(value.data(), value.size());
-	const int rc =
-	    ::mdb_put(db_txn->handle, db_dbi->handle, lmdb::Val(key), temp_value, nooverwrite ? MDB_NOOVERWRITE : 0);
+void DBlmdb::put(const lmdb::Val &key, const void *data, size_t size, bool nooverwrite) {
+	db_put_counter.add();
+	db_put_bytes_counter.add(key.size() + size);
+	lmdb::Val temp_value(data, size);
+	lmdb::Val temp_key = key;  // mdb_put wants non-const pointers
+	const int rc = ::mdb_put(db_txn->handle, db_dbi->handle, temp_key, temp_value, nooverwrite ? MDB_NOOVERWRITE : 0);
 	if (rc != MDB_SUCCESS && rc != MDB_KEYEXIST)
 		throw lmdb::Error("DBlmdb::put failed " + std::string(key.data(), key.size()));
 	if (nooverwrite && rc == MDB_KEYEXIST)
@@ -168,20 +178,34 @@ void DBlmdb::put(const std::string &key, const common::BinaryArray &value, bool
 		    "DBlmdb::put failed or nooverwrite key already exists " + std::string(key.data(), key.size()));
 }
 
+bool DBlmdb::get(const lmdb::Val &key, lmdb::Val &value) const {
+	db_get_counter.add();
+	lmdb::Val temp_key = key;
+	return db_dbi->get(*db_txn, temp_key, value);
+}
+
+void DBlmdb::del(const lmdb::Val &key, bool mustexist) {
+	db_del_counter.add();
+	lmdb::Val temp_key = key;
+	const int rc       = ::mdb_del(db_txn->handle, db_dbi->handle, temp_key, nullptr);
+	if (rc != MDB_SUCCESS && rc != MDB_NOTFOUND)
+		throw lmdb::Error("DBlmdb::del failed " + std::string(key.data(), key.size()));
+	if (mustexist &&
+	    rc == MDB_NOTFOUND)  // Soemtimes lmdb returns 0 for non existing keys, we have to get our own check upwards
+		throw lmdb::Error("DBlmdb::del key does not exist " + std::string(key.data(), key.size()));
+}
+
+void DBlmdb::put(const std::string &key, const common::BinaryArray &value, bool nooverwrite) {
+	put(lmdb::Val(key), value.data(), value.size(), nooverwrite);
+}
+
 void DBlmdb::put(const std::string &key, const std::string &value, bool nooverwrite) {
-	lmdb::Val temp_value(value.data(), value.size());
-	const int rc =
-	    ::mdb_put(db_txn->handle, db_dbi->handle, lmdb::Val(key), temp_value, nooverwrite ? MDB_NOOVERWRITE : 0);
-	if (rc != MDB_SUCCESS && rc != MDB_KEYEXIST)
-		throw lmdb::Error("DBlmdb::put failed " + std::string(key.data(), key.size()));
-	if (nooverwrite && rc == MDB_KEYEXIST)
-		throw lmdb::Error(
-		    "DBlmdb::put failed or nooverwrite key already exists " + std::string(key.data(), key.size()));
+	put(lmdb::Val(key), value.data(), value.size(), nooverwrite);
 }
 
 bool DBlmdb::get(const std::string &key, common::BinaryArray &value) const {
 	lmdb::Val val1;
-	if (!db_dbi->get(*db_txn, lmdb::Val(key), val1))
+	if (!get(lmdb::Val(key), val1))
 		return false;
 	value.assign(val1.data(), val1.data() + val1.size());
 	return true;
@@ -189,23 +213,44 @@ bool DBlmdb::get(const std::string &key, common::BinaryArray &value) const {
 
 bool DBlmdb::get(const std::string &key, std::string &value) const {
 	lmdb::Val val1;
-	if (!db_dbi->get(*db_txn, lmdb::Val(key), val1))
+	if (!get(lmdb::Val(key), val1))
 		return false;
 	value = std::string(val1.data(), val1.size());
 	return true;
 }
 
-bool DBlmdb::get(const std::string &key, Value &value) const { return db_dbi->get(*db_txn, lmdb::Val(key), value); }
+bool DBlmdb::get(const std::string &key, Value &value) const { return get(lmdb::Val(key), value); }
 
-void DBlmdb::del(const std::string &key, bool mustexist) {
-	const int rc = ::mdb_del(db_txn->handle, db_dbi->handle, lmdb::Val(key), nullptr);
-	if (rc != MDB_SUCCESS && rc != MDB_NOTFOUND)
-		throw lmdb::Error("DBlmdb::del failed " + std::string(key.data(), key.size()));
-	if (mustexist &&
-	    rc == MDB_NOTFOUND)  // Soemtimes lmdb returns 0 for non existing keys, we have to get our own check upwards
-		throw lmdb::Error("DBlmdb::del key does not exist " + std::string(key.data(), key.size()));
+void DBlmdb::del(const std::string &key, bool mustexist) { del(lmdb::Val(key), mustexist); }
+
+void DBlmdb::put(const Key &key, const common::BinaryArray &value, bool nooverwrite) {
+	put(lmdb::Val(key), value.data(), value.size(), nooverwrite);
+}
+
+void DBlmdb::put(const Key &key, const std::string &value, bool nooverwrite) {
+	put(lmdb::Val(key), value.data(), value.size(), nooverwrite);
+}
+
+bool DBlmdb::get(const Key &key, common::BinaryArray &value) const {
+	lmdb::Val val1;
+	if (!get(lmdb::Val(key), val1))
+		return false;
+	value.assign(val1.data(), val1.data() + val1.size());
+	return true;
+}
+
+bool DBlmdb::get(const Key &key, std::string &value) const {
+	lmdb::Val val1;
+	if (!get(lmdb::Val(key), val1))
+		return false;
+	value = std::string(val1.data(), val1.size());
+	return true;
 }
 
+bool DBlmdb::get(const Key &key, Value &value) const { return get(lmdb::Val(key), value); }
+
+void DBlmdb::del(const Key &key, bool mustexist) { del(lmdb::Val(key), mustexist); }
+
 std::string DBlmdb::to_ascending_key(uint32_t key) {
 	char buf[32] = {};
 	sprintf(buf, "%08X", key);
@@ -9,6 +9,7 @@
 #include <string>
 #include "common/BinaryArray.hpp"
 #include "common/Nocopy.hpp"
+#include "platform/DBKey.hpp"
 
 namespace platform {
 
@@ -18,6 +19,7 @@ struct Val {
 
 	Val() noexcept {}
 	explicit Val(const std::string &data) noexcept : Val{data.data(), data.size()} {}
+	explicit Val(const DBKey &data) noexcept : Val{data.data(), data.size()} {}
 	Val(const void *const data, const std::size_t size) noexcept : impl{size, const_cast<void *>(data)} {}
 	operator MDB_val *() noexcept { return &impl; }
 	operator const MDB_val *() const noexcept { return &impl; }
@@ -61,6 +63,9 @@ class DBlmdb {
 	lmdb::Env db_env;
 	std::unique_ptr<lmdb::Dbi> db_dbi;
 	std::unique_ptr<lmdb::Txn> db_txn;
+	void put(const lmdb::Val &key, const void *data, size_t size, bool nooverwrite);
+	bool get(const lmdb::Val &key, lmdb::Val &value) const;
+	void del(const lmdb::Val &key, bool mustexist);
 public:
 	explicit DBlmdb(bool read_only, const std::string &full_path,
 	    uint64_t max_db_size = 0x8000000000);  // 0.5 Tb default, out of total 4 Tb on windows
@@ -80,6 +85,14 @@ public:
 
 	void del(const std::string &key, bool mustexist);
 
+	typedef DBKey Key;  // Allocation-free versions for hot paths
+	void put(const Key &key, const common::BinaryArray &value, bool nooverwrite);
+	void put(const Key &key, const std::string &value, bool nooverwrite);
+	bool get(const Key &key, common::BinaryArray &value) const;
+	bool get(const Key &key, std::string &value) const;
+	bool get(const Key &key, Value &value) const;
+	void del(const Key &key, bool mustexist);
+
 	class Cursor {
 		lmdb::Cur db_cur;
 		std::string suffix;
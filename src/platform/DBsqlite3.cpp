@@ -5,6 +5,7 @@
 #include <boost/lexical_cast.hpp>
 #include <iostream>
 #include "PathTools.hpp"
+#include "common/Metrics.hpp"
 #include "common/string.hpp"
 
 using namespace platform;
@@ -14,6 +15,12 @@ static void sqlite_check(int rc, const char *msg) {
 		throw platform::sqlite::Error(msg + common::to_string(rc));
 }
 
+static common::metrics::Counter &db_get_counter = common::metrics::counter("varcoin_db_get_total");
+static common::metrics::Counter &db_put_counter = common::metrics::counter("varcoin_db_put_total");
+static common::metrics::Counter &db_put_bytes_counter = common::metrics::counter("varcoin_db_put_bytes_total");
+static common::metrics::Counter &db_del_counter = common::metrics::counter("varcoin_db_del_total");
+static common::metrics::Histogram &db_commit_histogram = common::metrics::histogram("varcoin_db_commit_seconds");
+
 sqlite::Dbi::~Dbi() {
 	sqlite3_close(handle);
 	handle = nullptr;
@@ -149,15 +156,17 @@ DBsqlite::Cursor DBsqlite::rbegin(const std::string &prefix, const std::string &
 }
 
 void DBsqlite::commit_db_txn() {
+	common::metrics::ScopedTimer timer(db_commit_histogram);
 	char *err_msg = nullptr;  // TODO - we leak err_msg
 	sqlite_check(sqlite3_exec(db_dbi.handle, "COMMIT TRANSACTION", 0, 0, &err_msg), err_msg);
 	sqlite_check(sqlite3_exec(db_dbi.handle, "BEGIN TRANSACTION", 0, 0, &err_msg), err_msg);
 }
 
-static void put(sqlite::Stmt &stmt, const std::string &key, const void *data, size_t size) {
+static void put(sqlite::Stmt &stmt, const char *key, size_t key_size, const void *data, size_t size) {
+	db_put_counter.add();
+	db_put_bytes_counter.add(key_size + size);
 	sqlite3_reset(stmt.handle);
-	sqlite_check(
-	    sqlite3_bind_blob(stmt.handle, 1, key.data(), static_cast<int>(key.size()), 0), "DB::put sqlite3_bind_blob 1 ");
+	sqlite_check(sqlite3_bind_blob(stmt.handle, 1, key, static_cast<int>(key_size), 0), "DB::put sqlite3_bind_blob 1 ");
 	sqlite_check(sqlite3_bind_blob(stmt.handle, 2, data, static_cast<int>(size), 0), "DB::put sqlite3_bind_blob 2 ");
 	auto rc = sqlite3_step(stmt.handle);
 	if (rc != SQLITE_DONE)
@@ -166,18 +175,28 @@ static void put(sqlite::Stmt &stmt, const std::string &key, const void *data, si
 
 void DBsqlite::put(const std::string &key, const common::BinaryArray &value, bool nooverwrite) {
 	sqlite::Stmt &stmt = nooverwrite ? stmt_insert : stmt_update;
-	::put(stmt, key, value.data(), value.size());
+	::put(stmt, key.data(), key.size(), value.data(), value.size());
 }
 
 void DBsqlite::put(const std::string &key, const std::string &value, bool nooverwrite) {
 	sqlite::Stmt &stmt = nooverwrite ? stmt_insert : stmt_update;
-	::put(stmt, key, value.data(), value.size());
+	::put(stmt, key.data(), key.size(), value.data(), value.size());
+}
+
+void DBsqlite::put(const Key &key, const common::BinaryArray &value, bool nooverwrite) {
+	sqlite::Stmt &stmt = nooverwrite ? stmt_insert : stmt_update;
+	::put(stmt, key.data(), key.size(), value.data(), value.size());
+}
+
+void DBsqlite::put(const Key &key, const std::string &value, bool nooverwrite) {
+	sqlite::Stmt &stmt = nooverwrite ? stmt_insert : stmt_update;
+	::put(stmt, key.data(), key.size(), value.data(), value.size());
 }
 
-static std::pair<const unsigned char *, size_t> get(const sqlite::Stmt &stmt, const std::string &key) {
+static std::pair<const unsigned char *, size_t> get(const sqlite::Stmt &stmt, const char *key, size_t key_size) {
+	db_get_counter.add();
 	sqlite3_reset(stmt.handle);
-	sqlite_check(
-	    sqlite3_bind_blob(stmt.handle, 1, key.data(), static_cast<int>(key.size()), 0), "DB::get sqlite3_bind_blob 1 ");
+	sqlite_check(sqlite3_bind_blob(stmt.handle, 1, key, static_cast<int>(key_size), 0), "DB::get sqlite3_bind_blob 1 ");
 	auto rc = sqlite3_step(stmt.handle);
 	if (rc == SQLITE_DONE)
 		return std::make_pair(nullptr, 0);
@@ -191,7 +210,7 @@ static std::pair<const unsigned char *, size_t> get(const sqlite::Stmt &stmt, co
 }
 
 bool DBsqlite::get(const std::string &key, common::BinaryArray &value) const {
-	auto result = ::get(stmt_get, key);
+	auto result = ::get(stmt_get, key.data(), key.size());
 	if (!result.first)
 		return false;
 	value.assign(result.first, result.first + result.second);
@@ -199,17 +218,34 @@ bool DBsqlite::get(const std::string &key, common::BinaryArray &value) const {
 }
 
 bool DBsqlite::get(const std::string &key, std::string &value) const {
-	auto result = ::get(stmt_get, key);
+	auto result = ::get(stmt_get, key.data(), key.size());
+	if (!result.first)
+		return false;
+	value.assign(result.first, result.first + result.second);
+	return true;
+}
+
+bool DBsqlite::get(const Key &key, common::BinaryArray &value) const {
+	auto result = ::get(stmt_get, key.data(), key.size());
+	if (!result.first)
+		return false;
+	value.assign(result.first, result.first + result.second);
+	return true;
+}
+
+bool DBsqlite::get(const Key &key, std::string &value) const {
+	auto result = ::get(stmt_get, key.data(), key.size());
 	if (!result.first)
 		return false;
 	value.assign(result.first, result.first + result.second);
 	return true;
 }
 
-void DBsqlite::del(const std::string &key, bool mustexist) {
+void DBsqlite::del(const char *key, size_t key_size, bool mustexist) {
+	db_del_counter.add();
 	sqlite3_reset(stmt_del.handle);
-	sqlite_check(sqlite3_bind_blob(stmt_del.handle, 1, key.data(), static_cast<int>(key.size()), 0),
-	    "DB::del sqlite3_bind_blob 1 ");
+	sqlite_check(
+	    sqlite3_bind_blob(stmt_del.handle, 1, key, static_cast<int>(key_size), 0), "DB::del sqlite3_bind_blob 1 ");
 	auto rc = sqlite3_step(stmt_del.handle);
 	if (rc != SQLITE_DONE)
 		throw platform::sqlite::Error("DB::del failed sqlite3_step in del " + common::to_string(rc));
@@ -218,6 +254,10 @@ void DBsqlite::del(const std::string &key, bool mustexist) {
 		throw platform::sqlite::Error("DB::del row does not exits");
 }
 
+void DBsqlite::del(const std::string &key, bool mustexist) { del(key.data(), key.size(), mustexist); }
+
+void DBsqlite::del(const Key &key, bool mustexist) { del(key.data(), key.size(), mustexist); }
+
 std::string DBsqlite::to_ascending_key(uint32_t key) {
 	char buf[32] = {};
 	sprintf(buf, "%08X", key);
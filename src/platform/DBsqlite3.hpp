@@ -9,6 +9,7 @@
 #include <string>
 #include "common/BinaryArray.hpp"
 #include "common/Nocopy.hpp"
+#include "platform/DBKey.hpp"
 
 namespace platform {
 
@@ -37,6 +38,7 @@ class DBsqlite {
 	sqlite::Stmt stmt_update;
 	sqlite::Stmt stmt_del;
 	sqlite::Stmt stmt_select_star;
+	void del(const char *key, size_t key_size, bool mustexist);
 
 public:
 	explicit DBsqlite(bool read_only, const std::string &full_path, uint64_t max_db_size = 0);  // no max size in sqlite3
@@ -56,6 +58,13 @@ public:
 
 	void del(const std::string &key, bool mustexist);
 
+	typedef DBKey Key;  // Allocation-free versions for hot paths
+	void put(const Key &key, const common::BinaryArray &value, bool nooverwrite);
+	void put(const Key &key, const std::string &value, bool nooverwrite);
+	bool get(const Key &key, common::BinaryArray &value) const;
+	bool get(const Key &key, std::string &value) const;
+	void del(const Key &key, bool mustexist);
+
 	class Cursor {
 		const DBsqlite *const db;
 		sqlite::Stmt stmt_get;
@@ -13,9 +13,13 @@
 #ifdef _WIN32
 #include <shlobj.h>
 #include <strsafe.h>
+#include <psapi.h>
 #include "platform/Windows.hpp"
 #pragma warning(disable : 4996)  // Deprecated GetVersionA
+#pragma comment(lib, "psapi.lib")
 #else
+#include <dirent.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
 #include <boost/algorithm/string/trim.hpp>
@@ -245,6 +249,24 @@ std::string get_os_version_string() {
 #endif  // #if !TARGET_OS_IPHONE
 #endif
 
+uint64_t get_peak_memory_usage() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return 0;
+	return pmc.PeakWorkingSetSize;
+#else
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#if defined(__MACH__)
+	return static_cast<uint64_t>(usage.ru_maxrss);  // bytes on macOS
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // kilobytes on Linux
+#endif
+#endif
+}
+
 #ifdef _WIN32
 static std::string get_special_folder_path(int nfolder, bool iscreate) {
 	wchar_t psz_path[MAX_PATH]{};
@@ -373,4 +395,36 @@ bool copy_file(const std::string &to_path, const std::string &from_path) {
 	}
 	return true;
 }
+
+std::vector<std::string> get_filenames_in_folder(const std::string &path) {
+	std::vector<std::string> result;
+#if defined(_WIN32)
+	WIN32_FIND_DATAW fd;
+	auto wpattern = FileStream::utf8_to_utf16(path + "\\*");
+	HANDLE sh     = FindFirstFileW(wpattern.c_str(), &fd);
+	if (sh == INVALID_HANDLE_VALUE)
+		return result;
+	do {
+		if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+			result.push_back(FileStream::utf16_to_utf8(fd.cFileName));
+	} while (FindNextFileW(sh, &fd) != 0);
+	FindClose(sh);
+#else
+	DIR *dir = opendir(path.c_str());
+	if (!dir)
+		return result;
+	while (struct dirent *ent = readdir(dir)) {
+		if (ent->d_type == DT_DIR)
+			continue;
+		if (ent->d_type == DT_UNKNOWN) {  // Some file systems do not report type, only then we pay for stat
+			struct stat info;
+			if (stat((path + "/" + ent->d_name).c_str(), &info) != 0 || (info.st_mode & S_IFDIR) != 0)
+				continue;
+		}
+		result.push_back(ent->d_name);
+	}
+	closedir(dir);
+#endif
+	return result;
+}
 }
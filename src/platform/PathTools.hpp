@@ -3,7 +3,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 // For documentation
 #if defined(__MACH__)
@@ -33,10 +35,12 @@ std::string get_default_data_directory(
 std::string get_app_data_folder(const std::string &app_name);
 
 std::string get_os_version_string();
+uint64_t get_peak_memory_usage();  // Peak resident set size of our process in bytes, 0 if unknown
 bool directory_exists(const std::string &path);
 bool create_directory_if_necessary(const std::string &path);    // Only last element
 bool create_directories_if_necessary(const std::string &path);  // Recursively all elements
 bool atomic_replace_file(const std::string &replacement_name, const std::string &old_file_name);
 bool copy_file(const std::string &to_path, const std::string &from_path);
+std::vector<std::string> get_filenames_in_folder(const std::string &path);  // Without subfolders, empty on error
 std::string get_filename_without_directory(const std::string &path);
 }
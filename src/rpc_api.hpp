@@ -360,6 +360,26 @@ struct GetTransaction {
 		    transaction;  // empty transaction no hash returned if this transaction contains no recognizable transfers
 	};
 };
+
+// Not JSON RPC. POST Request to url(), response is sent with Transfer-Encoding: chunked and never finishes,
+// each chunk is one Event encoded in JSON followed by '\n'. Clients reading too slowly are disconnected
+struct SubscribeEvents {
+	static std::string url() { return "/events"; }
+	struct Request {
+		std::string address;  // empty for all addresses
+		Height from_height = std::numeric_limits<uint32_t>::max();  // "blocks" event with transfers after
+		                                                            // from_height is sent first, default - from tip
+		bool pool = true;  // "pool" events
+	};
+	struct Event {
+		std::string type;  // "blocks", "undo" or "pool"
+		Height top_block_height = 0;
+		Hash top_block_hash;
+		std::vector<api::Block> blocks;  // "blocks" - new blocks with transfers we can view, in order of height
+		Height undo_from_height = 0;     // "undo" - blocks above this height were removed by reorganization
+		api::Block pool;                 // "pool" - transfers in mempool, sent in full every time they change
+	};
+};
 }
 }
 }
@@ -454,6 +474,76 @@ struct GetRandomOutputs {
 	};
 };
 
+struct GetOutputStats {
+	static std::string method() { return "get_output_stats"; }
+	struct Request {
+		std::vector<Amount> amounts;  // Empty to get all amounts present in blockchain
+	};
+	struct Response {
+		std::map<Amount, uint32_t> output_counts;  // Number of outputs, also next global index for amount
+		Height top_block_height = 0;                // Counts are for this tip
+	};
+};
+
+// Traffic and latency of connected peers, to find slow peers and heavy messages. Counters reset on reconnect.
+// Reveals peer addresses, so available only when varcoind is run with --varcoind-authorization
+struct GetPeerStats {
+	static std::string method() { return "get_peer_stats"; }
+	typedef EmptyStruct Request;
+	struct CommandStats {
+		uint32_t command           = 0;  // Levin command id
+		uint64_t messages_received = 0;
+		uint64_t bytes_received    = 0;
+		uint64_t messages_sent     = 0;
+		uint64_t bytes_sent        = 0;
+	};
+	struct LatencyStats {
+		uint32_t command = 0;  // of request, time is measured until its response is received
+		uint64_t count   = 0;
+		uint64_t avg_ms  = 0;
+		uint64_t p50_ms  = 0;  // upper bound of power of 2 bucket
+		uint64_t p99_ms  = 0;
+		uint64_t max_ms  = 0;
+		std::vector<uint64_t> histogram;  // histogram[i] counts latencies in (2^(i-1), 2^i] ms
+	};
+	struct Peer {
+		std::string address;
+		bool incoming                = false;
+		uint64_t peer_id             = 0;
+		uint32_t version             = 0;
+		Height top_block_height      = 0;  // last reported by peer
+		uint32_t downloading_blocks  = 0;
+		uint32_t requests_waiting    = 0;  // sent requests with response not yet received
+		uint32_t send_queue_messages = 0;  // not yet written to socket
+		uint64_t send_queue_bytes    = 0;
+		std::vector<CommandStats> commands;
+		std::vector<LatencyStats> latencies;
+	};
+	struct Response {
+		std::vector<Peer> peers;
+	};
+};
+
+// Not JSON RPC. POST Request to url(), response is sent with Transfer-Encoding: chunked and never finishes,
+// each chunk is one Event encoded in JSON followed by '\n'. Clients reading too slowly are disconnected
+struct SubscribeEvents {
+	static std::string url() { return "/events"; }
+	struct Request {
+		bool tip  = true;   // "tip" events
+		bool pool = false;  // "pool" events, first one contains all transactions in pool
+	};
+	struct Event {
+		std::string type;  // "tip" or "pool"
+		Height top_block_height = 0;
+		Hash top_block_hash;
+		Timestamp top_block_timestamp     = 0;  // "tip"
+		Difficulty top_block_difficulty   = 0;  // "tip"
+		uint32_t transaction_pool_version = 0;
+		std::vector<Hash> added_transactions;    // "pool"
+		std::vector<Hash> removed_transactions;  // "pool"
+	};
+};
+
 typedef walletd::SendTransaction SendTransaction;
 
 struct CheckSendProof {
@@ -572,6 +662,8 @@ void ser_members(varcoin::api::walletd::CreateSendProof::Request &v, ISeria &s);
 void ser_members(varcoin::api::walletd::CreateSendProof::Response &v, ISeria &s);
 void ser_members(varcoin::api::walletd::GetTransaction::Request &v, ISeria &s);
 void ser_members(varcoin::api::walletd::GetTransaction::Response &v, ISeria &s);
+void ser_members(varcoin::api::walletd::SubscribeEvents::Request &v, ISeria &s);
+void ser_members(varcoin::api::walletd::SubscribeEvents::Event &v, ISeria &s);
 
 void ser_members(varcoin::api::varcoind::GetStatus::Request &v, ISeria &s);
 void ser_members(varcoin::api::varcoind::GetStatus::Response &v, ISeria &s);
@@ -584,6 +676,14 @@ void ser_members(varcoin::api::varcoind::SyncMemPool::Request &v, ISeria &s);
 void ser_members(varcoin::api::varcoind::SyncMemPool::Response &v, ISeria &s);
 void ser_members(varcoin::api::varcoind::GetRandomOutputs::Request &v, ISeria &s);
 void ser_members(varcoin::api::varcoind::GetRandomOutputs::Response &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::GetOutputStats::Request &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::GetOutputStats::Response &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::GetPeerStats::CommandStats &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::GetPeerStats::LatencyStats &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::GetPeerStats::Peer &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::GetPeerStats::Response &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::SubscribeEvents::Request &v, ISeria &s);
+void ser_members(varcoin::api::varcoind::SubscribeEvents::Event &v, ISeria &s);
 void ser_members(varcoin::api::varcoind::SendTransaction::Request &v, ISeria &s);
 void ser_members(varcoin::api::varcoind::SendTransaction::Response &v, ISeria &s);
 void ser_members(varcoin::api::varcoind::CheckSendProof::Request &v, ISeria &s);
@@ -56,8 +56,7 @@ void JsonOutputStream::seria_v(double &value) { insert_or_push(JsonValue(value),
 void JsonOutputStream::seria_v(std::string &value) { insert_or_push(JsonValue(value), false); }
 
 void JsonOutputStream::seria_v(common::BinaryArray &value) {
-	std::string hex = common::to_hex(value);
-	seria_v(hex);
+	insert_or_push(JsonValue(common::to_hex(value)), false);
 }
 
 void JsonOutputStream::seria_v(uint8_t &value) { insert_or_push(JsonValue(JsonValue::Integer(value)), false); }
@@ -67,5 +66,5 @@ void JsonOutputStream::seria_v(bool &value) { insert_or_push(JsonValue(value), f
 void JsonOutputStream::binary(void *value, size_t size) {
 	std::string hex = common::to_hex(value, size);
 	bool all_zeroes = hex.find_first_not_of('0') == std::string::npos;
-	insert_or_push(all_zeroes ? std::string() : hex, false);
+	insert_or_push(JsonValue(all_zeroes ? std::string() : std::move(hex)), false);
 }
@@ -46,24 +46,25 @@ private:
 	common::JsonValue root;
 	std::vector<common::JsonValue *> chain;
 
-	common::JsonValue *insert_or_push(const common::JsonValue &value, bool optional) {
+	common::JsonValue *insert_or_push(common::JsonValue &&value, bool optional) {
+		// values are moved, so big hex strings are not copied on the way into tree
 		if (chain.empty()) {
 			if (!expecting_root)
 				throw std::logic_error("JsonOutputStream::begin_object unexpected root");
-			root           = common::JsonValue(value);
+			root           = std::move(value);
 			expecting_root = false;
 			return &root;
 		}
 		auto js = chain.back();
 		if (js->is_array()) {
-			return &js->push_back(value);
+			return &js->push_back(std::move(value));
 		}
 		if (js->is_object()) {
 			common::StringView key = next_key;
 			next_key               = common::StringView("");
 			if (optional)
 				return nullptr;
-			return &js->insert((std::string)key, value);
+			return &js->insert((std::string)key, std::move(value));
 		}
 		throw std::logic_error("JsonOutputStream::insert_or_push can only insert into object array or root");
 	}
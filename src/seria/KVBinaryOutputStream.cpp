@@ -96,18 +96,34 @@ void KVBinaryOutputStream::end_object() {
 	auto obj_stream = std::move(m_objects_stack.back());
 	m_objects_stack.pop_back();
 
-	IOutputStream &out = m_objects_stack.empty() ? m_target : stream();
-
 	if (verbose_debug)
 		std::cout << "end_object TYPE_OBJECT level.count=" << level.count << " level.name=" << (std::string)level.name
 		          << std::endl;
 
-	write_array_size(out, level.count);
-	out.write(obj_stream.buffer().data(), obj_stream.buffer().size());
+	if (m_objects_stack.empty()) {
+		m_target.reserve_write(sizeof(uint64_t) + obj_stream.size());
+		write_array_size(m_target, level.count);
+		obj_stream.copy_to(m_target);
+	} else {
+		auto &out = stream();
+		write_array_size(out, level.count);
+		out.append(std::move(obj_stream));
+	}
 	if (verbose_tokens)
 		std::cout << "OBJ c=" << level.count << std::endl;
 }
 
+void KVBinaryOutputStream::seria_encoded_object(const common::BinaryArray &encoded) {
+	if (encoded.size() <= sizeof(KVBinaryStorageBlockHeader))
+		throw std::logic_error("KVBinaryOutputStream::seria_encoded_object encoded object too short");
+	write_element_prefix(BIN_KV_SERIALIZE_TYPE_OBJECT);
+	// Root object has the same representation as nested one, except storage header
+	const size_t header_size = sizeof(KVBinaryStorageBlockHeader);
+	stream().write(encoded.data() + header_size, encoded.size() - header_size);
+	if (verbose_tokens)
+		std::cout << "OBJ encoded size=" << encoded.size() << std::endl;
+}
+
 void KVBinaryOutputStream::begin_array(size_t &size, bool fixed_size) {
 	write_element_prefix(BIN_KV_SERIALIZE_TYPE_ARRAY);
 
@@ -166,11 +182,42 @@ void KVBinaryOutputStream::write_element_prefix(uint8_t type) {
 	}
 }
 
-common::VectorStream &KVBinaryOutputStream::stream() {
+KVBinaryOutputStream::ObjectStream &KVBinaryOutputStream::stream() {
 	assert(m_objects_stack.size());
 	return m_objects_stack.back();
 }
 
+size_t KVBinaryOutputStream::ObjectStream::write_some(const void *data, size_t size) {
+	const uint8_t *begin = static_cast<const uint8_t *>(data);
+	if (m_chunks.empty() || m_chunks.back().size() >= MIN_CHUNK_SIZE || size >= MIN_CHUNK_SIZE)
+		m_chunks.emplace_back(begin, begin + size);
+	else
+		common::append(m_chunks.back(), begin, begin + size);
+	return size;
+}
+
+void KVBinaryOutputStream::ObjectStream::append(ObjectStream &&other) {
+	for (auto &&chunk : other.m_chunks) {
+		if (!m_chunks.empty() && m_chunks.back().size() < MIN_CHUNK_SIZE && chunk.size() < MIN_CHUNK_SIZE)
+			common::append(m_chunks.back(), chunk.begin(), chunk.end());
+		else
+			m_chunks.push_back(std::move(chunk));
+	}
+	other.m_chunks.clear();
+}
+
+void KVBinaryOutputStream::ObjectStream::copy_to(IOutputStream &out) const {
+	for (auto &&chunk : m_chunks)
+		out.write(chunk.data(), chunk.size());
+}
+
+size_t KVBinaryOutputStream::ObjectStream::size() const {
+	size_t result = 0;
+	for (auto &&chunk : m_chunks)
+		result += chunk.size();
+	return result;
+}
+
 void KVBinaryOutputStream::seria_v(uint8_t &value) {
 	write_element_prefix(BIN_KV_SERIALIZE_TYPE_UINT8);
 	write_pod(stream(), value);
@@ -40,10 +40,29 @@ public:
 	virtual void seria_v(common::BinaryArray &value) override;
 	virtual void binary(void *value, size_t size) override;
 
+	// Writes object previously encoded with to_binary_key_value, as array element or object value
+	void seria_encoded_object(const common::BinaryArray &encoded);
+
 private:
+	// Object body is collected until its element count is known, then spliced into parent. Large blobs (raw blocks
+	// and transactions) end up in their own chunks, which are moved, not copied, during splicing, so every blob is
+	// copied only once into target regardless of nesting depth
+	class ObjectStream : public common::IOutputStream {
+	public:
+		enum { MIN_CHUNK_SIZE = 4096 };  // smaller chunks are merged with neighbours
+
+		virtual size_t write_some(const void *data, size_t size) override;
+		void append(ObjectStream &&other);
+		void copy_to(common::IOutputStream &out) const;
+		size_t size() const;
+
+	private:
+		std::vector<common::BinaryArray> m_chunks;
+	};
+
 	void write_element_prefix(uint8_t type);
 
-	common::VectorStream &stream();
+	ObjectStream &stream();
 
 	enum class State { Root, Object, ArrayPrefix, Array };
 
@@ -63,7 +82,7 @@ private:
 
 	bool m_expecting_root = true;
 	common::StringView m_next_key;
-	std::vector<common::VectorStream> m_objects_stack;
+	std::vector<ObjectStream> m_objects_stack;
 	std::vector<Level> m_stack;
 	common::IOutputStream &m_target;
 };
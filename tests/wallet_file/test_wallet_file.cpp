@@ -1,6 +1,7 @@
 // Copyright (c) 2012-2018, The CryptoNote developers, YxomTech.
 // Licensed under the GNU Lesser General Public License. See LICENSE for details.
 
+#include <set>
 #include "Core/Wallet.hpp"
 #include "crypto/crypto.hpp"
 #include "platform/PathTools.hpp"
@@ -9,37 +10,39 @@
 
 using namespace std;
 
+// Fixtures were created by software of other currency, addresses below are their keys encoded with our prefix
+
 // test01.simplewallet.wallet
 // format - simplewallet with cache
 // no password
 // created by simplewallet from varcoin-2.1.2, several tx received and sent
-// 24xTx43fFtNBUn5f6Fj1wC7y8JsbD4N1XS2s3Q8HzWxtfvERccTPX6e5ua1mf55Wm7Z4MiaWT7LPeiBxPtD8kU9V7z3kuex
+// BGXTiT5nhbpBUn5f6Fj1wC7y8JsbD4N1XS2s3Q8HzWxtfvERccTPX6e5ua1mf55Wm7Z4MiaWT7LPeiBxPtD8kU9V7uAEWuu
 
 // test02.wallet
 // format - legacy walletd with cache (file truncated to 1000000 bytes due to git limitations)
 // no password
 // created by rpc-wallet-2.1.2, several tx received and sent
-// 25HYsSBvERcePEb7LWrECYiPw4vpeG3MWCBxB3LbNC43issv7LEDp8gat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDb8W8dk
-// 29gEx3NRgooBHLdzQUGicXBtMdAtHaaDtf6aGZjbsgJrCSFVaRCT9SYat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDZriJ8Y
-// 23acTzmNBWFSDK12QNVucEdjRjTwPmXHsPwyXaYtc1yP9FviK5e5bMiat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDaQapEx
+// BGrYdqE3g94ePEb7LWrECYiPw4vpeG3MWCBxB3LbNC43issv7LEDp8gat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDXwLZw5
+// BMFEiSQZ8XFBHLdzQUGicXBtMdAtHaaDtf6aGZjbsgJrCSFVaRCT9SYat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDYjGj6P
+// BF9cEPoVdDhSDK12QNVucEdjRjTwPmXHsPwyXaYtc1yP9FviK5e5bMiat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDdduAFG
 
 // test03.wallet
 // format - legacy walletd with cache (file truncated to 1000000 bytes due to git limitations)
 // password - test03
 // created by rpc-wallet-2.1.2, several tx received and sent
-// 21vbqHu4mDLGyo7Q959fbggLU4Z6cXMfaDpUJuHQSY9b4bRfYGbv9hF4zcz3DBpH1y4kUop2HPKPsNb9WLBYE6U16w1V12t
+// BDVbbgwCCvnGyo7Q959fbggLU4Z6cXMfaDpUJuHQSY9b4bRfYGbv9hF4zcz3DBpH1y4kUop2HPKPsNb9WLBYE6U16u5H2DU
 
 // test04.wallet
 // format - legacy walletd with cache and contacts (file truncated to 1000000 bytes due to git limitations)
 // password - test04
 // created by GUI wallet 1.1.9.3, several tx received and sent
-// 27TfAw84qKYEktQW9QvV94VkjNnRJuQ9JTrirjbQC5ASdRS233RAtENBNEZrGCSjPAFBNBReUsaQ8Jo82GTHLU4xQ28tTWU
+// BK2ewLACH2zEktQW9QvV94VkjNnRJuQ9JTrirjbQC5ASdRS233RAtENBNEZrGCSjPAFBNBReUsaQ8Jo82GTHLU4xQ2qPJmW
 
 // test05.wallet
 // format - new walletd
 // password - test05
 // created by walletd 3.0.0
-// 23ryfTTpryt8q3h5NFoMGs4BjM6jGmdQqUrtSuU4nM3oP8CKmXXwu6CcEYrwtUm2rx43LvihFEhKEfDagjQxWoLwDTX6XpC
+// BFRyRrVxJhL8q3h5NFoMGs4BjM6jGmdQqUrtSuU4nM3oP8CKmXXwu6CcEYrwtUm2rx43LvihFEhKEfDagjQxWoLwDWzTapn
 
 // test05v.wallet - view-only version of test05.wallet
 
@@ -47,9 +50,9 @@ using namespace std;
 // format - new walletd
 // no password
 // created by walletd 3.0.0
-// 27j6TP7du1SWKk4fVQa138VNhy339xa76jEBRajhHYnVeLaLs5HmSkEZ4FiLuLy87hgWYkSinGntREBMq3dvui11NkhsuUJ
-// 23kJeyCgzH6JkTJqq1NNjrhXFYrfsUYvw2a9HhiEqVtRXK86HAu3uWWZ4FiLuLy87hgWYkSinGntREBMq3dvui11NiUKftd
-// 28acio4hR2cjQPSBj8oYbjSYkFvVaPdQTH44HsigJQiSgr6S5BaAZkzZ4FiLuLy87hgWYkSinGntREBMq3dvui11Ng9YMtq
+// BKJ6Dn9mLitWKk4fVQa138VNhy339xa76jEBRajhHYnVeLaLs5HmSkEZ4FiLuLy87hgWYkSinGntREBMq3dvui11NhMqL5d
+// BFKJRNEpRzYJkTJqq1NNjrhXFYrfsUYvw2a9HhiEqVtRXK86HAu3uWWZ4FiLuLy87hgWYkSinGntREBMq3dvui11NfPeHPC
+// BL9cVC6prk4jQPSBj8oYbjSYkFvVaPdQTH44HsigJQiSgr6S5BaAZkzZ4FiLuLy87hgWYkSinGntREBMq3dvui11NfV9eiB
 
 // test06v.wallet - view-only version of test06.wallet
 
@@ -95,32 +98,113 @@ static void test_single_file(const varcoin::Currency &currency, const std::strin
 	test_body(currency, "test_wallet_file.tmp", password, addresses, view_only);
 }
 
+// Addresses are appended in place, records written without count in header (crash) must be dropped on load
+static void test_append_addresses(const std::string &path, const std::string &password) {
+	platform::copy_file("test_wallet_file.tmp", path);
+	size_t was_count = 0;
+	std::vector<varcoin::WalletRecord> created;
+	{
+		varcoin::Wallet wallet("test_wallet_file.tmp", password);
+		was_count = wallet.get_records().size();
+		created   = wallet.generate_new_addresses(std::vector<crypto::SecretKey>(5), 0);
+		created.push_back(wallet.generate_new_addresses({crypto::SecretKey{}}, 0).at(0));
+	}
+	{
+		varcoin::Wallet wallet("test_wallet_file.tmp", password);
+		if (wallet.get_records().size() != was_count + created.size())
+			throw std::runtime_error("appended records count wrong for " + path);
+		for (auto &&rec : created) {
+			auto rit = wallet.get_records().find(rec.spend_public_key);
+			if (rit == wallet.get_records().end() || rit->second != rec)
+				throw std::runtime_error("appended record not found for " + path);
+		}
+	}
+	{
+		platform::FileStream fs("test_wallet_file.tmp", platform::FileStream::READ_WRITE_EXISTING);
+		fs.seek(0, SEEK_END);
+		std::vector<uint8_t> garbage(3 * (varcoin::Wallet::wallet_file_size(1) - varcoin::Wallet::wallet_file_size(0)));
+		fs.write(garbage.data(), garbage.size());
+	}
+	varcoin::Wallet wallet("test_wallet_file.tmp", password);
+	if (wallet.get_records().size() != was_count + created.size())
+		throw std::runtime_error("records without count were not dropped for " + path);
+	platform::FileStream fs("test_wallet_file.tmp", platform::FileStream::READ_EXISTING);
+	if (fs.seek(0, SEEK_END) != varcoin::Wallet::wallet_file_size(was_count + created.size()))
+		throw std::runtime_error("records without count were not truncated for " + path);
+}
+
+// History records are appended to single file, later record for the same tid wins, torn record is dropped on load
+static void test_history(const std::string &path, const std::string &password) {
+	platform::copy_file("test_wallet_file.tmp", path);
+	const std::string history_path = "test_wallet_file.tmp.history/history.bin";
+	std::remove(history_path.c_str());
+	varcoin::Wallet::History history;
+	for (size_t i = 0; i != 3; ++i) {
+		varcoin::AccountPublicAddress address;
+		address.view_public_key  = crypto::rand<crypto::PublicKey>();
+		address.spend_public_key = crypto::rand<crypto::PublicKey>();
+		history.insert(address);
+	}
+	const crypto::Hash tid1 = crypto::rand<crypto::Hash>();
+	const crypto::Hash tid2 = crypto::rand<crypto::Hash>();
+	uint64_t history_size   = 0;
+	{
+		varcoin::Wallet wallet("test_wallet_file.tmp", password);
+		if (wallet.get_history_path() != history_path || !wallet.save_history(tid1, varcoin::Wallet::History{}) ||
+		    !wallet.save_history(tid2, history) || !wallet.save_history(tid1, history))
+			throw std::runtime_error("save_history failed for " + path);
+		platform::FileStream fs(history_path, platform::FileStream::READ_WRITE_EXISTING);
+		history_size = fs.seek(0, SEEK_END);
+		const uint8_t garbage[40]{};
+		fs.write(garbage, sizeof(garbage));
+	}
+	{
+		varcoin::Wallet wallet("test_wallet_file.tmp", password);
+		if (wallet.load_history(tid1) != history || wallet.load_history(tid2) != history ||
+		    !wallet.load_history(crypto::rand<crypto::Hash>()).empty())
+			throw std::runtime_error("load_history returned wrong addresses for " + path);
+		std::set<crypto::Hash> tids;  // superseded record for tid1 must be skipped
+		wallet.for_each_history([&](const crypto::Hash &tid, const varcoin::Wallet::History &used_addresses) {
+			if ((tid != tid1 && tid != tid2) || used_addresses != history || !tids.insert(tid).second)
+				throw std::runtime_error("for_each_history returned wrong record for " + path);
+		});
+		platform::FileStream fs(history_path, platform::FileStream::READ_EXISTING);
+		if (tids.size() != 2 || fs.seek(0, SEEK_END) != history_size)
+			throw std::runtime_error("torn history record was not dropped for " + path);
+	}
+	std::remove(history_path.c_str());
+	std::remove("test_wallet_file.tmp.history");
+}
+
 void test_wallet_file(const std::string &path_prefix) {
 	varcoin::Currency currency(false);
 
 	test_single_file(currency, path_prefix + "/test01.simplewallet.wallet", "",
-	    {"24xTx43fFtNBUn5f6Fj1wC7y8JsbD4N1XS2s3Q8HzWxtfvERccTPX6e5ua1mf55Wm7Z4MiaWT7LPeiBxPtD8kU9V7z3kuex"}, false);
+	    {"BGXTiT5nhbpBUn5f6Fj1wC7y8JsbD4N1XS2s3Q8HzWxtfvERccTPX6e5ua1mf55Wm7Z4MiaWT7LPeiBxPtD8kU9V7uAEWuu"}, false);
 	test_single_file(currency, path_prefix + "/test02.wallet", "",
-	    {"25HYsSBvERcePEb7LWrECYiPw4vpeG3MWCBxB3LbNC43issv7LEDp8gat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDb8W8dk",
-	        "29gEx3NRgooBHLdzQUGicXBtMdAtHaaDtf6aGZjbsgJrCSFVaRCT9SYat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDZriJ8Y",
-	        "23acTzmNBWFSDK12QNVucEdjRjTwPmXHsPwyXaYtc1yP9FviK5e5bMiat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDaQapEx"},
+	    {"BGrYdqE3g94ePEb7LWrECYiPw4vpeG3MWCBxB3LbNC43issv7LEDp8gat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDXwLZw5",
+	        "BMFEiSQZ8XFBHLdzQUGicXBtMdAtHaaDtf6aGZjbsgJrCSFVaRCT9SYat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDYjGj6P",
+	        "BF9cEPoVdDhSDK12QNVucEdjRjTwPmXHsPwyXaYtc1yP9FviK5e5bMiat9CRkq1ZusM85yZA6y2gTBfdUpJwyJKdDdduAFG"},
 	    false);
 	test_single_file(currency, path_prefix + "/test03.wallet", "test03",
-	    {"21vbqHu4mDLGyo7Q959fbggLU4Z6cXMfaDpUJuHQSY9b4bRfYGbv9hF4zcz3DBpH1y4kUop2HPKPsNb9WLBYE6U16w1V12t"}, false);
+	    {"BDVbbgwCCvnGyo7Q959fbggLU4Z6cXMfaDpUJuHQSY9b4bRfYGbv9hF4zcz3DBpH1y4kUop2HPKPsNb9WLBYE6U16u5H2DU"}, false);
 	test_single_file(currency, path_prefix + "/test04.wallet", "test04",
-	    {"27TfAw84qKYEktQW9QvV94VkjNnRJuQ9JTrirjbQC5ASdRS233RAtENBNEZrGCSjPAFBNBReUsaQ8Jo82GTHLU4xQ28tTWU"}, false);
+	    {"BK2ewLACH2zEktQW9QvV94VkjNnRJuQ9JTrirjbQC5ASdRS233RAtENBNEZrGCSjPAFBNBReUsaQ8Jo82GTHLU4xQ2qPJmW"}, false);
 	test_single_file(currency, path_prefix + "/test05.wallet", "test05",
-	    {"23ryfTTpryt8q3h5NFoMGs4BjM6jGmdQqUrtSuU4nM3oP8CKmXXwu6CcEYrwtUm2rx43LvihFEhKEfDagjQxWoLwDTX6XpC"}, false);
+	    {"BFRyRrVxJhL8q3h5NFoMGs4BjM6jGmdQqUrtSuU4nM3oP8CKmXXwu6CcEYrwtUm2rx43LvihFEhKEfDagjQxWoLwDWzTapn"}, false);
 	test_single_file(currency, path_prefix + "/test05v.wallet", "test05",
-	    {"23ryfTTpryt8q3h5NFoMGs4BjM6jGmdQqUrtSuU4nM3oP8CKmXXwu6CcEYrwtUm2rx43LvihFEhKEfDagjQxWoLwDTX6XpC"}, true);
+	    {"BFRyRrVxJhL8q3h5NFoMGs4BjM6jGmdQqUrtSuU4nM3oP8CKmXXwu6CcEYrwtUm2rx43LvihFEhKEfDagjQxWoLwDWzTapn"}, true);
 	test_single_file(currency, path_prefix + "/test06.wallet", "",
-	    {"27j6TP7du1SWKk4fVQa138VNhy339xa76jEBRajhHYnVeLaLs5HmSkEZ4FiLuLy87hgWYkSinGntREBMq3dvui11NkhsuUJ",
-	        "23kJeyCgzH6JkTJqq1NNjrhXFYrfsUYvw2a9HhiEqVtRXK86HAu3uWWZ4FiLuLy87hgWYkSinGntREBMq3dvui11NiUKftd",
-	        "28acio4hR2cjQPSBj8oYbjSYkFvVaPdQTH44HsigJQiSgr6S5BaAZkzZ4FiLuLy87hgWYkSinGntREBMq3dvui11Ng9YMtq"},
+	    {"BKJ6Dn9mLitWKk4fVQa138VNhy339xa76jEBRajhHYnVeLaLs5HmSkEZ4FiLuLy87hgWYkSinGntREBMq3dvui11NhMqL5d",
+	        "BFKJRNEpRzYJkTJqq1NNjrhXFYrfsUYvw2a9HhiEqVtRXK86HAu3uWWZ4FiLuLy87hgWYkSinGntREBMq3dvui11NfPeHPC",
+	        "BL9cVC6prk4jQPSBj8oYbjSYkFvVaPdQTH44HsigJQiSgr6S5BaAZkzZ4FiLuLy87hgWYkSinGntREBMq3dvui11NfV9eiB"},
 	    false);
 	test_single_file(currency, path_prefix + "/test06v.wallet", "",
-	    {"27j6TP7du1SWKk4fVQa138VNhy339xa76jEBRajhHYnVeLaLs5HmSkEZ4FiLuLy87hgWYkSinGntREBMq3dvui11NkhsuUJ",
-	        "23kJeyCgzH6JkTJqq1NNjrhXFYrfsUYvw2a9HhiEqVtRXK86HAu3uWWZ4FiLuLy87hgWYkSinGntREBMq3dvui11NiUKftd",
-	        "28acio4hR2cjQPSBj8oYbjSYkFvVaPdQTH44HsigJQiSgr6S5BaAZkzZ4FiLuLy87hgWYkSinGntREBMq3dvui11Ng9YMtq"},
+	    {"BKJ6Dn9mLitWKk4fVQa138VNhy339xa76jEBRajhHYnVeLaLs5HmSkEZ4FiLuLy87hgWYkSinGntREBMq3dvui11NhMqL5d",
+	        "BFKJRNEpRzYJkTJqq1NNjrhXFYrfsUYvw2a9HhiEqVtRXK86HAu3uWWZ4FiLuLy87hgWYkSinGntREBMq3dvui11NfPeHPC",
+	        "BL9cVC6prk4jQPSBj8oYbjSYkFvVaPdQTH44HsigJQiSgr6S5BaAZkzZ4FiLuLy87hgWYkSinGntREBMq3dvui11NfV9eiB"},
 	    true);
+	test_append_addresses(path_prefix + "/test05.wallet", "test05");
+	test_append_addresses(path_prefix + "/test06.wallet", "");
+	test_history(path_prefix + "/test05.wallet", "test05");
 }